@@ -0,0 +1,199 @@
+#include "app.hpp"
+#include "broadphase.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// microbenchmark: finding overlapping pairs among moving objects with a
+// brute-force pair loop and with `SweepAndPrune` (sorting 1 and 3 axes)
+//
+// the objects are `ak_fps`-style enemies (unit spheres), wandering around its
+// arena. The arena is scaled up with the number of enemies, so that they're
+// as densely packed as in `ak_fps`. Each broadphase's pairs are checked
+// against the brute-force loop's, and its events against its pairs
+
+namespace {
+    constexpr size_t g_NumFrames = 60;
+
+    // `ak_fps`'s arena: 11x11x11 enemies, spaced 6 apart in X/Z and 12 in Y
+    constexpr size_t g_ArenaEnemies = 1331;
+    constexpr glm::vec3 g_ArenaMin{-30.0f, -10.0f, -30.0f};
+    constexpr glm::vec3 g_ArenaMax{30.0f, 110.0f, 30.0f};
+
+    constexpr float g_EnemyRadius = 1.0f;
+    constexpr float g_EnemySpeed = 0.1f;  // per frame
+
+    double nsSince(std::chrono::steady_clock::time_point t0) {
+        auto t1 = std::chrono::steady_clock::now();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+
+    struct Arena final {
+        glm::vec3 min;
+        glm::vec3 max;
+        std::vector<glm::vec3> positions;
+        std::vector<glm::vec3> velocities;
+        std::vector<gp::AABB> aabbs;
+
+        Arena(std::default_random_engine& rng, size_t n) {
+            float scale = std::cbrt(static_cast<float>(n) / static_cast<float>(g_ArenaEnemies));
+            glm::vec3 center = 0.5f * (g_ArenaMin + g_ArenaMax);
+            min = center + scale * (g_ArenaMin - center);
+            max = center + scale * (g_ArenaMax - center);
+
+            std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+            std::uniform_real_distribution<float> dir{-1.0f, 1.0f};
+            for (size_t i = 0; i < n; ++i) {
+                positions.push_back(min + (max - min) * glm::vec3{unit(rng), unit(rng), unit(rng)});
+                velocities.push_back(g_EnemySpeed * glm::normalize(glm::vec3{dir(rng), dir(rng), dir(rng)}));
+            }
+            updateAABBs();
+        }
+
+        // moves each enemy, bouncing it off the arena's walls
+        void step() {
+            for (size_t i = 0; i < positions.size(); ++i) {
+                glm::vec3& p = positions[i];
+                glm::vec3& v = velocities[i];
+                p += v;
+                for (int axis = 0; axis < 3; ++axis) {
+                    if (p[axis] < min[axis] || p[axis] > max[axis]) {
+                        v[axis] = -v[axis];
+                    }
+                }
+            }
+            updateAABBs();
+        }
+
+        void updateAABBs() {
+            aabbs.clear();
+            for (glm::vec3 const& p : positions) {
+                aabbs.push_back(gp::sphereAABB(gp::Sphere{p, g_EnemyRadius}));
+            }
+        }
+    };
+
+    void bruteForcePairs(std::vector<gp::AABB> const& aabbs, std::vector<gp::OverlapPair>& out) {
+        out.clear();
+        for (uint32_t a = 0; a < aabbs.size(); ++a) {
+            for (uint32_t b = a + 1; b < aabbs.size(); ++b) {
+                if (gp::aabbsIntersect(aabbs[a], aabbs[b])) {
+                    out.push_back(gp::OverlapPair{a, b});
+                }
+            }
+        }
+    }
+
+    // applies `events` to `pairs` (sorted): returns false if an event doesn't
+    // make sense (e.g. a `Begin` for a pair that's already overlapping)
+    bool applyEvents(std::vector<gp::OverlapEvent> const& events, std::vector<gp::OverlapPair>& pairs) {
+        for (gp::OverlapEvent const& e : events) {
+            auto it = std::lower_bound(pairs.begin(), pairs.end(), e.pair);
+            bool present = it != pairs.end() && *it == e.pair;
+            if (e.type == gp::OverlapEventType::Begin) {
+                if (present) {
+                    return false;
+                }
+                pairs.insert(it, e.pair);
+            } else {
+                if (!present) {
+                    return false;
+                }
+                pairs.erase(it);
+            }
+        }
+        return true;
+    }
+
+    void bench(std::default_random_engine& rng, size_t n) {
+        // the brute-force loop is O(n^2), so big runs only time + check it on
+        // some frames
+        size_t checkEvery = n > 20000 ? 20 : 1;
+
+        Arena arena{rng, n};
+
+        gp::SweepAndPruneParams oneAxis;
+        oneAxis.numAxes = 1;
+        gp::SweepAndPrune sap1{oneAxis};
+        gp::SweepAndPrune sap3;
+
+        struct Row final {
+            char const* label;
+            gp::SweepAndPrune* sap;
+            double ns = 0.0;
+            uint64_t swaps = 0;
+            size_t numEvents = 0;
+            size_t numMismatches = 0;
+            std::vector<gp::OverlapPair> tracked;
+        };
+        Row rows[] = {{"sap 1 axis", &sap1, 0.0, 0, 0, 0, {}}, {"sap 3 axes", &sap3, 0.0, 0, 0, 0, {}}};
+
+        double bruteNs = 0.0;
+        size_t bruteFrames = 0;
+        size_t numPairs = 0;
+        std::vector<gp::OverlapPair> expected;
+        std::vector<gp::OverlapPair> got;
+        std::vector<gp::OverlapEvent> events;
+
+        for (size_t frame = 0; frame <= g_NumFrames; ++frame) {
+            arena.step();
+
+            bool check = frame % checkEvery == 0;
+            if (check) {
+                auto t0 = std::chrono::steady_clock::now();
+                bruteForcePairs(arena.aabbs, expected);
+                bruteNs += nsSince(t0);
+                ++bruteFrames;
+            }
+
+            for (Row& row : rows) {
+                events.clear();
+                auto t0 = std::chrono::steady_clock::now();
+                row.sap->update(arena.aabbs, events);
+                double ns = nsSince(t0);
+
+                // the first update sorts from scratch: only time the
+                // incremental ones
+                if (frame > 0) {
+                    row.ns += ns;
+                    row.swaps += row.sap->stats().numSwaps;
+                    row.numEvents += events.size();
+                }
+
+                row.numMismatches += !applyEvents(events, row.tracked);
+                if (check) {
+                    got.clear();
+                    row.sap->pairs(got);
+                    row.numMismatches += got != expected;
+                    row.numMismatches += row.tracked != expected;
+                }
+            }
+            numPairs = expected.size();
+        }
+
+        double bruteMs = bruteNs / (1e6 * static_cast<double>(bruteFrames));
+        std::printf("n = %6zu  %-10s  %9.3f ms/frame  pairs = %zu\n", n, "brute", bruteMs, numPairs);
+        for (Row const& row : rows) {
+            double ms = row.ns / (1e6 * g_NumFrames);
+            std::printf("n = %6zu  %-10s  %9.3f ms/frame  swaps/frame = %8.0f  events/frame = %6.1f  (%.1fx)%s\n",
+                        n,
+                        row.label,
+                        ms,
+                        static_cast<double>(row.swaps) / g_NumFrames,
+                        static_cast<double>(row.numEvents) / g_NumFrames,
+                        bruteMs / ms,
+                        row.numMismatches == 0 ? "" : "  MISMATCH");
+        }
+    }
+}
+
+int main() {
+    std::default_random_engine rng{1337};
+    for (size_t n : {1000, 10000, 100000}) {
+        bench(rng, n);
+    }
+}
@@ -0,0 +1,524 @@
+#include "app.hpp"
+#include "bvh.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// microbenchmark: BVH build + raycast times for the flattened `gp::BVH` (with
+// midpoint and SAH splits) vs. the pointer-based BVH that `ak_fps` used to
+// build
+//
+// primitives are AABBs scattered in a cube (uniformly, or in clusters), rays
+// are fired from outside the cube at random points in it. Each BVH's closest
+// hits are checked against the pointer-based BVH's
+//
+// the SAH BVH is also used for any-hit and all-hits queries, and collapsed into
+// 4- and 8-wide BVHs (their "build" time is just the collapse)
+//
+// also moves the primitives for a few frames, to compare refitting a BVH with
+// rebuilding it, and rebuilds a BVH over 1M moving spheres every frame with
+// each builder
+
+namespace {
+    constexpr size_t g_NumBuildRuns = 5;
+    constexpr size_t g_NumQueryRuns = 11;
+    constexpr size_t g_NumRays = 10000;
+
+    template<typename F>
+    double medianNs(size_t runs, F f) {
+        std::vector<double> samples;
+        samples.reserve(runs);
+
+        for (size_t run = 0; run < runs; ++run) {
+            auto t0 = std::chrono::steady_clock::now();
+            f();
+            auto t1 = std::chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + samples.size()/2, samples.end());
+        return samples[samples.size()/2];
+    }
+
+    // the BVH `ak_fps` used to build: nodes are bump-allocated in blocks and
+    // linked with pointers, one primitive per leaf
+    namespace legacy {
+        template<typename T>
+        struct TypedBumpAllocator final {
+            using T_mem = std::aligned_storage_t<sizeof(T), alignof(T)>;
+
+            struct Block final {
+                size_t nUsed;
+                std::unique_ptr<T_mem[]> data;
+
+                Block(size_t nPerBlock) : nUsed{0}, data{new T_mem[nPerBlock]} {}
+            };
+
+            std::vector<Block> blocks;
+            size_t nPerBlock;
+            size_t curBlock = 0;
+
+            TypedBumpAllocator(size_t nPerBlock_) : nPerBlock{nPerBlock_} {
+            }
+
+            T* alloc() {
+                if (blocks.empty()) {
+                    blocks.emplace_back(nPerBlock);
+                }
+
+                if (blocks[curBlock].nUsed == nPerBlock) {
+                    curBlock++;
+                    if (curBlock >= blocks.size()) {
+                        blocks.emplace_back(nPerBlock);
+                    }
+                }
+
+                Block& b = blocks[curBlock];
+                T* mem = reinterpret_cast<T*>(b.data.get() + b.nUsed);
+                b.nUsed++;
+                return mem;
+            }
+
+            void reset() {
+                for (Block& b : blocks) {
+                    b.nUsed = 0;
+                }
+                curBlock = 0;
+            }
+        };
+
+        struct BuildNode final {
+            gp::AABB bounds;
+            BuildNode* lhs;
+            BuildNode* rhs;
+            int firstPrimOffset;
+            int nPrims;
+        };
+
+        struct PrimitiveInfo final {
+            int id;
+            gp::AABB bounds;
+        };
+
+        struct BVH final {
+            TypedBumpAllocator<BuildNode> treemem{128};
+            std::vector<PrimitiveInfo> prims;
+            BuildNode* root = nullptr;
+        };
+
+        BuildNode* recursiveBuild(BVH& bvh, size_t first, size_t n) {
+            std::vector<PrimitiveInfo>& prims = bvh.prims;
+
+            if (n == 1) {
+                BuildNode* rv = bvh.treemem.alloc();
+                *rv = BuildNode{prims[first].bounds, nullptr, nullptr, static_cast<int>(first), 1};
+                return rv;
+            }
+
+            gp::AABB centroidAABB{{FLT_MAX, FLT_MAX, FLT_MAX}, {-FLT_MAX, -FLT_MAX, -FLT_MAX}};
+            for (size_t i = first, last = first + n; i < last; ++i) {
+                centroidAABB = gp::aabbUnion(centroidAABB, gp::aabbCenter(prims[i].bounds));
+            }
+
+            if (gp::aabbIsEmpty(centroidAABB)) {
+                gp::AABB bounds = prims[first].bounds;
+                for (size_t i = first, last = first + n; i < last; ++i) {
+                    bounds = gp::aabbUnion(bounds, prims[i].bounds);
+                }
+                BuildNode* rv = bvh.treemem.alloc();
+                *rv = BuildNode{bounds, nullptr, nullptr, static_cast<int>(first), static_cast<int>(n)};
+                return rv;
+            }
+
+            auto dim = gp::aabbLongestDimension(centroidAABB);
+            float pMidx2 = centroidAABB.max[dim] + centroidAABB.min[dim];
+            auto it = std::partition(prims.begin() + first, prims.begin() + first + n, [dim, pMidx2](PrimitiveInfo const& pi) {
+                return pi.bounds.max[dim] + pi.bounds.min[dim] < pMidx2;
+            });
+            size_t mid = static_cast<size_t>(std::distance(prims.begin(), it));
+
+            BuildNode* leftNode = recursiveBuild(bvh, first, mid-first);
+            BuildNode* rightNode = recursiveBuild(bvh, mid, (first + n) - mid);
+
+            BuildNode* rv = bvh.treemem.alloc();
+            *rv = BuildNode{gp::aabbUnion(leftNode->bounds, rightNode->bounds), leftNode, rightNode, -1, 0};
+            return rv;
+        }
+
+        void build(BVH& bvh, std::vector<gp::AABB> const& aabbs) {
+            bvh.treemem.reset();
+            bvh.prims.clear();
+            for (size_t i = 0; i < aabbs.size(); ++i) {
+                bvh.prims.push_back(PrimitiveInfo{static_cast<int>(i), aabbs[i]});
+            }
+            bvh.root = recursiveBuild(bvh, 0, bvh.prims.size());
+        }
+
+        void raycastRecursive(BVH const& bvh, gp::Line const& ray, int& hovered, float& closest, gp::BVHQueryStats& stats, BuildNode const* node) {
+            auto [ok1, ignore1, ignore2] = gp::lineIntersectsAABB(node->bounds, ray);
+            (void)ignore1;
+            (void)ignore2;
+            if (!ok1) {
+                return;
+            }
+
+            ++stats.nodesVisited;
+            if (node->nPrims > 0) {
+                for (int i = node->firstPrimOffset, end = node->firstPrimOffset + node->nPrims; i < end; ++i) {
+                    ++stats.primsTested;
+                    PrimitiveInfo const& pi = bvh.prims[static_cast<size_t>(i)];
+                    auto [ok, t0, t1] = gp::lineIntersectsAABB(pi.bounds, ray);
+                    (void)t1;
+                    if (ok && t0 >= 0.0f && t0 < closest) {
+                        hovered = pi.id;
+                        closest = t0;
+                    }
+                }
+            }
+
+            if (node->lhs) {
+                raycastRecursive(bvh, ray, hovered, closest, stats, node->lhs);
+            }
+            if (node->rhs) {
+                raycastRecursive(bvh, ray, hovered, closest, stats, node->rhs);
+            }
+        }
+    }
+
+    // primitive AABBs, in a 200x200x200 cube
+    std::vector<gp::AABB> uniformAABBs(std::default_random_engine& rng, size_t n) {
+        std::uniform_real_distribution<float> posDist{-100.0f, 100.0f};
+        std::uniform_real_distribution<float> sizeDist{0.1f, 1.0f};
+
+        std::vector<gp::AABB> rv;
+        rv.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            glm::vec3 pos{posDist(rng), posDist(rng), posDist(rng)};
+            rv.push_back(gp::AABB{pos - sizeDist(rng), pos + sizeDist(rng)});
+        }
+        return rv;
+    }
+
+    // primitive AABBs, in a few dense clusters in the same cube, which is
+    // where midpoint splits do badly
+    std::vector<gp::AABB> clusteredAABBs(std::default_random_engine& rng, size_t n) {
+        std::uniform_real_distribution<float> posDist{-100.0f, 100.0f};
+        std::uniform_real_distribution<float> sizeDist{0.1f, 1.0f};
+        std::normal_distribution<float> offsetDist{0.0f, 4.0f};
+
+        std::vector<glm::vec3> clusters;
+        for (size_t i = 0; i < 16; ++i) {
+            clusters.emplace_back(posDist(rng), posDist(rng), posDist(rng));
+        }
+
+        std::vector<gp::AABB> rv;
+        rv.reserve(n);
+        for (size_t i = 0; i < n; ++i) {
+            glm::vec3 pos = clusters[i % clusters.size()] + glm::vec3{offsetDist(rng), offsetDist(rng), offsetDist(rng)};
+            rv.push_back(gp::AABB{pos - sizeDist(rng), pos + sizeDist(rng)});
+        }
+        return rv;
+    }
+
+    void printRow(char const* label, size_t n, double buildNs, double queryNs, gp::BVHQueryStats const& stats, size_t numRays, size_t numMismatches) {
+        std::printf("n = %7zu  %-16s  build %8.2f ms  query %7.0f ns/ray  %6.1f nodes/ray  %6.1f prims/ray%s\n",
+                    n,
+                    label,
+                    buildNs / 1e6,
+                    queryNs / static_cast<double>(numRays),
+                    static_cast<double>(stats.nodesVisited) / static_cast<double>(numRays),
+                    static_cast<double>(stats.primsTested) / static_cast<double>(numRays),
+                    numMismatches == 0 ? "" : "  MISMATCH");
+    }
+
+    // times closest-hit queries against `bvh` (binary or wide), and checks
+    // them against `expected`
+    template<typename AnyBVH>
+    void benchQueries(char const* label,
+                      size_t n,
+                      double buildNs,
+                      AnyBVH const& bvh,
+                      std::vector<gp::PrecomputedRay> const& rays,
+                      std::vector<int32_t> const& expected) {
+
+        std::vector<int32_t> hits(rays.size());
+        gp::BVHQueryStats stats;
+        double queryNs = medianNs(g_NumQueryRuns, [&]() {
+            stats = {};
+            for (size_t i = 0; i < rays.size(); ++i) {
+                hits[i] = gp::bvhRaycastAABBs(bvh, rays[i], &stats).index;
+            }
+        });
+
+        size_t numMismatches = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            numMismatches += expected[i] != hits[i];
+        }
+        printRow(label, n, buildNs, queryNs, stats, rays.size(), numMismatches);
+    }
+
+    // times any-hit and all-hits queries against `bvh`, and checks them
+    // against the brute-force hit masks of `arr` (the same AABBs)
+    void benchOtherQueries(size_t n, gp::BVH const& bvh, std::vector<gp::PrecomputedRay> const& rays, gp::AABBArray const& arr) {
+        std::vector<uint64_t> hitMask(gp::hitMaskSize(arr.size()));
+        std::vector<size_t> expectedCounts;
+        for (gp::PrecomputedRay const& ray : rays) {
+            (void)gp::raycastAABBs(ray, arr, hitMask.data());
+            size_t count = 0;
+            for (uint64_t bits : hitMask) {
+                for (; bits; bits &= bits - 1) {
+                    ++count;
+                }
+            }
+            expectedCounts.push_back(count);
+        }
+
+        size_t numMismatches = 0;
+        gp::BVHQueryStats stats;
+        double queryNs = medianNs(g_NumQueryRuns, [&]() {
+            stats = {};
+            numMismatches = 0;
+            for (size_t i = 0; i < rays.size(); ++i) {
+                numMismatches += gp::bvhOccluded(bvh, rays[i], FLT_MAX, &stats) != (expectedCounts[i] > 0);
+            }
+        });
+        printRow("  any hit", n, 0.0, queryNs, stats, rays.size(), numMismatches);
+
+        std::vector<gp::RaycastHit> hits;
+        queryNs = medianNs(g_NumQueryRuns, [&]() {
+            stats = {};
+            numMismatches = 0;
+            for (size_t i = 0; i < rays.size(); ++i) {
+                hits.clear();
+                gp::bvhRaycastAllAABBs(bvh, rays[i], 0.0f, FLT_MAX, hits, &stats);
+                numMismatches += hits.size() != expectedCounts[i];
+            }
+        });
+        printRow("  all hits", n, 0.0, queryNs, stats, rays.size(), numMismatches);
+    }
+
+    // moves primitives around for a few frames, and compares refitting the
+    // BVH (via `gp::DynamicBVH`) against rebuilding it every frame
+    void benchMoving(std::default_random_engine& rng, size_t n, std::vector<gp::PrecomputedRay> const& rays) {
+        constexpr size_t numFrames = 120;
+        constexpr size_t reportEvery = 20;
+
+        std::vector<gp::AABB> aabbs = uniformAABBs(rng, n);
+        std::uniform_real_distribution<float> velDist{-0.5f, 0.5f};
+        std::vector<glm::vec3> velocities;
+        for (size_t i = 0; i < n; ++i) {
+            velocities.emplace_back(velDist(rng), velDist(rng), velDist(rng));
+        }
+
+        gp::DynamicBVHParams params;
+        params.asyncRebuild = false;
+        gp::DynamicBVH dynamic{params};
+        gp::BVH rebuilt;
+        gp::AABBArray arr;
+
+        std::printf("--- moving (n = %zu, rebuild once SAH cost grows %.1fx) ---\n", n, static_cast<double>(params.rebuildThreshold));
+
+        double updateNs = 0.0;
+        double rebuildNs = 0.0;
+        for (size_t frame = 0; frame < numFrames; ++frame) {
+            for (size_t i = 0; i < n; ++i) {
+                aabbs[i].min += velocities[i];
+                aabbs[i].max += velocities[i];
+            }
+
+            auto t0 = std::chrono::steady_clock::now();
+            dynamic.update(aabbs);
+            auto t1 = std::chrono::steady_clock::now();
+            gp::bvhBuild(rebuilt, aabbs, params.build);
+            auto t2 = std::chrono::steady_clock::now();
+            updateNs += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+            rebuildNs += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t2 - t1).count());
+
+            if ((frame+1) % reportEvery != 0) {
+                continue;
+            }
+
+            arr = gp::AABBArray{aabbs};
+            size_t numMismatches = 0;
+            gp::BVHQueryStats dynamicQueries;
+            gp::BVHQueryStats rebuiltQueries;
+            for (gp::PrecomputedRay const& ray : rays) {
+                int32_t expected = gp::raycastAABBs(ray, arr).index;
+                numMismatches += gp::bvhRaycastAABBs(dynamic.bvh(), ray, &dynamicQueries).index != expected;
+                numMismatches += gp::bvhRaycastAABBs(rebuilt, ray, &rebuiltQueries).index != expected;
+            }
+
+            gp::DynamicBVH::Stats stats = dynamic.stats();
+            std::printf("frames %3zu-%3zu  update %7.2f ms/frame  rebuild %7.2f ms/frame  cost ratio %.2f  rebuilds %2llu  nodes/ray %6.1f (rebuilt: %6.1f)%s\n",
+                        frame + 1 - reportEvery,
+                        frame,
+                        updateNs / (1e6 * reportEvery),
+                        rebuildNs / (1e6 * reportEvery),
+                        static_cast<double>(stats.costRatio),
+                        static_cast<unsigned long long>(stats.numRebuilds),
+                        static_cast<double>(dynamicQueries.nodesVisited) / static_cast<double>(rays.size()),
+                        static_cast<double>(rebuiltQueries.nodesVisited) / static_cast<double>(rays.size()),
+                        numMismatches == 0 ? "" : "  MISMATCH");
+            updateNs = 0.0;
+            rebuildNs = 0.0;
+        }
+    }
+
+    // rebuilds a BVH over spheres that all move every frame (e.g. particles)
+    // with each builder
+    void benchMovingSpheres(std::default_random_engine& rng, size_t n, std::vector<gp::PrecomputedRay> const& rays) {
+        constexpr size_t numFrames = 10;
+
+        std::uniform_real_distribution<float> posDist{-100.0f, 100.0f};
+        std::uniform_real_distribution<float> radiusDist{0.1f, 1.0f};
+        std::uniform_real_distribution<float> velDist{-0.5f, 0.5f};
+        std::vector<gp::Sphere> spheres;
+        std::vector<glm::vec3> velocities;
+        for (size_t i = 0; i < n; ++i) {
+            spheres.push_back(gp::Sphere{{posDist(rng), posDist(rng), posDist(rng)}, radiusDist(rng)});
+            velocities.emplace_back(velDist(rng), velDist(rng), velDist(rng));
+        }
+
+        gp::BVHBuildParams morton30;
+        morton30.splitMethod = gp::BVHSplitMethod::Morton;
+        gp::BVHBuildParams morton63 = morton30;
+        morton63.mortonBits = 63;
+        gp::BVHBuildParams midpoint;
+        midpoint.splitMethod = gp::BVHSplitMethod::Midpoint;
+        gp::BVHBuildParams sah;
+
+        std::pair<char const*, gp::BVHBuildParams> configs[] = {
+            {"Morton (30-bit)", morton30},
+            {"Morton (63-bit)", morton63},
+            {"midpoint (MT)", midpoint},
+            {"SAH (MT)", sah},
+        };
+
+        std::printf("--- moving spheres (n = %zu, rebuilt every frame) ---\n", n);
+
+        std::vector<gp::AABB> aabbs(n);
+        std::vector<double> buildNs(std::size(configs));
+        std::vector<gp::BVH> bvhs(std::size(configs));
+        for (size_t frame = 0; frame < numFrames; ++frame) {
+            for (size_t i = 0; i < n; ++i) {
+                spheres[i].origin += velocities[i];
+                aabbs[i] = gp::sphereAABB(spheres[i]);
+            }
+
+            for (size_t c = 0; c < std::size(configs); ++c) {
+                auto t0 = std::chrono::steady_clock::now();
+                gp::bvhBuild(bvhs[c], aabbs, configs[c].second);
+                auto t1 = std::chrono::steady_clock::now();
+                buildNs[c] += static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+            }
+        }
+
+        // check + time queries against the last frame
+        gp::AABBArray arr{aabbs};
+        std::vector<int32_t> expected;
+        for (gp::PrecomputedRay const& ray : rays) {
+            expected.push_back(gp::raycastAABBs(ray, arr).index);
+        }
+
+        for (size_t c = 0; c < std::size(configs); ++c) {
+            benchQueries(configs[c].first, n, buildNs[c] / numFrames, bvhs[c], rays, expected);
+        }
+    }
+
+}
+
+int main() {
+    std::default_random_engine rng{1337};
+    std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+
+    std::vector<gp::Line> rays;
+    for (size_t i = 0; i < g_NumRays; ++i) {
+        glm::vec3 from = 300.0f * glm::normalize(glm::vec3{unit(rng), unit(rng), unit(rng)});
+        glm::vec3 to = 100.0f * glm::vec3{unit(rng), unit(rng), unit(rng)};
+        rays.push_back(gp::Line{from, glm::normalize(to - from)});
+    }
+    std::vector<gp::PrecomputedRay> precomputed(rays.begin(), rays.end());
+
+    gp::BVHBuildParams midpoint;
+    midpoint.splitMethod = gp::BVHSplitMethod::Midpoint;
+    midpoint.numThreads = 1;
+
+    gp::BVHBuildParams sah;
+    sah.numThreads = 1;
+
+    gp::BVHBuildParams sahParallel;
+
+    gp::BVHBuildParams morton;
+    morton.splitMethod = gp::BVHSplitMethod::Morton;
+
+    struct Config final {
+        char const* label;
+        gp::BVHBuildParams params;
+
+        // if true, also collapse the BVH into 4- and 8-wide BVHs
+        bool collapse;
+    };
+
+    Config configs[] = {
+        {"flat midpoint", midpoint, false},
+        {"flat SAH", sah, false},
+        {"flat SAH (MT)", sahParallel, true},
+        {"flat Morton (MT)", morton, false},
+    };
+
+    std::printf("%u hardware threads\n\n", std::thread::hardware_concurrency());
+
+    for (char const* distribution : {"uniform", "clustered"}) {
+        std::printf("--- %s ---\n", distribution);
+
+        for (size_t n : {10000, 100000, 1000000}) {
+            std::vector<gp::AABB> aabbs = distribution[0] == 'u' ? uniformAABBs(rng, n) : clusteredAABBs(rng, n);
+
+            legacy::BVH oldBvh;
+            double oldBuildNs = medianNs(g_NumBuildRuns, [&]() { legacy::build(oldBvh, aabbs); });
+
+            std::vector<int32_t> oldHits(rays.size());
+            gp::BVHQueryStats oldQueries;
+            double oldQueryNs = medianNs(g_NumQueryRuns, [&]() {
+                oldQueries = {};
+                for (size_t i = 0; i < rays.size(); ++i) {
+                    int hovered = -1;
+                    float closest = FLT_MAX;
+                    legacy::raycastRecursive(oldBvh, rays[i], hovered, closest, oldQueries, oldBvh.root);
+                    oldHits[i] = hovered;
+                }
+            });
+            printRow("legacy", n, oldBuildNs, oldQueryNs, oldQueries, rays.size(), 0);
+
+            for (Config const& config : configs) {
+                gp::BVH bvh;
+                double buildNs = medianNs(g_NumBuildRuns, [&]() { gp::bvhBuild(bvh, aabbs, config.params); });
+                benchQueries(config.label, n, buildNs, bvh, precomputed, oldHits);
+
+                if (config.collapse) {
+                    benchOtherQueries(n, bvh, precomputed, gp::AABBArray{aabbs});
+
+                    gp::BVH4 bvh4;
+                    double collapseNs = medianNs(g_NumBuildRuns, [&]() { gp::bvhCollapse(bvh4, bvh); });
+                    benchQueries("  -> BVH4", n, collapseNs, bvh4, precomputed, oldHits);
+
+                    gp::BVH8 bvh8;
+                    collapseNs = medianNs(g_NumBuildRuns, [&]() { gp::bvhCollapse(bvh8, bvh); });
+                    benchQueries("  -> BVH8", n, collapseNs, bvh8, precomputed, oldHits);
+                }
+            }
+            std::printf("\n");
+        }
+    }
+
+    benchMoving(rng, 100000, precomputed);
+    std::printf("\n");
+    benchMovingSpheres(rng, 1000000, precomputed);
+}
@@ -0,0 +1,310 @@
+#include "app.hpp"
+
+#include <SDL.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+// headless check: a fixed-timestep simulation ends up in the same state no
+// matter what rate it's rendered at
+//
+// first, drives `gp::FixedTimestep` the way `App::show` does in
+// fixed-timestep mode (a `float` frame time is advanced, then that many
+// steps are run), for the same wall-time budget at several render rates
+// (and one jittery one), and compares the final simulation states
+// bit-for-bit
+//
+// then, runs the same sim in a headless `gp::App` at each (fixed) render
+// rate, with a screen that counts its updates + interpolation alphas and
+// taps a key/clicks the mouse via synthetic events, to check that each
+// tap/click is seen by exactly one step, whether the frame it lands in
+// runs several catch-up steps or none at all
+//
+// exits non-zero on a mismatch, so it can be run in CI. The `gp::App` part
+// is skipped if a headless app can't be created (e.g. a build without
+// GFXPLAY_USE_EGL, on a machine without a display)
+
+namespace {
+    constexpr double g_StepsPerSecond = 125.0;
+    constexpr int g_MaxCatchUpSteps = 8;
+
+    // 10.5 s is a whole number of frames at each render rate, but not a
+    // whole number of steps: the budget doesn't end on a step boundary,
+    // where float rounding in the summed frame times would decide whether
+    // the last step runs
+    constexpr double g_Budget = 10.5;
+
+    constexpr size_t g_NumParticles = 256;
+    constexpr glm::vec2 g_Gravity{0.0f, -9.81f};
+    constexpr float g_Restitution = 0.9f;
+
+    // particles bouncing around in a unit box
+    struct Sim final {
+        std::vector<glm::vec2> pos;
+        std::vector<glm::vec2> vel;
+        size_t numSteps = 0;
+
+        Sim() {
+            std::default_random_engine rng{1337};
+            std::uniform_real_distribution<float> unit{0.0f, 1.0f};
+            std::uniform_real_distribution<float> speed{-2.0f, 2.0f};
+            for (size_t i = 0; i < g_NumParticles; ++i) {
+                pos.push_back({unit(rng), unit(rng)});
+                vel.push_back({speed(rng), speed(rng)});
+            }
+        }
+
+        void step(float dt) {
+            for (size_t i = 0; i < pos.size(); ++i) {
+                glm::vec2& p = pos[i];
+                glm::vec2& v = vel[i];
+                v += g_Gravity * dt;
+                p += v * dt;
+                for (int axis = 0; axis < 2; ++axis) {
+                    if (p[axis] < 0.0f || p[axis] > 1.0f) {
+                        p[axis] = p[axis] < 0.0f ? -p[axis] : 2.0f - p[axis];
+                        v[axis] = -g_Restitution * v[axis];
+                    }
+                }
+            }
+            ++numSteps;
+        }
+
+        [[nodiscard]] bool sameState(Sim const& other) const {
+            return numSteps == other.numSteps &&
+                   std::memcmp(pos.data(), other.pos.data(), pos.size() * sizeof(glm::vec2)) == 0 &&
+                   std::memcmp(vel.data(), other.vel.data(), vel.size() * sizeof(glm::vec2)) == 0;
+        }
+    };
+
+    // runs the sim over `frameTimes`, and returns it
+    Sim run(std::vector<float> const& frameTimes) {
+        Sim sim;
+        gp::FixedTimestep ts{g_StepsPerSecond, g_MaxCatchUpSteps};
+        float stepDuration = static_cast<float>(ts.stepDuration());
+
+        // (the interpolated state is what a renderer would draw: it's
+        // computed, but it mustn't affect the sim)
+        glm::vec2 drawn{0.0f, 0.0f};
+        for (float dt : frameTimes) {
+            int steps = ts.advance(dt);
+            for (int i = 0; i < steps; ++i) {
+                sim.step(stepDuration);
+            }
+            float alpha = static_cast<float>(ts.alpha());
+            drawn += sim.pos[0] + alpha * stepDuration * sim.vel[0];
+        }
+        std::printf("  (drawn checksum = %g)", static_cast<double>(drawn.x + drawn.y));
+
+        return sim;
+    }
+
+    std::vector<float> fixedRateFrames(int fps) {
+        size_t n = static_cast<size_t>(g_Budget * fps + 0.5);
+        return std::vector<float>(n, 1.0f / static_cast<float>(fps));
+    }
+
+    // ~60 FPS, but each frame is 0.5x-1.5x as long (e.g. vsync misses),
+    // with the last frame trimmed to the budget
+    std::vector<float> jitteryFrames() {
+        std::default_random_engine rng{42};
+        std::uniform_real_distribution<double> scale{0.5, 1.5};
+
+        std::vector<float> rv;
+        double t = 0.0;
+        while (t < g_Budget) {
+            double dt = std::min(scale(rng) / 60.0, g_Budget - t);
+            rv.push_back(static_cast<float>(dt));
+            t += dt;
+        }
+        return rv;
+    }
+
+    // the `gp::App` screen taps this key, and clicks the left mouse button,
+    // every `g_InputPeriod` seconds, for `g_NumInputs` times
+    constexpr SDL_Scancode g_TapKey = SDL_SCANCODE_SPACE;
+    constexpr double g_InputPeriod = 0.5;
+    constexpr int g_NumInputs = 20;
+
+    // what a headless `gp::App` run saw
+    struct AppRun final {
+        Sim sim;
+        int numDraws = 0;
+        float minAlpha = 1.0f;
+        float maxAlpha = 0.0f;
+        bool wrongStepDuration = false;
+        int numKeyPresses = 0;
+        int numKeyReleases = 0;
+        int numClicks = 0;
+    };
+
+    class CheckScreen final : public gp::Screen {
+        AppRun& run;
+        double t = 0.0;
+        int numInputsSent = 0;
+        bool keyIsDown = false;
+        bool mouseWasPressed = false;
+
+        static void pushKey(Uint32 type) {
+            SDL_Event e{};
+            e.type = type;
+            e.key.keysym.scancode = g_TapKey;
+            SDL_PushEvent(&e);
+        }
+
+        static void pushClick() {
+            SDL_Event e{};
+            e.type = SDL_MOUSEBUTTONDOWN;
+            e.button.button = SDL_BUTTON_LEFT;
+            SDL_PushEvent(&e);
+            e.type = SDL_MOUSEBUTTONUP;
+            SDL_PushEvent(&e);
+        }
+
+    public:
+        explicit CheckScreen(AppRun& run_) : run{run_} {
+        }
+
+        void onUpdate() override {
+            gp::Io const& io = gp::App::IO();
+
+            run.sim.step(io.DeltaTime);
+            run.wrongStepDuration = run.wrongStepDuration || io.DeltaTime != static_cast<float>(1.0 / g_StepsPerSecond);
+
+            run.numKeyPresses += io.KeysDownDuration[g_TapKey] == 0.0f;
+            run.numKeyReleases += io.KeysDownDurationPrev[g_TapKey] >= 0.0f && !io.KeysDown[g_TapKey];
+            run.numClicks += io.MousePressed[0] && !mouseWasPressed;
+            mouseWasPressed = io.MousePressed[0];
+        }
+
+        void onDraw() override {
+        }
+
+        // taps the key for exactly one frame (released in the next frame),
+        // and clicks within one frame (pressed + released), so that they're
+        // easy to lose in a frame that runs no steps
+        void onDrawInterpolated(float alpha) override {
+            ++run.numDraws;
+            run.minAlpha = std::min(run.minAlpha, alpha);
+            run.maxAlpha = std::max(run.maxAlpha, alpha);
+
+            t += gp::App::IO().DeltaTime;
+            if (keyIsDown) {
+                pushKey(SDL_KEYUP);
+                keyIsDown = false;
+            } else if (numInputsSent < g_NumInputs && t >= g_InputPeriod * (numInputsSent + 1)) {
+                pushKey(SDL_KEYDOWN);
+                pushClick();
+                keyIsDown = true;
+                ++numInputsSent;
+            }
+        }
+    };
+
+    // runs the sim in a headless `gp::App`, rendered at `fps`, and returns
+    // what it saw
+    std::unique_ptr<AppRun> runApp(int fps) {
+        gp::HeadlessConfig config;
+        config.width = 64;
+        config.height = 64;
+        config.numFrames = static_cast<int>(g_Budget * fps + 0.5);
+        config.deltaTime = 1.0f / static_cast<float>(fps);
+
+        auto rv = std::make_unique<AppRun>();
+        gp::App app{config};
+        app.enableFixedTimestep(g_StepsPerSecond, g_MaxCatchUpSteps);
+        app.show(std::make_unique<CheckScreen>(*rv));
+        return rv;
+    }
+
+    // returns false if any check failed (but true if headless apps can't be
+    // created, so the checks were skipped)
+    bool checkApp(Sim const& reference) {
+        int numFailures = 0;
+        auto check = [&numFailures](bool ok, char const* what) {
+            if (!ok) {
+                std::printf("    FAILED: %s\n", what);
+                ++numFailures;
+            }
+        };
+
+        for (int fps : {30, 60, 144}) {
+            std::unique_ptr<AppRun> run;
+            try {
+                run = runApp(fps);
+            } catch (std::exception const& ex) {
+                std::printf("SKIPPED: cannot run a headless gp::App: %s\n", ex.what());
+                return true;
+            }
+
+            std::printf("gp::App @ %3d FPS  frames = %4d  steps = %zu  alpha = [%.3f, %.3f]  presses/releases/clicks = %d/%d/%d\n",
+                        fps,
+                        run->numDraws,
+                        run->sim.numSteps,
+                        static_cast<double>(run->minAlpha),
+                        static_cast<double>(run->maxAlpha),
+                        run->numKeyPresses,
+                        run->numKeyReleases,
+                        run->numClicks);
+
+            check(run->numDraws == static_cast<int>(g_Budget * fps + 0.5), "the screen wasn't drawn once per frame");
+            check(run->sim.sameState(reference), "the sim's final state differs from the reference");
+            check(!run->wrongStepDuration, "an update didn't see the step duration as its DeltaTime");
+            check(0.0f <= run->minAlpha && run->maxAlpha < 1.0f, "an interpolation alpha was outside [0, 1)");
+            check(run->numKeyPresses == g_NumInputs, "key presses weren't seen by exactly one step each");
+            check(run->numKeyReleases == g_NumInputs, "key releases weren't seen by exactly one step each");
+            check(run->numClicks == g_NumInputs, "mouse clicks weren't seen by exactly one step each");
+        }
+
+        if (numFailures > 0) {
+            std::printf("FAILED: a headless gp::App didn't step the sim, or report input, as expected\n");
+            return false;
+        }
+        std::printf("OK: each headless gp::App stepped the same sim, and each input was seen by exactly one step\n");
+        return true;
+    }
+}
+
+int main(int, char*[]) {
+    struct Case final {
+        char const* label;
+        std::vector<float> frameTimes;
+    };
+    Case cases[] = {
+        {"30 FPS", fixedRateFrames(30)},
+        {"60 FPS", fixedRateFrames(60)},
+        {"144 FPS", fixedRateFrames(144)},
+        {"~60 FPS (jittery)", jitteryFrames()},
+    };
+
+    std::printf("%.0f Hz simulation, %.1f s budget\n", g_StepsPerSecond, g_Budget);
+
+    Sim reference;
+    size_t numMismatches = 0;
+    for (size_t i = 0; i < std::size(cases); ++i) {
+        Case const& c = cases[i];
+        std::printf("%-18s  frames = %5zu", c.label, c.frameTimes.size());
+        Sim sim = run(c.frameTimes);
+        bool same = i == 0 || sim.sameState(reference);
+        std::printf("  steps = %zu  %s\n", sim.numSteps, i == 0 ? "(reference)" : same ? "identical" : "MISMATCH");
+        if (i == 0) {
+            reference = std::move(sim);
+        }
+        numMismatches += !same;
+    }
+
+    if (numMismatches > 0) {
+        std::printf("FAILED: the final state depends on the render rate\n");
+        return 1;
+    }
+    std::printf("OK: the final state is identical at every render rate\n");
+
+    return checkApp(reference) ? 0 : 1;
+}
@@ -1,13 +1,18 @@
 #include "app.hpp"
+#include "bvh.hpp"
+#include "culling.hpp"
 
 #include "gl.hpp"
 #include "gl_extensions.hpp"
+#include "profiler.hpp"
+#include "raycast.hpp"
 #include "runtime_config.hpp"
 
 #include <glm/gtx/norm.hpp>
 #include <imgui.h>
 
 #include <algorithm>
+#include <cmath>
 
 using namespace gp;
 
@@ -114,224 +119,47 @@ namespace ak_fps_cpp {
         }
     };
 
-    // --- BVH stuff ---
-
-    // an extremely basic bump allocator
-    template<typename T>
-    struct TypedBumpAllocator final {
-
-        // raw bytes for storing T /w type punning
-        using T_mem = std::aligned_storage_t<sizeof(T), alignof(T)>;
-
-        // raw byte block containing memory for Ts
-        struct Block final {
-            size_t nUsed;  // number of Ts in the block
-            std::unique_ptr<T_mem[]> data;  // pointer to heap-allocated block head
-
-            // construct a new block by heap-allocating it
-            Block(size_t nPerBlock) : nUsed{0}, data{new T_mem[nPerBlock]} {}
-        };
-
-        std::vector<Block> blocks;  // allocated blocks
-        size_t nPerBlock; // number of Ts that can fit in a newly-allocated block
-        int curBlock = -1;  // current block
-
-        // construct allocator - guaranteed not to allocate
-        TypedBumpAllocator(size_t nPerBlock_) : nPerBlock{nPerBlock_} {
-            GP_ASSERT(nPerBlock > 0);
-        }
-
-        // allocate memory for a T, but don't construct the T
-        T* alloc() {
-            // initial state /w no blocks
-            if (curBlock == -1) {
-                blocks.emplace_back(nPerBlock);
-                curBlock++;
-            }
-
-            // block is full, either advance to the next (empty) block
-            // or allocate a whole new block
-            if (blocks[curBlock].nUsed == nPerBlock) {
-                curBlock++;
-
-                if (curBlock >= blocks.size()) {
-                    blocks.emplace_back(nPerBlock);
-                }
-            }
-
-            Block& b = blocks[curBlock];
-            T* mem = reinterpret_cast<T*>(b.data.get() + b.nUsed);
-            b.nUsed++;
-            return mem;
-        }
-
-        void reset() {
-            for (Block& b : blocks) {
-                b.nUsed = 0;
-            }
-            curBlock = blocks.empty() ? -1 : 0;
-        }
-    };
-
-    // node of a BVH tree (while building)
-    struct BVH_BuildNode final {
-
-        // union of this node with its children/primitives
-        AABB bounds;
-
-        // left-hand node, or `nullptr` if this node is a leaf
-        BVH_BuildNode* lhs;
-
-        // right-hand node, or `nullptr` if this node is a leaf
-        BVH_BuildNode* rhs;
-
-        // offset into primitive info list
-        int firstPrimOffset;
-
-        // number of primitives (if leaf)
-        int nPrims;
-    };
-
-    // info about a primitive
-    struct BVH_PrimitiveInfo final {
-
-        // id into the underlying primitives list
-        //
-        // treat this opaquely - the implementation will use this to
-        // index into their own datastructures
-        int id;
+    // everything `GameScreen` needs to draw a frame
+    //
+    // the screen runs in pipelined mode, so the next update runs while this is
+    // being drawn
+    struct GameSnapshot final : public RenderSnapshot {
+        Euler_perspective_camera camera;
+        std::vector<Enemy> enemies;
 
-        // bounds of the primitive
-        AABB bounds;
-    };
+        // BVH node bounds + their depth in the tree (only if `showBVH`)
+        std::vector<std::pair<AABB, int>> bvhNodes;
 
-    struct BVH final {
-        TypedBumpAllocator<BVH_BuildNode> treemem{128};
-        std::vector<BVH_PrimitiveInfo> prims;
-        BVH_BuildNode* root = nullptr;
+        bool showAABBs;
+        bool showBVH;
+        std::chrono::microseconds raycast_dur;
 
-        void reset() {
-            treemem.reset();
-            prims.resize(0);
-            root = nullptr;
-        }
+        // BVH nodes visited + enemy AABBs tested by the raycast
+        int nodesVisited;
+        int primsTested;
     };
 
-    void BVH_InitLeafNode(BVH_BuildNode* n, int firstPrimOffset, int nPrims, AABB bounds) {
-        GP_ASSERT(firstPrimOffset >= 0);
-        GP_ASSERT(nPrims >= 0);
-
-        n->bounds = bounds;
-        n->lhs = nullptr;
-        n->rhs = nullptr;
-        n->firstPrimOffset = firstPrimOffset;
-        n->nPrims = nPrims;
-    }
-
-    void BVH_InitInternalNode(BVH_BuildNode* n, BVH_BuildNode* lhs, BVH_BuildNode* rhs) {
-        GP_ASSERT(lhs != nullptr);
-        GP_ASSERT(rhs != nullptr);
-
-        n->bounds = aabbUnion(lhs->bounds, rhs->bounds);
-        n->lhs = lhs;
-        n->rhs = rhs;
-        n->firstPrimOffset = -1;
-        n->nPrims = 0;
-    }
-
-    BVH_BuildNode* BVH_RecursiveBuild(BVH& bvh, size_t first, size_t n) {
-        std::vector<BVH_PrimitiveInfo>& prims = bvh.prims;
-
-        if (n == 1) {
-            // recursion bottomed out: init a leaf
-
-            BVH_BuildNode* rv = bvh.treemem.alloc();
-            BVH_InitLeafNode(rv, static_cast<int>(first), 1, prims[first].bounds);
-            return rv;
+    // collects the bounds + depth of every node in the BVH
+    void collectBVHNodes(BVH const& bvh, std::vector<std::pair<AABB, int>>& out) {
+        if (bvh.empty()) {
+            return;
         }
 
-        // else: >1 primitives need to be arranged with internal nodes etc.
-        GP_ASSERT(n > 1);
+        std::vector<std::pair<uint32_t, int>> stack = {{0, 0}};
+        while (!stack.empty()) {
+            auto [idx, depth] = stack.back();
+            stack.pop_back();
 
-        // compute bounding box of primitive centroids
-        AABB centroidAABB{
-            {FLT_MAX, FLT_MAX, FLT_MAX},
-            {-FLT_MAX, -FLT_MAX, -FLT_MAX}
-        };
-        for (size_t i = first, last = first + n; i < last; ++i) {
-            centroidAABB = aabbUnion(centroidAABB, aabbCenter(prims[i].bounds));  // 50 %
-        }
-
-        // edge-case: the bounding box is empty (e.g. because all centroids are
-        // at the same location)
-        //
-        // in this case, return a leaf node
-        if (aabbIsEmpty(centroidAABB)) {
-            AABB bounds{};
-            for (size_t i = first, last = first + n; i < last; ++i) {
-                bounds = aabbUnion(bounds, prims[i].bounds);
+            BVHNode const& node = bvh.nodes[idx];
+            out.emplace_back(node.bounds, depth);
+            if (!node.isLeaf()) {
+                stack.emplace_back(node.offset, depth + 1);
+                stack.emplace_back(idx + 1, depth + 1);
             }
-
-            BVH_BuildNode* rv = bvh.treemem.alloc();
-            BVH_InitLeafNode(rv, first, n, bounds);
-            return rv;
         }
-
-        // else: >1 primitives with not-colocated centroids
-        GP_ASSERT(n > 1 && !aabbIsEmpty(centroidAABB));
-
-        // as a heuristic, partition along the midpoint of the longest
-        // dimension of the centroid AABB
-
-        auto dim = aabbLongestDimension(centroidAABB);
-        float pMidx2 = centroidAABB.max[dim] + centroidAABB.min[dim];
-
-        auto isBelowMidpoint = [dim, pMidx2](BVH_PrimitiveInfo const& pi) {
-            float pi_pMidx2 = pi.bounds.max[dim] + pi.bounds.min[dim];
-            return pi_pMidx2 < pMidx2;
-        };
-
-        auto it = std::partition(prims.begin() + first, prims.begin() + first + n, isBelowMidpoint);
-        size_t mid = std::distance(prims.begin(), it);
-
-        // we now have two nonempty partitions
-        //
-        // [first, mid) : everything that has a centroid to the left of the midpoint
-        // [mid, n) : everything that has a centroid to the right of the midpoint
-        GP_ASSERT(mid != first);
-        GP_ASSERT(mid != first + n);
-        GP_ASSERT(first < mid && mid < first + n);
-
-        // recurse into the partitions
-
-        BVH_BuildNode* leftNode = BVH_RecursiveBuild(bvh, first, mid-first);
-        BVH_BuildNode* rightNode = BVH_RecursiveBuild(bvh, mid, (first + n) - mid);
-
-        BVH_BuildNode* rv = bvh.treemem.alloc();
-        BVH_InitInternalNode(rv, leftNode, rightNode);
-        return rv;
     }
 
-    void BVH_Build(BVH& bvh, Enemy const* enemies, size_t n) {
-        bvh.reset();
-
-        bvh.prims.reserve(n);
-        for (size_t i = 0; i < n; ++i) {
-            Sphere enemySphere;
-            enemySphere.origin = enemies[i].pos;
-            enemySphere.radius = 1.0f;
-            AABB enemyAABB = sphereAABB(enemySphere);
-
-            BVH_PrimitiveInfo pi;
-            pi.id = static_cast<int>(i);
-            pi.bounds = enemyAABB;
-            bvh.prims.push_back(pi);
-        }
-
-        bvh.root = BVH_RecursiveBuild(bvh, 0, bvh.prims.size());
-    }
-
-    struct GameScreen final : public Screen {
+    struct GameScreen final : public PipelinedScreen {
         Shader shader;
 
         static gl::Vertex_array makePlainVertVAO(Shader& shader, gl::Array_buffer<PlainVert>& vbo) {
@@ -382,8 +210,10 @@ namespace ak_fps_cpp {
         // if true, draw BVH wireframes in scene
         bool showBVH = false;
 
-        // BVH (for rendering)
-        std::unique_ptr<BVH> bvh = nullptr;
+        // (update thread) enemy bounds, and a BVH over them that's refitted
+        // when they move
+        std::vector<AABB> enemyBounds;
+        DynamicBVH enemyBVH;
 
         std::vector<Enemy> enemies = []() {
             constexpr int min = -30;
@@ -405,9 +235,13 @@ namespace ak_fps_cpp {
 
         std::chrono::microseconds raycast_dur{0};
 
-        glm::mat4 enemyModelMtx(size_t i) {
-            return glm::translate(glm::mat4{1.0f}, enemies[i].pos);
-        }
+        // (update thread) enemy AABBs, reused between raycasts
+        AABBArray enemyAABBs;
+
+        // (draw thread) enemy bounding spheres + indices of the enemies that
+        // survive frustum culling, reused between frames
+        SphereArray enemySpheres;
+        std::vector<uint32_t> visibleEnemies;
 
         void onMount() override {
             ImGuiInit();
@@ -429,36 +263,9 @@ namespace ak_fps_cpp {
             }
         }
 
-        int nqueries = 0;
-
-        void handleCollisionsRecursive(Line const& ray, int& hovered, float& closest, BVH_BuildNode* node) {
-            auto [ok1, ignore1, ignore2] = lineIntersectsAABB(node->bounds, ray);
-            if (!ok1) {
-                return;
-            }
-
-            ++nqueries;
-            if (node->nPrims > 0) {
-                // it's a leaf node
-                for (int i = node->firstPrimOffset, end = node->firstPrimOffset + node->nPrims; i < end; ++i) {
-                    BVH_PrimitiveInfo const& pi = bvh->prims[i];
-                    auto [ok, t0, t1] = lineIntersectsAABB(pi.bounds, ray);
-                    if (ok && t0 < closest) {
-                        hovered = pi.id;
-                        closest = t0;
-                    }
-                }
-            }
-
-            if (node->lhs) {
-                // it's an internal node, so recurse
-                handleCollisionsRecursive(ray, hovered, closest, node->lhs);
-            }
-
-            if (node->rhs) {
-                handleCollisionsRecursive(ray, hovered, closest, node->rhs);
-            }
-        }
+        // (update thread) work done by the last raycast
+        int nodesVisited = 0;
+        int primsTested = 0;
 
         void onUpdate() override {
             camera.onUpdate(10.0f, 0.001f);
@@ -467,48 +274,41 @@ namespace ak_fps_cpp {
             ray.o = camera.pos;
             ray.d = camera.front();
 
-            int hovered_enemy = -1;
-            float closest = FLT_MAX;
-
-            if (!bvh) {
-                bvh.reset(new BVH);
+            enemyBounds.clear();
+            for (Enemy& e : enemies) {
+                e.is_hovered = false;  // set true after raytest is done
+                enemyBounds.push_back(sphereAABB(Sphere{e.pos, cubeBoundingSphere.radius}));
             }
 
-            BVH_Build(*bvh, enemies.data(), enemies.size());
+            {
+                GP_PROFILE_SCOPE("BVH update");
+                enemyBVH.update(enemyBounds);
+            }
 
-            // build a BVH
             auto tbegin = std::chrono::high_resolution_clock::now();
+            GP_PROFILE_SCOPE("raycast");
 
-            bool useBvh = !true;
+            RaycastHit hit;
+            bool useBvh = true;
             if (useBvh) {
-
                 // traverse the BVH to find collisions
-                nqueries = 0;
-                handleCollisionsRecursive(ray, hovered_enemy, closest, bvh->root);
-
-                for (size_t i = 0; i < enemies.size(); ++i) {
-                    enemies[i].is_hovered = static_cast<int>(i) == hovered_enemy;
-                }
+                BVHQueryStats stats;
+                hit = bvhRaycastAABBs(enemyBVH.bvh(), PrecomputedRay{ray}, &stats);
+                nodesVisited = static_cast<int>(stats.nodesVisited);
+                primsTested = static_cast<int>(stats.primsTested);
             } else {
-                for (size_t i = 0; i < enemies.size(); ++i) {
-                    Enemy& e = enemies[i];
-                    e.is_hovered = false;  // set true after raytest is done
-
-                    Sphere s;
-                    s.origin = e.pos;
-                    s.radius = cubeBoundingSphere.radius;
-
-                    AABB aabb = sphereAABB(s);
-
-                    auto [ok, t0, t1] = lineIntersectsAABB(aabb, ray);
-                    if (ok && t0 >= 0.0f && t0 < closest) {
-                        hovered_enemy = static_cast<int>(i);
-                        closest = t0;
-                    }
-                }
-                if (hovered_enemy >= 0) {
-                    enemies[static_cast<size_t>(hovered_enemy)].is_hovered = true;
+                enemyAABBs.clear();
+                enemyAABBs.reserve(enemyBounds.size());
+                for (AABB const& aabb : enemyBounds) {
+                    enemyAABBs.push_back(aabb);
                 }
+                hit = raycastAABBs(PrecomputedRay{ray}, enemyAABBs);
+                nodesVisited = 0;
+                primsTested = static_cast<int>(enemyAABBs.size());
+            }
+
+            if (hit.hit()) {
+                enemies[static_cast<size_t>(hit.index)].is_hovered = true;
             }
 
             auto tend = std::chrono::high_resolution_clock::now();
@@ -517,33 +317,53 @@ namespace ak_fps_cpp {
             raycast_dur = dt_casted;
         }
 
-        void recurse(BVH_BuildNode* cur, glm::vec4 color) {
-            glm::vec3 halfWidths = aabbDimensions(cur->bounds) / 2.0f;
-            glm::vec3 center = aabbCenter(cur->bounds);
-
-            glm::mat4 scaler = glm::scale(glm::mat4{1.0f}, halfWidths);
-            glm::mat4 mover = glm::translate(glm::mat4{1.0f}, center);
-            glm::mat4 modelMtx = mover * scaler;
+        std::unique_ptr<GameSnapshot> makeSnapshot() const {
+            auto rv = std::make_unique<GameSnapshot>();
+            rv->camera = camera;
+            rv->enemies = enemies;
+            if (showBVH) {
+                collectBVHNodes(enemyBVH.bvh(), rv->bvhNodes);
+            }
+            rv->showAABBs = showAABBs;
+            rv->showBVH = showBVH;
+            rv->raycast_dur = raycast_dur;
+            rv->nodesVisited = nodesVisited;
+            rv->primsTested = primsTested;
+            return rv;
+        }
 
-            gl::Uniform(shader.uColor, color);
-            gl::Uniform(shader.uModel, modelMtx);
-            gl::DrawArrays(GL_LINES, 0, cubeWireframeVBO.size());
+        std::unique_ptr<RenderSnapshot> onSnapshot() override {
+            return makeSnapshot();
+        }
 
-            color.r *= 0.9f;
-            if (cur->lhs) {
-                recurse(cur->lhs, color);
-            }
-            if (cur->rhs) {
-                recurse(cur->rhs, color);
-            }
+        void onDrawSnapshot(RenderSnapshot const& snapshot, float) override {
+            drawSnapshot(static_cast<GameSnapshot const&>(snapshot));
         }
 
         void onDraw() override {
+            drawSnapshot(*makeSnapshot());
+        }
+
+        void drawSnapshot(GameSnapshot const& snap) {
             ImGuiNewFrame();
 
+            // frustum cull enemies
+            {
+                GP_PROFILE_SCOPE("frustum culling");
+
+                enemySpheres.clear();
+                enemySpheres.reserve(snap.enemies.size());
+                for (Enemy const& e : snap.enemies) {
+                    enemySpheres.push_back(Sphere{e.pos, cubeBoundingSphere.radius});
+                }
+
+                Frustum frustum = frustumFromCamera(snap.camera, App::cur().aspectRatio());
+                cullSpheres(frustum, enemySpheres, visibleEnemies);
+            }
+
             Line ray;
-            ray.o = camera.pos;
-            ray.d = camera.front();
+            ray.o = snap.camera.pos;
+            ray.d = snap.camera.front();
 
             Disc d;
             d.origin = {0.0f, 0.0f, 0.0f};
@@ -555,23 +375,26 @@ namespace ak_fps_cpp {
             ImGui::SetNextWindowSize(ImVec2{200.0f, 200.0f});
             if (ImGui::Begin("frame")) {
                 ImGui::Text("FPS = %.2f", ImGui::GetIO().Framerate);
-                ImGui::Text("micros = %ld", raycast_dur.count());
-                ImGui::Text("nqueries = %i", nqueries);
-                ImGui::Text("nels = %zu", enemies.size());
+                ImGui::Text("micros = %ld", snap.raycast_dur.count());
+                ImGui::Text("nqueries = %i (%i nodes, %i prims)", snap.nodesVisited + snap.primsTested, snap.nodesVisited, snap.primsTested);
+                ImGui::Text("nels = %zu", snap.enemies.size());
+                ImGui::Text("drawn = %zu", visibleEnemies.size());
                 ImGui::Text("intersects? = %s", res.intersected ? "yes" : "no");
                 ImGui::Text("t = %.2f", res.t);
-                auto p = camera.pos;
+                auto p = snap.camera.pos;
                 ImGui::Text("camera %.2f, %.2f, %.f2", p.x, p.y, p.z);
             }
             ImGui::End();
 
+            ImGuiProfilerPanel();
+
             gl::ClearColor(1.0f, 1.0f, 1.0f, 1.0f);
             gl::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
             gl::UseProgram(shader.prog);
 
-            gl::Uniform(shader.uView, camera.viewMatrix());
-            gl::Uniform(shader.uProjection, camera.projectionMatrix(App::cur().aspectRatio()));
+            gl::Uniform(shader.uView, snap.camera.viewMatrix());
+            gl::Uniform(shader.uProjection, snap.camera.projectionMatrix(App::cur().aspectRatio()));
 
             // draw plane
             if (false) {
@@ -620,23 +443,23 @@ namespace ak_fps_cpp {
             }
 
             gl::BindVertexArray(cubeVAO);
-            for (size_t i = 0; i < enemies.size(); ++i) {
-                if (enemies[i].is_hovered) {
+            for (uint32_t i : visibleEnemies) {
+                if (snap.enemies[i].is_hovered) {
                     gl::Uniform(shader.uColor, {0.0f, 0.0f, 1.0f, 1.0f});
                 } else {
                     gl::Uniform(shader.uColor, {1.0f, 0.0f, 0.0f, 1.0f});
                 }
 
-                gl::Uniform(shader.uModel, enemyModelMtx(i));
+                gl::Uniform(shader.uModel, glm::translate(glm::mat4{1.0f}, snap.enemies[i].pos));
                 gl::DrawArrays(GL_TRIANGLES, 0, cubeVBO.sizei());
             }
 
-            if (showAABBs) {
+            if (snap.showAABBs) {
                 gl::BindVertexArray(cubeWireframeVAO);
                 gl::Uniform(shader.uColor, {1.0f, 0.0f, 0.0f, 1.0f});
 
-                for (size_t i = 0; i < enemies.size(); ++i) {
-                    Enemy const& e = enemies[i];
+                for (uint32_t i : visibleEnemies) {
+                    Enemy const& e = snap.enemies[i];
 
                     Sphere s;
                     s.origin = e.pos;
@@ -651,9 +474,13 @@ namespace ak_fps_cpp {
                 gl::BindVertexArray();
             }
 
-            if (showBVH && bvh != nullptr) {
+            if (snap.showBVH) {
                 gl::BindVertexArray(cubeWireframeVAO);
-                recurse(this->bvh.get()->root, {1.0f, 0.0f, 0.0f, 1.0f});
+                for (auto const& [bounds, depth] : snap.bvhNodes) {
+                    gl::Uniform(shader.uColor, {std::pow(0.9f, static_cast<float>(depth)), 0.0f, 0.0f, 1.0f});
+                    gl::Uniform(shader.uModel, cubeToAABBXform(bounds));
+                    gl::DrawArrays(GL_LINES, 0, cubeWireframeVBO.size());
+                }
                 gl::BindVertexArray();
             }
 
@@ -673,5 +500,6 @@ namespace ak_fps_cpp {
 int main(int, char*[]) {
     App app;
     app.enableRelativeMouseMode();
+    app.enablePipelinedMode();
     app.show<ak_fps_cpp::GameScreen>();
 }
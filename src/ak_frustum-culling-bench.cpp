@@ -0,0 +1,132 @@
+#include "app.hpp"
+#include "culling.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// microbenchmark: frustum culling of AABBs and spheres with the scalar and
+// SIMD kernels in `culling.hpp`, and of AABBs through a BVH (`cullBVH`)
+//
+// objects are scattered uniformly in a cube around a camera at the origin,
+// so roughly 1/7th of them are visible. Each kernel's output is checked
+// against the scalar kernel's
+
+namespace {
+    constexpr size_t g_NumRuns = 21;
+
+    template<typename F>
+    double medianNs(F f) {
+        std::vector<double> samples;
+        samples.reserve(g_NumRuns);
+
+        for (size_t run = 0; run < g_NumRuns; ++run) {
+            auto t0 = std::chrono::steady_clock::now();
+            f();
+            auto t1 = std::chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + samples.size()/2, samples.end());
+        return samples[samples.size()/2];
+    }
+
+    std::vector<gp::SimdLevel> supportedLevels() {
+        std::vector<gp::SimdLevel> rv;
+        for (gp::SimdLevel l : {gp::SimdLevel::Scalar, gp::SimdLevel::SSE, gp::SimdLevel::AVX}) {
+            if (l <= gp::bestSimdLevel()) {
+                rv.push_back(l);
+            }
+        }
+        return rv;
+    }
+
+    template<typename Arr, typename Cull>
+    void bench(char const* label, Arr const& arr, Cull cull) {
+        std::vector<uint32_t> expected;
+        std::vector<uint32_t> out(arr.size());
+        double scalarNs = 0.0;
+
+        for (gp::SimdLevel level : supportedLevels()) {
+            size_t n = 0;
+            double ns = medianNs([&]() { n = cull(arr, out.data(), level); });
+
+            std::vector<uint32_t> got(out.begin(), out.begin() + static_cast<ptrdiff_t>(n));
+            if (level == gp::SimdLevel::Scalar) {
+                expected = got;
+                scalarNs = ns;
+            }
+
+            std::printf("%-8s n = %8zu  %-6s  %9.1f us  %6.2f ns/obj  visible = %7zu  (%.1fx)%s\n",
+                        label,
+                        arr.size(),
+                        gp::simdLevelName(level),
+                        ns / 1000.0,
+                        ns / static_cast<double>(arr.size()),
+                        n,
+                        scalarNs / ns,
+                        got == expected ? "" : "  MISMATCH");
+        }
+    }
+
+    // hierarchical culling, checked against the scalar AABB kernel (the BVH
+    // build isn't timed: it's assumed to be amortized over many frames)
+    void benchBVH(gp::Frustum const& frustum, std::vector<gp::AABB> const& aabbs) {
+        gp::AABBArray arr{aabbs};
+        std::vector<uint32_t> expected(arr.size());
+        expected.resize(gp::cullAABBs(frustum, arr, expected.data(), gp::SimdLevel::Scalar));
+
+        gp::BVH bvh;
+        gp::bvhBuild(bvh, aabbs);
+
+        std::vector<uint32_t> got;
+        double ns = medianNs([&]() { gp::cullBVH(frustum, bvh, got); });
+        std::sort(got.begin(), got.end());
+
+        std::printf("%-8s n = %8zu  %-6s  %9.1f us  %6.2f ns/obj  visible = %7zu%s\n",
+                    "AABBs",
+                    aabbs.size(),
+                    "bvh",
+                    ns / 1000.0,
+                    ns / static_cast<double>(aabbs.size()),
+                    got.size(),
+                    got == expected ? "" : "  MISMATCH");
+    }
+}
+
+int main() {
+    gp::Euler_perspective_camera camera;
+    camera.zfar = 500.0f;
+    gp::Frustum frustum = gp::frustumFromCamera(camera, 16.0f/9.0f);
+
+    std::default_random_engine rng{1337};
+    std::uniform_real_distribution<float> posDist{-500.0f, 500.0f};
+    std::uniform_real_distribution<float> sizeDist{0.25f, 2.0f};
+
+    for (size_t n : {10000, 100000, 1000000}) {
+        std::vector<gp::AABB> aabbVec;
+        gp::AABBArray aabbs;
+        gp::SphereArray spheres;
+        aabbVec.reserve(n);
+        aabbs.reserve(n);
+        spheres.reserve(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            glm::vec3 pos{posDist(rng), posDist(rng), posDist(rng)};
+            float r = sizeDist(rng);
+            aabbVec.push_back(gp::AABB{pos - r, pos + r});
+            aabbs.push_back(aabbVec.back());
+            spheres.push_back(gp::Sphere{pos, r});
+        }
+
+        bench("AABBs", aabbs, [&frustum](gp::AABBArray const& a, uint32_t* out, gp::SimdLevel level) {
+            return gp::cullAABBs(frustum, a, out, level);
+        });
+        benchBVH(frustum, aabbVec);
+        bench("spheres", spheres, [&frustum](gp::SphereArray const& s, uint32_t* out, gp::SimdLevel level) {
+            return gp::cullSpheres(frustum, s, out, level);
+        });
+    }
+}
@@ -0,0 +1,97 @@
+#include "app.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <vector>
+
+// microbenchmark: cost of a log call on the calling thread for the printf
+// path vs. the binary (deferred-formatting) path
+//
+// both paths sink into a sink that does nothing, so the printf path measures
+// formatting cost and the binary path measures encoding cost. The binary
+// consumer is flushed between batches (outside of the timed region) so that
+// its buffer never fills up
+
+namespace {
+    struct NullSink final : public gp::log::Sink {
+        size_t n = 0;
+
+        void log(gp::log::Msg const&) override {
+            ++n;
+        }
+    };
+
+    constexpr size_t g_BatchSize = 1000;
+    constexpr size_t g_NumBatches = 1000;
+
+    template<typename F>
+    double nsPerMessage(gp::log::Logger& logger, F f) {
+        std::vector<double> samples;
+        samples.reserve(g_NumBatches);
+
+        for (size_t batch = 0; batch < g_NumBatches; ++batch) {
+            auto t0 = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < g_BatchSize; ++i) {
+                f(logger, i);
+            }
+            auto t1 = std::chrono::steady_clock::now();
+
+            gp::log::binary::flush();
+
+            auto dt = std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0);
+            samples.push_back(static_cast<double>(dt.count()) / g_BatchSize);
+        }
+
+        // median: robust against the occasional batch that gets descheduled
+        std::nth_element(samples.begin(), samples.begin() + samples.size()/2, samples.end());
+        return samples[samples.size()/2];
+    }
+
+    template<typename F>
+    void bench(char const* label, F f) {
+        auto sink = std::make_shared<NullSink>();
+        gp::log::Logger logger{"bench", sink};
+        sink->setLevel(gp::log::level::trace);
+
+        logger.setBinaryMode(false);
+        double printfNs = nsPerMessage(logger, f);
+
+        logger.setBinaryMode(true);
+        double binaryNs = nsPerMessage(logger, f);
+        logger.setBinaryMode(false);
+
+        std::printf("%-24s printf = %7.1f ns/msg    binary = %7.1f ns/msg    (%.1fx)\n",
+                    label, printfNs, binaryNs, printfNs / binaryNs);
+    }
+}
+
+int main() {
+    bench("no args", [](gp::log::Logger& l, size_t) {
+        l.info("frame rendered");
+    });
+
+    bench("2 ints", [](gp::log::Logger& l, size_t i) {
+        l.info("frame %zu took %i ticks", i, static_cast<int>(i * 3));
+    });
+
+    bench("float + string", [](gp::log::Logger& l, size_t i) {
+        l.info("%s: %.3f ms", "raycast", static_cast<double>(i) * 0.001);
+    });
+
+    bench("GL debug message", [](gp::log::Logger& l, size_t i) {
+        l.debug("OpenGL debug message: id = %u, source = %s, type = %s, severity = %s: %s",
+                static_cast<unsigned>(i),
+                "GL_DEBUG_SOURCE_API",
+                "GL_DEBUG_TYPE_PERFORMANCE",
+                "GL_DEBUG_SEVERITY_MEDIUM",
+                "Buffer performance warning: Buffer object 3 (bound to GL_ARRAY_BUFFER_ARB, usage hint is GL_STATIC_DRAW) is being copied/moved from VIDEO memory to HOST memory.");
+    });
+
+    auto stats = gp::log::binary::stats();
+    std::printf("binary records: written = %llu, dropped = %llu, consumed = %llu\n",
+                static_cast<unsigned long long>(stats.written),
+                static_cast<unsigned long long>(stats.dropped),
+                static_cast<unsigned long long>(stats.consumed));
+}
@@ -0,0 +1,46 @@
+#include "app.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+// decodes a binary log file (see `gp::log::binary::writeToFile`) into
+// human-readable text
+//
+// usage: ak_log-decoder [input.bin] [output.txt]
+int main(int argc, char** argv) {
+    std::FILE* in = stdin;
+    std::FILE* out = stdout;
+
+    if (argc > 1 && std::strcmp(argv[1], "-") != 0) {
+        in = std::fopen(argv[1], "rb");
+        if (!in) {
+            std::fprintf(stderr, "%s: cannot open for reading: %s\n", argv[1], std::strerror(errno));
+            return 1;
+        }
+    }
+
+    if (argc > 2) {
+        out = std::fopen(argv[2], "w");
+        if (!out) {
+            std::fprintf(stderr, "%s: cannot open for writing: %s\n", argv[2], std::strerror(errno));
+            return 1;
+        }
+    }
+
+    bool ok = gp::log::binary::decodeFile(in, out);
+
+    if (in != stdin) {
+        std::fclose(in);
+    }
+    if (out != stdout) {
+        std::fclose(out);
+    }
+
+    if (!ok) {
+        std::fprintf(stderr, "error: malformed or truncated binary log\n");
+        return 1;
+    }
+
+    return 0;
+}
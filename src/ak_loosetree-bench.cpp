@@ -0,0 +1,274 @@
+#include "pointtree.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// microbenchmark: keeping a quadtree over moving points up to date each
+// frame by rebuilding a `Quadtree` (one insert at a time, and bulk-built) vs.
+// moving the points in a `LooseQuadtree` (with the default params, and with
+// bigger leaves + loose boxes, which points leave less often)
+//
+// the points are `qtree`'s `Sim_el`s (normally-distributed X, uniform Y, in a
+// 512x512 window), wandering around at up to `g_Speed` pixels per frame and
+// bouncing off the window's edges. Each tree's range and radius query
+// results are checked against a brute-force scan's on some frames. On
+// those frames, some points are also removed from (and then re-inserted
+// into) copies of the loose trees, which are checked after each
+namespace {
+    constexpr size_t g_NumFrames = 60;
+    constexpr size_t g_CheckEvery = 10;
+    constexpr size_t g_NumQueries = 20;
+    constexpr float g_W = 512.0f;
+    constexpr float g_H = 512.0f;
+    constexpr float g_Speed = 0.5f;
+    constexpr float g_QueryHalfExtent = 100.0f;
+    constexpr float g_QueryRadius = 100.0f;
+
+    // (per check) chance that a point is removed from the loose trees
+    constexpr double g_RemoveChance = 0.125;
+
+    double nsSince(std::chrono::steady_clock::time_point t0) {
+        auto t1 = std::chrono::steady_clock::now();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+
+    struct Sim final {
+        gp::Box<2> bounds{glm::vec2{0.0f}, glm::vec2{g_W, g_H}};
+        std::vector<glm::vec2> positions;
+        std::vector<glm::vec2> velocities;
+
+        Sim(std::default_random_engine& rng, size_t n) {
+            std::normal_distribution<float> xDist{g_W/2.0f, 64.0f};
+            std::uniform_real_distribution<float> yDist{0.0f, g_H};
+            std::uniform_real_distribution<float> vDist{-g_Speed, g_Speed};
+            for (size_t i = 0; i < n; ++i) {
+                positions.push_back(glm::vec2{std::clamp(xDist(rng), 0.0f, g_W), yDist(rng)});
+                velocities.push_back(glm::vec2{vDist(rng), vDist(rng)});
+            }
+        }
+
+        void step() {
+            for (size_t i = 0; i < positions.size(); ++i) {
+                glm::vec2& p = positions[i];
+                glm::vec2& v = velocities[i];
+                p += v;
+                for (int axis = 0; axis < 2; ++axis) {
+                    if (p[axis] < bounds.min[axis] || p[axis] > bounds.max[axis]) {
+                        v[axis] = -v[axis];
+                        p[axis] = std::clamp(p[axis], bounds.min[axis], bounds.max[axis]);
+                    }
+                }
+            }
+        }
+    };
+
+    float distance2(glm::vec2 const& a, glm::vec2 const& b) {
+        glm::vec2 d = a - b;
+        return d.x*d.x + d.y*d.y;
+    }
+
+    // a frame's queries (range queries of `boxes`, and radius queries
+    // around their centers), with their brute-force results
+    struct Queries final {
+        std::vector<gp::Box<2>> boxes;
+        std::vector<std::vector<uint32_t>> inRange;
+        std::vector<std::vector<uint32_t>> inRadius;
+    };
+
+    // (re)computes the expected results of `q.boxes`, skipping any points
+    // that are `removed`
+    void bruteQueries(std::vector<glm::vec2> const& ps, std::vector<bool> const& removed, Queries& q) {
+        q.inRange.assign(q.boxes.size(), {});
+        q.inRadius.assign(q.boxes.size(), {});
+        for (size_t i = 0; i < q.boxes.size(); ++i) {
+            glm::vec2 c = 0.5f * (q.boxes[i].min + q.boxes[i].max);
+            for (uint32_t j = 0; j < ps.size(); ++j) {
+                if (removed[j]) {
+                    continue;
+                }
+                if (gp::boxContains(q.boxes[i], ps[j])) {
+                    q.inRange[i].push_back(j);
+                }
+                if (distance2(ps[j], c) <= g_QueryRadius*g_QueryRadius) {
+                    q.inRadius[i].push_back(j);
+                }
+            }
+        }
+    }
+
+    struct Row final {
+        char const* label;
+        double updateNs = 0.0;
+        double rangeNs = 0.0;
+        double radiusNs = 0.0;
+        size_t numMismatches = 0;
+    };
+
+    // runs the queries on a tree, and checks them against the brute-force
+    // results
+    template<typename Tree>
+    void timeQueries(Tree const& tree, Queries const& q, Row& row) {
+        std::vector<uint32_t> got;
+        for (size_t i = 0; i < q.boxes.size(); ++i) {
+            got.clear();
+            auto t0 = std::chrono::steady_clock::now();
+            tree.queryRange(q.boxes[i], got);
+            row.rangeNs += nsSince(t0);
+
+            std::sort(got.begin(), got.end());
+            row.numMismatches += got != q.inRange[i];
+
+            glm::vec2 c = 0.5f * (q.boxes[i].min + q.boxes[i].max);
+            got.clear();
+            t0 = std::chrono::steady_clock::now();
+            tree.queryRadius(c, g_QueryRadius, got);
+            row.radiusNs += nsSince(t0);
+
+            std::sort(got.begin(), got.end());
+            row.numMismatches += got != q.inRadius[i];
+        }
+    }
+
+    // as above, but doesn't add to the row's timings (e.g. for checking a
+    // tree after removals)
+    template<typename Tree>
+    void checkQueries(Tree const& tree, Queries const& q, Row& row) {
+        Row scratch{row.label};
+        timeQueries(tree, q, scratch);
+        row.numMismatches += scratch.numMismatches;
+    }
+
+    // checks `queries` against a copy of `tree` with some of its points
+    // removed, and then re-inserted
+    void checkRemoveReinsert(gp::LooseQuadtree const& tree,
+                             std::vector<uint32_t> const& handles,
+                             std::vector<glm::vec2> const& ps,
+                             Queries& queries,
+                             std::bernoulli_distribution& removeDist,
+                             std::default_random_engine& rng,
+                             Row& row) {
+        gp::LooseQuadtree copy = tree;
+        std::vector<bool> removed(ps.size(), false);
+        for (uint32_t i = 0; i < ps.size(); ++i) {
+            removed[i] = removeDist(rng);
+            if (removed[i]) {
+                copy.remove(handles[i]);
+            }
+        }
+        bruteQueries(ps, removed, queries);
+        checkQueries(copy, queries, row);
+
+        for (uint32_t i = 0; i < ps.size(); ++i) {
+            if (removed[i]) {
+                copy.insert(ps[i], i);
+                removed[i] = false;
+            }
+        }
+        bruteQueries(ps, removed, queries);
+        checkQueries(copy, queries, row);
+    }
+
+    void bench(std::default_random_engine& rng, size_t n) {
+        Sim sim{rng, n};
+
+        gp::Quadtree inserted{sim.bounds};
+        gp::Quadtree bulk{sim.bounds};
+        gp::LooseQuadtree loose{sim.bounds};
+        gp::LooseTreeParams bigParams;
+        bigParams.maxPointsPerLeaf = 32;
+        bigParams.looseness = 3.0f;
+        gp::LooseQuadtree looseBig{sim.bounds, bigParams};
+
+        std::vector<uint32_t> handles;
+        std::vector<uint32_t> bigHandles;
+        for (uint32_t i = 0; i < n; ++i) {
+            handles.push_back(loose.insert(sim.positions[i], i));
+            bigHandles.push_back(looseBig.insert(sim.positions[i], i));
+        }
+
+        Row rows[] = {{"inserted", 0.0, 0.0, 0.0, 0}, {"bulk", 0.0, 0.0, 0.0, 0}, {"loose", 0.0, 0.0, 0.0, 0}, {"loose32", 0.0, 0.0, 0.0, 0}};
+        Row& insertedRow = rows[0];
+        Row& bulkRow = rows[1];
+        Row& looseRow = rows[2];
+        Row& looseBigRow = rows[3];
+
+        std::uniform_real_distribution<float> qDist{0.0f, g_W};
+        std::bernoulli_distribution removeDist{g_RemoveChance};
+        Queries queries;
+        std::vector<bool> const noneRemoved(n, false);
+        size_t numChecks = 0;
+
+        for (size_t frame = 1; frame <= g_NumFrames; ++frame) {
+            sim.step();
+
+            auto t0 = std::chrono::steady_clock::now();
+            inserted.clear();
+            for (uint32_t i = 0; i < n; ++i) {
+                inserted.insert(sim.positions[i], i);
+            }
+            insertedRow.updateNs += nsSince(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            bulk.build(sim.positions);
+            bulkRow.updateNs += nsSince(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < n; ++i) {
+                loose.move(handles[i], sim.positions[i]);
+            }
+            looseRow.updateNs += nsSince(t0);
+
+            t0 = std::chrono::steady_clock::now();
+            for (uint32_t i = 0; i < n; ++i) {
+                looseBig.move(bigHandles[i], sim.positions[i]);
+            }
+            looseBigRow.updateNs += nsSince(t0);
+
+            if (frame % g_CheckEvery != 0) {
+                continue;
+            }
+
+            queries.boxes.clear();
+            for (size_t i = 0; i < g_NumQueries; ++i) {
+                glm::vec2 c{qDist(rng), qDist(rng)};
+                queries.boxes.push_back(gp::Box<2>{c - g_QueryHalfExtent, c + g_QueryHalfExtent});
+            }
+            bruteQueries(sim.positions, noneRemoved, queries);
+            timeQueries(inserted, queries, insertedRow);
+            timeQueries(bulk, queries, bulkRow);
+            timeQueries(loose, queries, looseRow);
+            timeQueries(looseBig, queries, looseBigRow);
+            ++numChecks;
+
+            // remove some points from copies of the loose trees (so that the
+            // timed trees aren't churned), check the queries without them,
+            // then re-insert them (reusing the freed handles) and check again
+            checkRemoveReinsert(loose, handles, sim.positions, queries, removeDist, rng, looseRow);
+            checkRemoveReinsert(looseBig, bigHandles, sim.positions, queries, removeDist, rng, looseBigRow);
+        }
+
+        for (Row const& row : rows) {
+            double updateMs = row.updateNs / (1e6 * g_NumFrames);
+            double numQueries = static_cast<double>(numChecks * g_NumQueries);
+            std::printf("n = %7zu  %-8s  update = %9.3f ms/frame  (%6.1fx)  range = %9.2f us  radius = %9.2f us%s\n",
+                        n,
+                        row.label,
+                        updateMs,
+                        insertedRow.updateNs / row.updateNs,
+                        row.rangeNs / (1e3 * numQueries),
+                        row.radiusNs / (1e3 * numQueries),
+                        row.numMismatches == 0 ? "" : "  MISMATCH");
+        }
+    }
+}
+
+int main() {
+    std::default_random_engine rng{1337};
+    for (size_t n : {1000, 10000, 100000}) {
+        bench(rng, n);
+    }
+}
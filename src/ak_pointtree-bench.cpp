@@ -0,0 +1,259 @@
+#include "pointtree.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// microbenchmark: quadtree/octree builds (one insert at a time vs. bulk
+// Morton-order builds), and range, radius and k-nearest-neighbour queries on
+// both trees vs. brute-force scans over the same points
+//
+// the 2D points are distributed like `qtree`'s (normally-distributed X,
+// uniform Y, in a 512x512 window) and the queries are about the size of its
+// selection area. The 3D points are uniform in a cube. Each query's results
+// are checked against the brute-force scan's
+
+namespace {
+    constexpr size_t g_NumQueries = 200;
+    constexpr size_t g_K = 8;
+
+    double nsSince(std::chrono::steady_clock::time_point t0) {
+        auto t1 = std::chrono::steady_clock::now();
+        return static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+    }
+
+    template<glm::length_t D>
+    float distance2(glm::vec<D, float> const& a, glm::vec<D, float> const& b) {
+        float rv = 0.0f;
+        for (glm::length_t i = 0; i < D; ++i) {
+            rv += (a[i] - b[i]) * (a[i] - b[i]);
+        }
+        return rv;
+    }
+
+    template<glm::length_t D>
+    void bruteRange(std::vector<glm::vec<D, float>> const& ps, gp::Box<D> const& box, std::vector<uint32_t>& out) {
+        for (uint32_t i = 0; i < ps.size(); ++i) {
+            if (gp::boxContains(box, ps[i])) {
+                out.push_back(i);
+            }
+        }
+    }
+
+    template<glm::length_t D>
+    void bruteRadius(std::vector<glm::vec<D, float>> const& ps, glm::vec<D, float> const& c, float r, std::vector<uint32_t>& out) {
+        for (uint32_t i = 0; i < ps.size(); ++i) {
+            if (distance2(ps[i], c) <= r*r) {
+                out.push_back(i);
+            }
+        }
+    }
+
+    // keeps the k nearest in a max-heap, like the tree does, so that the
+    // comparison is against a reasonable scan rather than a full sort
+    template<glm::length_t D>
+    void bruteNearest(std::vector<glm::vec<D, float>> const& ps, glm::vec<D, float> const& p, size_t k, std::vector<gp::PointTreeNeighbor>& out) {
+        auto less = [](gp::PointTreeNeighbor const& a, gp::PointTreeNeighbor const& b) {
+            return a.distance2 < b.distance2 || (a.distance2 == b.distance2 && a.id < b.id);
+        };
+        for (uint32_t i = 0; i < ps.size(); ++i) {
+            gp::PointTreeNeighbor n{i, distance2(ps[i], p)};
+            if (out.size() < k) {
+                out.push_back(n);
+                std::push_heap(out.begin(), out.end(), less);
+            } else if (less(n, out.front())) {
+                std::pop_heap(out.begin(), out.end(), less);
+                out.back() = n;
+                std::push_heap(out.begin(), out.end(), less);
+            }
+        }
+        std::sort_heap(out.begin(), out.end(), less);
+    }
+
+    // range + radius results are unordered, so they're sorted before being
+    // compared
+    bool sameResults(std::vector<uint32_t>& got, std::vector<uint32_t> const& expected) {
+        std::sort(got.begin(), got.end());
+        return got == expected;
+    }
+
+    bool sameResults(std::vector<gp::PointTreeNeighbor> const& got, std::vector<gp::PointTreeNeighbor> const& expected) {
+        if (got.size() != expected.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < got.size(); ++i) {
+            if (got[i].id != expected[i].id || got[i].distance2 != expected[i].distance2) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    struct Timings final {
+        double inserted = 0.0;
+        double bulk = 0.0;
+        double brute = 0.0;
+        size_t results = 0;
+        size_t mismatches = 0;
+    };
+
+    void print(char const* dims, size_t n, char const* query, Timings const& t) {
+        double insertedUs = t.inserted / (1e3 * g_NumQueries);
+        double bulkUs = t.bulk / (1e3 * g_NumQueries);
+        double bruteUs = t.brute / (1e3 * g_NumQueries);
+        std::printf("%s  n = %7zu  %-7s  inserted = %9.2f us  bulk = %9.2f us  brute = %9.2f us  (%6.1fx)  results/query = %8.1f%s\n",
+                    dims,
+                    n,
+                    query,
+                    insertedUs,
+                    bulkUs,
+                    bruteUs,
+                    bruteUs / bulkUs,
+                    static_cast<double>(t.results) / g_NumQueries,
+                    t.mismatches == 0 ? "" : "  MISMATCH");
+    }
+
+    // runs `query(tree, out)` on both trees, and checks them against the
+    // brute-force results
+    template<typename Tree, typename Result, typename Query>
+    void timeTrees(Tree const& inserted, Tree const& bulk, std::vector<Result> const& expected, std::vector<Result>& got, Timings& t, Query query) {
+        got.clear();
+        auto t0 = std::chrono::steady_clock::now();
+        query(inserted, got);
+        t.inserted += nsSince(t0);
+        t.mismatches += !sameResults(got, expected);
+
+        got.clear();
+        t0 = std::chrono::steady_clock::now();
+        query(bulk, got);
+        t.bulk += nsSince(t0);
+        t.mismatches += !sameResults(got, expected);
+
+        t.results += got.size();
+    }
+
+    template<glm::length_t D>
+    void bench(char const* dims,
+               gp::Box<D> const& bounds,
+               std::vector<glm::vec<D, float>> const& ps,
+               std::vector<glm::vec<D, float>> const& queryPoints,
+               float halfExtent,
+               float radius) {
+
+        size_t n = ps.size();
+
+        auto t0 = std::chrono::steady_clock::now();
+        gp::PointTree<D> inserted{bounds};
+        for (uint32_t i = 0; i < n; ++i) {
+            inserted.insert(ps[i], i);
+        }
+        double insertMs = nsSince(t0) / 1e6;
+
+        t0 = std::chrono::steady_clock::now();
+        gp::PointTree<D> bulk{bounds};
+        bulk.build(ps);
+        double bulkMs = nsSince(t0) / 1e6;
+
+        std::printf("%s  n = %7zu  build    inserted = %9.2f ms  bulk = %9.2f ms  (%6.1fx)  nodes = %zu / %zu\n",
+                    dims,
+                    n,
+                    insertMs,
+                    bulkMs,
+                    insertMs / bulkMs,
+                    inserted.nodes().size(),
+                    bulk.nodes().size());
+
+        std::vector<uint32_t> got;
+        std::vector<uint32_t> expected;
+
+        Timings range;
+        for (glm::vec<D, float> const& q : queryPoints) {
+            gp::Box<D> box{q - halfExtent, q + halfExtent};
+
+            expected.clear();
+            t0 = std::chrono::steady_clock::now();
+            bruteRange(ps, box, expected);
+            range.brute += nsSince(t0);
+
+            timeTrees(inserted, bulk, expected, got, range, [&box](gp::PointTree<D> const& tree, std::vector<uint32_t>& out) {
+                tree.queryRange(box, out);
+            });
+        }
+        print(dims, n, "range", range);
+
+        Timings radial;
+        for (glm::vec<D, float> const& q : queryPoints) {
+            expected.clear();
+            t0 = std::chrono::steady_clock::now();
+            bruteRadius(ps, q, radius, expected);
+            radial.brute += nsSince(t0);
+
+            timeTrees(inserted, bulk, expected, got, radial, [&q, radius](gp::PointTree<D> const& tree, std::vector<uint32_t>& out) {
+                tree.queryRadius(q, radius, out);
+            });
+        }
+        print(dims, n, "radius", radial);
+
+        std::vector<gp::PointTreeNeighbor> gotNeighbors;
+        std::vector<gp::PointTreeNeighbor> expectedNeighbors;
+        Timings nearest;
+        for (glm::vec<D, float> const& q : queryPoints) {
+            expectedNeighbors.clear();
+            t0 = std::chrono::steady_clock::now();
+            bruteNearest(ps, q, g_K, expectedNeighbors);
+            nearest.brute += nsSince(t0);
+
+            timeTrees(inserted, bulk, expectedNeighbors, gotNeighbors, nearest, [&q](gp::PointTree<D> const& tree, std::vector<gp::PointTreeNeighbor>& out) {
+                tree.queryNearest(q, g_K, out);
+            });
+        }
+        print(dims, n, "nearest", nearest);
+    }
+
+    void bench2D(std::default_random_engine& rng, size_t n) {
+        constexpr float w = 512.0f;
+        constexpr float h = 512.0f;
+
+        std::normal_distribution<float> xDist{w/2.0f, 64.0f};
+        std::uniform_real_distribution<float> yDist{0.0f, h};
+        std::vector<glm::vec2> ps;
+        for (size_t i = 0; i < n; ++i) {
+            ps.push_back(glm::vec2{std::clamp(xDist(rng), 0.0f, w), yDist(rng)});
+        }
+
+        std::uniform_real_distribution<float> qDist{0.0f, w};
+        std::vector<glm::vec2> qs;
+        for (size_t i = 0; i < g_NumQueries; ++i) {
+            qs.push_back(glm::vec2{qDist(rng), qDist(rng)});
+        }
+
+        bench<2>("2D", gp::Box<2>{glm::vec2{0.0f}, glm::vec2{w, h}}, ps, qs, 100.0f, 16.0f);
+    }
+
+    void bench3D(std::default_random_engine& rng, size_t n) {
+        std::uniform_real_distribution<float> dist{-100.0f, 100.0f};
+        std::vector<glm::vec3> ps;
+        for (size_t i = 0; i < n; ++i) {
+            ps.push_back(glm::vec3{dist(rng), dist(rng), dist(rng)});
+        }
+        std::vector<glm::vec3> qs;
+        for (size_t i = 0; i < g_NumQueries; ++i) {
+            qs.push_back(glm::vec3{dist(rng), dist(rng), dist(rng)});
+        }
+
+        bench<3>("3D", gp::Box<3>{glm::vec3{-100.0f}, glm::vec3{100.0f}}, ps, qs, 20.0f, 10.0f);
+    }
+}
+
+int main() {
+    std::default_random_engine rng{1337};
+    for (size_t n : {100, 1000, 10000, 100000, 1000000}) {
+        bench2D(rng, n);
+    }
+    for (size_t n : {100, 1000, 10000, 100000, 1000000}) {
+        bench3D(rng, n);
+    }
+}
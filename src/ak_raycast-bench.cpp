@@ -0,0 +1,151 @@
+#include "app.hpp"
+#include "raycast.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <vector>
+
+// microbenchmark: casting rays against many AABBs and spheres with the
+// existing one-at-a-time hittests (`lineIntersectsAABB`, etc.) and with the
+// batched SIMD kernels in `raycast.hpp`
+//
+// primitives are scattered uniformly in a cube in front of the rays. Each
+// kernel's closest hit is checked against the one-at-a-time loop's
+
+namespace {
+    constexpr size_t g_NumRuns = 21;
+    constexpr size_t g_RaysPerRun = 64;
+
+    template<typename F>
+    double medianNs(F f) {
+        std::vector<double> samples;
+        samples.reserve(g_NumRuns);
+
+        for (size_t run = 0; run < g_NumRuns; ++run) {
+            auto t0 = std::chrono::steady_clock::now();
+            f();
+            auto t1 = std::chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + samples.size()/2, samples.end());
+        return samples[samples.size()/2];
+    }
+
+    std::vector<gp::SimdLevel> supportedLevels() {
+        std::vector<gp::SimdLevel> rv;
+        for (gp::SimdLevel l : {gp::SimdLevel::Scalar, gp::SimdLevel::SSE, gp::SimdLevel::AVX, gp::SimdLevel::AVX512}) {
+            if (l <= gp::bestSimdLevel()) {
+                rv.push_back(l);
+            }
+        }
+        return rv;
+    }
+
+    // the one-at-a-time loop that `ak_fps` used to do
+    template<typename Prim, typename Hittest>
+    int32_t closestOneAtATime(std::vector<Prim> const& prims, gp::Line const& ray, Hittest hittest) {
+        int32_t rv = -1;
+        float closest = FLT_MAX;
+        for (size_t i = 0; i < prims.size(); ++i) {
+            auto [ok, t0, t1] = hittest(prims[i], ray);
+            (void)t1;
+            if (ok && t0 >= 0.0f && t0 < closest) {
+                rv = static_cast<int32_t>(i);
+                closest = t0;
+            }
+        }
+        return rv;
+    }
+
+    template<typename Prim, typename Arr, typename Hittest, typename Raycast>
+    void bench(char const* label,
+               std::vector<Prim> const& prims,
+               Arr const& arr,
+               std::vector<gp::Line> const& rays,
+               Hittest hittest,
+               Raycast raycast) {
+
+        std::vector<int32_t> expected(rays.size());
+        double baselineNs = medianNs([&]() {
+            for (size_t i = 0; i < rays.size(); ++i) {
+                expected[i] = closestOneAtATime(prims, rays[i], hittest);
+            }
+        });
+
+        std::printf("%-8s n = %7zu  %-8s  %9.1f us  %6.2f ns/test\n",
+                    label,
+                    prims.size(),
+                    "line*",
+                    baselineNs / 1000.0,
+                    baselineNs / static_cast<double>(prims.size() * rays.size()));
+
+        std::vector<gp::PrecomputedRay> precomputed;
+        for (gp::Line const& l : rays) {
+            precomputed.emplace_back(l);
+        }
+
+        std::vector<uint64_t> hitMask(gp::hitMaskSize(arr.size()));
+        std::vector<int32_t> got(rays.size());
+
+        for (gp::SimdLevel level : supportedLevels()) {
+            double ns = medianNs([&]() {
+                for (size_t i = 0; i < precomputed.size(); ++i) {
+                    got[i] = raycast(precomputed[i], arr, hitMask.data(), level).index;
+                }
+            });
+
+            std::printf("%-8s n = %7zu  %-8s  %9.1f us  %6.2f ns/test  (%.1fx)%s\n",
+                        label,
+                        prims.size(),
+                        gp::simdLevelName(level),
+                        ns / 1000.0,
+                        ns / static_cast<double>(prims.size() * rays.size()),
+                        baselineNs / ns,
+                        got == expected ? "" : "  MISMATCH");
+        }
+    }
+}
+
+int main() {
+    std::default_random_engine rng{1337};
+    std::uniform_real_distribution<float> posDist{-100.0f, 100.0f};
+    std::uniform_real_distribution<float> sizeDist{0.25f, 2.0f};
+    std::uniform_real_distribution<float> spreadDist{-0.3f, 0.3f};
+
+    // rays start behind the primitives and fan out through them
+    std::vector<gp::Line> rays;
+    for (size_t i = 0; i < g_RaysPerRun; ++i) {
+        gp::Line l;
+        l.o = {0.0f, 0.0f, -150.0f};
+        l.d = glm::normalize(glm::vec3{spreadDist(rng), spreadDist(rng), 1.0f});
+        rays.push_back(l);
+    }
+
+    for (size_t n : {1000, 10000, 100000}) {
+        std::vector<gp::AABB> aabbs;
+        std::vector<gp::Sphere> spheres;
+        aabbs.reserve(n);
+        spheres.reserve(n);
+
+        for (size_t i = 0; i < n; ++i) {
+            glm::vec3 pos{posDist(rng), posDist(rng), posDist(rng)};
+            float r = sizeDist(rng);
+            aabbs.push_back(gp::AABB{pos - r, pos + r});
+            spheres.push_back(gp::Sphere{pos, r});
+        }
+
+        bench("AABBs", aabbs, gp::AABBArray{aabbs}, rays,
+              [](gp::AABB const& a, gp::Line const& l) { return gp::lineIntersectsAABB(a, l); },
+              [](gp::PrecomputedRay const& r, gp::AABBArray const& a, uint64_t* mask, gp::SimdLevel level) {
+                  return gp::raycastAABBs(r, a, mask, level);
+              });
+        bench("spheres", spheres, gp::SphereArray{spheres}, rays,
+              [](gp::Sphere const& s, gp::Line const& l) { return gp::lineIntersectsSphere(s, l); },
+              [](gp::PrecomputedRay const& r, gp::SphereArray const& s, uint64_t* mask, gp::SimdLevel level) {
+                  return gp::raycastSpheres(r, s, mask, level);
+              });
+    }
+}
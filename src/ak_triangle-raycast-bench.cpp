@@ -0,0 +1,238 @@
+#include "app.hpp"
+#include "raycast.hpp"
+#include "bvh.hpp"
+
+#ifdef GFXPLAY_USE_ASSIMP
+#include "runtime_config.hpp"
+
+#include <assimp/Importer.hpp>
+#include <assimp/scene.h>
+#include <assimp/postprocess.h>
+#endif
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+// microbenchmark: casting rays against triangle meshes with the existing
+// `lineIntersectsTriangle`, with the watertight kernels in `raycast.hpp`, and
+// through a triangle BVH (`bvhRaycastTriangles`)
+//
+// rays are fired from outside each mesh at random points in its AABB. Each
+// kernel's closest hit is checked against the scalar watertight kernel's. Also
+// fires rays from the center of the mesh through each of its edges, which
+// should always hit something, to show how many slip through the cracks
+
+namespace {
+    constexpr size_t g_NumRuns = 11;
+    constexpr size_t g_NumRays = 256;
+
+    template<typename F>
+    double medianNs(F f) {
+        std::vector<double> samples;
+        samples.reserve(g_NumRuns);
+
+        for (size_t run = 0; run < g_NumRuns; ++run) {
+            auto t0 = std::chrono::steady_clock::now();
+            f();
+            auto t1 = std::chrono::steady_clock::now();
+            samples.push_back(static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count()));
+        }
+
+        std::nth_element(samples.begin(), samples.begin() + samples.size()/2, samples.end());
+        return samples[samples.size()/2];
+    }
+
+    // an indexed triangle mesh
+    struct Mesh final {
+        std::vector<gp::PlainVert> verts;
+        std::vector<uint32_t> indices;
+    };
+
+    Mesh uvSphere() {
+        Mesh rv;
+        rv.verts = gp::generateUVSphere<gp::PlainVert>();
+        for (size_t i = 0; i < rv.verts.size(); ++i) {
+            rv.indices.push_back(static_cast<uint32_t>(i));
+        }
+        return rv;
+    }
+
+#ifdef GFXPLAY_USE_ASSIMP
+    // all of the model's meshes, merged into one
+    Mesh loadMesh(char const* path) {
+        Assimp::Importer imp;
+        aiScene const* scene = imp.ReadFile(path, aiProcess_Triangulate | aiProcess_JoinIdenticalVertices);
+        if (!scene) {
+            std::stringstream ss;
+            ss << path << ": error loading model: " << imp.GetErrorString();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        Mesh rv;
+        for (unsigned m = 0; m < scene->mNumMeshes; ++m) {
+            aiMesh const& mesh = *scene->mMeshes[m];
+            uint32_t base = static_cast<uint32_t>(rv.verts.size());
+
+            for (unsigned i = 0; i < mesh.mNumVertices; ++i) {
+                aiVector3D const& p = mesh.mVertices[i];
+                rv.verts.push_back(gp::PlainVert{p.x, p.y, p.z});
+            }
+            for (unsigned f = 0; f < mesh.mNumFaces; ++f) {
+                aiFace const& face = mesh.mFaces[f];
+                if (face.mNumIndices != 3) {
+                    continue;  // points/lines
+                }
+                for (unsigned j = 0; j < 3; ++j) {
+                    rv.indices.push_back(base + face.mIndices[j]);
+                }
+            }
+        }
+        return rv;
+    }
+#endif
+
+    // returns the index of the closest triangle hit by `lineIntersectsTriangle`
+    int32_t closestOneAtATime(Mesh const& m, gp::Line const& ray) {
+        int32_t rv = -1;
+        float closest = FLT_MAX;
+        for (size_t i = 0; i + 2 < m.indices.size(); i += 3) {
+            glm::vec3 tri[3] = {
+                m.verts[m.indices[i]].pos,
+                m.verts[m.indices[i+1]].pos,
+                m.verts[m.indices[i+2]].pos,
+            };
+            auto [ok, t] = gp::lineIntersectsTriangle(tri, ray);
+            if (ok && t < closest) {
+                rv = static_cast<int32_t>(i/3);
+                closest = t;
+            }
+        }
+        return rv;
+    }
+
+    void bench(char const* label, Mesh const& m) {
+        size_t numTriangles = m.indices.size() / 3;
+
+        std::vector<glm::vec3> positions;
+        for (gp::PlainVert const& v : m.verts) {
+            positions.push_back(v.pos);
+        }
+        gp::TriangleArray tris{positions.data(), m.indices.data(), m.indices.size()};
+
+        gp::AABB bounds = gp::aabbFromVerts(m.verts);
+        glm::vec3 center = gp::aabbCenter(bounds);
+        float radius = glm::length(bounds.max - bounds.min);
+
+        // rays from outside the mesh, aimed at points inside its AABB
+        std::default_random_engine rng{1337};
+        std::uniform_real_distribution<float> unit{-1.0f, 1.0f};
+        std::vector<gp::Line> rays;
+        for (size_t i = 0; i < g_NumRays; ++i) {
+            glm::vec3 from = center + radius * glm::normalize(glm::vec3{unit(rng), unit(rng), unit(rng)});
+            glm::vec3 to = center + 0.5f * (bounds.max - bounds.min) * glm::vec3{unit(rng), unit(rng), unit(rng)};
+            rays.push_back(gp::Line{from, glm::normalize(to - from)});
+        }
+
+        std::vector<gp::PrecomputedRay> precomputed;
+        for (gp::Line const& l : rays) {
+            precomputed.emplace_back(l);
+        }
+
+        std::vector<int32_t> expected(rays.size());
+        for (size_t i = 0; i < rays.size(); ++i) {
+            expected[i] = gp::raycastTriangles(precomputed[i], tris, gp::SimdLevel::Scalar).index;
+        }
+
+        auto print = [&](char const* kernel, double ns, double baselineNs, bool ok) {
+            std::printf("%-8s tris = %7zu  %-18s  %9.1f us  %6.2f ns/test  (%.1fx)%s\n",
+                        label,
+                        numTriangles,
+                        kernel,
+                        ns / 1000.0,
+                        ns / static_cast<double>(numTriangles * rays.size()),
+                        baselineNs / ns,
+                        ok ? "" : "  MISMATCH");
+        };
+
+        // `lineIntersectsTriangle` isn't watertight, so it may legitimately
+        // disagree on rays that graze edges: only report how often
+        std::vector<int32_t> got(rays.size());
+        double baselineNs = medianNs([&]() {
+            for (size_t i = 0; i < rays.size(); ++i) {
+                got[i] = closestOneAtATime(m, rays[i]);
+            }
+        });
+        print("lineIntersectsTri", baselineNs, baselineNs, true);
+        size_t numDisagreements = 0;
+        for (size_t i = 0; i < rays.size(); ++i) {
+            numDisagreements += got[i] != expected[i];
+        }
+
+        for (gp::SimdLevel level : {gp::SimdLevel::Scalar, gp::SimdLevel::AVX}) {
+            if (level > gp::bestSimdLevel()) {
+                continue;
+            }
+
+            double ns = medianNs([&]() {
+                for (size_t i = 0; i < precomputed.size(); ++i) {
+                    got[i] = gp::raycastTriangles(precomputed[i], tris, level).index;
+                }
+            });
+            print(level == gp::SimdLevel::Scalar ? "soa scalar" : "soa avx", ns, baselineNs, got == expected);
+
+            ns = medianNs([&]() {
+                for (size_t i = 0; i < precomputed.size(); ++i) {
+                    got[i] = gp::raycastIndexedTriangles(precomputed[i], m.verts.data(), m.indices.data(), m.indices.size(), level).index;
+                }
+            });
+            print(level == gp::SimdLevel::Scalar ? "indexed scalar" : "indexed avx", ns, baselineNs, got == expected);
+        }
+
+        // the BVH's cost is per-ray, not per-triangle, so `ns/test` is only
+        // comparable with the brute-force kernels' on the same mesh
+        gp::BVH bvh;
+        gp::bvhBuildTriangles(bvh, m.verts.data(), m.indices.data(), m.indices.size());
+        double bvhNs = medianNs([&]() {
+            for (size_t i = 0; i < precomputed.size(); ++i) {
+                got[i] = gp::bvhRaycastTriangles(bvh, precomputed[i], m.verts.data(), m.indices.data()).index;
+            }
+        });
+        print("bvh", bvhNs, baselineNs, got == expected);
+
+        // watertightness: rays from the center of the mesh through the
+        // midpoint of every edge, which is exactly where non-watertight tests
+        // can miss both triangles that share the edge
+        size_t numEdgeRays = 0;
+        size_t numOldMisses = 0;
+        size_t numNewMisses = 0;
+        for (size_t i = 0; i < numTriangles; ++i) {
+            std::array<glm::vec3, 3> tri = tris.get(i);
+            for (size_t j = 0; j < 3; ++j) {
+                glm::vec3 mid = 0.5f * (tri[j] + tri[(j+1)%3]);
+                if (mid == center) {
+                    continue;
+                }
+                gp::Line l{center, glm::normalize(mid - center)};
+                ++numEdgeRays;
+                numOldMisses += closestOneAtATime(m, l) < 0;
+                numNewMisses += !gp::raycastTriangles(gp::PrecomputedRay{l}, tris).hit();
+            }
+        }
+
+        std::printf("%-8s closest hit differs from lineIntersectsTriangle on %zu/%zu rays\n", label, numDisagreements, rays.size());
+        std::printf("%-8s rays through edges that missed: lineIntersectsTriangle = %zu, watertight = %zu (of %zu)\n\n", label, numOldMisses, numNewMisses, numEdgeRays);
+    }
+}
+
+int main() {
+    bench("sphere", uvSphere());
+
+#ifdef GFXPLAY_USE_ASSIMP
+    bench("backpack", loadMesh(gfxplay::resource_path("backpack/backpack.obj").string().c_str()));
+#endif
+}
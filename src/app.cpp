@@ -1,536 +1,2695 @@
 ﻿#include "app.hpp"
 
+#include "gl.hpp"
+#include "profiler.hpp"
+
 #include <SDL.h>
 #include <imgui/backends/imgui_impl_opengl3.h>
 #include <imgui/backends/imgui_impl_sdl.h>
 #include <GL/glew.h>
 #include <glm/gtc/matrix_transform.hpp>
+#ifdef GFXPLAY_USE_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 #include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <condition_variable>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <map>
 #include <sstream>
 #include <mutex>
+#include <optional>
+#include <thread>
+#include <tuple>
 
-class Stdout_sink final : public gp::log::Sink {
-    std::mutex mutex;
+// a pre-formatted log message, as stored in the `AsyncSink` ring buffer
+//
+// the strings are copied (and, if necessary, truncated) so that the record
+// does not reference any memory owned by the logging thread
+struct AsyncSinkRecord final {
+    std::chrono::system_clock::time_point t;
+    gp::log::level::LevelEnum level;
+    uint16_t loggerNameLen;
+    uint16_t payloadLen;
+    char loggerName[32];
+    char payload[512];
+};
 
-    void log(gp::log::Msg const& msg) override {
-        std::lock_guard g{mutex};
-        std::cout << '[' << msg.loggerName << "] [" << gp::log::toStringView(msg.level) << "] " << msg.payload << std::endl;
-    }
+// a slot in the ring buffer
+//
+// `seq` is the sequence number that producers/consumers use to figure out
+// whether the slot is free or full. See Dmitry Vyukov's bounded MPMC queue:
+//
+//     https://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+struct AsyncSinkSlot final {
+    std::atomic<size_t> seq;
+    AsyncSinkRecord rec;
 };
 
-static std::shared_ptr<gp::log::Logger> create_default_sink() {
-    return std::make_shared<gp::log::Logger>("default", std::make_shared<Stdout_sink>());
+static size_t roundUpToPowerOf2(size_t v) noexcept {
+    size_t rv = 1;
+    while (rv < v) {
+        rv <<= 1;
+    }
+    return rv;
 }
 
-std::string_view const gp::log::level::g_nameViews[] LOG_LVL_NAMES;
-char const* const gp::log::level::g_nameCStrings[] LOG_LVL_NAMES;
-static std::shared_ptr<gp::log::Logger> default_sink = create_default_sink();
+struct gp::log::AsyncSink::Impl final {
+    std::FILE* out;
+    OverflowPolicy policy;
 
-std::shared_ptr<gp::log::Logger> gp::log::defaultLogger() noexcept {
-    return default_sink;
-}
+    size_t mask;
+    std::unique_ptr<AsyncSinkSlot[]> slots;
 
-gp::log::Logger* gp::log::defaultLoggerRaw() noexcept {
-    return defaultLogger().get();
-}
+    // written by producers (logging threads)
+    alignas(64) std::atomic<size_t> enqueuePos{0};
 
-void gp::onAssertFailed(char const* failingSourceCode, char const* file, unsigned int line) noexcept {
-    char buf[512];
-    std::snprintf(buf, sizeof(buf), "%s:%u: an assertion failed: %s", file, line, failingSourceCode);
+    // only written by the consumer (writer thread)
+    alignas(64) std::atomic<size_t> dequeuePos{0};
 
-    try {
-        throw std::runtime_error{buf};
-    } catch (std::runtime_error const&) {
-        std::terminate();
-    }
-}
+    std::atomic<uint64_t> nEnqueued{0};
+    std::atomic<uint64_t> nDropped{0};
+    std::atomic<uint64_t> nFlushed{0};
 
-struct SdlCtx final {
-    SdlCtx(Uint32 flags) {
-        if (SDL_Init(flags) != 0) {
-            std::stringstream ss;
-            ss << "SDL_Init failed: " << SDL_GetError();
-            throw std::runtime_error{std::move(ss).str()};
+    // messages that were dropped, but not yet reported, under `countAndDrop`
+    std::atomic<uint64_t> nUnreportedDrops{0};
+
+    // used to put the writer to sleep when there's nothing to write and to
+    // wake up anyone waiting in `flush()`
+    std::mutex mutex;
+    std::condition_variable writerCv;
+    std::condition_variable flushCv;
+    std::atomic<bool> writerSleeping{false};
+    bool stopRequested = false;
+    size_t writtenPos = 0;  // like `dequeuePos`, but only updated after the write
+
+    std::thread writer;
+
+    Impl(std::FILE* out_, size_t capacity, OverflowPolicy policy_) :
+        out{out_},
+        policy{policy_},
+        mask{roundUpToPowerOf2(std::max<size_t>(capacity, 2)) - 1},
+        slots{new AsyncSinkSlot[mask + 1]} {
+
+        for (size_t i = 0; i <= mask; ++i) {
+            slots[i].seq.store(i, std::memory_order_relaxed);
         }
+
+        writer = std::thread{[this]() { writerMain(); }};
     }
-    SdlCtx(SdlCtx const&) = delete;
-    SdlCtx(SdlCtx&&) = delete;
-    SdlCtx& operator=(SdlCtx const&) = delete;
-    SdlCtx& operator=(SdlCtx&&) = delete;
-    ~SdlCtx() noexcept {
-        SDL_Quit();
-    }
-};
 
-struct SdlWindow final {
-    SDL_Window* handle;
+    // try to claim a slot and copy the message into it
+    //
+    // returns false if the buffer is full
+    bool tryEnqueue(Msg const& msg) noexcept {
+        size_t pos = enqueuePos.load(std::memory_order_relaxed);
+        AsyncSinkSlot* slot;
+
+        for (;;) {
+            slot = &slots[pos & mask];
+            size_t seq = slot->seq.load(std::memory_order_acquire);
+            auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+
+            if (diff == 0) {
+                if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;  // full
+            } else {
+                pos = enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
 
-    SdlWindow(const char* title, int x, int y, int w, int h, Uint32 flags) :
-        handle{SDL_CreateWindow(title, x, y, w, h, flags)} {
+        AsyncSinkRecord& rec = slot->rec;
+        rec.t = msg.t;
+        rec.level = msg.level;
+        rec.loggerNameLen = static_cast<uint16_t>(std::min(msg.loggerName.size(), sizeof(rec.loggerName)));
+        std::memcpy(rec.loggerName, msg.loggerName.data(), rec.loggerNameLen);
+        rec.payloadLen = static_cast<uint16_t>(std::min(msg.payload.size(), sizeof(rec.payload)));
+        std::memcpy(rec.payload, msg.payload.data(), rec.payloadLen);
 
-        if (!handle) {
-            std::stringstream ss;
-            ss << "SDL_CreateWindow failed: " << SDL_GetError();
-            throw std::runtime_error{std::move(ss).str()};
-        }
+        slot->seq.store(pos + 1, std::memory_order_release);
+        return true;
     }
-    SdlWindow(SdlWindow const&) = delete;
-    SdlWindow(SdlWindow&&) = delete;
-    SdlWindow& operator=(SdlWindow const&) = delete;
-    SdlWindow& operator=(SdlWindow&&) = delete;
-    ~SdlWindow() noexcept {
-        SDL_DestroyWindow(handle);
+
+    void wakeWriter() {
+        if (writerSleeping.load(std::memory_order_relaxed)) {
+            std::lock_guard g{mutex};
+            writerCv.notify_one();
+        }
     }
 
-    constexpr operator SDL_Window*() noexcept {
-        return handle;
+    void enqueue(Msg const& msg) {
+        while (!tryEnqueue(msg)) {
+            switch (policy) {
+            case OverflowPolicy::block:
+                wakeWriter();
+                std::this_thread::yield();
+                continue;
+            case OverflowPolicy::countAndDrop:
+                nUnreportedDrops.fetch_add(1, std::memory_order_relaxed);
+                [[fallthrough]];
+            case OverflowPolicy::drop:
+                nDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        nEnqueued.fetch_add(1, std::memory_order_relaxed);
+        wakeWriter();
     }
-};
 
-struct SdlGLContext final {
-    SDL_GLContext handle;
+    // pop all currently-available messages into `batch`
+    //
+    // returns the number of messages popped
+    size_t drainInto(std::string& batch) {
+        size_t n = 0;
+        size_t pos = dequeuePos.load(std::memory_order_relaxed);
+
+        for (;;) {
+            AsyncSinkSlot& slot = slots[pos & mask];
+            size_t seq = slot.seq.load(std::memory_order_acquire);
+            if (seq != pos + 1) {
+                break;  // empty (or the producer hasn't finished writing yet)
+            }
 
-    SdlGLContext(SdlWindow& w) : handle{SDL_GL_CreateContext(w)} {
-        if (!handle) {
-            std::stringstream ss;
-            ss << "SDL_GL_CreateContext failed: " << SDL_GetError();
-            throw std::runtime_error{std::move(ss).str()};
+            AsyncSinkRecord const& rec = slot.rec;
+            batch += '[';
+            batch.append(rec.loggerName, rec.loggerNameLen);
+            batch += "] [";
+            batch += toStringView(rec.level);
+            batch += "] ";
+            batch.append(rec.payload, rec.payloadLen);
+            batch += '\n';
+
+            slot.seq.store(pos + mask + 1, std::memory_order_release);
+            ++pos;
+            ++n;
         }
-    }
-    SdlGLContext(SdlGLContext const&) = delete;
-    SdlGLContext(SdlGLContext&& tmp) noexcept : handle{tmp.handle} {
-        tmp.handle = nullptr;
-    }
-    SdlGLContext& operator=(SdlGLContext const&) = delete;
-    SdlGLContext& operator=(SdlGLContext&&) = delete;
-    ~SdlGLContext() noexcept {
-        if (handle) {
-            SDL_GL_DeleteContext(handle);
+
+        dequeuePos.store(pos, std::memory_order_relaxed);
+
+        if (uint64_t drops = nUnreportedDrops.exchange(0, std::memory_order_relaxed); drops > 0) {
+            batch += "[AsyncSink] [warning] ";
+            batch += std::to_string(drops);
+            batch += " log messages were dropped because the log buffer was full\n";
         }
-    }
 
-    constexpr operator SDL_GLContext() noexcept {
-        return handle;
+        return n;
     }
-};
 
-[[nodiscard]] static bool isOpenGlInDebugMode() {
-    GLint flags;
-    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
-    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
-        return false;
+    void writerMain() {
+        std::string batch;
+        bool stopping = false;
+
+        while (!stopping) {
+            batch.clear();
+            size_t n = drainInto(batch);
+
+            if (!batch.empty()) {
+                std::fwrite(batch.data(), 1, batch.size(), out);
+                std::fflush(out);
+            }
+
+            std::unique_lock l{mutex};
+            nFlushed.fetch_add(n, std::memory_order_relaxed);
+            writtenPos = dequeuePos.load(std::memory_order_relaxed);
+            flushCv.notify_all();
+
+            if (n > 0) {
+                continue;  // there may be more: don't sleep
+            }
+
+            if (stopRequested) {
+                stopping = true;
+                continue;
+            }
+
+            // sleep until a producer wakes the writer up
+            //
+            // producers only notify if they see `writerSleeping`, which can
+            // race with it being set here, so the wait also has a timeout
+            writerSleeping.store(true, std::memory_order_relaxed);
+            writerCv.wait_for(l, std::chrono::milliseconds{10});
+            writerSleeping.store(false, std::memory_order_relaxed);
+        }
     }
 
-    GLboolean b = false;
-    glGetBooleanv(GL_DEBUG_OUTPUT, &b);
-    if (!b) {
-        return false;
+    void flush() {
+        size_t target = enqueuePos.load(std::memory_order_relaxed);
+
+        std::unique_lock l{mutex};
+        writerCv.notify_one();
+        flushCv.wait(l, [&]() { return writtenPos >= target; });
     }
 
-    glGetBooleanv(GL_DEBUG_OUTPUT_SYNCHRONOUS, &b);
-    if (!b) {
-        return false;
+    ~Impl() noexcept {
+        {
+            std::lock_guard g{mutex};
+            stopRequested = true;
+            writerCv.notify_one();
+        }
+        writer.join();
     }
+};
 
-    return true;
+gp::log::AsyncSink::AsyncSink(std::FILE* out, size_t capacity, OverflowPolicy policy) :
+    impl{new Impl{out, capacity, policy}} {
 }
 
-[[nodiscard]] constexpr static gp::log::level::LevelEnum mapGlSeverityToLogLevelSeverity(GLenum severity) noexcept {
-    switch (severity) {
-    case GL_DEBUG_SEVERITY_HIGH: return gp::log::level::err;
-    case GL_DEBUG_SEVERITY_MEDIUM: return gp::log::level::warn;
-    case GL_DEBUG_SEVERITY_LOW: return gp::log::level::info;
-    case GL_DEBUG_SEVERITY_NOTIFICATION: return gp::log::level::trace;
-    default: return gp::log::level::debug;
-    }
+gp::log::AsyncSink::~AsyncSink() noexcept {
+    delete impl;
 }
 
-[[nodiscard]] constexpr static char const* mapGlSeverityToString(GLenum severity) noexcept {
-    switch (severity) {
-    case GL_DEBUG_SEVERITY_HIGH: return "GL_DEBUG_SEVERITY_HIGH";
-    case GL_DEBUG_SEVERITY_MEDIUM: return "GL_DEBUG_SEVERITY_MEDIUM";
-    case GL_DEBUG_SEVERITY_LOW: return "GL_DEBUG_SEVERITY_LOW";
-    case GL_DEBUG_SEVERITY_NOTIFICATION: return "GL_DEBUG_SEVERITY_NOTIFICATION";
-    default: return "GL_DEBUG_SEVERITY_UNKNOWN_TO_GP";
-    }
+void gp::log::AsyncSink::log(Msg const& msg) {
+    impl->enqueue(msg);
 }
 
-[[nodiscard]] constexpr static char const* mapGlSourceToString(GLenum source) noexcept {
-    switch (source) {
-    case GL_DEBUG_SOURCE_API: return "GL_DEBUG_SOURCE_API";
-    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "GL_DEBUG_SOURCE_WINDOW_SYSTEM";
-    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "GL_DEBUG_SOURCE_SHADER_COMPILER";
-    case GL_DEBUG_SOURCE_THIRD_PARTY: return "GL_DEBUG_SOURCE_THIRD_PARTY";
-    case GL_DEBUG_SOURCE_APPLICATION: return "GL_DEBUG_SOURCE_APPLICATION";
-    case GL_DEBUG_SOURCE_OTHER: return "GL_DEBUG_SOURCE_OTHER";
-    default: return "GL_DEBUG_SOURCE_UNKNOWN_TO_GP";
-    }
+void gp::log::AsyncSink::flush() {
+    impl->flush();
 }
 
-[[nodiscard]] constexpr static char const* mapGlDebugTypeToString(GLenum type) noexcept {
-    switch (type) {
-    case GL_DEBUG_TYPE_ERROR: return "GL_DEBUG_TYPE_ERROR";
-    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR";
-    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR";
-    case GL_DEBUG_TYPE_PORTABILITY: return "GL_DEBUG_TYPE_PORTABILITY";
-    case GL_DEBUG_TYPE_PERFORMANCE: return "GL_DEBUG_TYPE_PERFORMANCE";
-    case GL_DEBUG_TYPE_MARKER: return "GL_DEBUG_TYPE_MARKER";
-    case GL_DEBUG_TYPE_PUSH_GROUP: return "GL_DEBUG_TYPE_PUSH_GROUP";
-    case GL_DEBUG_TYPE_POP_GROUP: return "GL_DEBUG_TYPE_POP_GROUP";
-    case GL_DEBUG_TYPE_OTHER: return "GL_DEBUG_TYPE_OTHER";
-    default: return "GL_DEBUG_TYPE_UNKNOWN_TO_GP";
-    }
+gp::log::AsyncSink::Stats gp::log::AsyncSink::stats() const noexcept {
+    Stats rv;
+    rv.enqueued = impl->nEnqueued.load(std::memory_order_relaxed);
+    rv.dropped = impl->nDropped.load(std::memory_order_relaxed);
+    rv.flushed = impl->nFlushed.load(std::memory_order_relaxed);
+    return rv;
 }
 
-// called by the OpenGL driver whenever it wants to emit a debug message
-static void onOpenGlDebugMessage(
-        GLenum source,
-        GLenum type,
-        unsigned int id,
-        GLenum severity,
-        GLsizei,
-        const char* message,
-        const void*) {
-
-    // ignore non-significant error/warning codes
-    // if (id == 131169 || id == 131185 || id == 131218 || id == 131204)
-    //    return;
+// binary (deferred-formatting) logging
+//
+// each logging thread owns a byte ring buffer that only it writes into and
+// only the consumer thread reads from (SPSC). Records are 8-byte aligned and
+// never straddle the end of the buffer: if a record doesn't fit in the space
+// left at the end, a padding marker is written and the record starts at the
+// beginning of the buffer instead
 
-    gp::log::level::LevelEnum lvl = mapGlSeverityToLogLevelSeverity(severity);
-    char const* srcStr = mapGlSourceToString(source);
-    char const* typeStr = mapGlDebugTypeToString(type);
-    char const* sevStr = mapGlSeverityToString(severity);
+static constexpr size_t g_BinaryThreadBufferSize = 1 << 20;
+static constexpr uint32_t g_BinaryPaddingFlag = 0x80000000u;
 
-    gp::log::log(lvl, R"(OpenGL debug message:
-    id = %u
-    message = %s
-    source = %s
-    type = %s
-    severity = %s)", id, message, srcStr, typeStr, sevStr);
+[[nodiscard]] static constexpr size_t binaryAlign(size_t n) noexcept {
+    return (n + 7) & ~size_t{7};
 }
 
-static void enableOpenGlDebugMode() {
-    if (isOpenGlInDebugMode()) {
-        gp::log::error("OpenGL is already in debug mode: skipping");
-        return;
+struct BinaryThreadBuffer final {
+    std::unique_ptr<char[]> data{new char[g_BinaryThreadBufferSize]};
+
+    // written by the owning thread
+    alignas(64) std::atomic<uint64_t> head{0};
+    uint64_t pendingHead = 0;
+    std::atomic<uint64_t> nWritten{0};
+    std::atomic<uint64_t> nDropped{0};
+
+    // written by the consumer thread
+    alignas(64) std::atomic<uint64_t> tail{0};
+
+    // set when the owning thread exits: the consumer frees the buffer once
+    // it's empty
+    std::atomic<bool> retired{false};
+};
+
+// background thread that consumes records from all per-thread buffers
+struct BinaryConsumer final {
+    std::mutex mutex;
+    std::condition_variable wakeCv;
+    std::condition_variable passCv;
+    std::vector<std::shared_ptr<BinaryThreadBuffer>> buffers;
+    uint64_t retiredWritten = 0;
+    uint64_t retiredDropped = 0;
+    std::atomic<uint64_t> nConsumed{0};
+    uint64_t passes = 0;
+    bool stopRequested = false;
+    bool running = false;
+    std::thread thread;
+
+    // when set, records are written here (see `writeToFile`) rather than
+    // being formatted into the logger's sinks
+    std::FILE* out = nullptr;
+    std::map<std::pair<char const*, gp::log::binary::ArgType const*>, uint32_t> fmtIds;
+    std::map<gp::log::Logger const*, uint32_t> loggerIds;
+
+    void ensureStarted() {
+        std::lock_guard g{mutex};
+        if (!running) {
+            running = true;
+            thread = std::thread{[this]() { consumerMain(); }};
+        }
     }
 
-    glEnable(GL_DEBUG_OUTPUT);
-    glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
-    glDebugMessageCallback(onOpenGlDebugMessage, nullptr);
-    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
-}
+    std::shared_ptr<BinaryThreadBuffer> registerBuffer() {
+        auto rv = std::make_shared<BinaryThreadBuffer>();
+        std::lock_guard g{mutex};
+        buffers.push_back(rv);
+        return rv;
+    }
 
-static void disableOpenGlDebugMode() {
-    if (!isOpenGlInDebugMode()) {
-        gp::log::error("OpenGL is not in debug mode: cannot disable it: skipping");
-        return;
+    template<typename T>
+    void writeRaw(T const& v) {
+        std::fwrite(&v, sizeof(T), 1, out);
     }
 
-    glDisable(GL_DEBUG_OUTPUT);
-}
+    void writeString(std::string_view sv) {
+        writeRaw(static_cast<uint32_t>(sv.size()));
+        std::fwrite(sv.data(), 1, sv.size(), out);
+    }
 
-// convenience macro for setting SDL attrs
-#define GP_SDL_GL_SetAttribute_CHECK(attr, value)                                                                     \
-    {                                                                                                                  \
-        if (SDL_GL_SetAttribute((attr), (value)) != 0) {                                                               \
-            std::stringstream ss; \
-            ss << "SDL_GL_SetAttribute failed when setting " #attr " = " #value " : " \
-               << SDL_GetError(); \
-            throw std::runtime_error{std::move(ss).str()}; \
-        } \
+    // write the record to the binary log file, along with any dictionary
+    // entries (format strings, logger names) the decoder hasn't seen yet
+    void writeRecord(gp::log::binary::RecordHeader const& h, char const* args, size_t argsLen) {
+        auto [fmtIt, fmtIsNew] = fmtIds.try_emplace({h.fmt, h.argTypes}, static_cast<uint32_t>(fmtIds.size()));
+        if (fmtIsNew) {
+            writeRaw('F');
+            writeRaw(fmtIt->second);
+            writeRaw(h.nArgs);
+            std::fwrite(h.argTypes, sizeof(*h.argTypes), h.nArgs, out);
+            writeString(h.fmt);
+        }
+
+        auto [loggerIt, loggerIsNew] = loggerIds.try_emplace(h.logger, static_cast<uint32_t>(loggerIds.size()));
+        if (loggerIsNew) {
+            writeRaw('L');
+            writeRaw(loggerIt->second);
+            writeString(h.logger->name());
+        }
+
+        writeRaw('R');
+        writeRaw(fmtIt->second);
+        writeRaw(loggerIt->second);
+        writeRaw(h.t);
+        writeRaw(h.level);
+        writeString(std::string_view{args, argsLen});
     }
 
-static SdlWindow initMainWindow() {
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_MINOR_VERSION, 3);    
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_DEPTH_SIZE, 24);
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_STENCIL_SIZE, 8);
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_MULTISAMPLEBUFFERS, 1);
-    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_MULTISAMPLESAMPLES, 16);
+    // returns the number of records consumed
+    size_t consume(BinaryThreadBuffer& b, std::string& scratch) {
+        size_t n = 0;
+        uint64_t tail = b.tail.load(std::memory_order_relaxed);
+        uint64_t head = b.head.load(std::memory_order_acquire);
 
-    return SdlWindow{
-        "windowname",
-        SDL_WINDOWPOS_CENTERED,
-        SDL_WINDOWPOS_CENTERED,
-        800,
-        600,
-        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED
-    };
-}
+        while (tail < head) {
+            char const* p = b.data.get() + (tail % g_BinaryThreadBufferSize);
 
-static SdlGLContext initWindowOpenGLContext(SdlWindow& window) {
-    SdlGLContext rv{window};
+            uint32_t size;
+            std::memcpy(&size, p, sizeof(size));
+            if (size & g_BinaryPaddingFlag) {
+                tail += size & ~g_BinaryPaddingFlag;
+                continue;
+            }
 
-    // enable the context
-    if (SDL_GL_MakeCurrent(window, rv) != 0) {
-        std::stringstream ss;
-        ss << "SDL_GL_MakeCurrent failed: " << SDL_GetError();
-        throw std::runtime_error{std::move(ss).str()};
+            gp::log::binary::RecordHeader h;
+            std::memcpy(&h, p, sizeof(h));
+            char const* args = p + sizeof(h);
+            size_t argsLen = h.size - sizeof(h);
+
+            if (out) {
+                writeRecord(h, args, argsLen);
+            } else {
+                scratch.clear();
+                gp::log::binary::format(h.fmt, h.argTypes, h.nArgs, args, argsLen, scratch);
+                auto t = std::chrono::system_clock::time_point{std::chrono::system_clock::duration{h.t}};
+                h.logger->sinkFormatted(static_cast<gp::log::level::LevelEnum>(h.level), scratch, t);
+            }
+
+            tail += binaryAlign(h.size);
+            b.tail.store(tail, std::memory_order_release);
+            ++n;
+        }
+
+        nConsumed.fetch_add(n, std::memory_order_relaxed);
+        return n;
     }
 
-    // vsync
-    if (SDL_GL_SetSwapInterval(-1) != 0) {
-        SDL_GL_SetSwapInterval(1);
+    void consumerMain() {
+        std::string scratch;
+        std::vector<std::shared_ptr<BinaryThreadBuffer>> snapshot;
+
+        for (;;) {
+            {
+                std::lock_guard g{mutex};
+                snapshot = buffers;
+            }
+
+            // note: records are consumed buffer-by-buffer, so messages from
+            // different threads are only roughly ordered
+            size_t n = 0;
+            for (auto const& b : snapshot) {
+                n += consume(*b, scratch);
+            }
+
+            std::unique_lock l{mutex};
+
+            if (out && n > 0) {
+                std::fflush(out);
+            }
+
+            // free buffers that belong to exited threads
+            auto isDone = [this](std::shared_ptr<BinaryThreadBuffer> const& b) {
+                bool done = b->retired.load(std::memory_order_acquire) &&
+                            b->tail.load(std::memory_order_relaxed) == b->head.load(std::memory_order_acquire);
+                if (done) {
+                    retiredWritten += b->nWritten.load(std::memory_order_relaxed);
+                    retiredDropped += b->nDropped.load(std::memory_order_relaxed);
+                }
+                return done;
+            };
+            buffers.erase(std::remove_if(buffers.begin(), buffers.end(), isDone), buffers.end());
+
+            ++passes;
+            passCv.notify_all();
+
+            if (n > 0) {
+                continue;
+            }
+
+            if (stopRequested) {
+                return;
+            }
+
+            wakeCv.wait_for(l, std::chrono::milliseconds{2});
+        }
+    }
+
+    void flush() {
+        std::unique_lock l{mutex};
+        if (!running) {
+            return;
+        }
+
+        // two complete passes guarantees that everything committed before
+        // this point was seen by the consumer
+        uint64_t target = passes + 2;
+        wakeCv.notify_one();
+        passCv.wait(l, [&]() { return passes >= target; });
+    }
+
+    ~BinaryConsumer() noexcept {
+        {
+            std::lock_guard g{mutex};
+            stopRequested = true;
+            wakeCv.notify_one();
+        }
+
+        if (thread.joinable()) {
+            thread.join();
+        }
+
+        if (out) {
+            std::fclose(out);
+        }
+    }
+};
+
+static bool g_BinaryConsumerDestroyed = false;
+
+static BinaryConsumer* binaryConsumer() {
+    struct Holder final {
+        BinaryConsumer c;
+        ~Holder() noexcept {
+            g_BinaryConsumerDestroyed = true;
+        }
+    };
+    static Holder h;
+    return g_BinaryConsumerDestroyed ? nullptr : &h.c;
+}
+
+// trivially destructible, so that they're still safe to read while (and
+// after) the calling thread's `thread_local`s are being destroyed
+static thread_local BinaryThreadBuffer* t_BinaryThreadBuffer = nullptr;
+static thread_local bool t_BinaryThreadBufferRetired = false;
+
+// returns the calling thread's buffer, or `nullptr` if binary logging has
+// shut down for it (the consumer was destroyed at exit, or the thread is
+// exiting and has already retired its buffer)
+static BinaryThreadBuffer* binaryThreadBuffer() noexcept {
+    struct Handle final {
+        std::shared_ptr<BinaryThreadBuffer> buf;
+        Handle() {
+            if (BinaryConsumer* c = binaryConsumer()) {
+                buf = c->registerBuffer();
+            }
+            t_BinaryThreadBuffer = buf.get();
+        }
+        ~Handle() noexcept {
+            t_BinaryThreadBuffer = nullptr;
+            t_BinaryThreadBufferRetired = true;
+            if (buf) {
+                buf->retired.store(true, std::memory_order_release);
+            }
+        }
+    };
+
+    if (t_BinaryThreadBufferRetired || g_BinaryConsumerDestroyed) {
+        return nullptr;
+    }
+    thread_local Handle h;
+    return t_BinaryThreadBuffer;
+}
+
+char* gp::log::binary::reserve(size_t n) noexcept {
+    BinaryThreadBuffer* bp = binaryThreadBuffer();
+    if (!bp) {
+        return nullptr;
+    }
+    BinaryThreadBuffer& b = *bp;
+    n = binaryAlign(n);
+
+    uint64_t head = b.head.load(std::memory_order_relaxed);
+    uint64_t tail = b.tail.load(std::memory_order_acquire);
+    size_t offset = head % g_BinaryThreadBufferSize;
+    size_t contiguous = g_BinaryThreadBufferSize - offset;
+    size_t needed = n <= contiguous ? n : contiguous + n;
+
+    if (n >= g_BinaryThreadBufferSize/2 || needed > g_BinaryThreadBufferSize - (head - tail)) {
+        b.nDropped.store(b.nDropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    if (n > contiguous) {
+        uint32_t padding = static_cast<uint32_t>(contiguous) | g_BinaryPaddingFlag;
+        std::memcpy(b.data.get() + offset, &padding, sizeof(padding));
+        head += contiguous;
+        offset = 0;
+    }
+
+    b.pendingHead = head + n;
+    return b.data.get() + offset;
+}
+
+void gp::log::binary::commit() noexcept {
+    BinaryThreadBuffer* b = binaryThreadBuffer();
+    if (!b) {
+        return;
+    }
+    b->head.store(b->pendingHead, std::memory_order_release);
+    b->nWritten.store(b->nWritten.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+}
+
+namespace {
+    // a decoded argument
+    struct BinaryArg final {
+        gp::log::binary::ArgType type;
+        int64_t i;
+        uint64_t u;
+        double d;
+        std::string s;
+    };
+
+    // cursor over a record's argument bytes
+    struct BinaryArgReader final {
+        gp::log::binary::ArgType const* types;
+        size_t nArgs;
+        char const* p;
+        char const* end;
+        size_t i = 0;
+
+        template<typename T>
+        bool read(T& v) {
+            if (end - p < static_cast<std::ptrdiff_t>(sizeof(T))) {
+                return false;
+            }
+            std::memcpy(&v, p, sizeof(T));
+            p += sizeof(T);
+            return true;
+        }
+
+        bool next(BinaryArg& out) {
+            using gp::log::binary::ArgType;
+
+            if (i >= nArgs) {
+                return false;
+            }
+            out.type = types[i++];
+
+            switch (out.type) {
+            case ArgType::I32: {
+                int32_t v;
+                if (!read(v)) { return false; }
+                out.i = v;
+                out.u = static_cast<uint32_t>(v);
+                return true;
+            }
+            case ArgType::U32: {
+                uint32_t v;
+                if (!read(v)) { return false; }
+                out.i = v;
+                out.u = v;
+                return true;
+            }
+            case ArgType::I64:
+                if (!read(out.i)) { return false; }
+                out.u = static_cast<uint64_t>(out.i);
+                return true;
+            case ArgType::U64:
+            case ArgType::Ptr:
+                if (!read(out.u)) { return false; }
+                out.i = static_cast<int64_t>(out.u);
+                return true;
+            case ArgType::F64:
+                return read(out.d);
+            case ArgType::Str: {
+                uint32_t len;
+                if (!read(len) || end - p < static_cast<std::ptrdiff_t>(len)) {
+                    return false;
+                }
+                out.s.assign(p, len);
+                p += len;
+                return true;
+            }
+            }
+            return false;
+        }
+    };
+
+    template<typename T>
+    void appendPrintf(std::string& out, char const* spec, T v) {
+        char buf[256];
+        int n = std::snprintf(buf, sizeof(buf), spec, v);
+        if (n < 0) {
+            return;
+        }
+
+        if (static_cast<size_t>(n) < sizeof(buf)) {
+            out.append(buf, static_cast<size_t>(n));
+        } else {
+            size_t oldSize = out.size();
+            out.resize(oldSize + static_cast<size_t>(n) + 1);
+            std::snprintf(&out[oldSize], static_cast<size_t>(n) + 1, spec, v);
+            out.resize(oldSize + static_cast<size_t>(n));
+        }
+    }
+}
+
+void gp::log::binary::format(char const* fmt,
+                             ArgType const* argTypes,
+                             size_t nArgs,
+                             char const* args,
+                             size_t argsLen,
+                             std::string& out) {
+
+    // printf can't be called with a runtime-built argument list, so this walks
+    // the format string and calls `snprintf` once per conversion instead
+
+    BinaryArgReader reader{argTypes, nArgs, args, args + argsLen};
+    BinaryArg arg;
+
+    char const* c = fmt;
+    while (*c) {
+        if (*c != '%') {
+            char const* next = std::strchr(c, '%');
+            size_t len = next ? static_cast<size_t>(next - c) : std::strlen(c);
+            out.append(c, len);
+            c += len;
+            continue;
+        }
+
+        if (c[1] == '%') {
+            out += '%';
+            c += 2;
+            continue;
+        }
+
+        // parse the conversion specification into `spec` (minus any length
+        // modifiers: those are replaced with ones that match the stored type)
+        std::string spec = "%";
+        ++c;
+        while (*c && std::strchr("-+ #0", *c)) {
+            spec += *c++;
+        }
+        for (int field = 0; field < 2; ++field) {
+            if (field == 1) {
+                if (*c != '.') {
+                    break;
+                }
+                spec += *c++;
+            }
+
+            if (*c == '*') {
+                ++c;
+                if (!reader.next(arg) || arg.type == ArgType::F64 || arg.type == ArgType::Str) {
+                    out += "<bad arg>";
+                    return;
+                }
+                spec += std::to_string(arg.i);
+            } else {
+                while (*c >= '0' && *c <= '9') {
+                    spec += *c++;
+                }
+            }
+        }
+        while (*c && std::strchr("hljztL", *c)) {
+            ++c;
+        }
+
+        char conversion = *c;
+        if (conversion == '\0') {
+            break;
+        }
+        ++c;
+
+        if (!reader.next(arg)) {
+            out += "<missing arg>";
+            continue;
+        }
+
+        bool isInt = arg.type != ArgType::F64 && arg.type != ArgType::Str && arg.type != ArgType::Ptr;
+        switch (conversion) {
+        case 'd':
+        case 'i':
+            if (!isInt) { break; }
+            spec += "ll";
+            spec += conversion;
+            appendPrintf(out, spec.c_str(), static_cast<long long>(arg.i));
+            continue;
+        case 'u':
+        case 'o':
+        case 'x':
+        case 'X':
+            if (!isInt) { break; }
+            spec += "ll";
+            spec += conversion;
+            appendPrintf(out, spec.c_str(), static_cast<unsigned long long>(arg.u));
+            continue;
+        case 'c':
+            if (!isInt) { break; }
+            spec += conversion;
+            appendPrintf(out, spec.c_str(), static_cast<int>(arg.i));
+            continue;
+        case 'f':
+        case 'F':
+        case 'e':
+        case 'E':
+        case 'g':
+        case 'G':
+        case 'a':
+        case 'A':
+            if (arg.type != ArgType::F64) { break; }
+            spec += conversion;
+            appendPrintf(out, spec.c_str(), arg.d);
+            continue;
+        case 's':
+            if (arg.type != ArgType::Str) { break; }
+            spec += conversion;
+            appendPrintf(out, spec.c_str(), arg.s.c_str());
+            continue;
+        case 'p':
+            if (arg.type != ArgType::Ptr) { break; }
+            spec += conversion;
+            appendPrintf(out, spec.c_str(), reinterpret_cast<void const*>(static_cast<uintptr_t>(arg.u)));
+            continue;
+        }
+
+        out += "<bad arg>";
+    }
+}
+
+void gp::log::binary::writeToFile(char const* path) {
+    BinaryConsumer* c = binaryConsumer();
+    if (!c) {
+        return;
+    }
+
+    std::FILE* f = std::fopen(path, "wb");
+    if (!f) {
+        std::stringstream ss;
+        ss << path << ": cannot open binary log file for writing: " << std::strerror(errno);
+        throw std::runtime_error{std::move(ss).str()};
+    }
+
+    c->ensureStarted();
+    c->flush();
+
+    std::lock_guard g{c->mutex};
+    if (c->out) {
+        std::fclose(c->out);
+    }
+    c->out = f;
+    c->fmtIds.clear();
+    c->loggerIds.clear();
+    std::fwrite("GPBINLOG", 1, 8, f);
+    c->writeRaw(uint32_t{1});  // version
+}
+
+void gp::log::binary::flush() {
+    if (BinaryConsumer* c = binaryConsumer(); c) {
+        c->flush();
+    }
+}
+
+gp::log::binary::Stats gp::log::binary::stats() noexcept {
+    Stats rv{0, 0, 0};
+    BinaryConsumer* c = binaryConsumer();
+    if (!c) {
+        return rv;
+    }
+
+    std::lock_guard g{c->mutex};
+    rv.written = c->retiredWritten;
+    rv.dropped = c->retiredDropped;
+    for (auto const& b : c->buffers) {
+        rv.written += b->nWritten.load(std::memory_order_relaxed);
+        rv.dropped += b->nDropped.load(std::memory_order_relaxed);
+    }
+    rv.consumed = c->nConsumed.load(std::memory_order_relaxed);
+    return rv;
+}
+
+bool gp::log::binary::decodeFile(std::FILE* in, std::FILE* out) {
+    auto read = [in](auto& v) {
+        return std::fread(&v, sizeof(v), 1, in) == 1;
+    };
+    auto readString = [&](std::string& s) {
+        uint32_t len;
+        if (!read(len)) {
+            return false;
+        }
+        s.resize(len);
+        return std::fread(s.data(), 1, len, in) == len;
+    };
+
+    char magic[8];
+    uint32_t version;
+    if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+        std::memcmp(magic, "GPBINLOG", sizeof(magic)) != 0 ||
+        !read(version) ||
+        version != 1) {
+        return false;
+    }
+
+    struct Fmt final {
+        std::string fmt;
+        std::vector<ArgType> argTypes;
+    };
+    std::vector<Fmt> fmts;
+    std::vector<std::string> loggerNames;
+    std::string args;
+    std::string formatted;
+
+    for (char kind; read(kind);) {
+        switch (kind) {
+        case 'F': {
+            uint32_t id;
+            uint8_t nArgs;
+            if (!read(id) || !read(nArgs) || id != fmts.size()) {
+                return false;
+            }
+            Fmt& f = fmts.emplace_back();
+            f.argTypes.resize(nArgs);
+            if (std::fread(f.argTypes.data(), sizeof(ArgType), nArgs, in) != nArgs || !readString(f.fmt)) {
+                return false;
+            }
+            break;
+        }
+        case 'L': {
+            uint32_t id;
+            if (!read(id) || id != loggerNames.size() || !readString(loggerNames.emplace_back())) {
+                return false;
+            }
+            break;
+        }
+        case 'R': {
+            uint32_t fmtId;
+            uint32_t loggerId;
+            int64_t t;
+            uint8_t lvl;
+            if (!read(fmtId) || !read(loggerId) || !read(t) || !read(lvl) || !readString(args) ||
+                fmtId >= fmts.size() || loggerId >= loggerNames.size() || lvl >= level::NUM_LEVELS) {
+                return false;
+            }
+
+            Fmt const& f = fmts[fmtId];
+            formatted.clear();
+            format(f.fmt.c_str(), f.argTypes.data(), f.argTypes.size(), args.data(), args.size(), formatted);
+            std::fprintf(out, "[%s] [%s] %s\n", loggerNames[loggerId].c_str(), toCString(static_cast<level::LevelEnum>(lvl)), formatted.c_str());
+            break;
+        }
+        default:
+            return false;
+        }
+    }
+
+    return std::feof(in) != 0;
+}
+
+gp::log::Logger::~Logger() noexcept {
+    if (binary_) {
+        binary::flush();
+
+        // the address may be reused by another logger, which should get its
+        // own entry in the binary log file
+        if (BinaryConsumer* c = binaryConsumer(); c) {
+            std::lock_guard g{c->mutex};
+            c->loggerIds.erase(this);
+        }
+    }
+}
+
+void gp::log::Logger::setBinaryMode(bool v) {
+    if (v) {
+        if (BinaryConsumer* c = binaryConsumer(); c) {
+            c->ensureStarted();
+        } else {
+            return;  // shutting down
+        }
+    } else if (binary_) {
+        // ensure any in-flight binary messages are sinked before subsequent
+        // (formatted) ones
+        binary::flush();
+    }
+
+    binary_ = v;
+}
+
+static std::shared_ptr<gp::log::Logger> create_default_sink() {
+    return std::make_shared<gp::log::Logger>("default", std::make_shared<gp::log::AsyncSink>(stdout));
+}
+
+std::string_view const gp::log::level::g_nameViews[] LOG_LVL_NAMES;
+char const* const gp::log::level::g_nameCStrings[] LOG_LVL_NAMES;
+static std::shared_ptr<gp::log::Logger> default_sink = create_default_sink();
+
+std::shared_ptr<gp::log::Logger> gp::log::defaultLogger() noexcept {
+    return default_sink;
+}
+
+gp::log::Logger* gp::log::defaultLoggerRaw() noexcept {
+    // don't copy the `shared_ptr`: this is called on every log call, and
+    // copying it would cost an atomic increment+decrement each time
+    return default_sink.get();
+}
+
+void gp::onAssertFailed(char const* failingSourceCode, char const* file, unsigned int line) noexcept {
+    char buf[512];
+    std::snprintf(buf, sizeof(buf), "%s:%u: an assertion failed: %s", file, line, failingSourceCode);
+
+    // the process is about to die, so make sure any asynchronously-queued
+    // log messages make it out first
+    gp::log::defaultLoggerRaw()->flush();
+
+    try {
+        throw std::runtime_error{buf};
+    } catch (std::runtime_error const&) {
+        std::terminate();
+    }
+}
+
+struct SdlCtx final {
+    SdlCtx(Uint32 flags) {
+        if (SDL_Init(flags) != 0) {
+            std::stringstream ss;
+            ss << "SDL_Init failed: " << SDL_GetError();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+    SdlCtx(SdlCtx const&) = delete;
+    SdlCtx(SdlCtx&&) = delete;
+    SdlCtx& operator=(SdlCtx const&) = delete;
+    SdlCtx& operator=(SdlCtx&&) = delete;
+    ~SdlCtx() noexcept {
+        SDL_Quit();
+    }
+};
+
+struct SdlWindow final {
+    SDL_Window* handle;
+
+    SdlWindow(const char* title, int x, int y, int w, int h, Uint32 flags) :
+        handle{SDL_CreateWindow(title, x, y, w, h, flags)} {
+
+        if (!handle) {
+            std::stringstream ss;
+            ss << "SDL_CreateWindow failed: " << SDL_GetError();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+    SdlWindow(SdlWindow const&) = delete;
+    SdlWindow(SdlWindow&&) = delete;
+    SdlWindow& operator=(SdlWindow const&) = delete;
+    SdlWindow& operator=(SdlWindow&&) = delete;
+    ~SdlWindow() noexcept {
+        SDL_DestroyWindow(handle);
+    }
+
+    constexpr operator SDL_Window*() noexcept {
+        return handle;
+    }
+};
+
+struct SdlGLContext final {
+    SDL_GLContext handle;
+
+    SdlGLContext(SdlWindow& w) : handle{SDL_GL_CreateContext(w)} {
+        if (!handle) {
+            std::stringstream ss;
+            ss << "SDL_GL_CreateContext failed: " << SDL_GetError();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+    SdlGLContext(SdlGLContext const&) = delete;
+    SdlGLContext(SdlGLContext&& tmp) noexcept : handle{tmp.handle} {
+        tmp.handle = nullptr;
+    }
+    SdlGLContext& operator=(SdlGLContext const&) = delete;
+    SdlGLContext& operator=(SdlGLContext&&) = delete;
+    ~SdlGLContext() noexcept {
+        if (handle) {
+            SDL_GL_DeleteContext(handle);
+        }
+    }
+
+    constexpr operator SDL_GLContext() noexcept {
+        return handle;
+    }
+};
+
+[[nodiscard]] static bool isOpenGlInDebugMode() {
+    GLint flags;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    if (!(flags & GL_CONTEXT_FLAG_DEBUG_BIT)) {
+        return false;
+    }
+
+    GLboolean b = false;
+    glGetBooleanv(GL_DEBUG_OUTPUT, &b);
+    if (!b) {
+        return false;
+    }
+
+    // (debug contexts may enable GL_DEBUG_OUTPUT by default, so also check
+    // that a callback was installed)
+    void* callback = nullptr;
+    glGetPointerv(GL_DEBUG_CALLBACK_FUNCTION, &callback);
+    return callback != nullptr;
+}
+
+[[nodiscard]] constexpr static gp::log::level::LevelEnum mapGlSeverityToLogLevelSeverity(GLenum severity) noexcept {
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: return gp::log::level::err;
+    case GL_DEBUG_SEVERITY_MEDIUM: return gp::log::level::warn;
+    case GL_DEBUG_SEVERITY_LOW: return gp::log::level::info;
+    case GL_DEBUG_SEVERITY_NOTIFICATION: return gp::log::level::trace;
+    default: return gp::log::level::debug;
+    }
+}
+
+[[nodiscard]] constexpr static char const* mapGlSeverityToString(GLenum severity) noexcept {
+    switch (severity) {
+    case GL_DEBUG_SEVERITY_HIGH: return "GL_DEBUG_SEVERITY_HIGH";
+    case GL_DEBUG_SEVERITY_MEDIUM: return "GL_DEBUG_SEVERITY_MEDIUM";
+    case GL_DEBUG_SEVERITY_LOW: return "GL_DEBUG_SEVERITY_LOW";
+    case GL_DEBUG_SEVERITY_NOTIFICATION: return "GL_DEBUG_SEVERITY_NOTIFICATION";
+    default: return "GL_DEBUG_SEVERITY_UNKNOWN_TO_GP";
+    }
+}
+
+[[nodiscard]] constexpr static char const* mapGlSourceToString(GLenum source) noexcept {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API: return "GL_DEBUG_SOURCE_API";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "GL_DEBUG_SOURCE_WINDOW_SYSTEM";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "GL_DEBUG_SOURCE_SHADER_COMPILER";
+    case GL_DEBUG_SOURCE_THIRD_PARTY: return "GL_DEBUG_SOURCE_THIRD_PARTY";
+    case GL_DEBUG_SOURCE_APPLICATION: return "GL_DEBUG_SOURCE_APPLICATION";
+    case GL_DEBUG_SOURCE_OTHER: return "GL_DEBUG_SOURCE_OTHER";
+    default: return "GL_DEBUG_SOURCE_UNKNOWN_TO_GP";
+    }
+}
+
+[[nodiscard]] constexpr static char const* mapGlDebugTypeToString(GLenum type) noexcept {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR: return "GL_DEBUG_TYPE_ERROR";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR";
+    case GL_DEBUG_TYPE_PORTABILITY: return "GL_DEBUG_TYPE_PORTABILITY";
+    case GL_DEBUG_TYPE_PERFORMANCE: return "GL_DEBUG_TYPE_PERFORMANCE";
+    case GL_DEBUG_TYPE_MARKER: return "GL_DEBUG_TYPE_MARKER";
+    case GL_DEBUG_TYPE_PUSH_GROUP: return "GL_DEBUG_TYPE_PUSH_GROUP";
+    case GL_DEBUG_TYPE_POP_GROUP: return "GL_DEBUG_TYPE_POP_GROUP";
+    case GL_DEBUG_TYPE_OTHER: return "GL_DEBUG_TYPE_OTHER";
+    default: return "GL_DEBUG_TYPE_UNKNOWN_TO_GP";
+    }
+}
+
+// aggregates OpenGL debug messages by (source, type, id)
+//
+// some drivers (e.g. llvmpipe) emit the same performance warning thousands
+// of times per frame, which floods the log and (because logging is slow)
+// tanks the framerate. So only the first occurrence of each message is
+// logged immediately; repeats are counted and summarized once per report
+// interval
+//
+// the driver may call the callback from any thread when debug output isn't
+// synchronous, hence the mutex
+struct GLDebugMessageAggregator final {
+    struct Entry final {
+        GLenum severity;
+        uint64_t frameCount = 0;
+        uint64_t lastFrameCount = 0;
+        uint64_t maxFrameCount = 0;
+        uint64_t totalCount = 0;
+        uint64_t countSinceReport = 0;
+
+        // as `maxFrameCount`, but only over frames since the last report
+        uint64_t maxFrameCountSinceReport = 0;
+
+        std::string message;
+    };
+
+    using Key = std::tuple<GLenum, GLenum, GLuint>;
+
+    std::mutex mutex;
+    std::map<Key, Entry> entries;
+    std::chrono::steady_clock::duration reportInterval = std::chrono::seconds{5};
+    std::chrono::steady_clock::time_point lastReport = std::chrono::steady_clock::now();
+};
+
+static GLDebugMessageAggregator g_GLDebugMessages;
+
+static void logGlDebugMessage(GLenum source, GLenum type, GLuint id, GLenum severity, char const* message) {
+    gp::log::level::LevelEnum lvl = mapGlSeverityToLogLevelSeverity(severity);
+    char const* srcStr = mapGlSourceToString(source);
+    char const* typeStr = mapGlDebugTypeToString(type);
+    char const* sevStr = mapGlSeverityToString(severity);
+
+    gp::log::log(lvl, R"(OpenGL debug message:
+    id = %u
+    message = %s
+    source = %s
+    type = %s
+    severity = %s)", id, message, srcStr, typeStr, sevStr);
+}
+
+// called by the OpenGL driver whenever it wants to emit a debug message
+static void onOpenGlDebugMessage(
+        GLenum source,
+        GLenum type,
+        unsigned int id,
+        GLenum severity,
+        GLsizei length,
+        const char* message,
+        const void* userParam) {
+
+    auto& agg = *static_cast<GLDebugMessageAggregator*>(const_cast<void*>(userParam));
+
+    {
+        std::lock_guard g{agg.mutex};
+        auto [it, inserted] = agg.entries.try_emplace(GLDebugMessageAggregator::Key{source, type, id});
+        GLDebugMessageAggregator::Entry& e = it->second;
+        ++e.frameCount;
+        ++e.totalCount;
+
+        if (!inserted) {
+            ++e.countSinceReport;
+            return;
+        }
+
+        e.severity = severity;
+        if (length >= 0) {
+            e.message.assign(message, static_cast<size_t>(length));
+        } else {
+            e.message = message;
+        }
+    }
+
+    logGlDebugMessage(source, type, id, severity, message);
+}
+
+// called at the end of each frame: rolls per-frame counters over and, once per
+// report interval, summarizes any messages that repeated
+static void onOpenGlDebugMessagesFrameEnd(GLDebugMessageAggregator& agg) {
+    struct Summary final {
+        GLenum source;
+        GLenum type;
+        GLuint id;
+        GLenum severity;
+        uint64_t count;
+        uint64_t maxFrameCount;
+        std::string message;
+    };
+    std::vector<Summary> summaries;
+    std::chrono::steady_clock::duration sinceLastReport;
+
+    {
+        std::lock_guard g{agg.mutex};
+
+        for (auto& [key, e] : agg.entries) {
+            e.lastFrameCount = e.frameCount;
+            e.maxFrameCount = std::max(e.maxFrameCount, e.frameCount);
+            e.maxFrameCountSinceReport = std::max(e.maxFrameCountSinceReport, e.frameCount);
+            e.frameCount = 0;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        sinceLastReport = now - agg.lastReport;
+        if (sinceLastReport < agg.reportInterval) {
+            return;
+        }
+        agg.lastReport = now;
+
+        for (auto& [key, e] : agg.entries) {
+            if (e.countSinceReport > 0) {
+                auto [source, type, id] = key;
+                summaries.push_back(Summary{source, type, id, e.severity, e.countSinceReport, e.maxFrameCountSinceReport, e.message});
+                e.countSinceReport = 0;
+            }
+            e.maxFrameCountSinceReport = 0;
+        }
+    }
+
+    double secs = std::chrono::duration<double>{sinceLastReport}.count();
+    for (Summary const& s : summaries) {
+        gp::log::log(mapGlSeverityToLogLevelSeverity(s.severity),
+                     "OpenGL debug message repeated %llu times in the last %.1f s (max %llu in one frame): id = %u, source = %s, type = %s: %s",
+                     static_cast<unsigned long long>(s.count),
+                     secs,
+                     static_cast<unsigned long long>(s.maxFrameCount),
+                     s.id,
+                     mapGlSourceToString(s.source),
+                     mapGlDebugTypeToString(s.type),
+                     s.message.c_str());
+    }
+}
+
+static void enableOpenGlDebugMode(bool synchronous) {
+    if (isOpenGlInDebugMode()) {
+        gp::log::error("OpenGL is already in debug mode: skipping");
+        return;
+    }
+
+    glEnable(GL_DEBUG_OUTPUT);
+    if (synchronous) {
+        glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    } else {
+        glDisable(GL_DEBUG_OUTPUT_SYNCHRONOUS);
+    }
+    glDebugMessageCallback(onOpenGlDebugMessage, &g_GLDebugMessages);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DONT_CARE, 0, nullptr, GL_TRUE);
+}
+
+static void disableOpenGlDebugMode() {
+    if (!isOpenGlInDebugMode()) {
+        gp::log::error("OpenGL is not in debug mode: cannot disable it: skipping");
+        return;
+    }
+
+    glDisable(GL_DEBUG_OUTPUT);
+}
+
+// convenience macro for setting SDL attrs
+#define GP_SDL_GL_SetAttribute_CHECK(attr, value)                                                                     \
+    {                                                                                                                  \
+        if (SDL_GL_SetAttribute((attr), (value)) != 0) {                                                               \
+            std::stringstream ss; \
+            ss << "SDL_GL_SetAttribute failed when setting " #attr " = " #value " : " \
+               << SDL_GetError(); \
+            throw std::runtime_error{std::move(ss).str()}; \
+        } \
+    }
+
+// `hidden` windows are only used for their OpenGL context (see `HeadlessContext`)
+static SdlWindow initMainWindow(bool hidden = false) {
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_FLAGS, SDL_GL_CONTEXT_DEBUG_FLAG);
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_CONTEXT_MINOR_VERSION, 3);    
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_DEPTH_SIZE, 24);
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_STENCIL_SIZE, 8);
+
+    // (a hidden window's framebuffer isn't drawn to, so it doesn't need MSAA)
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_MULTISAMPLEBUFFERS, hidden ? 0 : 1);
+    GP_SDL_GL_SetAttribute_CHECK(SDL_GL_MULTISAMPLESAMPLES, hidden ? 0 : 16);
+
+    Uint32 flags = hidden ?
+        SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN :
+        SDL_WINDOW_OPENGL | SDL_WINDOW_SHOWN | SDL_WINDOW_RESIZABLE | SDL_WINDOW_MAXIMIZED;
+
+    return SdlWindow{
+        "windowname",
+        SDL_WINDOWPOS_CENTERED,
+        SDL_WINDOWPOS_CENTERED,
+        800,
+        600,
+        flags
+    };
+}
+
+// loads OpenGL function pointers via GLEW (requires a current context)
+static void initGlew(bool headless) {
+    GLenum err = glewInit();
+
+    // GLEW 2.1 loads the core/extension functions and *then* tries to load
+    // GLX extensions, which fails if there's no X display. That's fine when
+    // the context was made via EGL (headless, or a hidden window on an
+    // EGL-based SDL video driver), because the GL functions are loaded by
+    // that point
+    if (headless && err == GLEW_ERROR_NO_GLX_DISPLAY) {
+        err = GLEW_OK;
+    }
+
+    if (err != GLEW_OK) {
+        std::stringstream ss;
+        ss << "glewInit() failed: " << glewGetErrorString(err);
+        throw std::runtime_error{std::move(ss).str()};
+    }
+}
+
+static SdlGLContext initWindowOpenGLContext(SdlWindow& window, bool headless = false) {
+    SdlGLContext rv{window};
+
+    // enable the context
+    if (SDL_GL_MakeCurrent(window, rv) != 0) {
+        std::stringstream ss;
+        ss << "SDL_GL_MakeCurrent failed: " << SDL_GetError();
+        throw std::runtime_error{std::move(ss).str()};
+    }
+
+    // vsync
+    if (SDL_GL_SetSwapInterval(-1) != 0) {
+        SDL_GL_SetSwapInterval(1);
+    }
+
+    // GLEW
+    initGlew(headless);
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glEnable(GL_MULTISAMPLE);
+
+    return rv;
+}
+
+// everything the app needs when it's showing a window
+struct WindowedContext final {
+    SdlWindow window = initMainWindow();
+    SdlGLContext sdlglctx = initWindowOpenGLContext(window);
+};
+
+#ifdef GFXPLAY_USE_EGL
+[[nodiscard]] static char const* eglErrorString() noexcept {
+    switch (eglGetError()) {
+    case EGL_SUCCESS: return "EGL_SUCCESS";
+    case EGL_NOT_INITIALIZED: return "EGL_NOT_INITIALIZED";
+    case EGL_BAD_ACCESS: return "EGL_BAD_ACCESS";
+    case EGL_BAD_ALLOC: return "EGL_BAD_ALLOC";
+    case EGL_BAD_ATTRIBUTE: return "EGL_BAD_ATTRIBUTE";
+    case EGL_BAD_CONFIG: return "EGL_BAD_CONFIG";
+    case EGL_BAD_CONTEXT: return "EGL_BAD_CONTEXT";
+    case EGL_BAD_DISPLAY: return "EGL_BAD_DISPLAY";
+    case EGL_BAD_MATCH: return "EGL_BAD_MATCH";
+    case EGL_BAD_PARAMETER: return "EGL_BAD_PARAMETER";
+    default: return "EGL error unknown to gp";
+    }
+}
+
+// a surfaceless EGL OpenGL 3.3 core context
+//
+// surfaceless (EGL_MESA_platform_surfaceless + EGL_KHR_surfaceless_context)
+// means that it doesn't need a window system, or a GPU: Mesa falls back to
+// its software renderer (llvmpipe)
+struct EglHeadlessContext final {
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    EglHeadlessContext() {
+        auto getPlatformDisplay =
+            reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+        if (getPlatformDisplay) {
+            display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        }
+        if (display == EGL_NO_DISPLAY) {
+            throw std::runtime_error{"eglGetDisplay failed: no EGL display available"};
+        }
+
+        if (eglInitialize(display, nullptr, nullptr) != EGL_TRUE) {
+            std::stringstream ss;
+            ss << "eglInitialize failed: " << eglErrorString();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        try {
+            init();
+        } catch (...) {
+            eglTerminate(display);
+            throw;
+        }
+    }
+
+    void init() {
+        if (eglBindAPI(EGL_OPENGL_API) != EGL_TRUE) {
+            std::stringstream ss;
+            ss << "eglBindAPI(EGL_OPENGL_API) failed: " << eglErrorString();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        // (the context is never bound to a surface, but EGL's default surface
+        // type is EGL_WINDOW_BIT, which surfaceless displays don't support)
+        EGLint const configAttrs[] = {
+            EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+            EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+            EGL_RED_SIZE, 8,
+            EGL_GREEN_SIZE, 8,
+            EGL_BLUE_SIZE, 8,
+            EGL_NONE,
+        };
+        EGLConfig config;
+        EGLint numConfigs = 0;
+        if (eglChooseConfig(display, configAttrs, &config, 1, &numConfigs) != EGL_TRUE || numConfigs < 1) {
+            std::stringstream ss;
+            ss << "eglChooseConfig failed: no config supports desktop OpenGL: " << eglErrorString();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        // same as the windowed context (see `initMainWindow`)
+        EGLint const contextAttrs[] = {
+            EGL_CONTEXT_MAJOR_VERSION, 3,
+            EGL_CONTEXT_MINOR_VERSION, 3,
+            EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+            EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE,
+            EGL_NONE,
+        };
+        context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttrs);
+        if (context == EGL_NO_CONTEXT) {
+            std::stringstream ss;
+            ss << "eglCreateContext failed: cannot create an OpenGL 3.3 core context: " << eglErrorString();
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        if (eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) != EGL_TRUE) {
+            std::stringstream ss;
+            ss << "eglMakeCurrent failed: does the driver support EGL_KHR_surfaceless_context?: " << eglErrorString();
+            eglDestroyContext(display, context);
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        try {
+            initGlew(true);
+        } catch (...) {
+            eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+            eglDestroyContext(display, context);
+            throw;
+        }
+
+        // same as the windowed context, minus multisampling: the offscreen
+        // framebuffer is single-sampled (MSAA is very slow in llvmpipe)
+        glEnable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+    }
+
+    EglHeadlessContext(EglHeadlessContext const&) = delete;
+    EglHeadlessContext(EglHeadlessContext&&) = delete;
+    EglHeadlessContext& operator=(EglHeadlessContext const&) = delete;
+    EglHeadlessContext& operator=(EglHeadlessContext&&) = delete;
+    ~EglHeadlessContext() noexcept {
+        eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext(display, context);
+        eglTerminate(display);
+    }
+};
+#endif
+
+// the offscreen framebuffer that a headless app renders into (in place of
+// the window's default framebuffer)
+struct OffscreenFramebuffer final {
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint depthStencil = 0;
+
+    OffscreenFramebuffer(int w, int h) {
+        glGenRenderbuffers(1, &color);
+        glBindRenderbuffer(GL_RENDERBUFFER, color);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+
+        glGenRenderbuffers(1, &depthStencil);
+        glBindRenderbuffer(GL_RENDERBUFFER, depthStencil);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, w, h);
+
+        glGenFramebuffers(1, &fbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, fbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthStencil);
+
+        if (GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER); status != GL_FRAMEBUFFER_COMPLETE) {
+            glDeleteFramebuffers(1, &fbo);
+            glDeleteRenderbuffers(1, &depthStencil);
+            glDeleteRenderbuffers(1, &color);
+            std::stringstream ss;
+            ss << "offscreen framebuffer is incomplete: status = " << status;
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+    OffscreenFramebuffer(OffscreenFramebuffer const&) = delete;
+    OffscreenFramebuffer(OffscreenFramebuffer&&) = delete;
+    OffscreenFramebuffer& operator=(OffscreenFramebuffer const&) = delete;
+    OffscreenFramebuffer& operator=(OffscreenFramebuffer&&) = delete;
+    ~OffscreenFramebuffer() noexcept {
+        glDeleteFramebuffers(1, &fbo);
+        glDeleteRenderbuffers(1, &depthStencil);
+        glDeleteRenderbuffers(1, &color);
+    }
+};
+
+// the SDL subsystems a headless app needs
+//
+// it still uses SDL's event queue (e.g. for synthetic events). Without EGL,
+// it also needs video, for its hidden window
+#ifdef GFXPLAY_USE_EGL
+static constexpr Uint32 g_HeadlessSdlFlags = SDL_INIT_EVENTS;
+#else
+static constexpr Uint32 g_HeadlessSdlFlags = SDL_INIT_VIDEO;
+#endif
+
+// everything the app needs when it's headless
+//
+// without EGL, the OpenGL context comes from a hidden window instead, so the
+// app still needs a display (but nothing is shown)
+struct HeadlessContext final {
+    gp::HeadlessConfig config;
+#ifdef GFXPLAY_USE_EGL
+    EglHeadlessContext egl;
+#else
+    SdlWindow hiddenWindow = initMainWindow(true);
+    SdlGLContext hiddenWindowGlContext = initWindowOpenGLContext(hiddenWindow, true);
+#endif
+    OffscreenFramebuffer fbo;
+
+    // wall-clock duration of each frame stepped so far, in seconds
+    std::vector<float> frameTimes;
+    std::chrono::steady_clock::time_point lastFrameEnd;
+
+    HeadlessContext(gp::HeadlessConfig const& config_) :
+        config{checkHeadlessConfig(config_)},
+        fbo{config.width, config.height} {
+
+        frameTimes.reserve(static_cast<size_t>(std::max(config.numFrames, 0)));
+    }
+
+    [[nodiscard]] static gp::HeadlessConfig const& checkHeadlessConfig(gp::HeadlessConfig const& config) {
+        if (config.width <= 0 || config.height <= 0 || config.numFrames < 0) {
+            std::stringstream ss;
+            ss << "invalid headless config: size = " << config.width << 'x' << config.height << ", numFrames = " << config.numFrames;
+            throw std::runtime_error{std::move(ss).str()};
+        }
+        return config;
+    }
+};
+
+// `App` also maintains these
+//
+// they're needed because purely asking for the mouse state (via SDL_GetMouseState)
+// does provide the latest (lowest-latency) state, but might miss rapid clicks that
+// toggle the state on+off before update is called
+static bool g_MousePressedInEvent[3] = {false, false, false};
+
+static void updateMousePosAndButtons(gp::Io& io, SDL_Window* window) {
+    // update `MousePosPrevious`
+    io.MousePosPrevious = io.MousePos;
+
+    // update `MousePressed[3]`
+    glm::ivec2 mouseLocal;
+    Uint32 mouseState = SDL_GetMouseState(&mouseLocal.x, &mouseLocal.y);
+    io.MousePressed[0] = g_MousePressedInEvent[0] || mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
+    g_MousePressedInEvent[0] = false;
+    io.MousePressed[1] = g_MousePressedInEvent[1] || mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT);
+    g_MousePressedInEvent[1] = false;
+    io.MousePressed[2] = g_MousePressedInEvent[2] || mouseState & SDL_BUTTON(SDL_BUTTON_MIDDLE);
+    g_MousePressedInEvent[2] = false;
+
+    // compute `MousePos`
+    //
+    // this is a little uglier than just querying it from GetMouseState because
+    // the mouse *heavily* affects how laggy the UI feels and other behavior
+    // like whether the mouse should work when another window is focused is
+    // important
+    static bool mouseCanUseGlobalState = strncmp(SDL_GetCurrentVideoDriver(), "wayland", 7) != 0;
+    bool curWindowHasFocus = SDL_GetWindowFlags(window) & SDL_WINDOW_INPUT_FOCUS;
+    if (curWindowHasFocus) {
+        // SDL_GetMouseGlobalState typically gives better mouse positions than
+        // the other methods because it uses a direct OS query for the mouse
+        // position (whereas the other method rely on the event queue, which can
+        // lag a little on Windows)
+        if (mouseCanUseGlobalState) {
+            glm::ivec2 mouseGlobal;
+            SDL_GetGlobalMouseState(&mouseGlobal.x, &mouseGlobal.y);
+            glm::ivec2 mouseWindow;
+            SDL_GetWindowPosition(window, &mouseWindow.x, &mouseWindow.y);
+
+            io.MousePos = mouseGlobal - mouseWindow;
+        } else {
+            io.MousePos = mouseLocal;
+        }
+    }
+
+    io.MousePosDelta = io.MousePos - io.MousePosPrevious;
+
+    // (edge-case)
+    //
+    // if the caller wants to set the mouse position, then it should be
+    // set. However, to ensure that Delta == Cur-Prev, we need to create
+    // a "fake"  *prev* that behaves "as if" the mouse moved from some
+    // location to the warp location
+    if (io.WantMousePosWarpTo && curWindowHasFocus) {
+        SDL_WarpMouseInWindow(window, static_cast<int>(io.MousePosWarpTo.x), static_cast<int>(io.MousePosWarpTo.y));
+        io.MousePosPrevious = io.MousePos - io.MousePosDelta;
+        io.MousePos = io.MousePosWarpTo;
+    }
+}
+
+static void updateKeysDownDurations(gp::Io& io) {
+    // KeysDownDurationPrev
+    std::copy(io.KeysDownDuration.begin(), io.KeysDownDuration.end(), io.KeysDownDurationPrev.begin());
+
+    // KeysDownDuration
+    static_assert(std::tuple_size<decltype(io.KeysDown)>::value == std::tuple_size<decltype(io.KeysDown)>::value);
+    for (size_t i = 0; i < io.KeysDown.size(); ++i) {
+        if (!io.KeysDown[i]) {
+            io.KeysDownDuration[i] = -1.0f;
+        } else {
+            io.KeysDownDuration[i] = io.KeysDownDuration[i] < 0.0f ? 0.0f : io.KeysDownDuration[i] + io.DeltaTime;
+        }
+    }
+}
+
+static void updateIOPoller(gp::Io& io, SDL_Window* window) {
+    GP_ASSERT(window != nullptr && "application is not initialized correctly: not showing a window?");
+
+    // DisplaySize
+    int w, h;
+    SDL_GetWindowSize(window, &w, &h);
+    io.DisplaySize = {w, h};
+
+    // Ticks, (IO ctor: TickFrequency), DeltaTime
+    uint64_t currentTicks = SDL_GetPerformanceCounter();
+    double dTicks = static_cast<double>(currentTicks - io.Ticks);
+    io.DeltaTime = static_cast<float>(dTicks/static_cast<double>(io.TickFrequency));
+    io.Ticks = currentTicks;
+
+    // MousePos, MousePosPrevious, MousePosDelta, MousePressed
+    updateMousePosAndButtons(io, window);
+
+    // (KeysDown, Shift-/Ctrl-/Alt-Down handled by events)
+
+    // KeysDownDurationPrev, KeysDownDuration
+    updateKeysDownDurations(io);
+}
+
+// as above, but for a headless app, which has no window/mouse and steps
+// time by a fixed amount per frame
+static void updateIOPollerHeadless(gp::Io& io, gp::HeadlessConfig const& config) {
+    // DisplaySize
+    io.DisplaySize = {config.width, config.height};
+
+    // Ticks, (IO ctor: TickFrequency), DeltaTime
+    io.DeltaTime = config.deltaTime;
+    io.Ticks += static_cast<uint64_t>(static_cast<double>(config.deltaTime) * static_cast<double>(io.TickFrequency));
+
+    // MousePos, MousePosPrevious, MousePosDelta, MousePressed
+    //
+    // the mouse never moves, but button presses may still come from
+    // (synthetic) events
+    io.MousePosPrevious = io.MousePos;
+    io.MousePosDelta = {0.0f, 0.0f};
+    io.WantMousePosWarpTo = false;
+    for (size_t i = 0; i < io.MousePressed.size(); ++i) {
+        io.MousePressed[i] = g_MousePressedInEvent[i];
+        g_MousePressedInEvent[i] = false;
+    }
+
+    // KeysDownDurationPrev, KeysDownDuration
+    updateKeysDownDurations(io);
+}
+
+gp::Io::Io(SDL_Window* window) :
+    DisplaySize{-1.0f, -1.0f},
+    Ticks{SDL_GetPerformanceCounter()},
+    TickFrequency{SDL_GetPerformanceFrequency()},
+    DeltaTime{0.0f},
+    MousePos{0.0f, 0.0f},
+    MousePosPrevious{0.0f, 0.0f},
+    MousePosDelta{0.0f, 0.0f},
+    WantMousePosWarpTo{false},
+    MousePosWarpTo{-1.0f, -1.0f},
+    MousePressed{false, false, false},
+    // KeysDown: handled below
+    ShiftDown{false},
+    CtrlDown{false},
+    AltDown{false}
+    // KeysDownDuration: handled below
+    // KeysDownDurationPrev: handled below
+    {
+
+    std::fill(KeysDown.begin(), KeysDown.end(), false);
+    std::fill(KeysDownDuration.begin(), KeysDownDuration.end(), -1.0f);
+    std::fill(KeysDownDurationPrev.begin(), KeysDownDurationPrev.end(), -1.0f);
+
+    // (headless apps have no window: the app updates the poller instead)
+    if (window) {
+        updateIOPoller(*this, window);
+    }
+}
+
+std::optional<gp::HeadlessConfig> gp::HeadlessConfig::fromEnvironment() {
+    char const* enabled = std::getenv("GFXPLAY_HEADLESS");
+    if (!enabled || *enabled == '\0' || std::strcmp(enabled, "0") == 0) {
+        return std::nullopt;
+    }
+
+    HeadlessConfig rv;
+
+    if (char const* size = std::getenv("GFXPLAY_HEADLESS_SIZE"); size) {
+        if (std::sscanf(size, "%dx%d", &rv.width, &rv.height) != 2) {
+            std::stringstream ss;
+            ss << "GFXPLAY_HEADLESS_SIZE: invalid value '" << size << "': expected WIDTHxHEIGHT (e.g. 1280x720)";
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+
+    if (char const* frames = std::getenv("GFXPLAY_HEADLESS_FRAMES"); frames) {
+        rv.numFrames = std::atoi(frames);
+    }
+
+    if (char const* dt = std::getenv("GFXPLAY_HEADLESS_DT"); dt) {
+        rv.deltaTime = std::strtof(dt, nullptr);
+    }
+
+    return rv;
+}
+
+// input journal support
+//
+// a journal is a header ("GPINPUT\0", u32 version, u32 sizeof(SDL_Event))
+// followed by one record per frame:
+//
+//     u32 numEvents
+//     SDL_Event[numEvents]  (raw)
+//     Io state              (see `writeIoFrame`)
+//
+// it's written in native byte order, because it's only meant to be replayed
+// by the same build on the same machine (e.g. for before/after benchmarks)
+static constexpr char g_InputJournalMagic[8] = {'G', 'P', 'I', 'N', 'P', 'U', 'T', '\0'};
+static constexpr uint32_t g_InputJournalVersion = 1;
+
+// returns true if the event can be written to a journal as raw bytes (i.e.
+// it doesn't point to any external data)
+static bool isJournalableEvent(SDL_Event const& e) noexcept {
+    switch (e.type) {
+    case SDL_DROPFILE:
+    case SDL_DROPTEXT:
+    case SDL_SYSWMEVENT:
+        return false;
+    default:
+        return e.type < SDL_USEREVENT;
+    }
+}
+
+class InputRecorder final {
+    std::FILE* out;
+    std::string path;
+    std::vector<SDL_Event> frameEvents;
+    size_t numFrames = 0;
+
+    template<typename T>
+    void write(T const& v) {
+        std::fwrite(&v, sizeof(T), 1, out);
+    }
+
+public:
+    explicit InputRecorder(char const* path_) : out{std::fopen(path_, "wb")}, path{path_} {
+        if (!out) {
+            std::stringstream ss;
+            ss << path_ << ": cannot open input journal for writing: " << std::strerror(errno);
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        std::fwrite(g_InputJournalMagic, 1, sizeof(g_InputJournalMagic), out);
+        write(g_InputJournalVersion);
+        write(static_cast<uint32_t>(sizeof(SDL_Event)));
+    }
+
+    InputRecorder(InputRecorder const&) = delete;
+    InputRecorder(InputRecorder&&) = delete;
+    InputRecorder& operator=(InputRecorder const&) = delete;
+    InputRecorder& operator=(InputRecorder&&) = delete;
+
+    ~InputRecorder() noexcept {
+        if (std::fclose(out) != 0) {
+            gp::log::error("%s: error closing input journal: %s", path.c_str(), std::strerror(errno));
+            return;
+        }
+        gp::log::info("%s: recorded %zu frames of input", path.c_str(), numFrames);
+    }
+
+    void onEvent(SDL_Event const& e) {
+        if (isJournalableEvent(e)) {
+            frameEvents.push_back(e);
+        }
+    }
+
+    // writes the frame's events and the (updated) IO state
+    void writeFrame(gp::Io const& io) {
+        write(static_cast<uint32_t>(frameEvents.size()));
+        std::fwrite(frameEvents.data(), sizeof(SDL_Event), frameEvents.size(), out);
+        frameEvents.clear();
+
+        write(io.DisplaySize);
+        write(io.Ticks);
+        write(io.DeltaTime);
+        write(io.MousePos);
+        write(io.MousePosPrevious);
+        write(io.MousePosDelta);
+
+        uint8_t buttons = 0;
+        for (size_t i = 0; i < io.MousePressed.size(); ++i) {
+            buttons |= static_cast<uint8_t>(io.MousePressed[i] << i);
+        }
+        buttons |= static_cast<uint8_t>(io.ShiftDown << 3);
+        buttons |= static_cast<uint8_t>(io.CtrlDown << 4);
+        buttons |= static_cast<uint8_t>(io.AltDown << 5);
+        write(buttons);
+
+        // (KeysDownDuration{,Prev} are derived from KeysDown + DeltaTime)
+        std::array<uint8_t, std::tuple_size_v<decltype(io.KeysDown)> / 8> keys{};
+        for (size_t i = 0; i < io.KeysDown.size(); ++i) {
+            keys[i / 8] |= static_cast<uint8_t>(io.KeysDown[i] << (i % 8));
+        }
+        write(keys);
+
+        if (std::ferror(out)) {
+            std::stringstream ss;
+            ss << path << ": error writing input journal: " << std::strerror(errno);
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        ++numFrames;
+    }
+};
+
+class InputReplayer final {
+    std::FILE* in;
+    std::string path;
+    size_t numFrames = 0;
+
+    // IO state of the last-read frame (see `InputRecorder::writeFrame`)
+    struct {
+        glm::vec2 DisplaySize;
+        uint64_t Ticks;
+        float DeltaTime;
+        glm::vec2 MousePos;
+        glm::vec2 MousePosPrevious;
+        glm::vec2 MousePosDelta;
+        uint8_t buttons;
+        std::array<uint8_t, std::tuple_size_v<decltype(gp::Io::KeysDown)> / 8> keys;
+    } frameIo{};
+
+    template<typename T>
+    [[nodiscard]] bool read(T& v) {
+        return std::fread(&v, sizeof(T), 1, in) == 1;
+    }
+
+    [[noreturn]] void throwInvalid(char const* why) {
+        std::stringstream ss;
+        ss << path << ": invalid input journal: " << why;
+        throw std::runtime_error{std::move(ss).str()};
+    }
+
+public:
+    explicit InputReplayer(char const* path_) : in{std::fopen(path_, "rb")}, path{path_} {
+        if (!in) {
+            std::stringstream ss;
+            ss << path_ << ": cannot open input journal for reading: " << std::strerror(errno);
+            throw std::runtime_error{std::move(ss).str()};
+        }
+
+        try {
+            char magic[sizeof(g_InputJournalMagic)];
+            uint32_t version;
+            uint32_t eventSize;
+            if (std::fread(magic, 1, sizeof(magic), in) != sizeof(magic) ||
+                std::memcmp(magic, g_InputJournalMagic, sizeof(magic)) != 0) {
+                throwInvalid("bad magic number");
+            }
+            if (!read(version) || version != g_InputJournalVersion) {
+                throwInvalid("unsupported version");
+            }
+            if (!read(eventSize) || eventSize != sizeof(SDL_Event)) {
+                throwInvalid("recorded with an incompatible SDL build");
+            }
+        } catch (...) {
+            std::fclose(in);
+            throw;
+        }
+    }
+
+    InputReplayer(InputReplayer const&) = delete;
+    InputReplayer(InputReplayer&&) = delete;
+    InputReplayer& operator=(InputReplayer const&) = delete;
+    InputReplayer& operator=(InputReplayer&&) = delete;
+
+    ~InputReplayer() noexcept {
+        std::fclose(in);
+    }
+
+    [[nodiscard]] size_t numFramesReplayed() const noexcept {
+        return numFrames;
+    }
+
+    [[nodiscard]] char const* filename() const noexcept {
+        return path.c_str();
+    }
+
+    // reads the next frame's events and IO state
+    //
+    // returns false at the end of the journal
+    [[nodiscard]] bool readFrame(std::vector<SDL_Event>& events) {
+        uint32_t numEvents;
+        if (!read(numEvents)) {
+            return false;
+        }
+
+        events.resize(numEvents);
+        if (std::fread(events.data(), sizeof(SDL_Event), numEvents, in) != numEvents) {
+            throwInvalid("truncated frame");
+        }
+
+        if (!read(frameIo.DisplaySize) ||
+            !read(frameIo.Ticks) ||
+            !read(frameIo.DeltaTime) ||
+            !read(frameIo.MousePos) ||
+            !read(frameIo.MousePosPrevious) ||
+            !read(frameIo.MousePosDelta) ||
+            !read(frameIo.buttons) ||
+            !read(frameIo.keys)) {
+
+            throwInvalid("truncated frame");
+        }
+
+        ++numFrames;
+        return true;
+    }
+
+    // sets the IO poller to the state recorded in the last-read frame
+    void applyFrameIo(gp::Io& io) const noexcept {
+        io.DisplaySize = frameIo.DisplaySize;
+        io.Ticks = frameIo.Ticks;
+        io.DeltaTime = frameIo.DeltaTime;
+        io.MousePos = frameIo.MousePos;
+        io.MousePosPrevious = frameIo.MousePosPrevious;
+        io.MousePosDelta = frameIo.MousePosDelta;
+
+        for (size_t i = 0; i < io.MousePressed.size(); ++i) {
+            io.MousePressed[i] = frameIo.buttons & (1u << i);
+        }
+        io.ShiftDown = frameIo.buttons & (1u << 3);
+        io.CtrlDown = frameIo.buttons & (1u << 4);
+        io.AltDown = frameIo.buttons & (1u << 5);
+        for (size_t i = 0; i < io.KeysDown.size(); ++i) {
+            io.KeysDown[i] = frameIo.keys[i / 8] & (1u << (i % 8));
+        }
+
+        // the recorded mouse position already includes the effect of any warp
+        io.WantMousePosWarpTo = false;
+    }
+};
+
+// input state that the fixed-timestep gameloop carries between steps
+//
+// edge-triggered input (the mouse moving, a key being pressed or released)
+// must be reported to exactly one step, even if a frame runs several
+// catch-up steps, or none at all
+struct FixedStepInput final {
+    // mouse movement since the last step
+    glm::vec2 pendingMousePosDelta{0.0f, 0.0f};
+
+    // mouse buttons that were pressed in a frame since the last step
+    std::array<bool, 3> pendingMousePressed{};
+
+    // keys that were pressed (`KeysDownDuration == 0`) in a frame since the
+    // last step
+    std::array<bool, 512> pendingKeysPressed{};
+
+    // `Io::KeysDownDuration`, as seen by the last step
+    std::array<float, 512> stepKeysDownDuration;
+
+    explicit FixedStepInput(gp::Io const& io) :
+        stepKeysDownDuration{io.KeysDownDuration} {
+    }
+};
+
+struct gp::App::Impl final {
+    SdlCtx sdlctx;
+
+    // exactly one of these is set
+    std::unique_ptr<WindowedContext> windowed;
+    std::unique_ptr<HeadlessContext> headless;
+
+    Io io;
+
+    // atomic, because `requestQuit` may be called from `onUpdate`, which
+    // runs on the simulation thread in pipelined mode
+    std::atomic<bool> quit = false;
+
+    // set if the gameloop is in fixed-timestep mode
+    std::optional<FixedTimestep> fixedTimestep;
+
+    // set alongside `fixedTimestep`
+    std::optional<FixedStepInput> fixedStepInput;
+
+    // true if `show` should run the pipelined gameloop
+    bool pipelined = false;
+
+    // set while input is being recorded to, or replayed from, a journal
+    std::unique_ptr<InputRecorder> inputRecorder;
+    std::unique_ptr<InputReplayer> inputReplayer;
+
+    Impl(std::optional<HeadlessConfig> const& headlessConfig) :
+        sdlctx{headlessConfig ? g_HeadlessSdlFlags : SDL_INIT_VIDEO},
+        windowed{headlessConfig ? nullptr : std::make_unique<WindowedContext>()},
+        headless{headlessConfig ? std::make_unique<HeadlessContext>(*headlessConfig) : nullptr},
+        io{windowed ? windowed->window.handle : nullptr} {
+
+        if (headless) {
+            gl::window_fbo_handle = headless->fbo.fbo;
+            glBindFramebuffer(GL_FRAMEBUFFER, headless->fbo.fbo);
+            glViewport(0, 0, headless->config.width, headless->config.height);
+            updateIOPollerHeadless(io, headless->config);
+        }
+    }
+
+    Impl(Impl const&) = delete;
+    Impl(Impl&&) = delete;
+    Impl& operator=(Impl const&) = delete;
+    Impl& operator=(Impl&&) = delete;
+
+    ~Impl() noexcept {
+        gp::prof::releaseGpuQueries();
+        gl::window_fbo_handle = 0;
+    }
+
+    [[nodiscard]] SDL_Window* window() noexcept {
+        return windowed ? windowed->window.handle : nullptr;
+    }
+};
+
+static void logHeadlessFrameStats(HeadlessContext const& ctx) {
+    if (ctx.frameTimes.empty()) {
+        return;
+    }
+
+    std::vector<float> sorted = ctx.frameTimes;
+    std::sort(sorted.begin(), sorted.end());
+    auto percentile = [&sorted](double p) {
+        return 1000.0 * sorted[static_cast<size_t>(p * static_cast<double>(sorted.size() - 1))];
+    };
+    double total = 0.0;
+    for (float t : sorted) {
+        total += t;
+    }
+
+    gp::log::info("headless: stepped %zu frames (%ix%i): mean = %.3f ms, p50 = %.3f ms, p95 = %.3f ms, p99 = %.3f ms, max = %.3f ms",
+                  sorted.size(),
+                  ctx.config.width,
+                  ctx.config.height,
+                  1000.0 * total / static_cast<double>(sorted.size()),
+                  percentile(0.50),
+                  percentile(0.95),
+                  percentile(0.99),
+                  percentile(1.0));
+}
+
+// records the duration of the frame that just finished
+//
+// returns true once all frames have been stepped, after logging frame time
+// statistics
+static bool stepHeadlessFrame(HeadlessContext& ctx) {
+    using clock = std::chrono::steady_clock;
+
+    clock::time_point now = clock::now();
+    ctx.frameTimes.push_back(std::chrono::duration<float>{now - ctx.lastFrameEnd}.count());
+    ctx.lastFrameEnd = now;
+
+    if (ctx.frameTimes.size() < static_cast<size_t>(ctx.config.numFrames)) {
+        return false;
+    }
+
+    logHeadlessFrameStats(ctx);
+    return true;
+}
+
+gp::App* gp::App::g_Current = nullptr;
+gp::Io* gp::App::g_CurrentIO = nullptr;
+
+gp::App::App() : impl{new Impl{HeadlessConfig::fromEnvironment()}} {
+    App::g_Current = this;
+    App::g_CurrentIO = &this->impl->io;
+
+    try {
+        if (char const* path = std::getenv("GFXPLAY_RECORD_INPUT"); path && *path) {
+            startInputRecording(path);
+        }
+        if (char const* path = std::getenv("GFXPLAY_REPLAY_INPUT"); path && *path) {
+            startInputReplay(path);
+        }
+    } catch (...) {
+        App::g_Current = nullptr;
+        App::g_CurrentIO = nullptr;
+        delete impl;
+        throw;
+    }
+}
+
+gp::App::App(HeadlessConfig const& config) : impl{new Impl{config}} {
+    App::g_Current = this;
+    App::g_CurrentIO = &this->impl->io;
+}
+
+gp::App::~App() noexcept {
+    delete impl;
+}
+
+// handles one event at the top level (IO poller, OpenGL) and then passes it
+// to the screen
+//
+// returns false if the application should quit
+static bool handleEvent(gp::App::Impl& impl, gp::Screen& screen, SDL_Event const& e) {
+    // top-level (pre-Screen) event handling
+    //
+    // this maintains some app-level state (Io polling, OpenGL)
+    switch (e.type) {
+    case SDL_QUIT:
+        // quit application
+        return false;
+    case SDL_MOUSEBUTTONDOWN:
+    {
+        // set flags that help the IO poller figure out whether the
+        // user clicked a mouse button during a step
+
+        if (e.button.button == SDL_BUTTON_LEFT) {
+            g_MousePressedInEvent[0] = true;
+        }
+
+        if (e.button.button == SDL_BUTTON_RIGHT) {
+            g_MousePressedInEvent[1] = true;
+        }
+
+        if (e.button.button == SDL_BUTTON_MIDDLE) {
+            g_MousePressedInEvent[2] = true;
+        }
+        break;
+    }
+    case SDL_KEYDOWN:
+    case SDL_KEYUP:
+    {
+        // update IO poller keyboard state
+
+        int scanCode = e.key.keysym.scancode;
+        impl.io.KeysDown[scanCode] = e.type == SDL_KEYDOWN;
+        impl.io.ShiftDown = SDL_GetModState() & KMOD_SHIFT;
+        impl.io.CtrlDown = SDL_GetModState() & KMOD_CTRL;
+        impl.io.AltDown = SDL_GetModState() & KMOD_ALT;
+        break;
+    }
+    case SDL_WINDOWEVENT:
+    {
+        // update OpenGL viewport if window was resized
+        //
+        // (replayed events may arrive at a headless app, which has no window)
+        if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED && impl.window()) {
+            int w, h;
+            SDL_GetWindowSize(impl.window(), &w, &h);
+            glViewport(0, 0, w, h);
+        }
+        break;
+    }
+    }
+
+    screen.onEvent(e);
+
+    return true;
+}
+
+// pumps pending events into the IO poller and the screen
+//
+// returns false if the application should quit
+static bool pumpEvents(gp::App::Impl& impl, gp::Screen& screen) {
+    GP_PROFILE_SCOPE("pump events");
+
+    for (SDL_Event e; SDL_PollEvent(&e);) {
+        if (impl.inputRecorder) {
+            impl.inputRecorder->onEvent(e);
+        }
+
+        if (!handleEvent(impl, screen, e)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// updates the IO poller at the start of a frame
+//
+// this assumes all events are processed and that the current screen will
+// expect the IO poller to be in the correct state (deltas, etc.)
+static void updateIO(gp::App::Impl& impl) {
+    if (impl.headless) {
+        updateIOPollerHeadless(impl.io, impl.headless->config);
+    } else {
+        updateIOPoller(impl.io, impl.window());
+    }
+}
+
+// feeds the next frame of the input journal to the IO poller and the screen
+//
+// returns false if the application should quit (incl. at the end of the
+// journal)
+static bool replayInput(gp::App::Impl& impl, gp::Screen& screen) {
+    GP_PROFILE_SCOPE("replay input");
+
+    // live input is ignored during a replay, apart from quitting (e.g. the
+    // user closing the window)
+    for (SDL_Event e; SDL_PollEvent(&e);) {
+        if (e.type == SDL_QUIT) {
+            return false;
+        }
+    }
+
+    std::vector<SDL_Event> events;
+    if (!impl.inputReplayer->readFrame(events)) {
+        gp::log::info("%s: replayed %zu frames of input", impl.inputReplayer->filename(), impl.inputReplayer->numFramesReplayed());
+        impl.inputReplayer.reset();
+        if (impl.headless) {
+            logHeadlessFrameStats(*impl.headless);
+        }
+        return false;
+    }
+
+    for (SDL_Event const& e : events) {
+        if (!handleEvent(impl, screen, e)) {
+            return false;
+        }
+    }
+
+    // the journal's IO state is authoritative, so it's applied after the
+    // events (which also modify it)
+    std::fill(std::begin(g_MousePressedInEvent), std::end(g_MousePressedInEvent), false);
+    impl.inputReplayer->applyFrameIo(impl.io);
+
+    updateKeysDownDurations(impl.io);
+
+    return true;
+}
+
+// prepares the input (events + IO poller) for the next frame, recording or
+// replaying it if an input journal is active
+//
+// returns false if the application should quit
+static bool beginFrame(gp::App::Impl& impl, gp::Screen& screen) {
+    if (impl.inputReplayer) {
+        return replayInput(impl, screen);
     }
 
-    // GLEW
-    if (auto err = glewInit(); err != GLEW_OK) {
-        std::stringstream ss;
-        ss << "glewInit() failed: " << glewGetErrorString(err);
-        throw std::runtime_error{std::move(ss).str()};
+    if (!pumpEvents(impl, screen)) {
+        return false;
     }
+    updateIO(impl);
 
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glEnable(GL_MULTISAMPLE);
+    if (impl.inputRecorder) {
+        impl.inputRecorder->writeFrame(impl.io);
+    }
 
-    return rv;
+    return true;
 }
 
-// `App` also maintains these
+// updates the screen for one frame
 //
-// they're needed because purely asking for the mouse state (via SDL_GetMouseState)
-// does provide the latest (lowest-latency) state, but might miss rapid clicks that
-// toggle the state on+off before update is called
-static bool g_MousePressedInEvent[3] = {false, false, false};
+// the screen's onUpdate may indirectly access App/IO (e.g. to check if the
+// user is clicking anything, moving mouse, etc.)
+//
+// returns the interpolation alpha if the app is in fixed-timestep mode
+static std::optional<float> updateScreen(gp::App::Impl& impl, gp::Screen& screen) {
+    GP_PROFILE_SCOPE("update");
 
-static void updateMousePosAndButtons(gp::Io& io, SDL_Window* window) {
-    // update `MousePosPrevious`
-    io.MousePosPrevious = io.MousePos;
+    if (!impl.fixedTimestep) {
+        screen.onUpdate();
+        return std::nullopt;
+    }
 
-    // update `MousePressed[3]`
-    glm::ivec2 mouseLocal;
-    Uint32 mouseState = SDL_GetMouseState(&mouseLocal.x, &mouseLocal.y);
-    io.MousePressed[0] = g_MousePressedInEvent[0] || mouseState & SDL_BUTTON(SDL_BUTTON_LEFT);
-    g_MousePressedInEvent[0] = false;
-    io.MousePressed[1] = g_MousePressedInEvent[1] || mouseState & SDL_BUTTON(SDL_BUTTON_RIGHT);
-    g_MousePressedInEvent[1] = false;
-    io.MousePressed[2] = g_MousePressedInEvent[2] || mouseState & SDL_BUTTON(SDL_BUTTON_MIDDLE);
-    g_MousePressedInEvent[2] = false;
+    gp::Io& io = impl.io;
+    FixedStepInput& in = *impl.fixedStepInput;
+    int steps = impl.fixedTimestep->advance(io.DeltaTime);
 
-    // compute `MousePos`
+    // accumulate this frame's input edges, so that they aren't lost if no
+    // step runs this frame
+    in.pendingMousePosDelta += io.MousePosDelta;
+    for (size_t i = 0; i < io.MousePressed.size(); ++i) {
+        in.pendingMousePressed[i] = in.pendingMousePressed[i] || io.MousePressed[i];
+    }
+    for (size_t i = 0; i < io.KeysDown.size(); ++i) {
+        in.pendingKeysPressed[i] = in.pendingKeysPressed[i] || io.KeysDownDuration[i] == 0.0f;
+    }
+
+    if (steps == 0) {
+        return static_cast<float>(impl.fixedTimestep->alpha());
+    }
+
+    // update screen in fixed-size steps
     //
-    // this is a little uglier than just querying it from GetMouseState because
-    // the mouse *heavily* affects how laggy the UI feels and other behavior
-    // like whether the mouse should work when another window is focused is
-    // important
-    static bool mouseCanUseGlobalState = strncmp(SDL_GetCurrentVideoDriver(), "wayland", 7) != 0;
-    bool curWindowHasFocus = SDL_GetWindowFlags(window) & SDL_WINDOW_INPUT_FOCUS;
-    if (curWindowHasFocus) {
-        // SDL_GetMouseGlobalState typically gives better mouse positions than
-        // the other methods because it uses a direct OS query for the mouse
-        // position (whereas the other method rely on the event queue, which can
-        // lag a little on Windows)
-        if (mouseCanUseGlobalState) {
-            glm::ivec2 mouseGlobal;
-            SDL_GetGlobalMouseState(&mouseGlobal.x, &mouseGlobal.y);
-            glm::ivec2 mouseWindow;
-            SDL_GetWindowPosition(window, &mouseWindow.x, &mouseWindow.y);
+    // each step sees the input "as if" it was polled just before the step:
+    // the first step sees everything since the last step (incl. frames that
+    // ran no steps), later catch-up steps only see what's still held. This
+    // ensures mouse movement, key presses, and key releases are only seen
+    // once. The frame's IO is restored afterwards, so that drawing (and the
+    // next frame's poll) sees the per-frame values
+    gp::Io frameIo = io;
+    io.DeltaTime = static_cast<float>(impl.fixedTimestep->stepDuration());
+    for (int i = 0; i < steps; ++i) {
+        io.MousePosDelta = i == 0 ? in.pendingMousePosDelta : glm::vec2{0.0f, 0.0f};
+        for (size_t j = 0; j < io.MousePressed.size(); ++j) {
+            io.MousePressed[j] = frameIo.MousePressed[j] || (i == 0 && in.pendingMousePressed[j]);
+        }
+        for (size_t j = 0; j < io.KeysDown.size(); ++j) {
+            io.KeysDown[j] = frameIo.KeysDown[j] || (i == 0 && in.pendingKeysPressed[j]);
+        }
+        io.KeysDownDuration = in.stepKeysDownDuration;
+        updateKeysDownDurations(io);
+        in.stepKeysDownDuration = io.KeysDownDuration;
 
-            io.MousePos = mouseGlobal - mouseWindow;
+        screen.onUpdate();
+    }
+    in.pendingMousePosDelta = {0.0f, 0.0f};
+    in.pendingMousePressed.fill(false);
+    in.pendingKeysPressed.fill(false);
+
+    io.DeltaTime = frameIo.DeltaTime;
+    io.MousePosDelta = frameIo.MousePosDelta;
+    io.MousePressed = frameIo.MousePressed;
+    io.KeysDown = frameIo.KeysDown;
+    io.KeysDownDuration = frameIo.KeysDownDuration;
+    io.KeysDownDurationPrev = frameIo.KeysDownDurationPrev;
+
+    return static_cast<float>(impl.fixedTimestep->alpha());
+}
+
+// presents the frame and performs end-of-frame bookkeeping
+//
+// returns true if the gameloop should stop (e.g. because a headless app has
+// stepped all of its frames)
+static bool endFrame(gp::App::Impl& impl) {
+    // present screen
+    //
+    // effectively, flips the rendered image onto the displayed window
+    {
+        GP_PROFILE_SCOPE("swap");
+        if (impl.headless) {
+            // (headless) wait for the frame to finish, so that frame times
+            // include the rendering work
+            glFinish();
         } else {
-            io.MousePos = mouseLocal;
+            SDL_GL_SwapWindow(impl.window());
         }
     }
 
-    io.MousePosDelta = io.MousePos - io.MousePosPrevious;
+    // mark the frame boundary in the profiler
+    gp::prof::endFrame();
 
-    // (edge-case)
-    //
-    // if the caller wants to set the mouse position, then it should be
-    // set. However, to ensure that Delta == Cur-Prev, we need to create
-    // a "fake"  *prev* that behaves "as if" the mouse moved from some
-    // location to the warp location
-    if (io.WantMousePosWarpTo && curWindowHasFocus) {
-        SDL_WarpMouseInWindow(window, static_cast<int>(io.MousePosWarpTo.x), static_cast<int>(io.MousePosWarpTo.y));
-        io.MousePosPrevious = io.MousePos - io.MousePosDelta;
-        io.MousePos = io.MousePosWarpTo;
-    }
+    // summarize any OpenGL debug messages that were emitted this frame
+    onOpenGlDebugMessagesFrameEnd(g_GLDebugMessages);
+
+    return impl.headless && stepHeadlessFrame(*impl.headless);
 }
 
-static void updateIOPoller(gp::Io& io, SDL_Window* window) {
-    GP_ASSERT(window != nullptr && "application is not initialized correctly: not showing a window?");
+// runs jobs, one at a time, on a dedicated thread
+//
+// used by the pipelined gameloop to update the screen while the main (GL)
+// thread draws the previous frame
+class SimulationThread final {
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::function<void()> job;
+    bool hasJob = false;
+    bool stopRequested = false;
+    std::exception_ptr error;
+    std::thread thread{[this]() { threadMain(); }};
+
+    void threadMain() {
+        gp::prof::setThreadName("simulation");
+
+        std::unique_lock l{mutex};
+        for (;;) {
+            cv.wait(l, [this]() { return hasJob || stopRequested; });
+            if (!hasJob) {
+                return;
+            }
 
-    // DisplaySize
-    int w, h;
-    SDL_GetWindowSize(window, &w, &h);
-    io.DisplaySize = {w, h};
+            l.unlock();
+            std::exception_ptr ex;
+            try {
+                job();
+            } catch (...) {
+                ex = std::current_exception();
+            }
+            l.lock();
 
-    // Ticks, (IO ctor: TickFrequency), DeltaTime
-    uint64_t currentTicks = SDL_GetPerformanceCounter();
-    double dTicks = static_cast<double>(currentTicks - io.Ticks);
-    io.DeltaTime = static_cast<float>(dTicks/static_cast<double>(io.TickFrequency));
-    io.Ticks = currentTicks;
+            error = ex;
+            hasJob = false;
+            cv.notify_all();
+        }
+    }
 
-    // MousePos, MousePosPrevious, MousePosDelta, MousePressed
-    updateMousePosAndButtons(io, window);
+public:
+    SimulationThread() = default;
+    SimulationThread(SimulationThread const&) = delete;
+    SimulationThread(SimulationThread&&) = delete;
+    SimulationThread& operator=(SimulationThread const&) = delete;
+    SimulationThread& operator=(SimulationThread&&) = delete;
+
+    // waits for any in-progress job to finish
+    ~SimulationThread() noexcept {
+        {
+            std::unique_lock l{mutex};
+            cv.wait(l, [this]() { return !hasJob; });
+            stopRequested = true;
+            cv.notify_all();
+        }
+        thread.join();
+    }
 
-    // (KeysDown, Shift-/Ctrl-/Alt-Down handled by events)
+    void start(std::function<void()> f) {
+        std::lock_guard g{mutex};
+        GP_ASSERT(!hasJob && "a simulation job is already running");
+        job = std::move(f);
+        hasJob = true;
+        cv.notify_all();
+    }
 
-    // KeysDownDurationPrev
-    std::copy(io.KeysDownDuration.begin(), io.KeysDownDuration.end(), io.KeysDownDurationPrev.begin());
+    // waits for the job to finish, rethrowing anything it threw
+    void wait() {
+        std::unique_lock l{mutex};
+        cv.wait(l, [this]() { return !hasJob; });
+        if (error) {
+            std::rethrow_exception(std::exchange(error, nullptr));
+        }
+    }
+};
 
-    // KeysDownDuration
-    static_assert(std::tuple_size<decltype(io.KeysDown)>::value == std::tuple_size<decltype(io.KeysDown)>::value);
-    for (size_t i = 0; i < io.KeysDown.size(); ++i) {
-        if (!io.KeysDown[i]) {
-            io.KeysDownDuration[i] = -1.0f;
-        } else {
-            io.KeysDownDuration[i] = io.KeysDownDuration[i] < 0.0f ? 0.0f : io.KeysDownDuration[i] + io.DeltaTime;
+// gameloop: update and draw on the main thread, one after the other
+static void showSerial(gp::App::Impl& impl, gp::Screen& screen) {
+    while (!impl.quit) {
+        if (!beginFrame(impl, screen)) {
+            return;
+        }
+
+        // update + render screen
+        //
+        // draws the screen onto the currently-bound (assumed, window) framebuffer
+        std::optional<float> alpha = updateScreen(impl, screen);
+        {
+            GP_PROFILE_SCOPE("draw");
+            GP_PROFILE_GPU_SCOPE("draw");
+            if (alpha) {
+                // render screen, interpolated between the previous and current step
+                screen.onDrawInterpolated(*alpha);
+            } else {
+                screen.onDraw();
+            }
+        }
+
+        if (endFrame(impl)) {
+            return;
         }
     }
 }
 
-gp::Io::Io(SDL_Window* window) :
-    DisplaySize{-1.0f, -1.0f},
-    Ticks{SDL_GetPerformanceCounter()},
-    TickFrequency{SDL_GetPerformanceFrequency()},
-    DeltaTime{0.0f},
-    MousePos{0.0f, 0.0f},
-    MousePosPrevious{0.0f, 0.0f},
-    MousePosDelta{0.0f, 0.0f},
-    WantMousePosWarpTo{false},
-    MousePosWarpTo{-1.0f, -1.0f},
-    MousePressed{false, false, false},
-    // KeysDown: handled below
-    ShiftDown{false},
-    CtrlDown{false},
-    AltDown{false}
-    // KeysDownDuration: handled below
-    // KeysDownDurationPrev: handled below
-    {
+// gameloop: update frame N+1 on the simulation thread while the main (GL)
+// thread draws (and presents) the snapshot of frame N
+//
+// events and IO polling are handled on the main thread while the simulation
+// thread is idle, so screens never see them change during `onUpdate`
+static void showPipelined(gp::App::Impl& impl, gp::PipelinedScreen& screen) {
+    struct Frame final {
+        std::unique_ptr<gp::RenderSnapshot> snapshot;
+        float alpha = 1.0f;
+    };
 
-    std::fill(KeysDown.begin(), KeysDown.end(), false);
-    std::fill(KeysDownDuration.begin(), KeysDownDuration.end(), -1.0f);
-    std::fill(KeysDownDurationPrev.begin(), KeysDownDurationPrev.end(), -1.0f);
+    auto simulate = [&impl, &screen]() {
+        Frame rv;
+        rv.alpha = updateScreen(impl, screen).value_or(1.0f);
+        GP_PROFILE_SCOPE("snapshot");
+        rv.snapshot = screen.onSnapshot();
+        return rv;
+    };
 
-    updateIOPoller(*this, window);
-}
+    // prime the pipeline with a snapshot of the first update
+    if (!beginFrame(impl, screen)) {
+        return;
+    }
+    Frame front = simulate();
 
-struct gp::App::Impl final {
-    SdlCtx sdlctx{SDL_INIT_VIDEO};
-    SdlWindow window = initMainWindow();
-    SdlGLContext sdlglctx = initWindowOpenGLContext(window);
-    Io io{window};
-    bool quit = false;
-};
+    if (!front.snapshot) {
+        gp::log::warn("pipelined mode is enabled, but the screen's onSnapshot() returned nullptr: falling back to serial updates + draws");
+        screen.onDraw();
+        if (endFrame(impl)) {
+            return;
+        }
+        showSerial(impl, screen);
+        return;
+    }
 
-gp::App* gp::App::g_Current = nullptr;
-gp::Io* gp::App::g_CurrentIO = nullptr;
+    // declared before `sim`, so that they outlive it: if drawing throws
+    // while a job is in flight, `sim`'s destructor waits for the job (which
+    // writes `back`) before either is destroyed
+    Frame back;
+    SimulationThread sim;
 
-gp::App::App() : impl{new Impl{}} {
-    App::g_Current = this;
-    App::g_CurrentIO = &this->impl->io;
-}
+    while (!impl.quit) {
+        if (!beginFrame(impl, screen)) {
+            return;
+        }
 
-gp::App::~App() noexcept {
-    delete impl;
+        sim.start([&]() { back = simulate(); });
+
+        {
+            GP_PROFILE_SCOPE("draw");
+            GP_PROFILE_GPU_SCOPE("draw");
+            screen.onDrawSnapshot(*front.snapshot, front.alpha);
+        }
+        bool done = endFrame(impl);
+
+        sim.wait();
+        if (!back.snapshot) {
+            throw std::runtime_error{"pipelined mode: the screen's onSnapshot() returned nullptr after previously returning a snapshot"};
+        }
+        front = std::move(back);
+
+        if (done) {
+            return;
+        }
+    }
 }
 
 void gp::App::show(std::unique_ptr<Screen> screenptr) {
     Screen& screen = *screenptr;
 
+    gp::prof::setThreadName("main");
+
     screen.onMount();
     GP_SCOPEGUARD({ screen.onUnmount(); });
 
-    while (!impl->quit) {
+    if (impl->headless) {
+        impl->headless->frameTimes.clear();
+        impl->headless->lastFrameEnd = std::chrono::steady_clock::now();
 
-        // pump events
-        for (SDL_Event e; SDL_PollEvent(&e);) {
-
-            // top-level (pre-Screen) event handling
-            //
-            // this maintains some app-level state (Io polling, OpenGL)
-            switch (e.type) {
-            case SDL_QUIT:
-                // quit application
-                return;
-            case SDL_MOUSEBUTTONDOWN:
-            {
-                // set flags that help the IO poller figure out whether the
-                // user clicked a mouse button during a step
+        if (impl->headless->config.numFrames == 0) {
+            return;
+        }
+    }
 
-                if (e.button.button == SDL_BUTTON_LEFT) {
-                    g_MousePressedInEvent[0] = true;
-                }
+    auto* pipelinedScreen = dynamic_cast<PipelinedScreen*>(&screen);
+    if (impl->pipelined && !pipelinedScreen) {
+        gp::log::warn("pipelined mode is enabled, but the screen isn't a PipelinedScreen: falling back to serial updates + draws");
+    }
 
-                if (e.button.button == SDL_BUTTON_RIGHT) {
-                    g_MousePressedInEvent[1] = true;
-                }
+    if (impl->pipelined && pipelinedScreen) {
+        showPipelined(*impl, *pipelinedScreen);
+    } else {
+        showSerial(*impl, screen);
+    }
+}
 
-                if (e.button.button == SDL_BUTTON_MIDDLE) {
-                    g_MousePressedInEvent[2] = true;
-                }
-                break;
-            }
-            case SDL_KEYDOWN:
-            case SDL_KEYUP:
-            {
-                // update IO poller keyboard state
-
-                int scanCode = e.key.keysym.scancode;
-                impl->io.KeysDown[scanCode] = e.type == SDL_KEYDOWN;
-                impl->io.ShiftDown = SDL_GetModState() & KMOD_SHIFT;
-                impl->io.CtrlDown = SDL_GetModState() & KMOD_CTRL;
-                impl->io.AltDown = SDL_GetModState() & KMOD_ALT;
-                break;
-            }
-            case SDL_WINDOWEVENT:
-            {
-                // update OpenGL viewport if window was resized
+void gp::App::startInputRecording(char const* path) {
+    impl->inputRecorder = std::make_unique<InputRecorder>(path);
+}
 
-                if (e.window.event == SDL_WINDOWEVENT_SIZE_CHANGED) {
-                    int w, h;
-                    SDL_GetWindowSize(impl->window, &w, &h);
-                    glViewport(0, 0, w, h);
-                }
-                break;
-            }
-            }
+void gp::App::stopInputRecording() noexcept {
+    impl->inputRecorder.reset();
+}
 
-            screen.onEvent(e);
-        }
+bool gp::App::isRecordingInput() const noexcept {
+    return impl->inputRecorder != nullptr;
+}
 
-        // update IO state
-        //
-        // this assumes all events are processed and that the current screen will
-        // expect the IO poller to be in the correct state (deltas, etc.)
-        updateIOPoller(impl->io, impl->window);
+void gp::App::startInputReplay(char const* path) {
+    impl->inputReplayer = std::make_unique<InputReplayer>(path);
+}
 
-        // update screen
-        //
-        // the screen's onUpdate may indirectly access App/IO (e.g. to check if the
-        // user is clicking anything, moving mouse, etc.)
-        screen.onUpdate();
+void gp::App::stopInputReplay() noexcept {
+    impl->inputReplayer.reset();
+}
 
-        // render screen
-        //
-        // draws the screen onto the currently-bound (assumed, window) framebuffer
-        screen.onDraw();
+bool gp::App::isReplayingInput() const noexcept {
+    return impl->inputReplayer != nullptr;
+}
 
-        // present screen
-        //
-        // effectively, flips the rendered image onto the displayed window
-        SDL_GL_SwapWindow(impl->window);
-    }
+bool gp::App::isHeadless() const noexcept {
+    return impl->headless != nullptr;
 }
 
 void* gp::App::windowRAW() noexcept {
-    return impl->window.handle;
+    return impl->window();
 }
 
 void* gp::App::glRAW() noexcept {
-    return impl->sdlglctx.handle;
+    return impl->windowed ? impl->windowed->sdlglctx.handle : nullptr;
 }
 
 void gp::App::enableRelativeMouseMode() noexcept {
     SDL_SetRelativeMouseMode(SDL_TRUE);
 }
 
+void gp::App::enableFixedTimestep(double stepsPerSecond, int maxCatchUpSteps) {
+    impl->fixedTimestep.emplace(stepsPerSecond, maxCatchUpSteps);
+    impl->fixedStepInput.emplace(impl->io);
+}
+
+void gp::App::disableFixedTimestep() noexcept {
+    impl->fixedTimestep.reset();
+    impl->fixedStepInput.reset();
+}
+
+bool gp::App::isFixedTimestepEnabled() const noexcept {
+    return impl->fixedTimestep.has_value();
+}
+
+void gp::App::enablePipelinedMode() noexcept {
+    impl->pipelined = true;
+}
+
+void gp::App::disablePipelinedMode() noexcept {
+    impl->pipelined = false;
+}
+
+bool gp::App::isPipelinedModeEnabled() const noexcept {
+    return impl->pipelined;
+}
+
 void gp::App::requestQuit() noexcept {
     impl->quit = true;
 }
@@ -539,8 +2698,8 @@ bool gp::App::isOpenGLDebugModeEnabled() noexcept {
     return ::isOpenGlInDebugMode();
 }
 
-void gp::App::enableOpenGLDebugMode() {
-    ::enableOpenGlDebugMode();
+void gp::App::enableOpenGLDebugMode(bool synchronous) {
+    ::enableOpenGlDebugMode(synchronous);
 }
 
 void gp::App::disableOpenGLDebugMode() {
@@ -550,21 +2709,31 @@ void gp::App::disableOpenGLDebugMode() {
 void gp::ImGuiInit() {
     ImGui::CreateContext();
 
+    // (headless apps have no window, so only the renderer backend is used:
+    // `ImGuiNewFrame` feeds ImGui the display size and time instead)
     App& app = App::cur();
-    SDL_Window* window = static_cast<SDL_Window*>(app.windowRAW());
-    SDL_GLContext gl = static_cast<SDL_GLContext>(app.glRAW());
-    ImGui_ImplSDL2_InitForOpenGL(window, gl);
+    if (!app.isHeadless()) {
+        SDL_Window* window = static_cast<SDL_Window*>(app.windowRAW());
+        SDL_GLContext gl = static_cast<SDL_GLContext>(app.glRAW());
+        ImGui_ImplSDL2_InitForOpenGL(window, gl);
+    }
 
     ImGui_ImplOpenGL3_Init("#version 330 core");
 }
 
 void gp::ImGuiShutdown() {
     ImGui_ImplOpenGL3_Shutdown();
-    ImGui_ImplSDL2_Shutdown();
+    if (!App::cur().isHeadless()) {
+        ImGui_ImplSDL2_Shutdown();
+    }
     ImGui::DestroyContext();
 }
 
 bool gp::ImGuiOnEvent(SDL_Event const& e) noexcept {
+    if (App::cur().isHeadless()) {
+        return false;
+    }
+
     ImGui_ImplSDL2_ProcessEvent(&e);
 
     auto const& io = ImGui::GetIO();
@@ -583,7 +2752,14 @@ bool gp::ImGuiOnEvent(SDL_Event const& e) noexcept {
 
 void gp::ImGuiNewFrame() {
     ImGui_ImplOpenGL3_NewFrame();
-    ImGui_ImplSDL2_NewFrame(static_cast<SDL_Window*>(App::cur().windowRAW()));
+    if (App::cur().isHeadless()) {
+        ImGuiIO& io = ImGui::GetIO();
+        io.DisplaySize = {App::IO().DisplaySize.x, App::IO().DisplaySize.y};
+        io.DisplayFramebufferScale = {1.0f, 1.0f};
+        io.DeltaTime = App::IO().DeltaTime;
+    } else {
+        ImGui_ImplSDL2_NewFrame(static_cast<SDL_Window*>(App::cur().windowRAW()));
+    }
     ImGui::NewFrame();
 }
 
@@ -592,6 +2768,81 @@ void gp::ImGuiRender() {
     ImGui_ImplOpenGL3_RenderDrawData(ImGui::GetDrawData());
 }
 
+std::vector<gp::GLDebugMessageStats> gp::getGLDebugMessageStats() {
+    std::vector<GLDebugMessageStats> rv;
+
+    {
+        std::lock_guard g{g_GLDebugMessages.mutex};
+        rv.reserve(g_GLDebugMessages.entries.size());
+        for (auto const& [key, e] : g_GLDebugMessages.entries) {
+            auto [source, type, id] = key;
+            rv.push_back(GLDebugMessageStats{source, type, id, e.severity, e.lastFrameCount, e.maxFrameCount, e.totalCount, e.message});
+        }
+    }
+
+    std::sort(rv.begin(), rv.end(), [](GLDebugMessageStats const& a, GLDebugMessageStats const& b) {
+        return a.totalCount > b.totalCount;
+    });
+
+    return rv;
+}
+
+void gp::resetGLDebugMessageStats() {
+    std::lock_guard g{g_GLDebugMessages.mutex};
+    g_GLDebugMessages.entries.clear();
+}
+
+void gp::setGLDebugMessageReportInterval(std::chrono::milliseconds interval) {
+    std::lock_guard g{g_GLDebugMessages.mutex};
+    g_GLDebugMessages.reportInterval = interval;
+}
+
+void gp::ImGuiGLDebugMessagesPanel() {
+    ImGui::Begin("OpenGL debug messages");
+    GP_SCOPEGUARD({ ImGui::End(); });
+
+    if (!App::cur().isOpenGLDebugModeEnabled()) {
+        ImGui::TextUnformatted("OpenGL debug mode is disabled (see App::enableOpenGLDebugMode)");
+    }
+
+    if (ImGui::Button("reset")) {
+        resetGLDebugMessageStats();
+    }
+
+    std::vector<GLDebugMessageStats> stats = getGLDebugMessageStats();
+
+    ImGuiTableFlags flags = ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg | ImGuiTableFlags_Resizable;
+    if (!ImGui::BeginTable("##gldebugmessages", 6, flags)) {
+        return;
+    }
+
+    ImGui::TableSetupColumn("id");
+    ImGui::TableSetupColumn("type");
+    ImGui::TableSetupColumn("last frame");
+    ImGui::TableSetupColumn("max/frame");
+    ImGui::TableSetupColumn("total");
+    ImGui::TableSetupColumn("message");
+    ImGui::TableHeadersRow();
+
+    for (GLDebugMessageStats const& s : stats) {
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+        ImGui::Text("%u", s.id);
+        ImGui::TableSetColumnIndex(1);
+        ImGui::TextUnformatted(mapGlDebugTypeToString(s.type));
+        ImGui::TableSetColumnIndex(2);
+        ImGui::Text("%llu", static_cast<unsigned long long>(s.lastFrameCount));
+        ImGui::TableSetColumnIndex(3);
+        ImGui::Text("%llu", static_cast<unsigned long long>(s.maxFrameCount));
+        ImGui::TableSetColumnIndex(4);
+        ImGui::Text("%llu", static_cast<unsigned long long>(s.totalCount));
+        ImGui::TableSetColumnIndex(5);
+        ImGui::TextWrapped("%s", s.message.c_str());
+    }
+
+    ImGui::EndTable();
+}
+
 glm::mat4 gp::Euler_perspective_camera::viewMatrix() const noexcept {
     return glm::lookAt(pos, pos + front(), up());
 }
@@ -1264,8 +3515,9 @@ gp::LineTriangleHittestResult gp::lineIntersectsTriangle(glm::vec3 const* v, Lin
         return rv;
     }
 
+    // plane equation: dot(N, P) = D
     float D = glm::dot(N, v[0]);
-    float t =  - (glm::dot(N, l.o) + D) / glm::dot(N, l.d);
+    float t = (D - glm::dot(N, l.o)) / NdotR;
 
     // if triangle plane is behind line then return early
     if (t < 0.0f) {
@@ -5,13 +5,20 @@
 #include <glm/vec3.hpp>
 #include <glm/vec2.hpp>
 
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
 #include <iostream>
 #include <utility>
 #include <memory>
+#include <optional>
 #include <string_view>
 #include <chrono>
 #include <vector>
 #include <array>
+#include <string>
+#include <type_traits>
 
 // logging support
 //
@@ -83,6 +90,11 @@ namespace gp::log {
         virtual ~Sink() noexcept = default;
         virtual void log(Msg const&) = 0;
 
+        // blocks until all messages previously given to `log` have been
+        // written out (only meaningful for sinks that buffer)
+        virtual void flush() {
+        }
+
         void setLevel(level::LevelEnum level) noexcept {
             level_ = level;
         }
@@ -96,10 +108,174 @@ namespace gp::log {
         }
     };
 
+    class Logger;
+
+    // binary (deferred-formatting) logging support
+    //
+    // in binary mode, a logging thread doesn't format anything. It copies the
+    // format string pointer and the raw argument bytes (the layout of which is
+    // worked out at compile time from the `Args...` pack) into a per-thread
+    // buffer. A background consumer thread later decodes+formats the records
+    // and passes them to the logger's sinks, or writes them to a binary log
+    // file that can be decoded offline (see `ak_log-decoder`)
+    //
+    // the format string must have static storage duration (e.g. a literal),
+    // because only its pointer is recorded
+    namespace binary {
+
+        // how an argument is stored in a record, after default argument
+        // promotion (i.e. the same promotion a printf-style call would do)
+        enum class ArgType : uint8_t { I32, U32, I64, U64, F64, Str, Ptr };
+
+        template<typename T>
+        struct DependentFalse final : std::false_type {};
+
+        template<typename T>
+        [[nodiscard]] constexpr ArgType argTypeOf() noexcept {
+            using U = std::decay_t<T>;
+
+            if constexpr (std::is_same_v<U, char*> || std::is_same_v<U, char const*>) {
+                return ArgType::Str;
+            } else if constexpr (std::is_pointer_v<U> || std::is_null_pointer_v<U>) {
+                return ArgType::Ptr;
+            } else if constexpr (std::is_floating_point_v<U>) {
+                return ArgType::F64;
+            } else if constexpr (std::is_enum_v<U>) {
+                return argTypeOf<std::underlying_type_t<U>>();
+            } else if constexpr (std::is_integral_v<U> && sizeof(U) < sizeof(int)) {
+                return ArgType::I32;  // promoted to `int`
+            } else if constexpr (std::is_integral_v<U> && sizeof(U) <= 4) {
+                return std::is_signed_v<U> ? ArgType::I32 : ArgType::U32;
+            } else if constexpr (std::is_integral_v<U> && sizeof(U) <= 8) {
+                return std::is_signed_v<U> ? ArgType::I64 : ArgType::U64;
+            } else {
+                static_assert(DependentFalse<T>::value, "unsupported binary log argument type");
+                return ArgType::Ptr;
+            }
+        }
+
+        // compile-time table of argument types for an `Args...` pack
+        //
+        // has one trailing (unused) element so that an empty pack is valid C++
+        template<typename... Args>
+        struct ArgTypeTable final {
+            static constexpr ArgType values[sizeof...(Args) + 1] = {argTypeOf<Args>()..., ArgType::Ptr};
+        };
+
+        // header at the start of each record in a per-thread buffer
+        struct RecordHeader final {
+            // total size of the record (header + argument bytes), in bytes
+            uint32_t size;
+            uint8_t level;
+            uint8_t nArgs;
+            char const* fmt;
+            ArgType const* argTypes;
+            Logger* logger;
+            int64_t t;  // `std::chrono::system_clock` ticks
+        };
+
+        template<typename T>
+        [[nodiscard]] inline size_t encodedSize(T const& v) noexcept {
+            constexpr ArgType type = argTypeOf<T>();
+
+            if constexpr (type == ArgType::Str) {
+                char const* s = v;
+                return sizeof(uint32_t) + (s ? std::strlen(s) : 0);
+            } else if constexpr (type == ArgType::I32 || type == ArgType::U32) {
+                return 4;
+            } else {
+                return 8;
+            }
+        }
+
+        template<typename T>
+        inline void encode(char*& p, T const& v) noexcept {
+            constexpr ArgType type = argTypeOf<T>();
+
+            if constexpr (type == ArgType::Str) {
+                char const* s = v;
+                uint32_t len = s ? static_cast<uint32_t>(std::strlen(s)) : 0;
+                std::memcpy(p, &len, sizeof(len));
+                std::memcpy(p + sizeof(len), s, len);
+                p += sizeof(len) + len;
+            } else if constexpr (type == ArgType::Ptr) {
+                uint64_t u = static_cast<uint64_t>(reinterpret_cast<uintptr_t>(static_cast<void const*>(v)));
+                std::memcpy(p, &u, sizeof(u));
+                p += sizeof(u);
+            } else if constexpr (type == ArgType::F64) {
+                double d = static_cast<double>(v);
+                std::memcpy(p, &d, sizeof(d));
+                p += sizeof(d);
+            } else if constexpr (type == ArgType::I32) {
+                int32_t i = static_cast<int32_t>(v);
+                std::memcpy(p, &i, sizeof(i));
+                p += sizeof(i);
+            } else if constexpr (type == ArgType::U32) {
+                uint32_t u = static_cast<uint32_t>(v);
+                std::memcpy(p, &u, sizeof(u));
+                p += sizeof(u);
+            } else if constexpr (type == ArgType::I64) {
+                int64_t i = static_cast<int64_t>(v);
+                std::memcpy(p, &i, sizeof(i));
+                p += sizeof(i);
+            } else {
+                uint64_t u = static_cast<uint64_t>(v);
+                std::memcpy(p, &u, sizeof(u));
+                p += sizeof(u);
+            }
+        }
+
+        // reserve `n` contiguous bytes in the calling thread's buffer
+        //
+        // returns `nullptr` (and counts a drop) if the buffer is full. Also
+        // returns `nullptr` once binary logging has shut down (during static
+        // destruction at exit, or while the calling thread is exiting): log
+        // calls made then are no-ops
+        [[nodiscard]] char* reserve(size_t n) noexcept;
+
+        // publish the bytes most recently reserved by the calling thread to
+        // the consumer
+        void commit() noexcept;
+
+        // format a record's arguments according to its printf-style format
+        // string, appending the result to `out`
+        void format(char const* fmt,
+                    ArgType const* argTypes,
+                    size_t nArgs,
+                    char const* args,
+                    size_t argsLen,
+                    std::string& out);
+
+        // make the background consumer write records to a binary log file
+        // (decode it with `decodeFile`) rather than formatting them into
+        // each logger's sinks
+        //
+        // throws if the file cannot be opened
+        void writeToFile(char const* path);
+
+        // blocks until the consumer has processed all records that were
+        // committed before this call
+        void flush();
+
+        struct Stats final {
+            uint64_t written;
+            uint64_t dropped;
+            uint64_t consumed;
+        };
+
+        [[nodiscard]] Stats stats() noexcept;
+
+        // decode a binary log file, writing the formatted messages to `out`
+        //
+        // returns false if the file is not a binary log, or is truncated
+        bool decodeFile(std::FILE* in, std::FILE* out);
+    }
+
     class Logger final {
         std::string name_;
         std::vector<std::shared_ptr<Sink>> sinks_;
         level::LevelEnum level_{level::trace};
+        bool binary_ = false;
 
     public:
         Logger(std::string name) : name_{std::move(name)}, sinks_() {
@@ -108,6 +284,26 @@ namespace gp::log {
         Logger(std::string name, std::shared_ptr<Sink> sink) : name_{std::move(name)}, sinks_{sink} {
         }
 
+        Logger(Logger const&) = delete;
+        Logger(Logger&&) = delete;
+        Logger& operator=(Logger const&) = delete;
+        Logger& operator=(Logger&&) = delete;
+
+        // flushes any binary records that reference this logger
+        ~Logger() noexcept;
+
+        [[nodiscard]] std::string const& name() const noexcept {
+            return name_;
+        }
+
+        // enable/disable binary (deferred-formatting) mode for `trace`, `debug`,
+        // etc. - see `gp::log::binary`
+        void setBinaryMode(bool);
+
+        [[nodiscard]] bool isBinaryMode() const noexcept {
+            return binary_;
+        }
+
         // sink a printf-style log message
         template<typename... Args>
         void log(level::LevelEnum msgLevel, char const* fmt, ...) {
@@ -127,12 +323,71 @@ namespace gp::log {
                 if (rv < 0) {
                     return;
                 }
-                n = std::min(static_cast<size_t>(rv), sizeof(buf));
+
+                if (static_cast<size_t>(rv) >= sizeof(buf)) {
+                    // truncated: make it obvious in the output (binary mode
+                    // does not have this limit)
+                    n = sizeof(buf) - 1;
+                    std::memcpy(buf + n - 3, "...", 3);
+                } else {
+                    n = static_cast<size_t>(rv);
+                }
+            }
+
+            sinkFormatted(msgLevel, std::string_view{buf, n}, std::chrono::system_clock::now());
+        }
+
+        // sink a printf-style log message without formatting it on the calling
+        // thread (see `gp::log::binary`)
+        template<typename... Args>
+        void logBinary(level::LevelEnum msgLevel, char const* fmt, Args const&... args) {
+            static_assert(sizeof...(Args) < 256, "too many arguments for a binary log record");
+
+            if (msgLevel < level_) {
+                return;
             }
 
-            Msg msg{name_, std::string_view{buf, n}, msgLevel};
+            size_t size = sizeof(binary::RecordHeader);
+            ((size += binary::encodedSize(args)), ...);
+
+            char* p = binary::reserve(size);
+            if (!p) {
+                return;  // buffer full: dropped
+            }
+
+            binary::RecordHeader h;
+            h.size = static_cast<uint32_t>(size);
+            h.level = static_cast<uint8_t>(msgLevel);
+            h.nArgs = static_cast<uint8_t>(sizeof...(Args));
+            h.fmt = fmt;
+            h.argTypes = binary::ArgTypeTable<Args...>::values;
+            h.logger = this;
+            h.t = std::chrono::system_clock::now().time_since_epoch().count();
+            std::memcpy(p, &h, sizeof(h));
+            p += sizeof(h);
+
+            (binary::encode(p, args), ...);
+
+            binary::commit();
+        }
+
+        // sink a printf-style log message, using binary mode if it's enabled
+        template<typename... Args>
+        void dispatch(level::LevelEnum msgLevel, char const* fmt, Args const&... args) {
+            if (binary_) {
+                logBinary(msgLevel, fmt, args...);
+            } else {
+                log(msgLevel, fmt, args...);
+            }
+        }
+
+        // sink an already-formatted message
+        void sinkFormatted(level::LevelEnum msgLevel,
+                           std::string_view payload,
+                           std::chrono::system_clock::time_point t) {
+            Msg msg{name_, payload, msgLevel};
+            msg.t = t;
 
-            // sink the message
             for (auto& sink : sinks_) {
                 if (sink->shouldLog(msg.level)) {
                     sink->log(msg);
@@ -142,32 +397,32 @@ namespace gp::log {
 
         template<typename... Args>
         void trace(char const* fmt, Args const&... args) {
-            log(level::trace, fmt, args...);
+            dispatch(level::trace, fmt, args...);
         }
 
         template<typename... Args>
         void debug(char const* fmt, Args const&... args) {
-            log(level::debug, fmt, args...);
+            dispatch(level::debug, fmt, args...);
         }
 
         template<typename... Args>
         void info(char const* fmt, Args const&... args) {
-            log(level::info, fmt, args...);
+            dispatch(level::info, fmt, args...);
         }
 
         template<typename... Args>
         void warn(char const* fmt, Args const&... args) {
-            log(level::warn, fmt, args...);
+            dispatch(level::warn, fmt, args...);
         }
 
         template<typename... Args>
         void error(char const* fmt, Args const&... args) {
-            log(level::err, fmt, args...);
+            dispatch(level::err, fmt, args...);
         }
 
         template<typename... Args>
         void critical(char const* fmt, Args const&... args) {
-            log(level::critical, fmt, args...);
+            dispatch(level::critical, fmt, args...);
         }
 
         [[nodiscard]] std::vector<std::shared_ptr<Sink>> const& sinks() const noexcept {
@@ -177,6 +432,68 @@ namespace gp::log {
         [[nodiscard]] std::vector<std::shared_ptr<Sink>>& sinks() noexcept {
             return sinks_;
         }
+
+        void flush() {
+            for (auto& sink : sinks_) {
+                sink->flush();
+            }
+        }
+    };
+
+    // a sink that asynchronously writes log messages to a C file (e.g. stdout)
+    //
+    // logging threads only copy the (already formatted) message into a bounded
+    // MPSC ring buffer. A background writer thread drains the buffer and writes
+    // messages out in batches (one write + flush per batch), so the logging
+    // thread never waits on the output stream
+    class AsyncSink final : public Sink {
+    public:
+        // what a logging thread should do when the ring buffer is full
+        enum class OverflowPolicy {
+            // drop the message (it is still counted in `Stats::dropped`)
+            drop,
+
+            // yield until the writer thread frees a slot in the buffer
+            block,
+
+            // drop the message, and have the writer thread emit a
+            // "N messages dropped" line once it catches up
+            countAndDrop,
+        };
+
+        struct Stats final {
+            // messages successfully put into the ring buffer
+            uint64_t enqueued;
+
+            // messages dropped because the ring buffer was full
+            uint64_t dropped;
+
+            // messages written to the output by the writer thread
+            uint64_t flushed;
+        };
+
+        struct Impl;
+
+    private:
+        Impl* impl;
+
+    public:
+        // `capacity` is rounded up to the next power of two
+        AsyncSink(std::FILE* out = stdout,
+                  size_t capacity = 1024,
+                  OverflowPolicy policy = OverflowPolicy::countAndDrop);
+        AsyncSink(AsyncSink const&) = delete;
+        AsyncSink(AsyncSink&&) = delete;
+        AsyncSink& operator=(AsyncSink const&) = delete;
+        AsyncSink& operator=(AsyncSink&&) = delete;
+
+        // joins the writer thread, after it has written all enqueued messages
+        ~AsyncSink() noexcept override;
+
+        void log(Msg const&) override;
+        void flush() override;
+
+        [[nodiscard]] Stats stats() const noexcept;
     };
 
     // global logging API
@@ -187,7 +504,7 @@ namespace gp::log {
 
     template<typename... Args>
     inline void log(level::LevelEnum level, char const* fmt, Args const&... args) {
-        defaultLoggerRaw()->log(level, fmt, args...);
+        defaultLoggerRaw()->dispatch(level, fmt, args...);
     }
 
     template<typename... Args>
@@ -244,6 +561,12 @@ namespace gp {
 // rest of the application's concerns (app init, gameloop maintenance, polling,
 // etc.)
 namespace gp {
+    // immutable per-frame state that a screen draws from in pipelined mode
+    // (see `PipelinedScreen::onSnapshot`)
+    struct RenderSnapshot {
+        virtual ~RenderSnapshot() noexcept = default;
+    };
+
     class Screen {
     public:
         virtual ~Screen() noexcept = default;
@@ -264,6 +587,41 @@ namespace gp {
         }
 
         virtual void onDraw() = 0;
+
+        // called instead of `onDraw` when the app is in fixed-timestep mode
+        // (see `App::enableFixedTimestep`)
+        //
+        // `alpha` is how far (0.0 to 1.0) real time has progressed between the
+        // most recent simulation step and the next one. Screens that want smooth
+        // rendering at any display rate should draw their state interpolated
+        // between the previous and current step by `alpha`
+        virtual void onDrawInterpolated(float alpha) {
+            (void)alpha;
+            onDraw();
+        }
+    };
+
+    // a screen that can be updated and drawn concurrently, when the app is in
+    // pipelined mode (see `App::enablePipelinedMode`)
+    //
+    // in that mode, the app only pipelines screens that derive from this:
+    // other screens are updated and drawn serially, so that `onDraw` never
+    // reads state that `onUpdate` is writing on another thread
+    class PipelinedScreen : public Screen {
+    public:
+        // called on the simulation thread, right after `onUpdate`
+        //
+        // should return an immutable copy of everything `onDrawSnapshot` needs,
+        // because the next `onUpdate` runs while the snapshot is being drawn.
+        // Returning `nullptr` makes the app fall back to serial updates/draws
+        [[nodiscard]] virtual std::unique_ptr<RenderSnapshot> onSnapshot() = 0;
+
+        // called on the main (GL) thread, instead of `onDraw`
+        //
+        // `alpha` is as in `onDrawInterpolated` (1.0 if the app isn't in
+        // fixed-timestep mode). Must only read `snapshot`, not the screen's
+        // own (simulated) state
+        virtual void onDrawSnapshot(RenderSnapshot const& snapshot, float alpha) = 0;
     };
 }
 
@@ -332,17 +690,102 @@ namespace gp {
 
         // initialize this struct
         //
-        // must be initialized after (or during) app initialization
+        // must be initialized after (or during) app initialization. `nullptr`
+        // (headless) leaves the window-dependent fields for the app to fill in
         Io(SDL_Window*);
     };
 }
 
+// fixed timestep support
+//
+// converts variable (frame) time into a whole number of fixed-size
+// simulation steps, so that simulation results don't depend on the framerate
+//
+// see: https://gafferongames.com/post/fix_your_timestep/
+namespace gp {
+    class FixedTimestep final {
+        double step_;
+        double accumulator_ = 0.0;
+        int maxStepsPerAdvance_;
+
+    public:
+        FixedTimestep(double stepsPerSecond, int maxStepsPerAdvance) noexcept :
+            step_{1.0/stepsPerSecond},
+            maxStepsPerAdvance_{maxStepsPerAdvance} {
+
+            GP_ASSERT(stepsPerSecond > 0.0);
+            GP_ASSERT(maxStepsPerAdvance > 0);
+        }
+
+        // accumulates `dt` seconds and returns how many steps should be run
+        //
+        // if more than `maxStepsPerAdvance` steps are due (e.g. because a step
+        // is slower than realtime, or the process was paused) then the excess
+        // time is discarded, so the simulation slows down rather than falling
+        // further and further behind
+        [[nodiscard]] int advance(double dt) noexcept {
+            accumulator_ += dt;
+
+            int steps = 0;
+            while (accumulator_ >= step_ && steps < maxStepsPerAdvance_) {
+                accumulator_ -= step_;
+                ++steps;
+            }
+
+            if (steps == maxStepsPerAdvance_ && accumulator_ >= step_) {
+                accumulator_ = 0.0;
+            }
+
+            return steps;
+        }
+
+        // fraction (0.0 to 1.0) of a step that has accumulated but not yet
+        // been stepped
+        [[nodiscard]] double alpha() const noexcept {
+            return accumulator_/step_;
+        }
+
+        // duration of one step, in seconds
+        [[nodiscard]] double stepDuration() const noexcept {
+            return step_;
+        }
+
+        void reset() noexcept {
+            accumulator_ = 0.0;
+        }
+    };
+}
+
 // application support
 //
 // top-level appplication system that initializes all major subsytems
 // (e.g. video, windowing, OpenGL, input) and maintains the top-level
 // gameloop
 namespace gp {
+
+    // configuration for a headless (offscreen) app
+    //
+    // a headless app has no window. It renders into an offscreen framebuffer
+    // (bound via `gl::window_fbo`) through a surfaceless EGL context, so it can
+    // run on machines that have no display or GPU (e.g. CI, with Mesa's
+    // llvmpipe). Builds without EGL (GFXPLAY_USE_EGL) get their context from
+    // a hidden window instead, so they still need a display. `App::show` steps exactly `numFrames` frames, each with a
+    // synthetic `Io::DeltaTime`, logs frame-time statistics, and returns
+    struct HeadlessConfig final {
+        int width = 1280;
+        int height = 720;
+        int numFrames = 600;
+        float deltaTime = 1.0f/60.0f;
+
+        // returns a config if the `GFXPLAY_HEADLESS` environment variable is
+        // set to a non-zero value. The defaults can be overridden with:
+        //
+        //     GFXPLAY_HEADLESS_SIZE=1920x1080
+        //     GFXPLAY_HEADLESS_FRAMES=100
+        //     GFXPLAY_HEADLESS_DT=0.008333
+        [[nodiscard]] static std::optional<HeadlessConfig> fromEnvironment();
+    };
+
     class App final {
     public:
         struct Impl;
@@ -363,7 +806,13 @@ namespace gp {
             return *g_CurrentIO;
         }
 
+        // creates a windowed app, or a headless one if the environment asks for
+        // it (see `HeadlessConfig::fromEnvironment`)
         App();
+
+        // creates a headless app
+        explicit App(HeadlessConfig const&);
+
         App(App const&) = delete;
         App(App&&) = delete;
         ~App() noexcept;
@@ -384,10 +833,16 @@ namespace gp {
             this->show(std::make_unique<TScreen>(std::forward(args)...));
         }
 
+        [[nodiscard]] bool isHeadless() const noexcept;
+
         // raw handle to underlying window implementation
+        //
+        // `nullptr` if the app is headless
         void* windowRAW() noexcept;
 
         // raw handle to underlying OpenGL context for window
+        //
+        // `nullptr` if the app is headless
         void* glRAW() noexcept;
 
         // "grabs" the mouse in the screen, hiding it and making it "stick"
@@ -397,6 +852,63 @@ namespace gp {
         // stuck in (e.g.) the corner
         void enableRelativeMouseMode() noexcept;
 
+        // switches the gameloop to fixed-timestep mode
+        //
+        // in this mode, `Screen::onUpdate` is called zero or more times per
+        // frame, such that it's called `stepsPerSecond` times per second on
+        // average, with `Io::DeltaTime` set to the step duration. At most
+        // `maxCatchUpSteps` steps are run per frame. `Screen::onDrawInterpolated`
+        // is then called once per frame (instead of `Screen::onDraw`)
+        //
+        // during `onUpdate`, the IO's mouse movement and key durations are
+        // per-step, so a key press/release (or mouse click) is seen by
+        // exactly one step, even if it happened in a frame that ran no steps
+        void enableFixedTimestep(double stepsPerSecond = 120.0, int maxCatchUpSteps = 8);
+
+        // switches the gameloop back to calling `Screen::onUpdate` once per frame
+        void disableFixedTimestep() noexcept;
+
+        [[nodiscard]] bool isFixedTimestepEnabled() const noexcept;
+
+        // switches the gameloop to pipelined mode (takes effect in the next
+        // call to `show`)
+        //
+        // in this mode, `Screen::onUpdate` + `PipelinedScreen::onSnapshot`
+        // run on a separate simulation thread, overlapping with the main
+        // thread drawing (`PipelinedScreen::onDrawSnapshot`) and presenting
+        // the previous frame's snapshot. This adds one frame of latency.
+        // `onUpdate` must not call OpenGL, because the GL context is only
+        // current on the main thread. Screens that aren't `PipelinedScreen`s
+        // are still updated and drawn serially
+        void enablePipelinedMode() noexcept;
+        void disablePipelinedMode() noexcept;
+        [[nodiscard]] bool isPipelinedModeEnabled() const noexcept;
+
+        // records the input of each subsequent frame (the SDL events pumped
+        // during it + the resulting `Io` state) to a binary journal at `path`
+        //
+        // `App()` starts a recording if `GFXPLAY_RECORD_INPUT=path` is set
+        //
+        // throws if the journal cannot be opened
+        void startInputRecording(char const* path);
+        void stopInputRecording() noexcept;
+        [[nodiscard]] bool isRecordingInput() const noexcept;
+
+        // replays a journal written by `startInputRecording`: each subsequent
+        // frame feeds the recorded events to the screen and sets `Io` to its
+        // recorded state (incl. `DeltaTime`), instead of polling the OS, so
+        // that screens see exactly the same input as during the recording.
+        // The gameloop ends when the journal runs out of frames (or, for a
+        // headless app, after `HeadlessConfig::numFrames`, whichever is first)
+        //
+        // `App()` starts a replay if `GFXPLAY_REPLAY_INPUT=path` is set, which
+        // can be combined with `GFXPLAY_HEADLESS` for repeatable benchmarks
+        //
+        // throws if the journal cannot be opened, or is invalid
+        void startInputReplay(char const* path);
+        void stopInputReplay() noexcept;
+        [[nodiscard]] bool isReplayingInput() const noexcept;
+
         // requst the app quits
         //
         // the app will only check for this at the *start* of a frame
@@ -404,7 +916,13 @@ namespace gp {
 
         // returns true if OpenGL debugging is enabled
         bool isOpenGLDebugModeEnabled() noexcept;
-        void enableOpenGLDebugMode();
+
+        // enables OpenGL debug messages (see `GLDebugMessageStats`)
+        //
+        // synchronous mode makes the driver emit each message from within the
+        // GL call that caused it, which is handy for breakpointing, but
+        // serializes the driver
+        void enableOpenGLDebugMode(bool synchronous = true);
         void disableOpenGLDebugMode();
 
         float aspectRatio() const noexcept {
@@ -413,6 +931,42 @@ namespace gp {
     };
 }
 
+// OpenGL debug message support
+//
+// when OpenGL debug mode is enabled, driver messages are aggregated by
+// (source, type, id). The first occurrence of a message is logged
+// immediately. Repeats are only counted, and are summarized in the log (one
+// line per message) once per report interval
+namespace gp {
+    struct GLDebugMessageStats final {
+        unsigned source;
+        unsigned type;
+        unsigned id;
+        unsigned severity;
+
+        // occurrences during the most recently completed frame
+        uint64_t lastFrameCount;
+
+        // highest number of occurrences during any one frame
+        uint64_t maxFrameCount;
+
+        uint64_t totalCount;
+
+        // message text of the first occurrence
+        std::string message;
+    };
+
+    // returns the stats of all messages seen so far, most frequent first
+    [[nodiscard]] std::vector<GLDebugMessageStats> getGLDebugMessageStats();
+
+    // forget all messages seen so far (the next occurrence of each is logged
+    // in full again)
+    void resetGLDebugMessageStats();
+
+    // set how often repeated messages are summarized in the log (default: 5 s)
+    void setGLDebugMessageReportInterval(std::chrono::milliseconds);
+}
+
 // ImGui support
 //
 // enables support for ImGui UI rendering: handy for debugging a screen
@@ -432,6 +986,12 @@ namespace gp {
 
     // should be called at the end of `draw()`
     void ImGuiRender();
+
+    // draws a panel that lists each OpenGL debug message with its per-frame
+    // and total counts (see `getGLDebugMessageStats`)
+    //
+    // should be called between `ImGuiNewFrame` and `ImGuiRender`
+    void ImGuiGLDebugMessagesPanel();
 }
 
 // scope guard support
@@ -753,6 +1313,13 @@ namespace gp {
         return a.min == a.max;
     }
 
+    // returns true if the provided AABBs overlap (touching counts)
+    [[nodiscard]] inline constexpr bool aabbsIntersect(AABB const& a, AABB const& b) noexcept {
+        return a.min.x <= b.max.x && b.min.x <= a.max.x &&
+               a.min.y <= b.max.y && b.min.y <= a.max.y &&
+               a.min.z <= b.max.z && b.min.z <= a.max.z;
+    }
+
     // returns the *index* of the longest dimension of an AABB
     [[nodiscard]] inline constexpr glm::vec3::length_type aabbLongestDimension(AABB const& a) noexcept {
         glm::vec3 dims = aabbDimensions(a);
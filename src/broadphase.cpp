@@ -0,0 +1,299 @@
+#include "broadphase.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace {
+    // one end of an object's AABB along an axis
+    struct Endpoint final {
+        float value;
+
+        // object index << 1 | (1 if this is the max endpoint)
+        uint32_t data;
+
+        [[nodiscard]] uint32_t object() const noexcept {
+            return data >> 1;
+        }
+
+        [[nodiscard]] bool isMax() const noexcept {
+            return data & 1;
+        }
+    };
+
+    // sort order of endpoints: mins sort before maxes with the same value,
+    // so that touching AABBs overlap (as in `aabbsIntersect`)
+    bool endpointLess(Endpoint const& a, Endpoint const& b) noexcept {
+        return a.value < b.value || (a.value == b.value && !a.isMax() && b.isMax());
+    }
+
+    struct ActiveObject final {
+        gp::AABB aabb;
+        uint32_t object;
+    };
+
+    uint64_t pairKey(uint32_t a, uint32_t b) noexcept {
+        if (a > b) {
+            std::swap(a, b);
+        }
+        return static_cast<uint64_t>(a) << 32 | b;
+    }
+
+    gp::OverlapPair keyPair(uint64_t key) noexcept {
+        return gp::OverlapPair{static_cast<uint32_t>(key >> 32), static_cast<uint32_t>(key)};
+    }
+
+    // appends an event for each pair that's in `after` but not `before`
+    // (`Begin`) or vice-versa (`End`): both must be sorted
+    void diffPairs(std::vector<gp::OverlapPair> const& before,
+                   std::vector<gp::OverlapPair> const& after,
+                   std::vector<gp::OverlapEvent>& out) {
+        auto b = before.begin();
+        auto a = after.begin();
+        while (b != before.end() || a != after.end()) {
+            if (a == after.end() || (b != before.end() && *b < *a)) {
+                out.push_back(gp::OverlapEvent{gp::OverlapEventType::End, *b++});
+            } else if (b == before.end() || *a < *b) {
+                out.push_back(gp::OverlapEvent{gp::OverlapEventType::Begin, *a++});
+            } else {
+                ++a;
+                ++b;
+            }
+        }
+    }
+}
+
+struct gp::SweepAndPrune::Impl final {
+    SweepAndPruneParams params;
+
+    // the objects' current AABBs
+    std::vector<AABB> aabbs;
+
+    // per sorted axis: every object's endpoints, sorted by `endpointLess`
+    std::vector<Endpoint> endpoints[3];
+
+    // (1 axis) the axis that's sorted, and the overlapping pairs (sorted)
+    int sweepAxis = 0;
+    std::vector<OverlapPair> sweptPairs;
+    std::vector<OverlapPair> prevSweptPairs;
+
+    // (3 axes) the overlapping pairs, as `pairKey`s
+    std::unordered_set<uint64_t> pairSet;
+
+    // reused by `sweep`: the objects whose intervals overlap the sweep line
+    // (with copies of their AABBs, so that testing against them reads
+    // contiguous memory), and where each object is in `active`
+    std::vector<ActiveObject> active;
+    std::vector<uint32_t> activePos;
+
+    uint64_t numSwaps = 0;
+
+    Impl(SweepAndPruneParams const& params_) : params{params_} {
+        if (params.numAxes != 1 && params.numAxes != 3) {
+            std::stringstream ss;
+            ss << "SweepAndPrune: numAxes must be 1 or 3 (got " << params.numAxes << ')';
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+
+    [[nodiscard]] size_t numSortedAxes() const noexcept {
+        return params.numAxes;
+    }
+
+    [[nodiscard]] int axisOf(size_t i) const noexcept {
+        return params.numAxes == 1 ? sweepAxis : static_cast<int>(i);
+    }
+
+    // copies the current AABBs into the endpoints (in their existing order)
+    void refreshEndpoints() noexcept {
+        for (size_t i = 0; i < numSortedAxes(); ++i) {
+            int axis = axisOf(i);
+            for (Endpoint& e : endpoints[i]) {
+                AABB const& a = aabbs[e.object()];
+                e.value = e.isMax() ? a.max[axis] : a.min[axis];
+            }
+        }
+    }
+
+    // writes every overlapping pair into `out` (sorted), by sweeping along
+    // `endpoints[0]` and testing the AABBs of the objects that overlap along it
+    void sweep(std::vector<OverlapPair>& out) {
+        out.clear();
+        active.clear();
+        activePos.resize(aabbs.size());
+
+        for (Endpoint const& e : endpoints[0]) {
+            uint32_t obj = e.object();
+            if (!e.isMax()) {
+                AABB const& aabb = aabbs[obj];
+                for (ActiveObject const& other : active) {
+                    if (aabbsIntersect(aabb, other.aabb)) {
+                        out.push_back(OverlapPair{std::min(obj, other.object), std::max(obj, other.object)});
+                    }
+                }
+                activePos[obj] = static_cast<uint32_t>(active.size());
+                active.push_back(ActiveObject{aabb, obj});
+            } else {
+                // swap-remove it from the active list
+                uint32_t pos = activePos[obj];
+                active[pos] = active.back();
+                activePos[active[pos].object] = pos;
+                active.pop_back();
+            }
+        }
+
+        std::sort(out.begin(), out.end());
+    }
+
+    // sorts `endpoints[i]` with insertion sort
+    //
+    // insertion sort swaps each out-of-order pair of endpoints exactly once.
+    // With 3 axes, a min passing a max (leftwards) means that the two objects
+    // started overlapping along this axis, so they overlap if their AABBs
+    // do. A max passing a min means that they stopped overlapping along this
+    // axis, so they don't overlap at all
+    void insertionSort(size_t i, std::vector<OverlapEvent>& events) {
+        std::vector<Endpoint>& eps = endpoints[i];
+        bool trackPairs = params.numAxes == 3;
+
+        for (size_t j = 1; j < eps.size(); ++j) {
+            Endpoint e = eps[j];
+            size_t k = j;
+            while (k > 0 && endpointLess(e, eps[k-1])) {
+                Endpoint const& o = eps[k-1];
+                ++numSwaps;
+
+                if (trackPairs && e.isMax() != o.isMax() && e.object() != o.object()) {
+                    uint64_t key = pairKey(e.object(), o.object());
+                    if (!e.isMax()) {
+                        if (aabbsIntersect(aabbs[e.object()], aabbs[o.object()]) && pairSet.insert(key).second) {
+                            events.push_back(OverlapEvent{OverlapEventType::Begin, keyPair(key)});
+                        }
+                    } else if (pairSet.erase(key)) {
+                        events.push_back(OverlapEvent{OverlapEventType::End, keyPair(key)});
+                    }
+                }
+
+                eps[k] = o;
+                --k;
+            }
+            eps[k] = e;
+        }
+    }
+
+    // rebuilds the endpoint lists + pairs from scratch
+    void rebuild(std::vector<OverlapEvent>& events) {
+        size_t n = aabbs.size();
+
+        // sweep along the axis that the objects' centers are most spread out
+        // along, so that the fewest objects overlap along it
+        if (params.numAxes == 1 && n > 0) {
+            glm::vec3 mean{0.0f};
+            for (AABB const& a : aabbs) {
+                mean += aabbCenter(a);
+            }
+            mean /= static_cast<float>(n);
+
+            glm::vec3 variance{0.0f};
+            for (AABB const& a : aabbs) {
+                glm::vec3 d = aabbCenter(a) - mean;
+                variance += d*d;
+            }
+            sweepAxis = variance.x >= variance.y && variance.x >= variance.z ? 0 : variance.y >= variance.z ? 1 : 2;
+        }
+
+        for (size_t i = 0; i < numSortedAxes(); ++i) {
+            std::vector<Endpoint>& eps = endpoints[i];
+            eps.clear();
+            eps.reserve(2*n);
+            for (uint32_t obj = 0; obj < n; ++obj) {
+                eps.push_back(Endpoint{0.0f, obj << 1});
+                eps.push_back(Endpoint{0.0f, obj << 1 | 1});
+            }
+        }
+        refreshEndpoints();
+        for (size_t i = 0; i < numSortedAxes(); ++i) {
+            std::sort(endpoints[i].begin(), endpoints[i].end(), endpointLess);
+        }
+
+        std::vector<OverlapPair> before;
+        if (params.numAxes == 1) {
+            before = std::move(sweptPairs);
+        } else {
+            for (uint64_t key : pairSet) {
+                before.push_back(keyPair(key));
+            }
+            std::sort(before.begin(), before.end());
+        }
+
+        sweep(sweptPairs);
+        diffPairs(before, sweptPairs, events);
+
+        if (params.numAxes == 3) {
+            pairSet.clear();
+            for (OverlapPair const& p : sweptPairs) {
+                pairSet.insert(pairKey(p.a, p.b));
+            }
+            sweptPairs.clear();
+        }
+    }
+
+    void update(AABB const* newAABBs, size_t n, std::vector<OverlapEvent>& events) {
+        size_t firstEvent = events.size();
+        numSwaps = 0;
+
+        bool sizeChanged = n != aabbs.size();
+        aabbs.assign(newAABBs, newAABBs + n);
+
+        if (sizeChanged) {
+            rebuild(events);
+        } else {
+            refreshEndpoints();
+            for (size_t i = 0; i < numSortedAxes(); ++i) {
+                insertionSort(i, events);
+            }
+
+            if (params.numAxes == 1) {
+                std::swap(prevSweptPairs, sweptPairs);
+                sweep(sweptPairs);
+                diffPairs(prevSweptPairs, sweptPairs, events);
+            }
+        }
+
+        std::sort(events.begin() + static_cast<ptrdiff_t>(firstEvent), events.end(), [](OverlapEvent const& a, OverlapEvent const& b) {
+            return a.pair < b.pair;
+        });
+    }
+};
+
+gp::SweepAndPrune::SweepAndPrune(SweepAndPruneParams const& params) :
+    impl{new Impl{params}} {
+}
+
+gp::SweepAndPrune::~SweepAndPrune() noexcept {
+    delete impl;
+}
+
+void gp::SweepAndPrune::update(AABB const* aabbs, size_t n, std::vector<OverlapEvent>& events) {
+    impl->update(aabbs, n, events);
+}
+
+void gp::SweepAndPrune::pairs(std::vector<OverlapPair>& out) const {
+    size_t first = out.size();
+    if (impl->params.numAxes == 1) {
+        out.insert(out.end(), impl->sweptPairs.begin(), impl->sweptPairs.end());
+    } else {
+        for (uint64_t key : impl->pairSet) {
+            out.push_back(keyPair(key));
+        }
+        std::sort(out.begin() + static_cast<ptrdiff_t>(first), out.end());
+    }
+}
+
+gp::SweepAndPrune::Stats gp::SweepAndPrune::stats() const noexcept {
+    Stats rv;
+    rv.numSwaps = impl->numSwaps;
+    rv.numPairs = impl->params.numAxes == 1 ? impl->sweptPairs.size() : impl->pairSet.size();
+    return rv;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include "app.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// collision broadphase support
+//
+// finds the pairs of objects whose AABBs overlap, so that only those pairs
+// need an exact (narrowphase) collision test
+namespace gp {
+
+    // a pair of objects whose AABBs overlap (`a < b`)
+    struct OverlapPair final {
+        uint32_t a;
+        uint32_t b;
+    };
+
+    [[nodiscard]] inline bool operator==(OverlapPair const& x, OverlapPair const& y) noexcept {
+        return x.a == y.a && x.b == y.b;
+    }
+
+    [[nodiscard]] inline bool operator<(OverlapPair const& x, OverlapPair const& y) noexcept {
+        return x.a < y.a || (x.a == y.a && x.b < y.b);
+    }
+
+    enum class OverlapEventType {
+        // the pair started overlapping
+        Begin,
+
+        // the pair stopped overlapping
+        End,
+    };
+
+    struct OverlapEvent final {
+        OverlapEventType type;
+        OverlapPair pair;
+    };
+
+    struct SweepAndPruneParams final {
+        // number of axes whose endpoints are kept sorted: 1 or 3
+        //
+        // 1: the overlapping pairs are found by sweeping along one axis (the
+        // one the objects are most spread out along) on every update, and
+        // diffed against the last update's to get events. Cheap per object,
+        // but each update costs at least as much as the pairs that overlap
+        // along that axis
+        //
+        // 3: the overlapping pairs are kept in a set, which is updated
+        // whenever sorting swaps two endpoints, so an update only costs as
+        // much as the objects moved. Best when the objects move coherently
+        // (i.e. a little each frame)
+        size_t numAxes = 3;
+    };
+
+    // a persistent sweep-and-prune (SAP) broadphase
+    //
+    // keeps each object's AABB endpoints (min + max) in sorted lists, one per
+    // axis. Objects usually only move a little between updates, so the lists
+    // are re-sorted with insertion sort, which is close to O(n) when they're
+    // nearly sorted already
+    class SweepAndPrune final {
+    public:
+        struct Stats final {
+            // endpoint swaps that the last update's sorting did
+            uint64_t numSwaps;
+
+            // currently-overlapping pairs
+            size_t numPairs;
+        };
+
+        struct Impl;
+
+    private:
+        Impl* impl;
+
+    public:
+        SweepAndPrune(SweepAndPruneParams const& params = {});
+        SweepAndPrune(SweepAndPrune const&) = delete;
+        SweepAndPrune(SweepAndPrune&&) = delete;
+        SweepAndPrune& operator=(SweepAndPrune const&) = delete;
+        SweepAndPrune& operator=(SweepAndPrune&&) = delete;
+        ~SweepAndPrune() noexcept;
+
+        // updates to the objects' current AABBs (object `i` is `aabbs[i]`),
+        // and appends a `Begin`/`End` event to `events` for each pair that
+        // started/stopped overlapping since the last update (sorted by pair)
+        //
+        // if the number of objects changes, the lists are rebuilt from
+        // scratch, and objects are still matched up by index
+        void update(AABB const* aabbs, size_t n, std::vector<OverlapEvent>& events);
+
+        void update(std::vector<AABB> const& aabbs, std::vector<OverlapEvent>& events) {
+            update(aabbs.data(), aabbs.size(), events);
+        }
+
+        // appends every currently-overlapping pair to `out` (sorted)
+        void pairs(std::vector<OverlapPair>& out) const;
+
+        [[nodiscard]] Stats stats() const noexcept;
+    };
+}
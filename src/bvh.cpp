@@ -0,0 +1,1401 @@
+#include "bvh.hpp"
+#include "parallel.hpp"
+
+#include <glm/matrix.hpp>
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+#ifdef GP_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    // a primitive, as seen by the builder
+    struct BVHBuildPrim final {
+        gp::AABB bounds;
+        glm::vec3 centroid;
+        uint32_t index;
+    };
+
+    // a subtree that's built by a worker thread
+    struct BVHBuildTask final {
+        size_t first;
+        size_t n;
+        size_t depth;
+        std::vector<gp::BVHNode> nodes;
+    };
+
+    struct BVHBuilder final {
+        gp::BVHBuildParams params;
+
+        // partitioned in-place during the build, which leaves it in leaf
+        // order. Subtrees only touch their own range, so tasks can share it
+        std::vector<BVHBuildPrim> prims;
+
+        // subtrees smaller than this become tasks (0 == build serially)
+        size_t taskCutoff = 0;
+        std::vector<BVHBuildTask> tasks;
+    };
+
+    // how a node's primitives should be split
+    struct BVHSplit final {
+        bool makeLeaf;
+        size_t nLeft;
+        uint8_t axis;
+    };
+}
+
+static float surfaceArea(gp::AABB const& a) noexcept {
+    glm::vec3 d = gp::aabbDimensions(a);
+    return 2.0f * (d.x*d.y + d.y*d.z + d.z*d.x);
+}
+
+// partitions `prims[first, first+n)` at the SAH-optimal bin boundary
+//
+// returns false if there's no valid split, or if a leaf is cheaper
+static bool sahSplit(BVHBuilder& b, size_t first, size_t n, gp::AABB const& bounds, gp::AABB const& centroidBounds, BVHSplit& out) {
+    struct Bin final {
+        gp::AABB bounds;
+        size_t count;
+    };
+
+    size_t numBins = std::clamp(b.params.numBins, size_t{2}, gp::bvhMaxBins);
+    auto begin = b.prims.begin() + static_cast<ptrdiff_t>(first);
+    auto end = begin + static_cast<ptrdiff_t>(n);
+
+    // bin the centroids along all three dimensions in one pass
+    glm::vec3 lo = centroidBounds.min;
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; ++axis) {
+        scale[axis] = extent[axis] > 0.0f ? static_cast<float>(numBins) / extent[axis] : 0.0f;
+    }
+
+    std::array<std::array<Bin, gp::bvhMaxBins>, 3> bins;
+    for (int axis = 0; axis < 3; ++axis) {
+        for (size_t i = 0; i < numBins; ++i) {
+            bins[axis][i] = Bin{{glm::vec3{FLT_MAX}, glm::vec3{-FLT_MAX}}, 0};
+        }
+    }
+    for (auto it = begin; it != end; ++it) {
+        glm::vec3 pos = (it->centroid - lo) * scale;
+        for (int axis = 0; axis < 3; ++axis) {
+            Bin& bin = bins[axis][std::min(numBins - 1, static_cast<size_t>(pos[axis]))];
+            bin.bounds.min = glm::min(bin.bounds.min, it->bounds.min);
+            bin.bounds.max = glm::max(bin.bounds.max, it->bounds.max);
+            ++bin.count;
+        }
+    }
+
+    float bestCost = FLT_MAX;
+    int bestAxis = -1;
+    size_t bestBin = 0;
+
+    for (int axis = 0; axis < 3; ++axis) {
+        if (scale[axis] == 0.0f) {
+            continue;
+        }
+
+        // sweep from the right, so that the left sweep can compute each
+        // split's cost in one pass
+        std::array<float, gp::bvhMaxBins> rightCost;
+        gp::AABB acc{glm::vec3{FLT_MAX}, glm::vec3{-FLT_MAX}};
+        size_t count = 0;
+        for (size_t i = numBins - 1; i > 0; --i) {
+            if (bins[axis][i].count) {
+                acc = gp::aabbUnion(acc, bins[axis][i].bounds);
+                count += bins[axis][i].count;
+            }
+            rightCost[i] = count ? surfaceArea(acc) * static_cast<float>(count) : 0.0f;
+        }
+
+        acc = gp::AABB{glm::vec3{FLT_MAX}, glm::vec3{-FLT_MAX}};
+        count = 0;
+        for (size_t i = 0; i < numBins - 1; ++i) {
+            if (bins[axis][i].count) {
+                acc = gp::aabbUnion(acc, bins[axis][i].bounds);
+                count += bins[axis][i].count;
+            }
+            float leftCost = count ? surfaceArea(acc) * static_cast<float>(count) : 0.0f;
+            float cost = leftCost + rightCost[i+1];
+            if (count > 0 && count < n && cost < bestCost) {
+                bestCost = cost;
+                bestAxis = axis;
+                bestBin = i;
+            }
+        }
+    }
+
+    if (bestAxis < 0) {
+        return false;
+    }
+
+    float area = surfaceArea(bounds);
+    float splitCost = b.params.traversalCost + b.params.intersectionCost * (area > 0.0f ? bestCost / area : static_cast<float>(n));
+    float leafCost = b.params.intersectionCost * static_cast<float>(n);
+    if (n <= b.params.maxPrimsPerLeaf && leafCost <= splitCost) {
+        out.makeLeaf = true;
+        return true;
+    }
+
+    float axisLo = lo[bestAxis];
+    float axisScale = scale[bestAxis];
+    auto mid = std::partition(begin, end, [=](BVHBuildPrim const& p) {
+        return std::min(numBins - 1, static_cast<size_t>((p.centroid[bestAxis] - axisLo) * axisScale)) <= bestBin;
+    });
+
+    out.makeLeaf = false;
+    out.nLeft = static_cast<size_t>(mid - begin);
+    out.axis = static_cast<uint8_t>(bestAxis);
+    return out.nLeft > 0 && out.nLeft < n;
+}
+
+static BVHSplit chooseSplit(BVHBuilder& b, size_t first, size_t n, size_t depth, gp::AABB const& bounds) {
+    BVHSplit rv{false, 0, 0};
+    if (n == 1) {
+        rv.makeLeaf = true;
+        return rv;
+    }
+
+    auto begin = b.prims.begin() + static_cast<ptrdiff_t>(first);
+    auto end = begin + static_cast<ptrdiff_t>(n);
+
+    gp::AABB centroidBounds{begin->centroid, begin->centroid};
+    for (auto it = begin + 1; it != end; ++it) {
+        centroidBounds = gp::aabbUnion(centroidBounds, it->centroid);
+    }
+    auto dim = gp::aabbLongestDimension(centroidBounds);
+
+    if (depth < gp::bvhMaxDepth/2) {
+        if (b.params.splitMethod == gp::BVHSplitMethod::SAH) {
+            if (sahSplit(b, first, n, bounds, centroidBounds, rv)) {
+                return rv;
+            }
+        } else if (n <= b.params.maxPrimsPerLeaf) {
+            rv.makeLeaf = true;
+            return rv;
+        } else {
+            // split at the midpoint of the longest dimension
+            float midpoint = 0.5f * (centroidBounds.min[dim] + centroidBounds.max[dim]);
+            auto mid = std::partition(begin, end, [dim, midpoint](BVHBuildPrim const& p) {
+                return p.centroid[dim] < midpoint;
+            });
+            rv.nLeft = static_cast<size_t>(mid - begin);
+            rv.axis = static_cast<uint8_t>(dim);
+            if (rv.nLeft > 0 && rv.nLeft < n) {
+                return rv;
+            }
+        }
+    }
+
+    if (n <= b.params.maxPrimsPerLeaf) {
+        rv.makeLeaf = true;
+        return rv;
+    }
+
+    // fall back to splitting at the median if nothing else split anything
+    // (e.g. because all centroids are colocated) or the tree is getting too
+    // deep: median splits are balanced, so the depth stays bounded
+    auto mid = begin + static_cast<ptrdiff_t>(n/2);
+    std::nth_element(begin, mid, end, [dim](BVHBuildPrim const& p1, BVHBuildPrim const& p2) {
+        return p1.centroid[dim] < p2.centroid[dim];
+    });
+    rv.makeLeaf = false;
+    rv.nLeft = n/2;
+    rv.axis = static_cast<uint8_t>(dim);
+    return rv;
+}
+
+// builds the subtree for `prims[first, first+n)` into `nodes` and returns its
+// root's index
+//
+// nodes are appended as they're visited, which produces the depth-first
+// layout: a node's first child is built (and appended) straight after it
+//
+// if `allowTasks`, subtrees smaller than the task cutoff are deferred to a
+// worker thread, leaving a placeholder node (`pad == 1`, `offset` == task
+// index) that `bvhEmitRecursive` replaces with the task's subtree
+static uint32_t bvhBuildRecursive(BVHBuilder& b, std::vector<gp::BVHNode>& nodes, size_t first, size_t n, size_t depth, bool allowTasks) {
+    uint32_t idx = static_cast<uint32_t>(nodes.size());
+    nodes.emplace_back();
+
+    gp::BVHNode node{};
+
+    if (allowTasks && n < b.taskCutoff) {
+        node.offset = static_cast<uint32_t>(b.tasks.size());
+        node.pad = 1;
+        b.tasks.push_back(BVHBuildTask{first, n, depth, {}});
+        nodes[idx] = node;
+        return idx;
+    }
+
+    node.bounds = b.prims[first].bounds;
+    for (size_t i = first + 1; i < first + n; ++i) {
+        node.bounds = gp::aabbUnion(node.bounds, b.prims[i].bounds);
+    }
+
+    BVHSplit split = chooseSplit(b, first, n, depth, node.bounds);
+    if (split.makeLeaf) {
+        node.offset = static_cast<uint32_t>(first);
+        node.nPrims = static_cast<uint16_t>(n);
+        nodes[idx] = node;
+        return idx;
+    }
+
+    bvhBuildRecursive(b, nodes, first, split.nLeft, depth + 1, allowTasks);
+    node.offset = bvhBuildRecursive(b, nodes, first + split.nLeft, n - split.nLeft, depth + 1, allowTasks);
+    node.axis = split.axis;
+    nodes[idx] = node;
+
+    return idx;
+}
+
+// copies the top of the tree + the tasks' subtrees into `out`, depth-first
+static uint32_t bvhEmitRecursive(BVHBuilder& b, std::vector<gp::BVHNode> const& top, uint32_t idx, std::vector<gp::BVHNode>& out) {
+    gp::BVHNode const& node = top[idx];
+    uint32_t rv = static_cast<uint32_t>(out.size());
+
+    if (node.pad) {
+        // placeholder: splice in the task's subtree, rebasing its child indices
+        BVHBuildTask const& task = b.tasks[node.offset];
+        for (gp::BVHNode n : task.nodes) {
+            if (!n.isLeaf()) {
+                n.offset += rv;
+            }
+            out.push_back(n);
+        }
+    } else if (node.isLeaf()) {
+        out.push_back(node);
+    } else {
+        out.push_back(node);
+        bvhEmitRecursive(b, top, idx + 1, out);
+        out[rv].offset = bvhEmitRecursive(b, top, node.offset, out);
+    }
+
+    return rv;
+}
+
+// recomputes every node's bounds from `bvh.primBounds`
+static void refitNodes(gp::BVH& bvh) noexcept {
+    // depth-first layout: children always come after their parent, so walking
+    // backwards visits them first
+    for (size_t i = bvh.nodes.size(); i-- > 0;) {
+        gp::BVHNode& node = bvh.nodes[i];
+
+        if (node.isLeaf()) {
+            node.bounds = bvh.primBounds[node.offset];
+            for (uint32_t p = node.offset + 1, end = node.offset + node.nPrims; p < end; ++p) {
+                node.bounds = gp::aabbUnion(node.bounds, bvh.primBounds[p]);
+            }
+        } else {
+            node.bounds = gp::aabbUnion(bvh.nodes[i + 1].bounds, bvh.nodes[node.offset].bounds);
+        }
+    }
+}
+
+// linear BVH (LBVH) builder
+//
+// sorts the primitives along a Morton (Z-order) curve through their centroids
+// and then splits each node where the highest differing bit of its
+// primitives' codes changes (Karras, "Maximizing Parallelism in the
+// Construction of BVHs, Octrees, and k-d Trees", 2012). Every internal node's
+// split can be found independently, which makes the whole build O(n) and
+// parallel, at the cost of a worse tree than SAH
+
+namespace {
+    template<typename Key>
+    struct LinearBuilder final {
+        gp::BVHBuildParams params;
+        size_t numChunks;
+
+        struct Prim final {
+            Key code;
+            uint32_t index;
+        };
+
+        // Morton code of each primitive, and the primitive's index. Sorted
+        // by code
+        std::vector<Prim> prims;
+
+        // split of each internal node of the Karras tree: its left child
+        // covers [first, split], its right child [split+1, last]
+        std::vector<uint32_t> splits;
+    };
+}
+
+// spreads the low 10 bits of `v` out, so that there are 2 zero bits between
+// each of them
+static uint32_t spreadBits(uint32_t v) noexcept {
+    v = (v * 0x00010001u) & 0xFF0000FFu;
+    v = (v * 0x00000101u) & 0x0F00F00Fu;
+    v = (v * 0x00000011u) & 0xC30C30C3u;
+    v = (v * 0x00000005u) & 0x49249249u;
+    return v;
+}
+
+// spreads the low 21 bits of `v` out, so that there are 2 zero bits between
+// each of them
+static uint64_t spreadBits(uint64_t v) noexcept {
+    v &= 0x1FFFFF;
+    v = (v | v << 32) & 0x1F00000000FFFF;
+    v = (v | v << 16) & 0x1F0000FF0000FF;
+    v = (v | v << 8) & 0x100F00F00F00F00F;
+    v = (v | v << 4) & 0x10C30C30C30C30C3;
+    v = (v | v << 2) & 0x1249249249249249;
+    return v;
+}
+
+static int countLeadingZeros(uint32_t v) noexcept {
+#ifdef _MSC_VER
+    unsigned long idx;
+    return _BitScanReverse(&idx, v) ? 31 - static_cast<int>(idx) : 32;
+#else
+    return v ? __builtin_clz(v) : 32;
+#endif
+}
+
+static int countLeadingZeros(uint64_t v) noexcept {
+#ifdef _MSC_VER
+    unsigned long idx;
+    return _BitScanReverse64(&idx, v) ? 63 - static_cast<int>(idx) : 64;
+#else
+    return v ? __builtin_clzll(v) : 64;
+#endif
+}
+
+// length of the common prefix of the (sorted) codes at `i` and `j`, or -1 if
+// `j` is out of range. Duplicate codes are told apart by their positions
+template<typename Key>
+static int commonPrefix(LinearBuilder<Key> const& b, int64_t i, int64_t j) noexcept {
+    if (j < 0 || j >= static_cast<int64_t>(b.prims.size())) {
+        return -1;
+    }
+
+    Key ki = b.prims[static_cast<size_t>(i)].code;
+    Key kj = b.prims[static_cast<size_t>(j)].code;
+    if (ki != kj) {
+        return countLeadingZeros(ki ^ kj);
+    }
+    return static_cast<int>(8*sizeof(Key)) + countLeadingZeros(static_cast<uint32_t>(i ^ j));
+}
+
+// finds the split of internal node `i` of the Karras tree
+template<typename Key>
+static uint32_t karrasSplit(LinearBuilder<Key> const& b, int64_t i) noexcept {
+    // the node's range starts or ends at `i`: it extends in whichever
+    // direction shares the longer prefix with `i`
+    int64_t d = commonPrefix(b, i, i + 1) > commonPrefix(b, i, i - 1) ? 1 : -1;
+    int minPrefix = commonPrefix(b, i, i - d);
+
+    // find the other end of the range (exponential, then binary, search)
+    int64_t maxLen = 2;
+    while (commonPrefix(b, i, i + maxLen*d) > minPrefix) {
+        maxLen *= 2;
+    }
+    int64_t len = 0;
+    for (int64_t step = maxLen/2; step >= 1; step /= 2) {
+        if (commonPrefix(b, i, i + (len + step)*d) > minPrefix) {
+            len += step;
+        }
+    }
+    int64_t j = i + len*d;
+
+    // small nodes become leaves, so their split is never used
+    if (static_cast<size_t>(len) < b.params.maxPrimsPerLeaf) {
+        return 0;
+    }
+
+    // binary search for the last code that shares more than the range's
+    // common prefix with `i`
+    int nodePrefix = commonPrefix(b, i, j);
+    int64_t s = 0;
+    int64_t step = len;
+    do {
+        step = (step + 1) / 2;
+        if (commonPrefix(b, i, i + (s + step)*d) > nodePrefix) {
+            s += step;
+        }
+    } while (step > 1);
+
+    return static_cast<uint32_t>(i + s*d + std::min(d, int64_t{0}));
+}
+
+// emits the subtree for internal node `node` of the Karras tree, which covers
+// the sorted primitives [first, last], into `nodes` (depth-first)
+template<typename Key>
+static void emitLinearRecursive(LinearBuilder<Key> const& b, std::vector<gp::BVHNode>& nodes, size_t node, size_t first, size_t last, size_t depth) {
+    size_t idx = nodes.size();
+    nodes.emplace_back();
+
+    size_t n = last - first + 1;
+    if (n <= b.params.maxPrimsPerLeaf) {
+        nodes[idx].offset = static_cast<uint32_t>(first);
+        nodes[idx].nPrims = static_cast<uint16_t>(n);
+        return;
+    }
+
+    // the highest differing bit says which dimension the node splits (codes
+    // are interleaved xyz, with x in the top bit of each triple)
+    int prefix = countLeadingZeros(b.prims[first].code ^ b.prims[last].code);
+    int bit = static_cast<int>(8*sizeof(Key)) - 1 - prefix;
+    uint8_t axis = bit >= 0 ? static_cast<uint8_t>(2 - bit%3) : 0;
+
+    // median splits once the tree gets deep (e.g. lots of duplicate codes),
+    // so that the depth stays bounded
+    size_t split = depth < gp::bvhMaxDepth/2 ? b.splits[node] : first + n/2 - 1;
+
+    emitLinearRecursive(b, nodes, split, first, split, depth + 1);
+    nodes[idx].offset = static_cast<uint32_t>(nodes.size());
+    nodes[idx].axis = axis;
+    emitLinearRecursive(b, nodes, split + 1, split + 1, last, depth + 1);
+}
+
+template<typename Key>
+static void bvhBuildLinear(gp::BVH& bvh, gp::AABB const* aabbs, size_t n, gp::BVHBuildParams const& params, size_t numThreads) {
+    constexpr size_t bitsPerAxis = sizeof(Key) == 4 ? 10 : 21;
+    constexpr size_t minPrimsPerChunk = 16384;
+
+    LinearBuilder<Key> b;
+    b.params = params;
+    b.numChunks = std::clamp(n / minPrimsPerChunk, size_t{1}, numThreads);
+
+    // quantize the centroids to the grid the codes are computed on
+    std::vector<gp::AABB> chunkBounds(b.numChunks);
+    gp::parallelFor(b.numChunks, n, [aabbs, &chunkBounds](size_t chunk, size_t begin, size_t end) {
+        glm::vec3 c = gp::aabbCenter(aabbs[begin]);
+        gp::AABB bounds{c, c};
+        for (size_t i = begin + 1; i < end; ++i) {
+            bounds = gp::aabbUnion(bounds, gp::aabbCenter(aabbs[i]));
+        }
+        chunkBounds[chunk] = bounds;
+    });
+    gp::AABB centroidBounds = chunkBounds[0];
+    for (gp::AABB const& bounds : chunkBounds) {
+        centroidBounds = gp::aabbUnion(centroidBounds, bounds);
+    }
+
+    float gridMax = static_cast<float>((1u << bitsPerAxis) - 1);
+    glm::vec3 extent = centroidBounds.max - centroidBounds.min;
+    glm::vec3 scale;
+    for (int axis = 0; axis < 3; ++axis) {
+        scale[axis] = extent[axis] > 0.0f ? gridMax / extent[axis] : 0.0f;
+    }
+
+    b.prims.resize(n);
+    gp::parallelFor(b.numChunks, n, [aabbs, &b, &centroidBounds, scale, gridMax](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            glm::vec3 p = glm::clamp((gp::aabbCenter(aabbs[i]) - centroidBounds.min) * scale, 0.0f, gridMax);
+            Key x = spreadBits(static_cast<Key>(p.x));
+            Key y = spreadBits(static_cast<Key>(p.y));
+            Key z = spreadBits(static_cast<Key>(p.z));
+            b.prims[i].code = (x << 2) | (y << 1) | z;
+            b.prims[i].index = static_cast<uint32_t>(i);
+        }
+    });
+
+    using Prim = typename LinearBuilder<Key>::Prim;
+    gp::parallelRadixSort(b.prims, 3*bitsPerAxis, b.numChunks, [](Prim const& p) { return p.code; });
+
+    // internal node `i`'s split only depends on the sorted codes
+    b.splits.resize(n - 1);
+    gp::parallelFor(b.numChunks, n - 1, [&b](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            b.splits[i] = karrasSplit(b, static_cast<int64_t>(i));
+        }
+    });
+
+    bvh.nodes.reserve(2*n - 1);
+    emitLinearRecursive(b, bvh.nodes, 0, 0, n - 1, 0);
+
+    bvh.prims.resize(n);
+    bvh.primBounds.resize(n);
+    gp::parallelFor(b.numChunks, n, [aabbs, &b, &bvh](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            bvh.prims[i] = b.prims[i].index;
+            bvh.primBounds[i] = aabbs[b.prims[i].index];
+        }
+    });
+    refitNodes(bvh);
+}
+
+void gp::bvhBuild(BVH& bvh, AABB const* aabbs, size_t n, BVHBuildParams const& params) {
+    bvh.clear();
+    if (n == 0) {
+        return;
+    }
+
+    BVHBuilder b;
+    b.params = params;
+    b.params.maxPrimsPerLeaf = std::clamp(params.maxPrimsPerLeaf, size_t{1}, size_t{UINT16_MAX});
+    size_t numThreads = params.numThreads ? params.numThreads : std::max(1u, std::thread::hardware_concurrency());
+
+    if (params.splitMethod == BVHSplitMethod::Morton) {
+        if (params.mortonBits <= 30) {
+            bvhBuildLinear<uint32_t>(bvh, aabbs, n, b.params, numThreads);
+        } else {
+            bvhBuildLinear<uint64_t>(bvh, aabbs, n, b.params, numThreads);
+        }
+        return;
+    }
+
+    b.prims.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        b.prims.push_back(BVHBuildPrim{aabbs[i], aabbCenter(aabbs[i]), static_cast<uint32_t>(i)});
+    }
+
+    size_t minPrimsPerTask = std::max(params.minPrimsPerTask, size_t{1});
+    bvh.nodes.reserve(2*n - 1);
+
+    if (numThreads <= 1 || n < 2*minPrimsPerTask) {
+        bvhBuildRecursive(b, bvh.nodes, 0, n, 0, false);
+    } else {
+        // build the top of the tree serially, until there are a few tasks per
+        // thread, so that uneven task sizes even out
+        b.taskCutoff = std::max(n / (4*numThreads), minPrimsPerTask);
+        std::vector<BVHNode> top;
+        bvhBuildRecursive(b, top, 0, n, 0, true);
+
+        // biggest tasks first
+        std::vector<size_t> order(b.tasks.size());
+        for (size_t i = 0; i < order.size(); ++i) {
+            order[i] = i;
+        }
+        std::sort(order.begin(), order.end(), [&b](size_t t1, size_t t2) {
+            return b.tasks[t1].n > b.tasks[t2].n;
+        });
+
+        std::atomic<size_t> next{0};
+        auto worker = [&b, &order, &next]() {
+            for (size_t i = next++; i < order.size(); i = next++) {
+                BVHBuildTask& task = b.tasks[order[i]];
+                task.nodes.reserve(2*task.n - 1);
+                bvhBuildRecursive(b, task.nodes, task.first, task.n, task.depth, false);
+            }
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t i = 1; i < std::min(numThreads, b.tasks.size()); ++i) {
+            threads.emplace_back(worker);
+        }
+        worker();
+        for (std::thread& t : threads) {
+            t.join();
+        }
+
+        bvhEmitRecursive(b, top, 0, bvh.nodes);
+    }
+
+    bvh.prims.reserve(n);
+    bvh.primBounds.reserve(n);
+    for (BVHBuildPrim const& p : b.prims) {
+        bvh.prims.push_back(p.index);
+        bvh.primBounds.push_back(p.bounds);
+    }
+}
+
+void gp::bvhRefit(BVH& bvh, AABB const* aabbs, size_t n) {
+    if (n != bvh.prims.size()) {
+        std::stringstream ss;
+        ss << "bvhRefit: the BVH was built from " << bvh.prims.size() << " primitives, but " << n << " were supplied";
+        throw std::runtime_error{std::move(ss).str()};
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        bvh.primBounds[i] = aabbs[bvh.prims[i]];
+    }
+    refitNodes(bvh);
+}
+
+float gp::bvhSAHCost(BVH const& bvh, BVHBuildParams const& params) noexcept {
+    if (bvh.empty()) {
+        return 0.0f;
+    }
+
+    float rootArea = surfaceArea(bvh.nodes[0].bounds);
+    if (rootArea <= 0.0f) {
+        return 0.0f;
+    }
+
+    // each node's cost is weighted by the probability that a ray that hits
+    // the root also hits it (ratio of surface areas)
+    double cost = 0.0;
+    for (BVHNode const& node : bvh.nodes) {
+        float nodeCost = node.isLeaf() ? params.intersectionCost * static_cast<float>(node.nPrims) : params.traversalCost;
+        cost += static_cast<double>(surfaceArea(node.bounds) * nodeCost);
+    }
+    return static_cast<float>(cost / static_cast<double>(rootArea));
+}
+
+namespace {
+    // a node that's still to be visited, and where the ray enters it
+    struct BVHStackEntry final {
+        uint32_t node;
+        float t;
+    };
+}
+
+// returns true if the ray hits `aabb` at `t <= tMax` (and sets `t`)
+//
+// the slab's exit distance is scaled by `tFarScale` first, which, if it's a
+// few ULPs over 1, makes the test conservative (it can't miss a point that's
+// inside the AABB due to rounding)
+static bool rayEntersAABB(gp::PrecomputedRay const& ray, gp::AABB const& aabb, float tMax, float tFarScale, float& t) noexcept {
+    gp::LineAABBHittestResult res = gp::rayIntersectsAABB(ray, aabb);
+    t = std::max(res.t0, 0.0f);
+    return res.t1 * tFarScale >= t && t <= tMax;
+}
+
+// visits the primitives of `bvh` that the ray hits at `t <= tMax`, calling
+// `visit(slot, t)` (`slot` indexes `bvh.prims`) for each of them
+//
+// nodes are visited nearest-first. `visit` may lower `tMax` (which culls
+// anything further away), and returns true to stop the traversal. The AABB
+// tests use `tFarScale` as in `rayEntersAABB`
+template<typename Visit>
+static void traverseBinary(gp::BVH const& bvh, gp::PrecomputedRay const& ray, float& tMax, float tFarScale, gp::BVHQueryStats* stats, Visit visit) noexcept {
+    size_t nVisited = 0;
+    size_t nTested = 0;
+
+    auto enterT = [&ray, &tMax, tFarScale](gp::BVHNode const& node, float& t) {
+        return rayEntersAABB(ray, node.bounds, tMax, tFarScale, t);
+    };
+
+    float rootT;
+    if (!bvh.empty() && enterT(bvh.nodes[0], rootT)) {
+        // each level pushes (at most) one child
+        BVHStackEntry stack[gp::bvhMaxDepth];
+        size_t stackSize = 0;
+        uint32_t cur = 0;
+
+        for (;;) {
+            gp::BVHNode const& node = bvh.nodes[cur];
+            ++nVisited;
+
+            if (!node.isLeaf()) {
+                uint32_t near = cur + 1;
+                uint32_t far = node.offset;
+                float nearT;
+                float farT;
+                bool hitNear = enterT(bvh.nodes[near], nearT);
+                bool hitFar = enterT(bvh.nodes[far], farT);
+
+                if (hitNear && hitFar) {
+                    if (farT < nearT) {
+                        std::swap(near, far);
+                        std::swap(nearT, farT);
+                    }
+                    stack[stackSize++] = BVHStackEntry{far, farT};
+                    cur = near;
+                    continue;
+                } else if (hitNear || hitFar) {
+                    cur = hitNear ? near : far;
+                    continue;
+                }
+            } else {
+                bool stop = false;
+                for (uint32_t i = node.offset, end = node.offset + node.nPrims; i < end && !stop; ++i) {
+                    ++nTested;
+                    float t;
+                    if (rayEntersAABB(ray, bvh.primBounds[i], tMax, tFarScale, t)) {
+                        stop = visit(i, t);
+                    }
+                }
+                if (stop) {
+                    break;
+                }
+            }
+
+            // pop the next node that's still in range
+            while (stackSize > 0 && stack[stackSize-1].t > tMax) {
+                --stackSize;
+            }
+            if (stackSize == 0) {
+                break;
+            }
+            cur = stack[--stackSize].node;
+        }
+    }
+
+    if (stats) {
+        stats->nodesVisited += nVisited;
+        stats->primsTested += nTested;
+    }
+}
+
+gp::RaycastHit gp::bvhRaycastAABBs(BVH const& bvh, PrecomputedRay const& ray, BVHQueryStats* stats) noexcept {
+    RaycastHit rv;
+    float tMax = FLT_MAX;
+    traverseBinary(bvh, ray, tMax, 1.0f, stats, [&bvh, &rv, &tMax](uint32_t slot, float t) {
+        // ties are broken by index, as in `raycastAABBs`
+        int32_t prim = static_cast<int32_t>(bvh.prims[slot]);
+        if (t < rv.t || (t == rv.t && prim < rv.index)) {
+            rv.index = prim;
+            rv.t = t;
+            tMax = t;
+        }
+        return false;
+    });
+    return rv;
+}
+
+gp::RaycastHit gp::bvhRaycastAnyAABB(BVH const& bvh, PrecomputedRay const& ray, float tMax, BVHQueryStats* stats) noexcept {
+    RaycastHit rv;
+    traverseBinary(bvh, ray, tMax, 1.0f, stats, [&bvh, &rv](uint32_t slot, float t) {
+        rv.index = static_cast<int32_t>(bvh.prims[slot]);
+        rv.t = t;
+        return true;
+    });
+    return rv;
+}
+
+void gp::bvhRaycastAllAABBs(BVH const& bvh, PrecomputedRay const& ray, float tMin, float tMax, std::vector<RaycastHit>& out, BVHQueryStats* stats) {
+    size_t first = out.size();
+    traverseBinary(bvh, ray, tMax, 1.0f, stats, [&bvh, &out, tMin](uint32_t slot, float t) {
+        if (t >= tMin) {
+            RaycastHit hit;
+            hit.index = static_cast<int32_t>(bvh.prims[slot]);
+            hit.t = t;
+            out.push_back(hit);
+        }
+        return false;
+    });
+
+    std::sort(out.begin() + static_cast<ptrdiff_t>(first), out.end(), [](RaycastHit const& a, RaycastHit const& b) {
+        return a.t < b.t || (a.t == b.t && a.index < b.index);
+    });
+}
+
+// triangle BVHs
+
+static glm::vec3 const& stridedPos(char const* bytes, size_t stride, uint32_t i) noexcept {
+    return *reinterpret_cast<glm::vec3 const*>(bytes + stride*i);
+}
+
+void gp::bvhBuildTriangles(BVH& bvh,
+                           glm::vec3 const* positions,
+                           size_t stride,
+                           uint32_t const* indices,
+                           size_t numIndices,
+                           BVHBuildParams const& params) {
+    char const* bytes = reinterpret_cast<char const*>(positions);
+    size_t numTriangles = numIndices / 3;
+
+    std::vector<AABB> aabbs;
+    aabbs.reserve(numTriangles);
+    for (size_t tri = 0; tri < numTriangles; ++tri) {
+        glm::vec3 const& a = stridedPos(bytes, stride, indices[3*tri]);
+        glm::vec3 const& b = stridedPos(bytes, stride, indices[3*tri + 1]);
+        glm::vec3 const& c = stridedPos(bytes, stride, indices[3*tri + 2]);
+
+        aabbs.push_back(AABB{glm::min(glm::min(a, b), c), glm::max(glm::max(a, b), c)});
+    }
+
+    bvhBuild(bvh, aabbs, params);
+}
+
+// the ray can't hit a triangle before it enters the triangle's AABB, so
+// triangle queries can cull against the closest triangle hit so far
+//
+// but the slab tests and the triangle test round differently, so the slab
+// tests are made conservative (a triangle that's flat along an axis has a
+// flat AABB, which a rounded slab test can miss), and culling leaves a few
+// ULPs of slack, so that ties (e.g. rays through an edge shared by two
+// triangles) still go to the lowest index
+static constexpr float g_TriangleTFarScale = 1.0f + 4.0f*FLT_EPSILON;
+static constexpr float g_TriangleTMaxScale = 1.0f + 8.0f*FLT_EPSILON;
+
+// finds the closest triangle the ray hits at `t <= tMax`, lowering `tMax` as
+// it finds closer ones
+static gp::TriangleRaycastHit closestTriangle(gp::BVH const& bvh,
+                                              gp::PrecomputedRay const& ray,
+                                              char const* bytes,
+                                              size_t stride,
+                                              uint32_t const* indices,
+                                              float& tMax,
+                                              gp::BVHQueryStats* stats) noexcept {
+    gp::TriangleRaycastHit rv;
+    traverseBinary(bvh, ray, tMax, g_TriangleTFarScale, stats, [&](uint32_t slot, float) {
+        uint32_t tri = bvh.prims[slot];
+        glm::vec3 verts[3] = {
+            stridedPos(bytes, stride, indices[3*tri]),
+            stridedPos(bytes, stride, indices[3*tri + 1]),
+            stridedPos(bytes, stride, indices[3*tri + 2]),
+        };
+
+        gp::RayTriangleHittestResult res = gp::rayIntersectsTriangle(ray, verts);
+        int32_t index = static_cast<int32_t>(tri);
+        if (res.intersected && (res.t < rv.t || (res.t == rv.t && index < rv.index))) {
+            rv.index = index;
+            rv.t = res.t;
+            rv.u = res.u;
+            rv.v = res.v;
+            tMax = res.t * g_TriangleTMaxScale;
+        }
+        return false;
+    });
+    return rv;
+}
+
+gp::TriangleRaycastHit gp::bvhRaycastTriangles(BVH const& bvh,
+                                               PrecomputedRay const& ray,
+                                               glm::vec3 const* positions,
+                                               size_t stride,
+                                               uint32_t const* indices,
+                                               BVHQueryStats* stats) noexcept {
+    float tMax = FLT_MAX;
+    return closestTriangle(bvh, ray, reinterpret_cast<char const*>(positions), stride, indices, tMax, stats);
+}
+
+// instanced (two-level) BVHs
+
+void gp::blasBuild(BLAS& blas,
+                   glm::vec3 const* positions,
+                   size_t stride,
+                   uint32_t const* indices,
+                   size_t numIndices,
+                   BVHBuildParams const& params) {
+    bvhBuildTriangles(blas.bvh, positions, stride, indices, numIndices, params);
+    blas.positions = positions;
+    blas.stride = stride;
+    blas.indices = indices;
+}
+
+// returns the AABB of `a` after it's been transformed by the affine matrix `m`
+//
+// this is Arvo's method ("Transforming Axis-Aligned Bounding Boxes", Graphics
+// Gems 1990): each output dimension's extremes are sums of the extremes of
+// each input dimension's contribution, so it doesn't transform all 8 corners
+static gp::AABB transformAABB(glm::mat4 const& m, gp::AABB const& a) noexcept {
+    glm::vec3 lo{m[3]};
+    glm::vec3 hi{m[3]};
+    for (int col = 0; col < 3; ++col) {
+        glm::vec3 e = glm::vec3{m[col]} * a.min[col];
+        glm::vec3 f = glm::vec3{m[col]} * a.max[col];
+        lo += glm::min(e, f);
+        hi += glm::max(e, f);
+    }
+    return gp::AABB{lo, hi};
+}
+
+void gp::tlasBuild(TLAS& tlas,
+                   BLAS const* blases,
+                   size_t numBLASes,
+                   glm::mat4 const* transforms,
+                   uint32_t const* blasIndices,
+                   size_t numInstances,
+                   BVHBuildParams const& params) {
+    tlas.clear();
+
+    std::vector<AABB> aabbs;
+    aabbs.reserve(numInstances);
+    tlas.instances.reserve(numInstances);
+
+    for (size_t i = 0; i < numInstances; ++i) {
+        uint32_t blasIdx = blasIndices ? blasIndices[i] : 0;
+        if (blasIdx >= numBLASes) {
+            std::stringstream ss;
+            ss << "tlasBuild: instance " << i << " uses BLAS " << blasIdx << ", but there are only " << numBLASes << " BLASes";
+            throw std::runtime_error{std::move(ss).str()};
+        }
+        BLAS const& blas = blases[blasIdx];
+
+        // an empty BLAS can't be hit, but its instance still needs a leaf,
+        // so give it a point AABB
+        glm::mat4 const& m = transforms[i];
+        aabbs.push_back(blas.bvh.empty() ? AABB{glm::vec3{m[3]}, glm::vec3{m[3]}} : transformAABB(m, blas.bvh.nodes[0].bounds));
+        tlas.instances.push_back(TLASInstance{glm::mat4x3{glm::inverse(m)}, blasIdx});
+    }
+
+    bvhBuild(tlas.bvh, aabbs, params);
+}
+
+gp::InstanceRaycastHit gp::tlasRaycast(TLAS const& tlas, BLAS const* blases, PrecomputedRay const& ray, BVHQueryStats* stats) noexcept {
+    InstanceRaycastHit rv;
+
+    // the object-space rays aren't renormalized, so `t` means the same thing
+    // in every instance, and one `tMax` culls both levels. The instances'
+    // AABBs bound their triangles, so the triangles' slab test tolerances
+    // apply to them too
+    float tMax = FLT_MAX;
+    traverseBinary(tlas.bvh, ray, tMax, g_TriangleTFarScale, stats, [&](uint32_t slot, float) {
+        uint32_t inst = tlas.bvh.prims[slot];
+        TLASInstance const& instance = tlas.instances[inst];
+        BLAS const& blas = blases[instance.blas];
+
+        Line objectRay{
+            instance.worldToObject * glm::vec4{ray.origin, 1.0f},
+            instance.worldToObject * glm::vec4{ray.dir, 0.0f},
+        };
+        float instanceTMax = tMax;
+        TriangleRaycastHit hit = closestTriangle(blas.bvh,
+                                                 PrecomputedRay{objectRay},
+                                                 reinterpret_cast<char const*>(blas.positions),
+                                                 blas.stride,
+                                                 blas.indices,
+                                                 instanceTMax,
+                                                 stats);
+
+        int32_t index = static_cast<int32_t>(inst);
+        if (hit.hit() && (hit.t < rv.t || (hit.t == rv.t && index < rv.instance))) {
+            rv.instance = index;
+            rv.triangle = hit.index;
+            rv.t = hit.t;
+            rv.u = hit.u;
+            rv.v = hit.v;
+            tMax = hit.t * g_TriangleTMaxScale;
+        }
+        return false;
+    });
+    return rv;
+}
+
+// wide BVHs
+
+// returns the index of the wide node made from binary node `binIdx`
+template<size_t Width>
+static uint32_t collapseRecursive(gp::WideBVH<Width>& out, gp::BVH const& in, uint32_t binIdx) {
+    uint32_t idx = static_cast<uint32_t>(out.nodes.size());
+    out.nodes.emplace_back();
+
+    // the wide node's children: starts with the binary node's children (or
+    // the binary node itself, if it's a leaf root), then repeatedly replaces
+    // the biggest internal child with its children
+    uint32_t kids[Width];
+    size_t numKids = 0;
+    gp::BVHNode const& binNode = in.nodes[binIdx];
+    if (binNode.isLeaf()) {
+        kids[numKids++] = binIdx;
+    } else {
+        kids[numKids++] = binIdx + 1;
+        kids[numKids++] = binNode.offset;
+    }
+
+    while (numKids < Width) {
+        size_t biggest = Width;
+        float biggestArea = -1.0f;
+        for (size_t k = 0; k < numKids; ++k) {
+            gp::BVHNode const& kid = in.nodes[kids[k]];
+            float area = surfaceArea(kid.bounds);
+            if (!kid.isLeaf() && area > biggestArea) {
+                biggest = k;
+                biggestArea = area;
+            }
+        }
+        if (biggest == Width) {
+            break;  // all leaves
+        }
+
+        uint32_t kid = kids[biggest];
+        kids[biggest] = kid + 1;
+        kids[numKids++] = in.nodes[kid].offset;
+    }
+
+    gp::WideBVHNode<Width> node{};
+    node.numChildren = static_cast<uint8_t>(numKids);
+    for (size_t k = 0; k < Width; ++k) {
+        if (k >= numKids) {
+            // unused: never hit, because the traversal masks it out
+            node.minX[k] = node.minY[k] = node.minZ[k] = FLT_MAX;
+            node.maxX[k] = node.maxY[k] = node.maxZ[k] = -FLT_MAX;
+            continue;
+        }
+
+        gp::BVHNode const& kid = in.nodes[kids[k]];
+        node.minX[k] = kid.bounds.min.x;
+        node.minY[k] = kid.bounds.min.y;
+        node.minZ[k] = kid.bounds.min.z;
+        node.maxX[k] = kid.bounds.max.x;
+        node.maxY[k] = kid.bounds.max.y;
+        node.maxZ[k] = kid.bounds.max.z;
+        node.nPrims[k] = kid.nPrims;
+        node.child[k] = kid.isLeaf() ? kid.offset : collapseRecursive(out, in, kids[k]);
+    }
+    out.nodes[idx] = node;
+
+    return idx;
+}
+
+template<size_t Width>
+static void collapse(gp::WideBVH<Width>& out, gp::BVH const& in) {
+    out.clear();
+    if (in.empty()) {
+        return;
+    }
+
+    out.nodes.reserve(in.nodes.size() / (Width - 1) + 1);
+    collapseRecursive(out, in, 0);
+    out.prims = in.prims;
+    out.primBounds = in.primBounds;
+}
+
+void gp::bvhCollapse(BVH4& out, BVH const& in) {
+    collapse(out, in);
+}
+
+void gp::bvhCollapse(BVH8& out, BVH const& in) {
+    collapse(out, in);
+}
+
+namespace {
+    // an internal node that's still to be visited, and where the ray enters
+    // it
+    struct WideStackEntry final {
+        uint32_t node;
+        float t;
+    };
+
+    // slab-tests a ray against all of a wide node's children, one at a time
+    template<size_t Width>
+    struct ChildTestScalar final {
+        gp::PrecomputedRay const& r;
+
+        // returns a bitmask of the children the ray hits, and writes where
+        // it enters each of them (`max(t0, 0)`) to `tEnter`
+        uint32_t operator()(gp::WideBVHNode<Width> const& node, float* tEnter) const noexcept {
+            uint32_t rv = 0;
+            for (size_t i = 0; i < Width; ++i) {
+                float txA = (node.minX[i] - r.origin.x) * r.invDir.x;
+                float txB = (node.maxX[i] - r.origin.x) * r.invDir.x;
+                float tyA = (node.minY[i] - r.origin.y) * r.invDir.y;
+                float tyB = (node.maxY[i] - r.origin.y) * r.invDir.y;
+                float tzA = (node.minZ[i] - r.origin.z) * r.invDir.z;
+                float tzB = (node.maxZ[i] - r.origin.z) * r.invDir.z;
+
+                float t0 = std::max(std::max(std::min(txA, txB), std::min(tyA, tyB)), std::min(tzA, tzB));
+                float t1 = std::min(std::min(std::max(txA, txB), std::max(tyA, tyB)), std::max(tzA, tzB));
+                tEnter[i] = std::max(t0, 0.0f);
+                rv |= static_cast<uint32_t>(tEnter[i] <= t1) << i;
+            }
+            return rv;
+        }
+    };
+}
+
+// finds the closest hit in a wide BVH, using `intersect` to test each node's
+// children
+//
+// force-inlined into each kernel's entry point, so that `intersect` is
+// inlined with the kernel's instruction set
+template<size_t Width, typename IntersectChildren>
+static GP_FORCE_INLINE gp::RaycastHit traverseWide(gp::WideBVH<Width> const& bvh,
+                                                   gp::PrecomputedRay const& r,
+                                                   gp::BVHQueryStats* stats,
+                                                   IntersectChildren const& intersect) noexcept {
+    gp::RaycastHit rv;
+    size_t nVisited = 0;
+    size_t nTested = 0;
+
+    if (!bvh.empty()) {
+        // each level of the tree pushes, at most, all-but-one of a node's
+        // children
+        WideStackEntry stack[gp::bvhMaxDepth * Width];
+        size_t stackSize = 0;
+        uint32_t cur = 0;
+
+        for (;;) {
+            gp::WideBVHNode<Width> const& node = bvh.nodes[cur];
+            ++nVisited;
+
+            alignas(32) float tEnter[Width];
+            uint32_t mask = intersect(node, tEnter) & ((1u << node.numChildren) - 1);
+
+            // sort the hit children nearest-first, skipping any that are
+            // further away than the closest hit so far
+            uint32_t order[Width];
+            size_t numHit = 0;
+            for (uint32_t c = 0; c < Width; ++c) {
+                if (!(mask & (1u << c)) || tEnter[c] > rv.t) {
+                    continue;
+                }
+                size_t j = numHit++;
+                for (; j > 0 && tEnter[order[j-1]] > tEnter[c]; --j) {
+                    order[j] = order[j-1];
+                }
+                order[j] = c;
+            }
+
+            // test leaves first, which may bring the closest hit closer...
+            for (size_t k = 0; k < numHit; ++k) {
+                uint32_t c = order[k];
+                if (!node.nPrims[c] || tEnter[c] > rv.t) {
+                    continue;
+                }
+
+                for (uint32_t i = node.child[c], end = node.child[c] + node.nPrims[c]; i < end; ++i) {
+                    ++nTested;
+                    gp::LineAABBHittestResult primRes = gp::rayIntersectsAABB(r, bvh.primBounds[i]);
+                    float t = std::max(primRes.t0, 0.0f);
+                    int32_t prim = static_cast<int32_t>(bvh.prims[i]);
+
+                    // ties are broken by index, as in `raycastAABBs`
+                    if (primRes.intersected && (t < rv.t || (t == rv.t && prim < rv.index))) {
+                        rv.index = prim;
+                        rv.t = t;
+                    }
+                }
+            }
+
+            // ...then push the internal children furthest-first, so that the
+            // nearest is popped next
+            for (size_t k = numHit; k-- > 0;) {
+                uint32_t c = order[k];
+                if (!node.nPrims[c] && tEnter[c] <= rv.t) {
+                    stack[stackSize++] = WideStackEntry{node.child[c], tEnter[c]};
+                }
+            }
+
+            // pop the next node that could still be closer than the closest
+            // hit
+            while (stackSize > 0 && stack[stackSize-1].t > rv.t) {
+                --stackSize;
+            }
+            if (stackSize == 0) {
+                break;
+            }
+            cur = stack[--stackSize].node;
+        }
+    }
+
+    if (stats) {
+        stats->nodesVisited += nVisited;
+        stats->primsTested += nTested;
+    }
+    return rv;
+}
+
+template<size_t Width>
+static gp::RaycastHit raycastWideScalar(gp::WideBVH<Width> const& bvh, gp::PrecomputedRay const& r, gp::BVHQueryStats* stats) noexcept {
+    return traverseWide(bvh, r, stats, ChildTestScalar<Width>{r});
+}
+
+#ifdef GP_SIMD_X86
+namespace {
+    // slab-tests a ray against a wide node's children, 4 at a time (SSE2)
+    template<size_t Width>
+    struct ChildTestSSE final {
+        __m128 ox, oy, oz;
+        __m128 idx, idy, idz;
+
+        explicit ChildTestSSE(gp::PrecomputedRay const& r) noexcept :
+            ox{_mm_set1_ps(r.origin.x)},
+            oy{_mm_set1_ps(r.origin.y)},
+            oz{_mm_set1_ps(r.origin.z)},
+            idx{_mm_set1_ps(r.invDir.x)},
+            idy{_mm_set1_ps(r.invDir.y)},
+            idz{_mm_set1_ps(r.invDir.z)} {
+        }
+
+        uint32_t operator()(gp::WideBVHNode<Width> const& node, float* tEnter) const noexcept {
+            uint32_t rv = 0;
+            for (size_t i = 0; i < Width; i += 4) {
+                __m128 txA = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.minX[i]), ox), idx);
+                __m128 txB = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.maxX[i]), ox), idx);
+                __m128 tyA = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.minY[i]), oy), idy);
+                __m128 tyB = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.maxY[i]), oy), idy);
+                __m128 tzA = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.minZ[i]), oz), idz);
+                __m128 tzB = _mm_mul_ps(_mm_sub_ps(_mm_load_ps(&node.maxZ[i]), oz), idz);
+
+                __m128 t0 = _mm_max_ps(_mm_max_ps(_mm_min_ps(txA, txB), _mm_min_ps(tyA, tyB)), _mm_min_ps(tzA, tzB));
+                __m128 t1 = _mm_min_ps(_mm_min_ps(_mm_max_ps(txA, txB), _mm_max_ps(tyA, tyB)), _mm_max_ps(tzA, tzB));
+                __m128 t = _mm_max_ps(t0, _mm_setzero_ps());
+                _mm_store_ps(tEnter + i, t);
+                rv |= static_cast<uint32_t>(_mm_movemask_ps(_mm_cmple_ps(t, t1))) << i;
+            }
+            return rv;
+        }
+    };
+
+    // slab-tests a ray against all 8 of a BVH8 node's children at once (AVX)
+    struct ChildTestAVX final {
+        __m256 ox, oy, oz;
+        __m256 idx, idy, idz;
+
+        GP_TARGET_AVX explicit ChildTestAVX(gp::PrecomputedRay const& r) noexcept :
+            ox{_mm256_set1_ps(r.origin.x)},
+            oy{_mm256_set1_ps(r.origin.y)},
+            oz{_mm256_set1_ps(r.origin.z)},
+            idx{_mm256_set1_ps(r.invDir.x)},
+            idy{_mm256_set1_ps(r.invDir.y)},
+            idz{_mm256_set1_ps(r.invDir.z)} {
+        }
+
+        GP_TARGET_AVX uint32_t operator()(gp::WideBVHNode<8> const& node, float* tEnter) const noexcept {
+            __m256 txA = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minX), ox), idx);
+            __m256 txB = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxX), ox), idx);
+            __m256 tyA = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minY), oy), idy);
+            __m256 tyB = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxY), oy), idy);
+            __m256 tzA = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.minZ), oz), idz);
+            __m256 tzB = _mm256_mul_ps(_mm256_sub_ps(_mm256_load_ps(node.maxZ), oz), idz);
+
+            __m256 t0 = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(txA, txB), _mm256_min_ps(tyA, tyB)), _mm256_min_ps(tzA, tzB));
+            __m256 t1 = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(txA, txB), _mm256_max_ps(tyA, tyB)), _mm256_max_ps(tzA, tzB));
+            __m256 t = _mm256_max_ps(t0, _mm256_setzero_ps());
+            _mm256_store_ps(tEnter, t);
+            return static_cast<uint32_t>(_mm256_movemask_ps(_mm256_cmp_ps(t, t1, _CMP_LE_OQ)));
+        }
+    };
+}
+
+template<size_t Width>
+static gp::RaycastHit raycastWideSSE(gp::WideBVH<Width> const& bvh, gp::PrecomputedRay const& r, gp::BVHQueryStats* stats) noexcept {
+    return traverseWide(bvh, r, stats, ChildTestSSE<Width>{r});
+}
+
+GP_TARGET_AVX static gp::RaycastHit raycastBVH8AVX(gp::BVH8 const& bvh, gp::PrecomputedRay const& r, gp::BVHQueryStats* stats) noexcept {
+    return traverseWide(bvh, r, stats, ChildTestAVX{r});
+}
+#endif
+
+gp::RaycastHit gp::bvhRaycastAABBs(BVH4 const& bvh, PrecomputedRay const& r, BVHQueryStats* stats, SimdLevel level) noexcept {
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::SSE) {
+        return raycastWideSSE(bvh, r, stats);
+    }
+#else
+    (void)level;
+#endif
+    return raycastWideScalar(bvh, r, stats);
+}
+
+gp::RaycastHit gp::bvhRaycastAABBs(BVH8 const& bvh, PrecomputedRay const& r, BVHQueryStats* stats, SimdLevel level) noexcept {
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX) {
+        return raycastBVH8AVX(bvh, r, stats);
+    } else if (level >= SimdLevel::SSE) {
+        return raycastWideSSE(bvh, r, stats);
+    }
+#else
+    (void)level;
+#endif
+    return raycastWideScalar(bvh, r, stats);
+}
+
+struct gp::DynamicBVH::Impl final {
+    DynamicBVHParams params;
+
+    BVH current;
+    float builtCost = 0.0f;
+    float cost = 0.0f;
+    uint64_t numRefits = 0;
+    uint64_t numRebuilds = 0;
+
+    // background rebuild: the worker builds `pending` from `snapshot` and then
+    // sets `pendingReady`, after which only the update thread touches them
+    std::thread worker;
+    std::unique_ptr<BVH> pending;
+    std::vector<AABB> snapshot;
+    std::atomic<bool> pendingReady{false};
+
+    Impl(DynamicBVHParams const& params_) : params{params_} {
+    }
+
+    ~Impl() noexcept {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    void resetCost() {
+        builtCost = bvhSAHCost(current, params.build);
+        cost = builtCost;
+    }
+
+    void rebuild(AABB const* aabbs, size_t n) {
+        bvhBuild(current, aabbs, n, params.build);
+        resetCost();
+        ++numRebuilds;
+    }
+
+    void startRebuild(AABB const* aabbs, size_t n) {
+        snapshot.assign(aabbs, aabbs + n);
+        if (!pending) {
+            pending = std::make_unique<BVH>();
+        }
+        pendingReady.store(false, std::memory_order_relaxed);
+
+        worker = std::thread{[this]() {
+            bvhBuild(*pending, snapshot, params.build);
+            pendingReady.store(true, std::memory_order_release);
+        }};
+    }
+
+    // discards any background rebuild
+    void cancelRebuild() {
+        if (worker.joinable()) {
+            worker.join();
+        }
+        pendingReady.store(false, std::memory_order_relaxed);
+    }
+
+    void update(AABB const* aabbs, size_t n) {
+        if (n != current.prims.size()) {
+            // primitives were added/removed, so the tree can't be refitted
+            // (and a pending rebuild is already out of date)
+            cancelRebuild();
+            rebuild(aabbs, n);
+            return;
+        }
+
+        if (worker.joinable() && pendingReady.load(std::memory_order_acquire)) {
+            worker.join();
+            pendingReady.store(false, std::memory_order_relaxed);
+            std::swap(current, *pending);
+            ++numRebuilds;
+
+            // the primitives may have moved while it was building
+            bvhRefit(current, aabbs, n);
+            ++numRefits;
+            resetCost();
+            return;
+        }
+
+        bvhRefit(current, aabbs, n);
+        ++numRefits;
+        cost = bvhSAHCost(current, params.build);
+
+        if (cost <= builtCost * params.rebuildThreshold || worker.joinable()) {
+            return;
+        }
+
+        if (params.asyncRebuild) {
+            startRebuild(aabbs, n);
+        } else {
+            rebuild(aabbs, n);
+        }
+    }
+};
+
+gp::DynamicBVH::DynamicBVH(DynamicBVHParams const& params) :
+    impl{new Impl{params}} {
+}
+
+gp::DynamicBVH::~DynamicBVH() noexcept {
+    delete impl;
+}
+
+void gp::DynamicBVH::update(AABB const* aabbs, size_t n) {
+    impl->update(aabbs, n);
+}
+
+gp::BVH const& gp::DynamicBVH::bvh() const noexcept {
+    return impl->current;
+}
+
+gp::DynamicBVH::Stats gp::DynamicBVH::stats() const noexcept {
+    Stats rv;
+    rv.costRatio = impl->builtCost > 0.0f ? impl->cost / impl->builtCost : 1.0f;
+    rv.numRefits = impl->numRefits;
+    rv.numRebuilds = impl->numRebuilds;
+    rv.rebuildPending = impl->worker.joinable();
+    return rv;
+}
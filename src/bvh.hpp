@@ -0,0 +1,509 @@
+#pragma once
+
+#include "app.hpp"
+#include "raycast.hpp"
+
+#include <glm/mat4x3.hpp>
+#include <glm/mat4x4.hpp>
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// bounding volume hierarchy (BVH) support
+//
+// a binary BVH over primitive AABBs. The build flattens the tree into one
+// contiguous, depth-first array of 32-byte nodes (two per cache line), so
+// traversal walks forward through memory rather than chasing pointers
+//
+// a binary BVH can be collapsed into a 4- or 8-wide one, which tests all of
+// a node's children in one SIMD instruction
+namespace gp {
+
+    // node of a flattened BVH
+    //
+    // depth-first layout: an internal node's first child is always the next
+    // node in the array, so only the second child's index is stored
+    struct alignas(32) BVHNode final {
+        // union of the node's children/primitives
+        AABB bounds;
+
+        // internal node: index of the second child in `BVH::nodes`
+        // leaf node: index of the first primitive in `BVH::prims`
+        uint32_t offset;
+
+        // number of primitives in the leaf, or 0 if this is an internal node
+        uint16_t nPrims;
+
+        // dimension (0, 1, 2 == X, Y, Z) an internal node was split along
+        uint8_t axis;
+
+        uint8_t pad;
+
+        [[nodiscard]] bool isLeaf() const noexcept {
+            return nPrims > 0;
+        }
+    };
+    static_assert(sizeof(BVHNode) == 32, "BVH nodes should be half a cache line");
+
+    // the deepest a BVH can get
+    //
+    // the builder switches to (balanced) median splits once it's halfway
+    // there, so that traversal can use a fixed-size stack
+    constexpr size_t bvhMaxDepth = 64;
+
+    struct BVH final {
+        // depth-first; the root is `nodes[0]`
+        std::vector<BVHNode> nodes;
+
+        // index of each primitive (in the array the BVH was built from), in
+        // leaf order
+        std::vector<uint32_t> prims;
+
+        // bounds of each primitive, in leaf order, so that leaf tests read
+        // contiguous memory
+        std::vector<AABB> primBounds;
+
+        [[nodiscard]] bool empty() const noexcept {
+            return nodes.empty();
+        }
+
+        void clear() noexcept {
+            nodes.clear();
+            prims.clear();
+            primBounds.clear();
+        }
+    };
+
+    // how a BVH builder chooses where to split a node's primitives
+    enum class BVHSplitMethod {
+        // at the midpoint of the longest dimension of the primitives'
+        // centroids: fast to build, but gives poor trees for clustered data
+        Midpoint,
+
+        // binned surface area heuristic (SAH): buckets the centroids into
+        // bins and splits at the bin boundary that minimizes the expected
+        // cost of a ray query
+        SAH,
+
+        // linear BVH (LBVH): sorts the primitives along a Morton (Z-order)
+        // curve through their centroids, and splits wherever the curve
+        // crosses a power-of-two grid boundary. Much faster to build than
+        // SAH, and parallel throughout, but gives worse trees. Meant for
+        // scenes that move too much to refit
+        Morton,
+    };
+
+    // the most bins a SAH build can use
+    constexpr size_t bvhMaxBins = 128;
+
+    struct BVHBuildParams final {
+        BVHSplitMethod splitMethod = BVHSplitMethod::SAH;
+
+        // number of bins (per dimension) that SAH splits are chosen from.
+        // Clamped to [2, bvhMaxBins]
+        size_t numBins = 16;
+
+        // bits in the Morton codes that a Morton build sorts by: 30 (10 per
+        // dimension) or 63 (21 per dimension, which separates primitives
+        // that are close together in big scenes, but sorts twice as slowly)
+        size_t mortonBits = 30;
+
+        // the most primitives a leaf can have
+        //
+        // the SAH builder may stop splitting before this, if testing all of
+        // a node's primitives is expected to be cheaper than splitting it
+        size_t maxPrimsPerLeaf = 4;
+
+        // SAH costs of traversing a node and testing one primitive. Raising
+        // `traversalCost` relative to `intersectionCost` gives shallower
+        // trees with bigger leaves
+        float traversalCost = 1.0f;
+        float intersectionCost = 1.0f;
+
+        // threads to build with (0 == one per core)
+        //
+        // for SAH/midpoint builds, the top of the tree is split serially,
+        // then the subtrees below it are built in parallel
+        size_t numThreads = 0;
+
+        // subtrees with fewer primitives than this aren't split into more
+        // parallel tasks
+        size_t minPrimsPerTask = 4096;
+    };
+
+    // (re)builds `bvh` over the supplied primitive AABBs
+    //
+    // reuses the BVH's existing allocations
+    void bvhBuild(BVH& bvh, AABB const* aabbs, size_t n, BVHBuildParams const& params = {});
+
+    inline void bvhBuild(BVH& bvh, std::vector<AABB> const& aabbs, BVHBuildParams const& params = {}) {
+        bvhBuild(bvh, aabbs.data(), aabbs.size(), params);
+    }
+
+    // updates the bounds of every primitive + node in `bvh`, bottom-up,
+    // without changing the tree's topology
+    //
+    // `aabbs` must be the primitives the BVH was built from (same number, same
+    // order), but they may have moved. Much cheaper than a rebuild, but the
+    // tree gets worse as the primitives drift away from where they were when
+    // it was built (see `bvhSAHCost`)
+    void bvhRefit(BVH& bvh, AABB const* aabbs, size_t n);
+
+    inline void bvhRefit(BVH& bvh, std::vector<AABB> const& aabbs) {
+        bvhRefit(bvh, aabbs.data(), aabbs.size());
+    }
+
+    // returns the SAH cost of `bvh`: the expected cost of a query that hits
+    // the root, using `params`' traversal + intersection costs
+    //
+    // comparing it against the cost straight after a build shows how much a
+    // refitted tree has degraded
+    [[nodiscard]] float bvhSAHCost(BVH const& bvh, BVHBuildParams const& params = {}) noexcept;
+
+    struct DynamicBVHParams final {
+        BVHBuildParams build;
+
+        // the tree is rebuilt once its SAH cost has grown by this factor
+        // since it was built
+        float rebuildThreshold = 1.5f;
+
+        // if true, rebuilds happen on a background thread, and the rebuilt
+        // tree is swapped in by the first `update` after it's ready.
+        // Otherwise, `update` rebuilds the tree in-place
+        bool asyncRebuild = true;
+    };
+
+    // a BVH over primitives that move
+    //
+    // each `update` refits the current tree, which is cheap, and only
+    // rebuilds it when refitting has degraded it too much. Not thread-safe:
+    // `update` and `bvh` should be called from the same thread
+    class DynamicBVH final {
+    public:
+        struct Stats final {
+            // SAH cost of the current tree, relative to its cost when it was
+            // built
+            float costRatio;
+
+            uint64_t numRefits;
+            uint64_t numRebuilds;
+
+            // true if a background rebuild is in progress
+            bool rebuildPending;
+        };
+
+        struct Impl;
+
+    private:
+        Impl* impl;
+
+    public:
+        DynamicBVH(DynamicBVHParams const& params = {});
+        DynamicBVH(DynamicBVH const&) = delete;
+        DynamicBVH(DynamicBVH&&) = delete;
+        DynamicBVH& operator=(DynamicBVH const&) = delete;
+        DynamicBVH& operator=(DynamicBVH&&) = delete;
+
+        // joins the background rebuild thread (if any)
+        ~DynamicBVH() noexcept;
+
+        // updates the tree to the primitives' current bounds
+        //
+        // refits the tree if the number of primitives hasn't changed, or
+        // rebuilds it (immediately) if it has
+        void update(AABB const* aabbs, size_t n);
+
+        void update(std::vector<AABB> const& aabbs) {
+            update(aabbs.data(), aabbs.size());
+        }
+
+        [[nodiscard]] BVH const& bvh() const noexcept;
+        [[nodiscard]] Stats stats() const noexcept;
+    };
+
+    // counters for BVH queries
+    //
+    // queries add to these, so one `BVHQueryStats` can total many queries
+    struct BVHQueryStats final {
+        // nodes that were visited (a wide node counts once)
+        size_t nodesVisited = 0;
+
+        // primitives whose AABBs were tested against the ray
+        size_t primsTested = 0;
+    };
+
+    // BVH queries
+    //
+    // rays hit primitive AABBs at `t = max(t0, 0)` (as in `raycastAABBs`),
+    // and `index` is the primitive's index in the array the BVH was built
+    // from. Traversal tests each node's bounds once (when its parent is
+    // visited), visits children nearest-first, and skips subtrees that the
+    // ray enters beyond the query's range (which, for closest-hit queries,
+    // shrinks to the closest hit so far)
+
+    // returns the closest primitive AABB the ray hits (ties are broken by
+    // lowest index)
+    [[nodiscard]] RaycastHit bvhRaycastAABBs(BVH const&, PrecomputedRay const&, BVHQueryStats* = nullptr) noexcept;
+
+    // returns the first primitive AABB the traversal finds that the ray hits
+    // at `t <= tMax`, which isn't necessarily the closest one
+    //
+    // stops as soon as anything's hit, so it's cheaper than a closest-hit
+    // query if any hit will do
+    [[nodiscard]] RaycastHit bvhRaycastAnyAABB(BVH const&, PrecomputedRay const&, float tMax = FLT_MAX, BVHQueryStats* = nullptr) noexcept;
+
+    // returns true if the ray hits any primitive AABB at `t <= tMax` (e.g.
+    // for line-of-sight checks, with `tMax` = the distance to the target)
+    [[nodiscard]] inline bool bvhOccluded(BVH const& bvh, PrecomputedRay const& ray, float tMax, BVHQueryStats* stats = nullptr) noexcept {
+        return bvhRaycastAnyAABB(bvh, ray, tMax, stats).hit();
+    }
+
+    // appends every primitive AABB the ray hits at `tMin <= t <= tMax` to
+    // `out`, nearest-first (ties are broken by lowest index)
+    void bvhRaycastAllAABBs(BVH const&, PrecomputedRay const&, float tMin, float tMax, std::vector<RaycastHit>& out, BVHQueryStats* = nullptr);
+
+    // triangle BVHs
+    //
+    // a BVH over the triangles of an indexed mesh, with one primitive per
+    // triangle, so a primitive's index is its triangle's index (i.e.
+    // `indices[3*index]` is its first vertex). As in `raycastIndexedTriangles`,
+    // `positions` is a strided array (`stride` is in bytes)
+
+    // (re)builds `bvh` over the triangles of an indexed mesh
+    void bvhBuildTriangles(BVH& bvh,
+                           glm::vec3 const* positions,
+                           size_t stride,
+                           uint32_t const* indices,
+                           size_t numIndices,
+                           BVHBuildParams const& params = {});
+
+    inline void bvhBuildTriangles(BVH& bvh,
+                                  glm::vec3 const* positions,
+                                  uint32_t const* indices,
+                                  size_t numIndices,
+                                  BVHBuildParams const& params = {}) {
+        bvhBuildTriangles(bvh, positions, sizeof(glm::vec3), indices, numIndices, params);
+    }
+
+    // as above, for vertex structs that have a `pos` member
+    template<typename Vert>
+    inline void bvhBuildTriangles(BVH& bvh,
+                                  Vert const* verts,
+                                  uint32_t const* indices,
+                                  size_t numIndices,
+                                  BVHBuildParams const& params = {}) {
+        bvhBuildTriangles(bvh, &verts->pos, sizeof(Vert), indices, numIndices, params);
+    }
+
+    // returns the closest triangle the ray hits (ties are broken by lowest
+    // index), using the watertight `rayIntersectsTriangle` on each triangle
+    // whose AABB the ray hits
+    //
+    // `positions` + `indices` must be the mesh that `bvh` was built from
+    [[nodiscard]] TriangleRaycastHit bvhRaycastTriangles(BVH const& bvh,
+                                                         PrecomputedRay const&,
+                                                         glm::vec3 const* positions,
+                                                         size_t stride,
+                                                         uint32_t const* indices,
+                                                         BVHQueryStats* = nullptr) noexcept;
+
+    [[nodiscard]] inline TriangleRaycastHit bvhRaycastTriangles(BVH const& bvh,
+                                                                PrecomputedRay const& ray,
+                                                                glm::vec3 const* positions,
+                                                                uint32_t const* indices,
+                                                                BVHQueryStats* stats = nullptr) noexcept {
+        return bvhRaycastTriangles(bvh, ray, positions, sizeof(glm::vec3), indices, stats);
+    }
+
+    template<typename Vert>
+    [[nodiscard]] inline TriangleRaycastHit bvhRaycastTriangles(BVH const& bvh,
+                                                                PrecomputedRay const& ray,
+                                                                Vert const* verts,
+                                                                uint32_t const* indices,
+                                                                BVHQueryStats* stats = nullptr) noexcept {
+        return bvhRaycastTriangles(bvh, ray, &verts->pos, sizeof(Vert), indices, stats);
+    }
+
+    // instanced (two-level) BVHs
+    //
+    // for scenes with many copies of a few meshes. Each unique mesh gets one
+    // bottom-level BVH (BLAS) over its triangles, in its own object space, and
+    // a top-level BVH (TLAS) is built over the instances' world-space AABBs.
+    // Queries transform the ray into an instance's object space when they
+    // reach the instance's leaf, so each mesh's triangles are only stored
+    // once, however many times it's instanced
+
+    // a triangle mesh, plus a BVH over its triangles
+    //
+    // doesn't own the mesh: `positions` and `indices` must outlive it
+    struct BLAS final {
+        // see `bvhBuildTriangles`
+        BVH bvh;
+
+        glm::vec3 const* positions = nullptr;
+        size_t stride = sizeof(glm::vec3);
+        uint32_t const* indices = nullptr;
+    };
+
+    // (re)builds `blas` over an indexed mesh
+    void blasBuild(BLAS& blas,
+                   glm::vec3 const* positions,
+                   size_t stride,
+                   uint32_t const* indices,
+                   size_t numIndices,
+                   BVHBuildParams const& params = {});
+
+    // as above, for vertex structs that have a `pos` member
+    template<typename Vert>
+    inline void blasBuild(BLAS& blas,
+                          Vert const* verts,
+                          uint32_t const* indices,
+                          size_t numIndices,
+                          BVHBuildParams const& params = {}) {
+        blasBuild(blas, &verts->pos, sizeof(Vert), indices, numIndices, params);
+    }
+
+    // an instance of a BLAS
+    struct TLASInstance final {
+        // world space -> the BLAS's object space (i.e. the inverse of the
+        // instance's transform). Affine, so stored as a 4x3 matrix
+        glm::mat4x3 worldToObject;
+
+        // index of the instance's BLAS
+        uint32_t blas;
+    };
+
+    struct TLAS final {
+        // over the instances' world-space AABBs
+        BVH bvh;
+
+        // in the order they were supplied to `tlasBuild`, so `bvh.prims`
+        // indexes this
+        std::vector<TLASInstance> instances;
+
+        [[nodiscard]] bool empty() const noexcept {
+            return bvh.empty();
+        }
+
+        void clear() noexcept {
+            bvh.clear();
+            instances.clear();
+        }
+    };
+
+    // (re)builds `tlas` over `numInstances` instances, where instance `i` is
+    // `blases[blasIndices[i]]`, placed in the world by the (affine, object ->
+    // world) matrix `transforms[i]`
+    //
+    // `blasIndices` may be `nullptr`, in which case every instance is of
+    // `blases[0]`. Throws if an instance's BLAS index is out of range
+    void tlasBuild(TLAS& tlas,
+                   BLAS const* blases,
+                   size_t numBLASes,
+                   glm::mat4 const* transforms,
+                   uint32_t const* blasIndices,
+                   size_t numInstances,
+                   BVHBuildParams const& params = {});
+
+    // the closest instance triangle hit by a ray
+    struct InstanceRaycastHit final {
+        // index of the instance, or -1 if nothing was hit
+        int32_t instance = -1;
+
+        // index of the triangle in the instance's BLAS
+        int32_t triangle = -1;
+
+        // distance along the (world-space) ray
+        float t = FLT_MAX;
+
+        // barycentric coordinates, as in `TriangleRaycastHit`
+        float u = 0.0f;
+        float v = 0.0f;
+
+        [[nodiscard]] bool hit() const noexcept {
+            return instance >= 0;
+        }
+    };
+
+    // returns the closest triangle, of any instance, that the ray hits (ties
+    // are broken by lowest instance, then lowest triangle, index)
+    //
+    // `blases` must be the BLASes that `tlas` was built with. Stats count the
+    // nodes/primitives of both levels
+    [[nodiscard]] InstanceRaycastHit tlasRaycast(TLAS const& tlas,
+                                                 BLAS const* blases,
+                                                 PrecomputedRay const&,
+                                                 BVHQueryStats* = nullptr) noexcept;
+
+    // node of a wide (4- or 8-ary) BVH
+    //
+    // the children's bounds are stored SoA, so that one SIMD slab test tests
+    // all of them. Unused child slots are at the end
+    template<size_t Width>
+    struct alignas(32) WideBVHNode final {
+        float minX[Width];
+        float minY[Width];
+        float minZ[Width];
+        float maxX[Width];
+        float maxY[Width];
+        float maxZ[Width];
+
+        // per child: index of the child in `WideBVH::nodes` (internal), or
+        // of its first primitive in `WideBVH::prims` (leaf)
+        uint32_t child[Width];
+
+        // per child: number of primitives in the leaf, or 0 if the child is
+        // an internal node
+        uint16_t nPrims[Width];
+
+        uint8_t numChildren;
+    };
+    static_assert(sizeof(WideBVHNode<4>) == 128, "BVH4 nodes should be two cache lines");
+    static_assert(sizeof(WideBVHNode<8>) == 256, "BVH8 nodes should be four cache lines");
+
+    // a wide BVH, collapsed from a binary one
+    //
+    // has the same leaves as the binary BVH, but far fewer (internal) nodes,
+    // so queries do fewer, wider, node tests
+    template<size_t Width>
+    struct WideBVH final {
+        // the root is `nodes[0]`
+        std::vector<WideBVHNode<Width>> nodes;
+
+        // as in `BVH`
+        std::vector<uint32_t> prims;
+        std::vector<AABB> primBounds;
+
+        [[nodiscard]] bool empty() const noexcept {
+            return nodes.empty();
+        }
+
+        void clear() noexcept {
+            nodes.clear();
+            prims.clear();
+            primBounds.clear();
+        }
+    };
+
+    using BVH4 = WideBVH<4>;
+    using BVH8 = WideBVH<8>;
+
+    // (re)builds a wide BVH from a binary one
+    //
+    // each wide node takes the place of a binary node, and repeatedly pulls
+    // up the grandchildren of its largest (by surface area) internal child
+    // until it has `Width` children
+    void bvhCollapse(BVH4&, BVH const&);
+    void bvhCollapse(BVH8&, BVH const&);
+
+    // returns the closest primitive AABB the ray hits, as in the binary BVH
+    // overload
+    //
+    // each visited node tests all of its children with one slab test (SSE
+    // for BVH4, AVX for BVH8), then visits the ones that were hit nearest
+    // first
+    [[nodiscard]] RaycastHit bvhRaycastAABBs(BVH4 const&, PrecomputedRay const&, BVHQueryStats* = nullptr, SimdLevel = bestSimdLevel()) noexcept;
+    [[nodiscard]] RaycastHit bvhRaycastAABBs(BVH8 const&, PrecomputedRay const&, BVHQueryStats* = nullptr, SimdLevel = bestSimdLevel()) noexcept;
+}
@@ -25,7 +25,7 @@ namespace cairo {
         }
     };
 
-    surface_t image_surface_create_for_data(
+    inline surface_t image_surface_create_for_data(
             unsigned char *data,
             cairo_format_t format,
             int	width,
@@ -65,7 +65,17 @@ namespace cairo {
         }
     };
 
-    t create(cairo_surface_t* target) {
+    inline surface_t image_surface_create(cairo_format_t format, int width, int height) {
+        cairo_surface_t* ptr = cairo_image_surface_create(format, width, height);
+        if (cairo_surface_status(ptr) != CAIRO_STATUS_SUCCESS) {
+            cairo_surface_destroy(ptr);
+            throw std::runtime_error{"cairo_image_surface_create: failed"};
+        }
+
+        return surface_t{ptr};
+    }
+
+    inline t create(cairo_surface_t* target) {
         return t{cairo_create(target)};
     }
 }
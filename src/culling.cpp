@@ -0,0 +1,297 @@
+#include "culling.hpp"
+
+#ifdef GP_SIMD_X86
+#include <immintrin.h>
+#endif
+
+gp::Frustum gp::frustumFromViewProjection(glm::mat4 const& m) noexcept {
+    // Gribb & Hartmann: a clip-space point is inside the frustum if
+    // -w <= x, y, z <= w, so each plane is row3 +/- row{0,1,2} of the matrix
+    //
+    // (glm is column-major: m[col][row])
+    auto row = [&m](int r) {
+        return glm::vec4{m[0][r], m[1][r], m[2][r], m[3][r]};
+    };
+
+    Frustum rv;
+    rv.planes[0] = row(3) + row(0);  // left
+    rv.planes[1] = row(3) - row(0);  // right
+    rv.planes[2] = row(3) + row(1);  // bottom
+    rv.planes[3] = row(3) - row(1);  // top
+    rv.planes[4] = row(3) + row(2);  // near
+    rv.planes[5] = row(3) - row(2);  // far
+
+    for (glm::vec4& p : rv.planes) {
+        p /= glm::length(glm::vec3{p});
+    }
+
+    return rv;
+}
+
+// the "positive vertex" of an AABB w.r.t. a plane is the corner that is
+// furthest along the plane's normal: if it's behind the plane, the whole AABB is
+bool gp::frustumIntersectsAABB(Frustum const& f, AABB const& a) noexcept {
+    bool visible = true;
+    for (glm::vec4 const& p : f.planes) {
+        float px = p.x >= 0.0f ? a.max.x : a.min.x;
+        float py = p.y >= 0.0f ? a.max.y : a.min.y;
+        float pz = p.z >= 0.0f ? a.max.z : a.min.z;
+        visible &= p.x*px + p.y*py + p.z*pz + p.w >= 0.0f;
+    }
+    return visible;
+}
+
+// returns true if `a` is entirely inside the frustum (i.e. its "negative
+// vertex" is inside every plane)
+static bool frustumContainsAABB(gp::Frustum const& f, gp::AABB const& a) noexcept {
+    bool inside = true;
+    for (glm::vec4 const& p : f.planes) {
+        float nx = p.x >= 0.0f ? a.min.x : a.max.x;
+        float ny = p.y >= 0.0f ? a.min.y : a.max.y;
+        float nz = p.z >= 0.0f ? a.min.z : a.max.z;
+        inside &= p.x*nx + p.y*ny + p.z*nz + p.w >= 0.0f;
+    }
+    return inside;
+}
+
+bool gp::frustumIntersectsSphere(Frustum const& f, Sphere const& s) noexcept {
+    bool visible = true;
+    for (glm::vec4 const& p : f.planes) {
+        visible &= p.x*s.origin.x + p.y*s.origin.y + p.z*s.origin.z + p.w + s.radius >= 0.0f;
+    }
+    return visible;
+}
+
+// appends the indices of the set bits in `mask` (of `width` lanes starting at
+// index `base`) to `out`
+//
+// branchless: every lane's index is written, but `count` only advances past
+// visible ones. This never writes out of bounds, because `count <= base + lane`
+static inline size_t compactMask(uint32_t* out, size_t count, size_t base, unsigned mask, unsigned width) noexcept {
+    for (unsigned lane = 0; lane < width; ++lane) {
+        out[count] = static_cast<uint32_t>(base + lane);
+        count += (mask >> lane) & 1u;
+    }
+    return count;
+}
+
+namespace {
+    // a frustum plane, plus which AABB arrays hold the "positive vertex"
+    // components for it
+    struct AABBPlane final {
+        glm::vec4 plane;
+        float const* px;
+        float const* py;
+        float const* pz;
+    };
+
+    std::array<AABBPlane, 6> aabbPlanes(gp::Frustum const& f, gp::AABBArray const& a) noexcept {
+        std::array<AABBPlane, 6> rv;
+        for (size_t i = 0; i < rv.size(); ++i) {
+            glm::vec4 const& p = f.planes[i];
+            rv[i].plane = p;
+            rv[i].px = p.x >= 0.0f ? a.maxX.data() : a.minX.data();
+            rv[i].py = p.y >= 0.0f ? a.maxY.data() : a.minY.data();
+            rv[i].pz = p.z >= 0.0f ? a.maxZ.data() : a.minZ.data();
+        }
+        return rv;
+    }
+}
+
+static size_t cullAABBsScalar(std::array<AABBPlane, 6> const& planes, size_t begin, size_t end, uint32_t* out, size_t count) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+        bool visible = true;
+        for (AABBPlane const& p : planes) {
+            visible &= p.plane.x*p.px[i] + p.plane.y*p.py[i] + p.plane.z*p.pz[i] + p.plane.w >= 0.0f;
+        }
+        out[count] = static_cast<uint32_t>(i);
+        count += visible;
+    }
+    return count;
+}
+
+static size_t cullSpheresScalar(gp::Frustum const& f, gp::SphereArray const& s, size_t begin, size_t end, uint32_t* out, size_t count) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+        bool visible = true;
+        for (glm::vec4 const& p : f.planes) {
+            visible &= p.x*s.x[i] + p.y*s.y[i] + p.z*s.z[i] + p.w + s.r[i] >= 0.0f;
+        }
+        out[count] = static_cast<uint32_t>(i);
+        count += visible;
+    }
+    return count;
+}
+
+#ifdef GP_SIMD_X86
+static size_t cullAABBsSSE(std::array<AABBPlane, 6> const& planes, size_t n, uint32_t* out) noexcept {
+    size_t count = 0;
+    size_t i = 0;
+    __m128 const zero = _mm_setzero_ps();
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (AABBPlane const& p : planes) {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.plane.x), _mm_loadu_ps(p.px + i)),
+                           _mm_mul_ps(_mm_set1_ps(p.plane.y), _mm_loadu_ps(p.py + i))),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.plane.z), _mm_loadu_ps(p.pz + i)),
+                           _mm_set1_ps(p.plane.w)));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(d, zero));
+        }
+        count = compactMask(out, count, i, static_cast<unsigned>(_mm_movemask_ps(visible)), 4);
+    }
+
+    return cullAABBsScalar(planes, i, n, out, count);
+}
+
+GP_TARGET_AVX static size_t cullAABBsAVX(std::array<AABBPlane, 6> const& planes, size_t n, uint32_t* out) noexcept {
+    size_t count = 0;
+    size_t i = 0;
+    __m256 const zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (AABBPlane const& p : planes) {
+            __m256 d = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.plane.x), _mm256_loadu_ps(p.px + i)),
+                              _mm256_mul_ps(_mm256_set1_ps(p.plane.y), _mm256_loadu_ps(p.py + i))),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.plane.z), _mm256_loadu_ps(p.pz + i)),
+                              _mm256_set1_ps(p.plane.w)));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+        }
+        count = compactMask(out, count, i, static_cast<unsigned>(_mm256_movemask_ps(visible)), 8);
+    }
+
+    return cullAABBsScalar(planes, i, n, out, count);
+}
+
+static size_t cullSpheresSSE(gp::Frustum const& f, gp::SphereArray const& s, uint32_t* out) noexcept {
+    size_t n = s.size();
+    size_t count = 0;
+    size_t i = 0;
+    __m128 const zero = _mm_setzero_ps();
+
+    for (; i + 4 <= n; i += 4) {
+        __m128 x = _mm_loadu_ps(s.x.data() + i);
+        __m128 y = _mm_loadu_ps(s.y.data() + i);
+        __m128 z = _mm_loadu_ps(s.z.data() + i);
+        __m128 r = _mm_loadu_ps(s.r.data() + i);
+
+        __m128 visible = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (glm::vec4 const& p : f.planes) {
+            __m128 d = _mm_add_ps(
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.x), x), _mm_mul_ps(_mm_set1_ps(p.y), y)),
+                _mm_add_ps(_mm_mul_ps(_mm_set1_ps(p.z), z), _mm_add_ps(_mm_set1_ps(p.w), r)));
+            visible = _mm_and_ps(visible, _mm_cmpge_ps(d, zero));
+        }
+        count = compactMask(out, count, i, static_cast<unsigned>(_mm_movemask_ps(visible)), 4);
+    }
+
+    return cullSpheresScalar(f, s, i, n, out, count);
+}
+
+GP_TARGET_AVX static size_t cullSpheresAVX(gp::Frustum const& f, gp::SphereArray const& s, uint32_t* out) noexcept {
+    size_t n = s.size();
+    size_t count = 0;
+    size_t i = 0;
+    __m256 const zero = _mm256_setzero_ps();
+
+    for (; i + 8 <= n; i += 8) {
+        __m256 x = _mm256_loadu_ps(s.x.data() + i);
+        __m256 y = _mm256_loadu_ps(s.y.data() + i);
+        __m256 z = _mm256_loadu_ps(s.z.data() + i);
+        __m256 r = _mm256_loadu_ps(s.r.data() + i);
+
+        __m256 visible = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        for (glm::vec4 const& p : f.planes) {
+            __m256 d = _mm256_add_ps(
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.x), x), _mm256_mul_ps(_mm256_set1_ps(p.y), y)),
+                _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(p.z), z), _mm256_add_ps(_mm256_set1_ps(p.w), r)));
+            visible = _mm256_and_ps(visible, _mm256_cmp_ps(d, zero, _CMP_GE_OQ));
+        }
+        count = compactMask(out, count, i, static_cast<unsigned>(_mm256_movemask_ps(visible)), 8);
+    }
+
+    return cullSpheresScalar(f, s, i, n, out, count);
+}
+#endif
+
+size_t gp::cullAABBs(Frustum const& f, AABBArray const& aabbs, uint32_t* out, SimdLevel level) noexcept {
+    std::array<AABBPlane, 6> planes = aabbPlanes(f, aabbs);
+
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX) {
+        return cullAABBsAVX(planes, aabbs.size(), out);
+    } else if (level >= SimdLevel::SSE) {
+        return cullAABBsSSE(planes, aabbs.size(), out);
+    }
+#endif
+    return cullAABBsScalar(planes, 0, aabbs.size(), out, 0);
+}
+
+void gp::cullAABBs(Frustum const& f, AABBArray const& aabbs, std::vector<uint32_t>& out, SimdLevel level) {
+    out.resize(aabbs.size());
+    out.resize(cullAABBs(f, aabbs, out.data(), level));
+}
+
+size_t gp::cullSpheres(Frustum const& f, SphereArray const& spheres, uint32_t* out, SimdLevel level) noexcept {
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX) {
+        return cullSpheresAVX(f, spheres, out);
+    } else if (level >= SimdLevel::SSE) {
+        return cullSpheresSSE(f, spheres, out);
+    }
+#endif
+    return cullSpheresScalar(f, spheres, 0, spheres.size(), out, 0);
+}
+
+void gp::cullSpheres(Frustum const& f, SphereArray const& spheres, std::vector<uint32_t>& out, SimdLevel level) {
+    out.resize(spheres.size());
+    out.resize(cullSpheres(f, spheres, out.data(), level));
+}
+
+void gp::cullBVH(Frustum const& f, BVH const& bvh, std::vector<uint32_t>& out) {
+    out.clear();
+    if (bvh.empty()) {
+        return;
+    }
+
+    // each level pops one node and pushes (at most) two
+    uint32_t stack[bvhMaxDepth + 1];
+    size_t stackSize = 0;
+    stack[stackSize++] = 0;
+
+    while (stackSize > 0) {
+        uint32_t cur = stack[--stackSize];
+        BVHNode const& node = bvh.nodes[cur];
+
+        if (!frustumIntersectsAABB(f, node.bounds)) {
+            continue;
+        }
+
+        if (node.isLeaf()) {
+            for (uint32_t i = node.offset, end = node.offset + node.nPrims; i < end; ++i) {
+                if (frustumIntersectsAABB(f, bvh.primBounds[i])) {
+                    out.push_back(bvh.prims[i]);
+                }
+            }
+        } else if (frustumContainsAABB(f, node.bounds)) {
+            // the layout's depth-first, so the subtree's primitives are
+            // contiguous: from its leftmost leaf's to its rightmost leaf's
+            uint32_t first = cur + 1;
+            while (!bvh.nodes[first].isLeaf()) {
+                ++first;
+            }
+            uint32_t last = node.offset;
+            while (!bvh.nodes[last].isLeaf()) {
+                last = bvh.nodes[last].offset;
+            }
+            uint32_t begin = bvh.nodes[first].offset;
+            uint32_t end = bvh.nodes[last].offset + bvh.nodes[last].nPrims;
+            out.insert(out.end(), bvh.prims.begin() + begin, bvh.prims.begin() + end);
+        } else {
+            stack[stackSize++] = node.offset;
+            stack[stackSize++] = cur + 1;
+        }
+    }
+}
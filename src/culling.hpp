@@ -0,0 +1,71 @@
+#pragma once
+
+#include "app.hpp"
+#include "bvh.hpp"
+#include "simd.hpp"
+#include "soa.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// frustum culling support
+//
+// tests batches of bounding volumes against a camera's view frustum and
+// outputs the (compacted) indices of the volumes that are potentially
+// visible, so that callers only draw those
+//
+// the tests are conservative: a volume that is near a frustum corner may be
+// reported as visible even if it's just outside the frustum, but a visible
+// volume is never culled
+namespace gp {
+
+    // a view frustum, as six planes (left, right, bottom, top, near, far)
+    //
+    // each plane is `(n.x, n.y, n.z, d)`, where `n` is normalized and points
+    // into the frustum, so that a point `p` is inside the plane if
+    // `dot(n, p) + d >= 0`
+    struct Frustum final {
+        std::array<glm::vec4, 6> planes;
+    };
+
+    // extracts the frustum planes from a (projection * view) matrix
+    //
+    // works for any OpenGL-style (clip space z in [-w, w]) projection
+    [[nodiscard]] Frustum frustumFromViewProjection(glm::mat4 const&) noexcept;
+
+    [[nodiscard]] inline Frustum frustumFromCamera(Euler_perspective_camera const& camera, float aspectRatio) noexcept {
+        return frustumFromViewProjection(camera.projectionMatrix(aspectRatio) * camera.viewMatrix());
+    }
+
+    [[nodiscard]] bool frustumIntersectsAABB(Frustum const&, AABB const&) noexcept;
+    [[nodiscard]] bool frustumIntersectsSphere(Frustum const&, Sphere const&) noexcept;
+
+    // writes the indices of the AABBs that intersect the frustum into `out`
+    // (ascending), returning the number of indices written
+    //
+    // `out` must have space for `aabbs.size()` indices
+    size_t cullAABBs(Frustum const&, AABBArray const& aabbs, uint32_t* out, SimdLevel = bestSimdLevel()) noexcept;
+
+    // as above, but resizes `out` to fit the visible indices
+    void cullAABBs(Frustum const&, AABBArray const& aabbs, std::vector<uint32_t>& out, SimdLevel = bestSimdLevel());
+
+    // writes the indices of the spheres that intersect the frustum into `out`
+    // (ascending), returning the number of indices written
+    //
+    // `out` must have space for `spheres.size()` indices
+    size_t cullSpheres(Frustum const&, SphereArray const& spheres, uint32_t* out, SimdLevel = bestSimdLevel()) noexcept;
+
+    // as above, but resizes `out` to fit the visible indices
+    void cullSpheres(Frustum const&, SphereArray const& spheres, std::vector<uint32_t>& out, SimdLevel = bestSimdLevel());
+
+    // resizes `out` to fit the indices of the primitives in `bvh` whose AABBs
+    // intersect the frustum (in leaf order, not ascending)
+    //
+    // hierarchical: skips subtrees whose bounds are outside the frustum, and
+    // outputs subtrees whose bounds are entirely inside it without testing
+    // their primitives, so the cost scales with what's near the frustum's
+    // boundary, rather than with the number of primitives
+    void cullBVH(Frustum const&, BVH const& bvh, std::vector<uint32_t>& out);
+}
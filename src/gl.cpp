@@ -5,6 +5,8 @@
 
 using std::literals::operator""s;
 
+GLuint gl::window_fbo_handle = 0;
+
 void gl::CompileFromSource(Shader_handle const& s, const char* src) {
     glShaderSource(s.get(), 1, &src, nullptr);
     glCompileShader(s.get());
@@ -640,10 +640,16 @@ namespace gl {
         glBindFramebuffer(target, fb.raw_handle());
     }
 
+    // handle of the framebuffer that `window_fbo` binds
+    //
+    // usually 0 (the window's default framebuffer), but a headless app
+    // renders into an offscreen FBO instead
+    extern GLuint window_fbo_handle;
+
     struct Window_fbo final {};
     static constexpr Window_fbo window_fbo{};
     inline void BindFramebuffer(GLenum target, Window_fbo) noexcept {
-        glBindFramebuffer(target, 0);
+        glBindFramebuffer(target, window_fbo_handle);
     }
 
     template<typename Texture>
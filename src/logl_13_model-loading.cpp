@@ -146,12 +146,15 @@ int main(int, char**) {
 
     // Extra GL setup
     auto prog = Model_program{};
-    std::shared_ptr<Model> model = model::load_model_cached(gfxplay::resource_path("backpack/backpack.obj").c_str());
+    std::shared_ptr<Model> model = model::load_model_cached(
+        gfxplay::resource_path("backpack/backpack.obj").c_str(),
+        model::LoadFlag_Keep_Cpu_Data);
     Compiled_model cmodel{prog, std::move(model)};
     glEnable(GL_FRAMEBUFFER_SRGB);
 
     // Game state setup
     auto game = ui::Game_state{};
+    model::Mesh_hit last_hit;
 
     // game loop
     auto throttle = util::Software_throttle{8ms};
@@ -170,6 +173,22 @@ int main(int, char**) {
 
         game.tick(dt);
 
+        // pick whatever's under the crosshair (the model matrix is the
+        // identity, so the camera ray is already in model space)
+        {
+            model::Mesh_hit hit = model::raycast(*cmodel.m, gp::Line{game.camera.pos, game.camera.front()});
+            if (hit.mesh != last_hit.mesh || hit.triangle != last_hit.triangle) {
+                char buf[128];
+                if (hit.hit()) {
+                    std::snprintf(buf, sizeof(buf), "mesh %i, triangle %i, uv = (%.3f, %.3f)", hit.mesh, hit.triangle, hit.uv.x, hit.uv.y);
+                } else {
+                    std::snprintf(buf, sizeof(buf), "nothing under the crosshair");
+                }
+                SDL_SetWindowTitle(sdl.window, buf);
+            }
+            last_hit = hit;
+        }
+
         gl::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         draw(prog, cmodel, game);
 
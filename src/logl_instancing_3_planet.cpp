@@ -1,5 +1,7 @@
 #include "logl_common.hpp"
 #include "logl_model.hpp"
+#include "culling.hpp"
+#include "bvh.hpp"
 
 // A program that performs instanced rendering
 //
@@ -69,11 +71,32 @@ static gl::Vertex_array create_vao(Instanced_model_program& p,
     return vao;
 }
 
+// CPU-side copy of a model's instances, so that they can be frustum culled
+// before uploading the visible ones, and picked
+//
+// two-level: one BLAS per mesh (in the mesh's object space), plus a TLAS over
+// every (instance, mesh) pair, so the model's triangles are only stored once
+struct Culled_instances final {
+    std::vector<glm::mat4> matrices;
+    std::vector<gp::BLAS> blases;
+
+    // TLAS instance `i` is mesh `i % blases.size()` of instance
+    // `i / blases.size()`
+    gp::TLAS tlas;
+
+    // reused between frames
+    std::vector<uint32_t> visible;
+    std::vector<glm::mat4> visible_matrices;
+};
+
 struct Compiled_model final {
     std::shared_ptr<Model> model;
     gl::Array_buffer<glm::mat4> instance_matrices;
     std::vector<gl::Vertex_array> vaos;
 
+    // if set, only the instances that are in the camera's frustum are drawn
+    std::unique_ptr<Culled_instances> culling;
+
     Compiled_model(Instanced_model_program& p,
                    std::shared_ptr<Model> m,
                    gl::Array_buffer<glm::mat4> ims) :
@@ -90,7 +113,7 @@ struct Compiled_model final {
 static Compiled_model load_asteroids(Instanced_model_program& p) {
     constexpr size_t num_roids = 100000;
 
-    std::array<glm::mat4, num_roids> roids;
+    std::vector<glm::mat4> roids(num_roids);
 
     float radius = 150.0;
     float offset = 25.0f;
@@ -118,11 +141,73 @@ static Compiled_model load_asteroids(Instanced_model_program& p) {
         roids[i] = model;
     }
 
-    return Compiled_model{
+    Compiled_model rv{
         p,
-        model::load_model_cached(gfxplay::resource_path("rock/rock.obj").c_str()),
+        model::load_model_cached(gfxplay::resource_path("rock/rock.obj").c_str(), model::LoadFlag_Keep_Cpu_Data),
         gl::Array_buffer<glm::mat4>(roids)
     };
+
+    // build the TLAS over each (instance, mesh) pair
+    std::vector<Mesh> const& meshes = rv.model->meshes;
+    rv.culling = std::make_unique<Culled_instances>();
+    Culled_instances& c = *rv.culling;
+
+    c.blases.resize(meshes.size());
+    for (size_t i = 0; i < meshes.size(); ++i) {
+        gp::blasBuild(c.blases[i], meshes[i].cpu_verts.data(), meshes[i].cpu_indices.data(), meshes[i].cpu_indices.size());
+    }
+
+    std::vector<glm::mat4> transforms;
+    std::vector<uint32_t> blas_indices;
+    transforms.reserve(roids.size() * meshes.size());
+    blas_indices.reserve(roids.size() * meshes.size());
+    for (glm::mat4 const& m : roids) {
+        for (size_t i = 0; i < meshes.size(); ++i) {
+            transforms.push_back(m);
+            blas_indices.push_back(static_cast<uint32_t>(i));
+        }
+    }
+    gp::tlasBuild(c.tlas, c.blases.data(), c.blases.size(), transforms.data(), blas_indices.data(), transforms.size());
+
+    c.matrices = std::move(roids);
+
+    return rv;
+}
+
+// uploads the model's instances that are in the camera's frustum
+static void cull_instances(Compiled_model& m, ui::Game_state& gs) {
+    Culled_instances& c = *m.culling;
+
+    gp::Frustum frustum = gp::frustumFromViewProjection(gs.camera.persp_mtx() * gs.camera.view_mtx());
+    gp::cullBVH(frustum, c.tlas.bvh, c.visible);
+
+    // map (instance, mesh) pairs back to instances: an instance is drawn if
+    // any of its meshes are visible
+    size_t num_meshes = std::max(c.blases.size(), size_t{1});
+    for (uint32_t& i : c.visible) {
+        i /= static_cast<uint32_t>(num_meshes);
+    }
+    if (num_meshes > 1) {
+        std::sort(c.visible.begin(), c.visible.end());
+        c.visible.erase(std::unique(c.visible.begin(), c.visible.end()), c.visible.end());
+    }
+
+    c.visible_matrices.clear();
+    for (uint32_t i : c.visible) {
+        c.visible_matrices.push_back(c.matrices[i]);
+    }
+    m.instance_matrices.assign(c.visible_matrices.data(), c.visible_matrices.size());
+}
+
+// returns the index of the instance under the camera's crosshair, or -1 if
+// there isn't one
+static int pick_instance(Compiled_model const& m, ui::Game_state const& gs) {
+    Culled_instances const& c = *m.culling;
+
+    gp::PrecomputedRay ray{gp::Line{gs.camera.pos, gs.camera.front()}};
+    gp::InstanceRaycastHit hit = gp::tlasRaycast(c.tlas, c.blases.data(), ray);
+
+    return hit.hit() ? hit.instance / static_cast<int>(c.blases.size()) : -1;
 }
 
 // draw a mesh
@@ -197,6 +282,10 @@ static void draw(Instanced_model_program& p,
                  Compiled_model& m,
                  ui::Game_state& gs) {
 
+    if (m.culling) {
+        cull_instances(m, gs);
+    }
+
     std::vector<Mesh>& meshes = m.model->meshes;
 
     for (size_t i = 0; i < m.vaos.size(); ++i) {
@@ -227,6 +316,7 @@ int main(int, char**) {
 
     // Game state setup
     auto game = ui::Game_state{};
+    int picked = -1;
 
     // game loop
     auto throttle = util::Software_throttle{8ms};
@@ -245,6 +335,13 @@ int main(int, char**) {
 
         game.tick(dt);
 
+        // show which asteroid is under the crosshair
+        if (int p = pick_instance(asteroids, game); p != picked) {
+            picked = p;
+            std::string title = p >= 0 ? "asteroid " + std::to_string(p) : "no asteroid under the crosshair";
+            SDL_SetWindowTitle(sdl.window, title.c_str());
+        }
+
         gl::Clear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         draw(prog, planet, game);
         draw(prog, asteroids, game);
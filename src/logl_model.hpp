@@ -1,15 +1,19 @@
 #pragma once
 
 #include "gl_extensions.hpp"
+#include "bvh.hpp"
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
 #include <assimp/postprocess.h>
 
+#include <cfloat>
 #include <filesystem>
+#include <map>
 #include <unordered_map>
 #include <mutex>
 #include <memory>
+#include <type_traits>
 #include <cstdint>
 #include <vector>
 
@@ -41,12 +45,51 @@ namespace model {
         gl::Element_array_buffer<unsigned> ebo;
         size_t num_indices;
         std::vector<std::shared_ptr<Mesh_tex>> textures;
+
+        // CPU-side copy of the verts/indices, plus a BVH over the mesh's
+        // triangles, for picking (see `raycast`). Empty unless the mesh was
+        // loaded with `LoadFlag_Keep_Cpu_Data`
+        std::vector<Mesh_vert> cpu_verts;
+        std::vector<unsigned> cpu_indices;
+        gp::BVH bvh;
     };
 
     struct Model final {
         std::vector<Mesh> meshes;
     };
 
+    enum Load_flags {
+        LoadFlag_None = 0,
+
+        // keep a CPU-side copy of each mesh + build a triangle BVH over it,
+        // so that the model can be raycasted against without touching the GPU
+        LoadFlag_Keep_Cpu_Data = 1,
+    };
+
+    // the closest triangle hit by a ray
+    struct Mesh_hit final {
+        // index of the mesh in `Model::meshes`, or -1 if nothing was hit
+        int mesh = -1;
+
+        // index of the triangle in the mesh (i.e. `cpu_indices[3*triangle]`
+        // is its first vertex)
+        int triangle = -1;
+
+        // distance along the ray
+        float t = FLT_MAX;
+
+        // barycentric weights of the triangle's verts at the hit
+        glm::vec3 barycentrics = {0.0f, 0.0f, 0.0f};
+
+        // interpolated position (in model space) + texture coordinate of the hit
+        glm::vec3 pos = {0.0f, 0.0f, 0.0f};
+        glm::vec2 uv = {0.0f, 0.0f};
+
+        [[nodiscard]] bool hit() const noexcept {
+            return mesh >= 0;
+        }
+    };
+
     static Mesh_tex load_texture(path p, Tex_type type) {
         gl::Tex_flags flgs = type == Tex_type::diffuse ?
             gl::Tex_flags::TexFlag_SRGB :
@@ -88,9 +131,13 @@ namespace model {
         return ctl.load(p, type);
     }
 
-    static Mesh load_mesh(path const& dir, aiScene const& scene, aiMesh const& mesh) {
+    static Mesh load_mesh(path const& dir, aiScene const& scene, aiMesh const& mesh, Load_flags flags = LoadFlag_None) {
+        bool keep_cpu_data = flags & LoadFlag_Keep_Cpu_Data;
+        std::vector<Mesh_vert> cpu_verts;
+        std::vector<unsigned> cpu_indices;
+
         // load verts into an OpenGL VBO
-        gl::Array_buffer<Mesh_vert> vbo = [&mesh]() {
+        gl::Array_buffer<Mesh_vert> vbo = [&mesh, keep_cpu_data, &cpu_verts]() {
             bool has_tex_coords = mesh.mTextureCoords[0] != nullptr;
 
             std::vector<Mesh_vert> dest_verts;
@@ -118,12 +165,16 @@ namespace model {
                 }
             }
 
-            return gl::Array_buffer<Mesh_vert>{dest_verts};
+            gl::Array_buffer<Mesh_vert> rv{dest_verts};
+            if (keep_cpu_data) {
+                cpu_verts = std::move(dest_verts);
+            }
+            return rv;
         }();
 
         // load indices into an OpenGL EBO
         size_t num_indices = 1337;
-        gl::Element_array_buffer<unsigned> ebo = [&mesh, &num_indices]() {
+        gl::Element_array_buffer<unsigned> ebo = [&mesh, &num_indices, keep_cpu_data, &cpu_indices]() {
             std::vector<unsigned> indices;
 
             for (size_t i = 0; i < mesh.mNumFaces; ++i) {
@@ -134,7 +185,11 @@ namespace model {
             }
             num_indices = indices.size();
 
-            return gl::Element_array_buffer<unsigned>{indices};
+            gl::Element_array_buffer<unsigned> rv{indices};
+            if (keep_cpu_data) {
+                cpu_indices = std::move(indices);
+            }
+            return rv;
         }();
 
         // load textures into a std::vector for later binding
@@ -174,26 +229,39 @@ namespace model {
 
         textures.shrink_to_fit();
 
-        return Mesh{std::move(vbo), std::move(ebo), num_indices , std::move(textures)};
+        // build a BVH over the triangles, for picking
+        gp::BVH bvh;
+        if (keep_cpu_data) {
+            gp::bvhBuildTriangles(bvh, cpu_verts.data(), cpu_indices.data(), cpu_indices.size());
+        }
+
+        return Mesh{std::move(vbo),
+                    std::move(ebo),
+                    num_indices,
+                    std::move(textures),
+                    std::move(cpu_verts),
+                    std::move(cpu_indices),
+                    std::move(bvh)};
     }
 
     static void process_node(path const& dir,
                              aiScene const& scene,
                              aiNode const& node,
-                             Model& out) {
+                             Model& out,
+                             Load_flags flags) {
 
         // process all meshes in `node`
         for (size_t i = 0; i < node.mNumMeshes; ++i) {
-            out.meshes.push_back(load_mesh(dir, scene, *scene.mMeshes[node.mMeshes[i]]));
+            out.meshes.push_back(load_mesh(dir, scene, *scene.mMeshes[node.mMeshes[i]], flags));
         }
 
         // recurse into all sub-nodes in `node`
         for (size_t i = 0; i < node.mNumChildren; ++i) {
-            process_node(dir, scene, *node.mChildren[i], out);
+            process_node(dir, scene, *node.mChildren[i], out, flags);
         }
     }
 
-    static Model load_model_(char const* path) {
+    static Model load_model_(char const* path, Load_flags flags = LoadFlag_None) {
         Assimp::Importer imp;
         aiScene const* scene =
             imp.ReadFile(path, aiProcess_Triangulate | aiProcess_GenSmoothNormals | aiProcess_CalcTangentSpace);
@@ -211,34 +279,88 @@ namespace model {
                 std::filesystem::path{path}.parent_path();
 
         Model rv;
-        process_node(model_dir, *scene, *scene->mRootNode, rv);
+        process_node(model_dir, *scene, *scene->mRootNode, rv, flags);
         return rv;
     }
 
     struct Caching_model_loader final {
-        std::unordered_map<std::string, std::shared_ptr<Model>> cache;
+        // keyed by flags too, because models loaded with different flags
+        // hold different data
+        std::map<std::pair<std::string, Load_flags>, std::shared_ptr<Model>> cache;
         std::mutex m;
 
-        std::shared_ptr<Model> load(path p) {
+        std::shared_ptr<Model> load(path p, Load_flags flags) {
             auto l = std::lock_guard(m);
-            auto it = cache.find(p);
+            auto key = std::pair{std::move(p).string(), flags};
+            auto it = cache.find(key);
 
             if (it != cache.end()) {
                 return it->second;
             }
 
             std::shared_ptr<Model> t =
-                std::make_shared<Model>(load_model_(p.c_str()));
+                std::make_shared<Model>(load_model_(key.first.c_str(), flags));
 
-            cache.emplace(std::move(p).string(), t);
+            cache.emplace(std::move(key), t);
 
             return t;
         }
     };
 
-    static std::shared_ptr<Model> load_model_cached(char const* path) {
+    static std::shared_ptr<Model> load_model_cached(char const* path, Load_flags flags = LoadFlag_None) {
         static Caching_model_loader cml;
-        return cml.load(path);
+        return cml.load(path, flags);
+    }
+
+    // returns the closest triangle in `mesh` that the ray hits (`mesh` is
+    // always 0, because the mesh doesn't know its index in a model)
+    //
+    // the ray must be in the mesh's model space. Always misses if the mesh
+    // was loaded without `LoadFlag_Keep_Cpu_Data`
+    static Mesh_hit raycast(Mesh const& mesh, gp::PrecomputedRay const& ray) {
+        static_assert(std::is_same_v<unsigned, uint32_t>, "mesh indices are passed to the BVH as-is");
+
+        Mesh_hit rv;
+        gp::TriangleRaycastHit hit = gp::bvhRaycastTriangles(
+            mesh.bvh,
+            ray,
+            mesh.cpu_verts.data(),
+            mesh.cpu_indices.data());
+
+        if (!hit.hit()) {
+            return rv;
+        }
+
+        Mesh_vert const& a = mesh.cpu_verts[mesh.cpu_indices[3*hit.index]];
+        Mesh_vert const& b = mesh.cpu_verts[mesh.cpu_indices[3*hit.index + 1]];
+        Mesh_vert const& c = mesh.cpu_verts[mesh.cpu_indices[3*hit.index + 2]];
+
+        rv.mesh = 0;
+        rv.triangle = hit.index;
+        rv.t = hit.t;
+        rv.barycentrics = {1.0f - hit.u - hit.v, hit.u, hit.v};
+        rv.pos = rv.barycentrics.x*a.pos + rv.barycentrics.y*b.pos + rv.barycentrics.z*c.pos;
+        rv.uv = rv.barycentrics.x*a.uv + rv.barycentrics.y*b.uv + rv.barycentrics.z*c.uv;
+        return rv;
+    }
+
+    // returns the closest triangle, in any of the model's meshes, that the
+    // ray hits
+    //
+    // the ray must be in model space (e.g. transformed by the inverse of the
+    // model matrix), and `t` is measured in model space
+    static Mesh_hit raycast(Model const& model, gp::Line const& ray) {
+        gp::PrecomputedRay r{ray};
+
+        Mesh_hit rv;
+        for (size_t i = 0; i < model.meshes.size(); ++i) {
+            Mesh_hit hit = raycast(model.meshes[i], r);
+            if (hit.hit() && hit.t < rv.t) {
+                rv = hit;
+                rv.mesh = static_cast<int>(i);
+            }
+        }
+        return rv;
     }
 }
 
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+// helpers for splitting data-parallel loops (e.g. in builders) across
+// threads
+namespace gp {
+
+    // runs `f(chunk, begin, end)` for `numChunks` equal chunks of [0, n), one
+    // chunk per thread (the calling thread runs chunk 0)
+    //
+    // `numChunks == 0` is treated as 1
+    template<typename F>
+    void parallelFor(size_t numChunks, size_t n, F f) {
+        numChunks = numChunks > 0 ? numChunks : 1;
+
+        auto run = [&f, numChunks, n](size_t chunk) {
+            f(chunk, (n * chunk) / numChunks, (n * (chunk + 1)) / numChunks);
+        };
+
+        std::vector<std::thread> threads;
+        for (size_t chunk = 1; chunk < numChunks; ++chunk) {
+            threads.emplace_back(run, chunk);
+        }
+        run(0);
+        for (std::thread& t : threads) {
+            t.join();
+        }
+    }
+
+    // a fixed set of threads that `parallelFor` loops are run on, for
+    // callers that run them often enough (e.g. every frame) that starting
+    // threads per call would cost more than the work
+    //
+    // `parallelFor` is blocking, and has the same semantics as the free
+    // function, but chunks are handed out to whichever thread is free (the
+    // calling thread included), so uneven chunks balance out. It must only
+    // be called by one thread at a time, not from inside `f`, and `f` must
+    // not throw
+    class WorkerPool final {
+    public:
+        // `numThreads` includes the calling thread, so `numThreads - 1`
+        // workers are started (`numThreads == 0` is treated as 1)
+        explicit WorkerPool(size_t numThreads) {
+            for (size_t i = 1; i < numThreads; ++i) {
+                threads.emplace_back([this]() { workerMain(); });
+            }
+        }
+        WorkerPool(WorkerPool const&) = delete;
+        WorkerPool(WorkerPool&&) = delete;
+        WorkerPool& operator=(WorkerPool const&) = delete;
+        WorkerPool& operator=(WorkerPool&&) = delete;
+        ~WorkerPool() noexcept {
+            {
+                std::lock_guard<std::mutex> lock{mutex};
+                stopping = true;
+            }
+            workReady.notify_all();
+            for (std::thread& t : threads) {
+                t.join();
+            }
+        }
+
+        [[nodiscard]] size_t numThreads() const noexcept {
+            return threads.size() + 1;
+        }
+
+        // runs `f(chunk, begin, end)` for `numChunks` equal chunks of [0, n)
+        // (`numChunks == 0` is treated as 1)
+        template<typename F>
+        void parallelFor(size_t numChunks, size_t n, F f) {
+            numChunks = numChunks > 0 ? numChunks : 1;
+
+            auto run = [&f, numChunks, n](size_t chunk) {
+                f(chunk, (n * chunk) / numChunks, (n * (chunk + 1)) / numChunks);
+            };
+
+            if (threads.empty() || numChunks == 1) {
+                for (size_t chunk = 0; chunk < numChunks; ++chunk) {
+                    run(chunk);
+                }
+                return;
+            }
+
+            std::unique_lock<std::mutex> lock{mutex};
+            job = [](void* ctx, size_t chunk) { (*static_cast<decltype(run)*>(ctx))(chunk); };
+            jobCtx = &run;
+            jobChunks = numChunks;
+            nextChunk = 0;
+            numDone = 0;
+            ++generation;
+            workReady.notify_all();
+
+            work(lock);
+            workDone.wait(lock, [this]() { return numDone == jobChunks; });
+            job = nullptr;
+            jobCtx = nullptr;
+        }
+
+    private:
+        // runs the current job's unclaimed chunks until there are none left
+        void work(std::unique_lock<std::mutex>& lock) {
+            while (job != nullptr && nextChunk < jobChunks) {
+                size_t chunk = nextChunk++;
+                void (*j)(void*, size_t) = job;
+                void* ctx = jobCtx;
+
+                lock.unlock();
+                j(ctx, chunk);
+                lock.lock();
+
+                if (++numDone == jobChunks) {
+                    workDone.notify_all();
+                }
+            }
+        }
+
+        void workerMain() {
+            std::unique_lock<std::mutex> lock{mutex};
+            uint64_t seen = generation;
+            for (;;) {
+                workReady.wait(lock, [this, &seen]() { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                work(lock);
+            }
+        }
+
+        std::mutex mutex;
+        std::condition_variable workReady;
+        std::condition_variable workDone;
+
+        // the current `parallelFor` call's chunks (`jobCtx` is its `run`,
+        // which lives on the caller's stack until every chunk is done)
+        void (*job)(void*, size_t) = nullptr;
+        void* jobCtx = nullptr;
+        size_t jobChunks = 0;
+        size_t nextChunk = 0;
+        size_t numDone = 0;
+        uint64_t generation = 0;
+        bool stopping = false;
+
+        std::vector<std::thread> threads;
+    };
+
+    // stable LSD radix sort of `v` by the low `numBits` bits of `key(el)`
+    // (an unsigned integer), 11 bits per pass
+    //
+    // each pass histograms, then scatters, `numChunks` chunks of `v` in
+    // parallel (`numChunks == 0` is treated as 1). Passes whose digit is the
+    // same for every element are skipped
+    template<typename T, typename Key>
+    void parallelRadixSort(std::vector<T>& v, size_t numBits, size_t numChunks, Key key) {
+        numChunks = numChunks > 0 ? numChunks : 1;
+
+        constexpr size_t radixBits = 11;
+        constexpr size_t radix = size_t{1} << radixBits;
+
+        size_t n = v.size();
+        std::vector<T> tmp(n);
+        std::vector<std::array<size_t, radix>> offsets(numChunks);
+
+        for (size_t shift = 0; shift < numBits; shift += radixBits) {
+            parallelFor(numChunks, n, [&v, &offsets, &key, shift](size_t chunk, size_t begin, size_t end) {
+                std::array<size_t, radix>& hist = offsets[chunk];
+                hist.fill(0);
+                for (size_t i = begin; i < end; ++i) {
+                    ++hist[(key(v[i]) >> shift) & (radix - 1)];
+                }
+            });
+
+            // turn the histograms into where each chunk writes each digit:
+            // all of a digit's chunks in chunk order, which keeps the sort
+            // stable
+            bool allSameDigit = false;
+            size_t total = 0;
+            for (size_t digit = 0; digit < radix; ++digit) {
+                size_t count = 0;
+                for (std::array<size_t, radix>& hist : offsets) {
+                    size_t c = hist[digit];
+                    hist[digit] = total + count;
+                    count += c;
+                }
+                allSameDigit = allSameDigit || count == n;
+                total += count;
+            }
+            if (allSameDigit) {
+                continue;  // the pass wouldn't move anything
+            }
+
+            parallelFor(numChunks, n, [&v, &offsets, &tmp, &key, shift](size_t chunk, size_t begin, size_t end) {
+                T const* src = v.data();
+                T* dest = tmp.data();
+                std::array<size_t, radix>& pos = offsets[chunk];
+                for (size_t i = begin; i < end; ++i) {
+                    dest[pos[(key(src[i]) >> shift) & (radix - 1)]++] = src[i];
+                }
+            });
+
+            std::swap(v, tmp);
+        }
+    }
+}
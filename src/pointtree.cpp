@@ -0,0 +1,1064 @@
+#include "pointtree.hpp"
+#include "parallel.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    template<glm::length_t D>
+    bool boxesIntersect(gp::Box<D> const& a, gp::Box<D> const& b) noexcept {
+        for (glm::length_t i = 0; i < D; ++i) {
+            if (a.max[i] < b.min[i] || b.max[i] < a.min[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // returns true if `inner` is entirely inside `outer`
+    template<glm::length_t D>
+    bool boxInside(gp::Box<D> const& inner, gp::Box<D> const& outer) noexcept {
+        for (glm::length_t i = 0; i < D; ++i) {
+            if (inner.min[i] < outer.min[i] || outer.max[i] < inner.max[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // squared distance from `p` to the nearest point in `b` (0 if it's inside)
+    template<glm::length_t D>
+    float boxDistance2(gp::Box<D> const& b, glm::vec<D, float> const& p) noexcept {
+        float rv = 0.0f;
+        for (glm::length_t i = 0; i < D; ++i) {
+            float d = std::max(std::max(b.min[i] - p[i], p[i] - b.max[i]), 0.0f);
+            rv += d*d;
+        }
+        return rv;
+    }
+
+    // squared distance from `p` to the furthest point in `b`
+    template<glm::length_t D>
+    float boxFarDistance2(gp::Box<D> const& b, glm::vec<D, float> const& p) noexcept {
+        float rv = 0.0f;
+        for (glm::length_t i = 0; i < D; ++i) {
+            float d = std::max(p[i] - b.min[i], b.max[i] - p[i]);
+            rv += d*d;
+        }
+        return rv;
+    }
+
+    template<glm::length_t D>
+    float distance2(glm::vec<D, float> const& a, glm::vec<D, float> const& b) noexcept {
+        float rv = 0.0f;
+        for (glm::length_t i = 0; i < D; ++i) {
+            float d = a[i] - b[i];
+            rv += d*d;
+        }
+        return rv;
+    }
+
+    // index of the child of a node with bounds `b` that `p` belongs in
+    //
+    // points on a split plane belong in the upper child
+    template<glm::length_t D>
+    size_t childIndex(gp::Box<D> const& b, glm::vec<D, float> const& p) noexcept {
+        size_t rv = 0;
+        for (glm::length_t i = 0; i < D; ++i) {
+            float mid = 0.5f * (b.min[i] + b.max[i]);
+            if (p[i] >= mid) {
+                rv |= size_t{1} << i;
+            }
+        }
+        return rv;
+    }
+
+    // "max-heap" order of k-nearest-neighbour candidates: the heap's top is
+    // the candidate that'd be dropped first
+    bool neighborLess(gp::PointTreeNeighbor const& a, gp::PointTreeNeighbor const& b) noexcept {
+        return a.distance2 < b.distance2 || (a.distance2 == b.distance2 && a.id < b.id);
+    }
+
+    // a node waiting to be visited by a query
+    template<glm::length_t D>
+    struct StackEntry final {
+        gp::Box<D> box;
+        uint32_t node;
+
+        // range/radius queries: the node is entirely inside the query region
+        bool contained;
+
+        // nearest-neighbour queries: squared distance to the node's box
+        float distance2;
+    };
+
+    // spreads the low 16 bits of `v` out, so that there's a zero bit between
+    // each of them
+    uint32_t spreadBits2(uint32_t v) noexcept {
+        v &= 0x0000FFFF;
+        v = (v | v << 8) & 0x00FF00FF;
+        v = (v | v << 4) & 0x0F0F0F0F;
+        v = (v | v << 2) & 0x33333333;
+        v = (v | v << 1) & 0x55555555;
+        return v;
+    }
+
+    // spreads the low 10 bits of `v` out, so that there are 2 zero bits
+    // between each of them
+    uint32_t spreadBits3(uint32_t v) noexcept {
+        v = (v * 0x00010001u) & 0xFF0000FFu;
+        v = (v * 0x00000101u) & 0x0F00F00Fu;
+        v = (v * 0x00000011u) & 0xC30C30C3u;
+        v = (v * 0x00000005u) & 0x49249249u;
+        return v;
+    }
+
+    // interleaves per-axis cell coordinates into a Morton code, with axis
+    // `a` in bit `a` of each level's digit (as in `childIndex`)
+    template<glm::length_t D>
+    uint32_t mortonCode(std::array<uint32_t, D> const& cells) noexcept {
+        uint32_t rv = 0;
+        for (glm::length_t a = 0; a < D; ++a) {
+            rv |= (D == 2 ? spreadBits2(cells[a]) : spreadBits3(cells[a])) << a;
+        }
+        return rv;
+    }
+
+    // bulk (Morton-order) point tree builder
+    //
+    // a point's digit at depth `d` (which child it's in) has to be exactly
+    // what `childIndex` says, or queries, which compute node bounds by
+    // repeatedly halving the root's, could miss it. Quantizing positions
+    // rounds differently, so each axis's split planes for the top levels
+    // are precomputed by halving, and points are binned against them
+    //
+    // codes only hold a window of `windowLevels` levels of digits, so that
+    // they're 32 bits and sort in 2 radix passes. The (rare: they're in dense
+    // clusters) nodes that still need splitting below their window get the
+    // next window of digits by halving their bounds, and are re-sorted
+    template<glm::length_t D>
+    struct MortonBuilder final {
+        static constexpr size_t windowLevels = 22 / D;
+        static constexpr size_t numChildren = size_t{1} << D;
+
+        struct Prim final {
+            uint32_t code;
+            uint32_t index;
+        };
+
+        glm::vec<D, float> const* points;
+        size_t leafSize;
+        size_t maxDepth;
+
+        // levels in the codes that the points are sorted by initially
+        size_t rootLevels;
+
+        // per axis: the `2^rootLevels + 1` boundaries of the cells at depth
+        // `rootLevels`, and cells per unit
+        std::array<std::vector<float>, D> planes;
+        std::array<double, D> scale;
+
+        std::vector<Prim> prims;
+
+        MortonBuilder(gp::Box<D> const& bounds, glm::vec<D, float> const* points_, size_t leafSize_, size_t maxDepth_) :
+            points{points_},
+            leafSize{leafSize_},
+            maxDepth{maxDepth_},
+            rootLevels{std::min(windowLevels, maxDepth_)} {
+
+            size_t numCells = size_t{1} << rootLevels;
+            for (glm::length_t a = 0; a < D; ++a) {
+                std::vector<float>& ps = planes[a];
+                ps.resize(numCells + 1);
+                ps.front() = bounds.min[a];
+                ps.back() = bounds.max[a];
+                for (size_t step = numCells; step > 1; step /= 2) {
+                    for (size_t i = 0; i < numCells; i += step) {
+                        ps[i + step/2] = 0.5f * (ps[i] + ps[i + step]);
+                    }
+                }
+                double extent = static_cast<double>(bounds.max[a]) - static_cast<double>(bounds.min[a]);
+                scale[a] = extent > 0.0 ? static_cast<double>(numCells) / extent : 0.0;
+            }
+        }
+
+        // returns `p`'s code for the top `rootLevels` levels
+        uint32_t rootCode(glm::vec<D, float> const& p) const noexcept {
+            std::array<uint32_t, D> cells;
+            for (glm::length_t a = 0; a < D; ++a) {
+                std::vector<float> const& ps = planes[a];
+                size_t last = ps.size() - 2;
+
+                // guess from the position, then fix the guess up against the
+                // actual planes (it's only ever off by rounding)
+                //
+                // (the point's in bounds, so this is >= 0, and truncating
+                // it is flooring it)
+                double guess = (static_cast<double>(p[a]) - static_cast<double>(ps.front())) * scale[a];
+                size_t c = std::min(static_cast<size_t>(guess), last);
+                while (c > 0 && p[a] < ps[c]) {
+                    --c;
+                }
+                while (c < last && p[a] >= ps[c + 1]) {
+                    ++c;
+                }
+                cells[a] = static_cast<uint32_t>(c);
+            }
+            return mortonCode<D>(cells);
+        }
+
+        // returns `p`'s code for `levels` levels below a node with bounds `box`
+        uint32_t windowCode(glm::vec<D, float> const& p, gp::Box<D> const& box, size_t levels) const noexcept {
+            std::array<uint32_t, D> cells;
+            for (glm::length_t a = 0; a < D; ++a) {
+                float lo = box.min[a];
+                float hi = box.max[a];
+                uint32_t cell = 0;
+                for (size_t l = 0; l < levels; ++l) {
+                    float mid = 0.5f * (lo + hi);
+                    bool upper = p[a] >= mid;
+                    cell = cell << 1 | upper;
+                    if (upper) {
+                        lo = mid;
+                    } else {
+                        hi = mid;
+                    }
+                }
+                cells[a] = cell;
+            }
+            return mortonCode<D>(cells);
+        }
+
+        // returns prim `i`'s digit at `depth`, where its code's window ends
+        // at `windowEnd`
+        size_t digit(size_t i, size_t depth, size_t windowEnd) const noexcept {
+            return (prims[i].code >> (D*(windowEnd - 1 - depth))) & (numChildren - 1);
+        }
+
+        // splits [first, last) (which is sorted by digit at `depth`) into
+        // the ranges of the node's children
+        std::array<size_t, numChildren + 1> childRanges(size_t first, size_t last, size_t depth, size_t windowEnd) const noexcept {
+            constexpr size_t maxLinearScan = 64;
+
+            std::array<size_t, numChildren + 1> rv;
+            rv.front() = first;
+            rv.back() = last;
+            for (size_t c = 1; c < numChildren; ++c) {
+                size_t lo = rv[c - 1];
+                size_t hi = last;
+                if (hi - lo <= maxLinearScan) {
+                    while (lo < hi && digit(lo, depth, windowEnd) < c) {
+                        ++lo;
+                    }
+                } else {
+                    while (lo < hi) {
+                        size_t mid = lo + (hi - lo)/2;
+                        if (digit(mid, depth, windowEnd) < c) {
+                            lo = mid + 1;
+                        } else {
+                            hi = mid;
+                        }
+                    }
+                }
+                rv[c] = lo;
+            }
+            return rv;
+        }
+
+        // appends the subtree over [first, last) (which has bounds `box`) to
+        // `nodes`, as `nodes[node]` and (after it) its descendants
+        void emit(std::vector<gp::PointTreeNode>& nodes, size_t node, gp::Box<D> const& box, size_t first, size_t last, size_t depth, size_t windowEnd) {
+            if (last - first <= leafSize || depth >= maxDepth) {
+                nodes[node] = gp::PointTreeNode{static_cast<uint32_t>(first), static_cast<uint32_t>(last - first)};
+                return;
+            }
+
+            if (depth == windowEnd) {
+                size_t levels = std::min(windowLevels, maxDepth - depth);
+                for (size_t i = first; i < last; ++i) {
+                    prims[i].code = windowCode(points[prims[i].index], box, levels);
+                }
+                std::sort(prims.begin() + static_cast<ptrdiff_t>(first), prims.begin() + static_cast<ptrdiff_t>(last), [](Prim const& a, Prim const& b) {
+                    return a.code < b.code || (a.code == b.code && a.index < b.index);
+                });
+                windowEnd = depth + levels;
+            }
+
+            size_t firstChild = nodes.size();
+            nodes.resize(firstChild + numChildren);
+            nodes[node] = gp::PointTreeNode{static_cast<uint32_t>(firstChild), gp::PointTreeNode::internal};
+
+            auto ranges = childRanges(first, last, depth, windowEnd);
+            for (size_t c = 0; c < numChildren; ++c) {
+                gp::Box<D> childBox = gp::PointTree<D>::childBounds(box, c);
+                emit(nodes, firstChild + c, childBox, ranges[c], ranges[c + 1], depth + 1, windowEnd);
+            }
+        }
+    };
+
+    // every entry a traversal can have on its stack at once: each internal
+    // node on the path to the current node leaves (at most) all but one of
+    // its children there
+    template<glm::length_t D>
+    using Stack = std::array<StackEntry<D>, ((size_t{1} << D) - 1) * gp::pointTreeMaxDepth + 1>;
+
+    // `box` scaled by `looseness` around its center, clamped to
+    // `parentLoose`, so that (despite rounding) a node's loose box is inside
+    // its parent's
+    template<glm::length_t D>
+    gp::Box<D> looseBox(gp::Box<D> const& box, float looseness, gp::Box<D> const& parentLoose) noexcept {
+        gp::Box<D> rv;
+        for (glm::length_t i = 0; i < D; ++i) {
+            float margin = 0.5f * (looseness - 1.0f) * (box.max[i] - box.min[i]);
+            rv.min[i] = std::max(box.min[i] - margin, parentLoose.min[i]);
+            rv.max[i] = std::min(box.max[i] + margin, parentLoose.max[i]);
+        }
+        return rv;
+    }
+
+    // a loose tree node waiting to be visited by a query (loose trees store
+    // their nodes' boxes)
+    struct LooseStackEntry final {
+        uint32_t node;
+        bool contained;
+    };
+
+    template<glm::length_t D>
+    using LooseStack = std::array<LooseStackEntry, ((size_t{1} << D) - 1) * gp::pointTreeMaxDepth + 1>;
+}
+
+template<glm::length_t D>
+gp::PointTree<D>::PointTree(Box<D> const& bounds, PointTreeParams const& params) :
+    params_{params},
+    bounds_{bounds} {
+
+    for (glm::length_t i = 0; i < D; ++i) {
+        if (!(bounds.min[i] <= bounds.max[i])) {
+            std::stringstream ss;
+            ss << "PointTree: invalid bounds: min[" << i << "] (" << bounds.min[i] << ") is greater than max[" << i << "] (" << bounds.max[i] << ')';
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+
+    params_.maxPointsPerLeaf = std::max(params_.maxPointsPerLeaf, size_t{1});
+    params_.maxDepth = std::min(params_.maxDepth, pointTreeMaxDepth);
+
+    clear();
+}
+
+template<glm::length_t D>
+gp::Box<D> gp::PointTree<D>::childBounds(Box<D> const& parent, size_t i) noexcept {
+    Box<D> rv = parent;
+    for (glm::length_t axis = 0; axis < D; ++axis) {
+        float mid = 0.5f * (parent.min[axis] + parent.max[axis]);
+        if (i & (size_t{1} << axis)) {
+            rv.min[axis] = mid;
+        } else {
+            rv.max[axis] = mid;
+        }
+    }
+    return rv;
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::clear() noexcept {
+    nodes_.clear();
+    nodes_.push_back(PointTreeNode{0, 0});
+    positions_.clear();
+    ids_.clear();
+    for (std::vector<uint32_t>& blocks : freeBlocks_) {
+        blocks.clear();
+    }
+    size_ = 0;
+    packed_ = false;
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::build(Vec const* points, size_t n) {
+    constexpr size_t minPointsPerChunk = 16384;
+
+    clear();
+    if (n == 0) {
+        return;
+    }
+
+    MortonBuilder<D> b{bounds_, points, params_.maxPointsPerLeaf, params_.maxDepth};
+    size_t numThreads = params_.numThreads ? params_.numThreads : std::max(1u, std::thread::hardware_concurrency());
+    size_t numChunks = std::clamp(n / minPointsPerChunk, size_t{1}, numThreads);
+
+    // each chunk records the first of its points that's out of bounds (if
+    // any), so that the build can throw once they've all finished
+    std::vector<size_t> outOfBounds(numChunks, n);
+
+    b.prims.resize(n);
+    gp::parallelFor(numChunks, n, [this, points, n, &b, &outOfBounds](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            uint32_t code = 0;
+            if (boxContains(bounds_, points[i])) {
+                code = b.rootCode(points[i]);
+            } else if (outOfBounds[chunk] == n) {
+                outOfBounds[chunk] = i;
+            }
+            b.prims[i] = typename MortonBuilder<D>::Prim{code, static_cast<uint32_t>(i)};
+        }
+    });
+    for (size_t i : outOfBounds) {
+        if (i != n) {
+            std::stringstream ss;
+            ss << "PointTree::build: point " << i << " is outside of the tree's bounds";
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+
+    using Prim = typename MortonBuilder<D>::Prim;
+    gp::parallelRadixSort(b.prims, D*b.rootLevels, numChunks, [](Prim const& p) { return p.code; });
+
+    // (`nodes_` is just the root, after `clear`)
+    b.emit(nodes_, 0, bounds_, 0, n, 0, b.rootLevels);
+    nodes_.shrink_to_fit();
+
+    positions_.resize(n);
+    ids_.resize(n);
+    gp::parallelFor(numChunks, n, [this, points, &b](size_t, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; ++i) {
+            positions_[i] = points[b.prims[i].index];
+            ids_[i] = b.prims[i].index;
+        }
+    });
+
+    size_ = n;
+    packed_ = true;
+}
+
+// size class of the block that holds a (non-empty) leaf's points
+template<glm::length_t D>
+size_t gp::PointTree<D>::sizeClassOf(uint32_t count) const noexcept {
+    size_t c = 0;
+    while ((params_.maxPointsPerLeaf << c) < count) {
+        ++c;
+    }
+    return c;
+}
+
+template<glm::length_t D>
+uint32_t gp::PointTree<D>::allocBlock(size_t sizeClass) {
+    if (sizeClass < freeBlocks_.size() && !freeBlocks_[sizeClass].empty()) {
+        uint32_t rv = freeBlocks_[sizeClass].back();
+        freeBlocks_[sizeClass].pop_back();
+        return rv;
+    }
+    size_t rv = positions_.size();
+    positions_.resize(rv + (params_.maxPointsPerLeaf << sizeClass));
+    ids_.resize(rv + (params_.maxPointsPerLeaf << sizeClass));
+    return static_cast<uint32_t>(rv);
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::freeBlock(uint32_t offset, size_t sizeClass) {
+    if (freeBlocks_.size() <= sizeClass) {
+        freeBlocks_.resize(sizeClass + 1);
+    }
+    freeBlocks_[sizeClass].push_back(offset);
+}
+
+// moves each leaf's (packed) points into a block
+template<glm::length_t D>
+void gp::PointTree<D>::unpack() {
+    std::vector<Vec> packedPositions;
+    std::vector<uint32_t> packedIds;
+    std::swap(positions_, packedPositions);
+    std::swap(ids_, packedIds);
+
+    for (PointTreeNode& n : nodes_) {
+        if (!n.isLeaf() || n.count == 0) {
+            continue;
+        }
+        uint32_t offset = allocBlock(sizeClassOf(n.count));
+        std::copy(packedPositions.begin() + n.offset, packedPositions.begin() + n.offset + n.count, positions_.begin() + offset);
+        std::copy(packedIds.begin() + n.offset, packedIds.begin() + n.offset + n.count, ids_.begin() + offset);
+        n.offset = offset;
+    }
+    packed_ = false;
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::insert(Vec const& p, uint32_t id) {
+    if (!boxContains(bounds_, p)) {
+        std::stringstream ss;
+        ss << "PointTree::insert: point " << id << " is outside of the tree's bounds";
+        throw std::runtime_error{std::move(ss).str()};
+    }
+
+    if (packed_) {
+        unpack();
+    }
+
+    uint32_t node = 0;
+    Box<D> box = bounds_;
+    size_t depth = 0;
+
+    for (;;) {
+        PointTreeNode n = nodes_[node];
+
+        if (!n.isLeaf()) {
+            size_t i = childIndex(box, p);
+            node = n.offset + static_cast<uint32_t>(i);
+            box = childBounds(box, i);
+            ++depth;
+            continue;
+        }
+
+        if (n.count == 0) {
+            nodes_[node].offset = allocBlock(0);
+        } else if (n.count == (params_.maxPointsPerLeaf << sizeClassOf(n.count))) {
+            // the leaf's block is full
+
+            if (depth < params_.maxDepth) {
+                // split it: move its points into (new) children, then carry
+                // on down into the right child
+                uint32_t firstChild = static_cast<uint32_t>(nodes_.size());
+                nodes_.resize(nodes_.size() + numChildren, PointTreeNode{0, 0});
+                nodes_[node] = PointTreeNode{firstChild, PointTreeNode::internal};
+
+                // (usually, the leaf held `maxPointsPerLeaf` points, but
+                // leaves that `build` stopped at can hold more)
+                std::array<uint32_t, numChildren> counts{};
+                for (uint32_t j = 0; j < n.count; ++j) {
+                    ++counts[childIndex(box, positions_[n.offset + j])];
+                }
+                for (size_t i = 0; i < numChildren; ++i) {
+                    if (counts[i] > 0) {
+                        nodes_[firstChild + i].offset = allocBlock(sizeClassOf(counts[i]));
+                    }
+                }
+
+                for (uint32_t j = 0; j < n.count; ++j) {
+                    Vec q = positions_[n.offset + j];
+                    PointTreeNode& child = nodes_[firstChild + childIndex(box, q)];
+                    positions_[child.offset + child.count] = q;
+                    ids_[child.offset + child.count] = ids_[n.offset + j];
+                    ++child.count;
+                }
+                freeBlock(n.offset, sizeClassOf(n.count));
+                continue;
+            }
+
+            // it can't be split, so move its points into a bigger block
+            size_t sizeClass = sizeClassOf(n.count);
+            uint32_t offset = allocBlock(sizeClass + 1);
+            std::copy(positions_.begin() + n.offset, positions_.begin() + n.offset + n.count, positions_.begin() + offset);
+            std::copy(ids_.begin() + n.offset, ids_.begin() + n.offset + n.count, ids_.begin() + offset);
+            freeBlock(n.offset, sizeClass);
+            nodes_[node].offset = offset;
+        }
+
+        PointTreeNode& leaf = nodes_[node];
+        positions_[leaf.offset + leaf.count] = p;
+        ids_[leaf.offset + leaf.count] = id;
+        ++leaf.count;
+        ++size_;
+        return;
+    }
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::queryRange(Box<D> const& box, std::vector<uint32_t>& out) const {
+    if (empty() || !boxesIntersect(box, bounds_)) {
+        return;
+    }
+
+    Stack<D> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = StackEntry<D>{bounds_, 0, boxInside(bounds_, box), 0.0f};
+
+    while (stackSize > 0) {
+        StackEntry<D> e = stack[--stackSize];
+        PointTreeNode const& n = nodes_[e.node];
+
+        if (n.isLeaf()) {
+            if (e.contained) {
+                out.insert(out.end(), ids_.begin() + n.offset, ids_.begin() + n.offset + n.count);
+            } else {
+                for (uint32_t j = n.offset; j < n.offset + n.count; ++j) {
+                    if (boxContains(box, positions_[j])) {
+                        out.push_back(ids_[j]);
+                    }
+                }
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < numChildren; ++i) {
+            uint32_t child = n.offset + static_cast<uint32_t>(i);
+            if (nodes_[child].count == 0) {
+                continue;
+            }
+            Box<D> cb = childBounds(e.box, i);
+            if (e.contained) {
+                stack[stackSize++] = StackEntry<D>{cb, child, true, 0.0f};
+            } else if (boxesIntersect(cb, box)) {
+                stack[stackSize++] = StackEntry<D>{cb, child, boxInside(cb, box), 0.0f};
+            }
+        }
+    }
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::queryRadius(Vec const& center, float radius, std::vector<uint32_t>& out) const {
+    float r2 = radius * radius;
+    if (empty() || radius < 0.0f || boxDistance2(bounds_, center) > r2) {
+        return;
+    }
+
+    Stack<D> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = StackEntry<D>{bounds_, 0, boxFarDistance2(bounds_, center) <= r2, 0.0f};
+
+    while (stackSize > 0) {
+        StackEntry<D> e = stack[--stackSize];
+        PointTreeNode const& n = nodes_[e.node];
+
+        if (n.isLeaf()) {
+            if (e.contained) {
+                out.insert(out.end(), ids_.begin() + n.offset, ids_.begin() + n.offset + n.count);
+            } else {
+                for (uint32_t j = n.offset; j < n.offset + n.count; ++j) {
+                    if (distance2(positions_[j], center) <= r2) {
+                        out.push_back(ids_[j]);
+                    }
+                }
+            }
+            continue;
+        }
+
+        for (size_t i = 0; i < numChildren; ++i) {
+            uint32_t child = n.offset + static_cast<uint32_t>(i);
+            if (nodes_[child].count == 0) {
+                continue;
+            }
+            Box<D> cb = childBounds(e.box, i);
+            if (e.contained) {
+                stack[stackSize++] = StackEntry<D>{cb, child, true, 0.0f};
+            } else if (boxDistance2(cb, center) <= r2) {
+                stack[stackSize++] = StackEntry<D>{cb, child, boxFarDistance2(cb, center) <= r2, 0.0f};
+            }
+        }
+    }
+}
+
+template<glm::length_t D>
+void gp::PointTree<D>::queryNearest(Vec const& p, size_t k, std::vector<PointTreeNeighbor>& out) const {
+    if (empty() || k == 0) {
+        return;
+    }
+
+    // the candidates so far are a max-heap at the end of `out`, so that the
+    // furthest one can be replaced by anything nearer
+    ptrdiff_t const first = static_cast<ptrdiff_t>(out.size());
+    auto heapSize = [&out, first]() { return out.size() - static_cast<size_t>(first); };
+    auto furthest = [&out, first]() -> PointTreeNeighbor const& { return out[static_cast<size_t>(first)]; };
+
+    Stack<D> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = StackEntry<D>{bounds_, 0, false, boxDistance2(bounds_, p)};
+
+    while (stackSize > 0) {
+        StackEntry<D> e = stack[--stackSize];
+
+        // (not `>=`: an equally-distant point with a lower id would win)
+        if (heapSize() == k && e.distance2 > furthest().distance2) {
+            continue;
+        }
+
+        PointTreeNode const& n = nodes_[e.node];
+
+        if (n.isLeaf()) {
+            for (uint32_t j = n.offset; j < n.offset + n.count; ++j) {
+                PointTreeNeighbor candidate{ids_[j], distance2(positions_[j], p)};
+                if (heapSize() < k) {
+                    out.push_back(candidate);
+                    std::push_heap(out.begin() + first, out.end(), neighborLess);
+                } else if (neighborLess(candidate, furthest())) {
+                    std::pop_heap(out.begin() + first, out.end(), neighborLess);
+                    out.back() = candidate;
+                    std::push_heap(out.begin() + first, out.end(), neighborLess);
+                }
+            }
+            continue;
+        }
+
+        // push the children furthest-first, so that the nearest is visited
+        // next
+        std::array<StackEntry<D>, numChildren> children;
+        size_t numNonEmpty = 0;
+        for (size_t i = 0; i < numChildren; ++i) {
+            uint32_t child = n.offset + static_cast<uint32_t>(i);
+            if (nodes_[child].count == 0) {
+                continue;
+            }
+            Box<D> cb = childBounds(e.box, i);
+            StackEntry<D> ce{cb, child, false, boxDistance2(cb, p)};
+
+            // (insertion sort: there are at most 2^D)
+            size_t pos = numNonEmpty++;
+            while (pos > 0 && children[pos-1].distance2 < ce.distance2) {
+                children[pos] = children[pos-1];
+                --pos;
+            }
+            children[pos] = ce;
+        }
+        for (size_t i = 0; i < numNonEmpty; ++i) {
+            stack[stackSize++] = children[i];
+        }
+    }
+
+    std::sort_heap(out.begin() + first, out.end(), neighborLess);
+}
+
+template class gp::PointTree<2>;
+template class gp::PointTree<3>;
+
+template<glm::length_t D>
+gp::LooseTree<D>::LooseTree(Box<D> const& bounds, LooseTreeParams const& params) :
+    params_{params} {
+
+    for (glm::length_t i = 0; i < D; ++i) {
+        if (!(bounds.min[i] <= bounds.max[i])) {
+            std::stringstream ss;
+            ss << "LooseTree: invalid bounds: min[" << i << "] (" << bounds.min[i] << ") is greater than max[" << i << "] (" << bounds.max[i] << ')';
+            throw std::runtime_error{std::move(ss).str()};
+        }
+    }
+
+    params_.maxPointsPerLeaf = std::max(params_.maxPointsPerLeaf, size_t{1});
+    params_.maxDepth = std::min(params_.maxDepth, pointTreeMaxDepth);
+    if (!(params_.looseness >= 1.0f)) {
+        params_.looseness = 1.0f;
+    }
+
+    // the root's loose box is clamped to `bounds`, so every loose box is
+    // inside it: `move`'s fast path can't accept a point outside of it
+    Box<D> loose = looseBox(bounds, params_.looseness, bounds);
+    nodes_.push_back(LooseTreeNode<D>{LooseTreeNode<D>::none, LooseTreeNode<D>::none, LooseTreeNode<D>::none, 0, 0, 0, bounds, loose});
+
+    clear();
+}
+
+template<glm::length_t D>
+void gp::LooseTree<D>::clear() noexcept {
+    nodes_.resize(1);
+    LooseTreeNode<D>& root = nodes_[0];
+    root.firstChild = LooseTreeNode<D>::none;
+    root.firstPoint = LooseTreeNode<D>::none;
+    root.numPoints = 0;
+    root.subtreeSize = 0;
+    freeNodes_.clear();
+    positions_.clear();
+    ids_.clear();
+    pointNodes_.clear();
+    next_.clear();
+    prev_.clear();
+    pointLooseBounds_.clear();
+    freeHandles_.clear();
+    size_ = 0;
+}
+
+// pushes point `handle` onto the front of `node`'s points
+template<glm::length_t D>
+void gp::LooseTree<D>::link(uint32_t node, uint32_t handle) noexcept {
+    LooseTreeNode<D>& n = nodes_[node];
+    pointNodes_[handle] = node;
+    pointLooseBounds_[handle] = n.looseBounds;
+    prev_[handle] = LooseTreeNode<D>::none;
+    next_[handle] = n.firstPoint;
+    if (n.firstPoint != LooseTreeNode<D>::none) {
+        prev_[n.firstPoint] = handle;
+    }
+    n.firstPoint = handle;
+    ++n.numPoints;
+}
+
+// takes point `handle` out of its node's points (but not its node's, or its
+// ancestors', `subtreeSize`)
+template<glm::length_t D>
+void gp::LooseTree<D>::unlink(uint32_t handle) noexcept {
+    LooseTreeNode<D>& n = nodes_[pointNodes_[handle]];
+    uint32_t prev = prev_[handle];
+    uint32_t next = next_[handle];
+    if (prev != LooseTreeNode<D>::none) {
+        next_[prev] = next;
+    } else {
+        n.firstPoint = next;
+    }
+    if (next != LooseTreeNode<D>::none) {
+        prev_[next] = prev;
+    }
+    --n.numPoints;
+}
+
+// adds point `handle` (which is in `node`'s loose box, and already counted
+// in its `subtreeSize`) to the deepest node under `node` that'll hold it
+template<glm::length_t D>
+void gp::LooseTree<D>::place(uint32_t node, uint32_t handle) {
+    Vec p = positions_[handle];
+
+    // points on a split plane go into the upper child, as in `PointTree`,
+    // but points in the node's loose box (and not its box) may not be in
+    // any child's loose box, so they stay in the node
+    while (!nodes_[node].isLeaf()) {
+        uint32_t child = nodes_[node].firstChild + static_cast<uint32_t>(childIndex(nodes_[node].bounds, p));
+        if (!boxContains(nodes_[child].looseBounds, p)) {
+            break;
+        }
+        ++nodes_[child].subtreeSize;
+        node = child;
+    }
+
+    link(node, handle);
+
+    LooseTreeNode<D> const& n = nodes_[node];
+    if (n.isLeaf() && n.numPoints > params_.maxPointsPerLeaf && n.depth < params_.maxDepth) {
+        split(node);
+    }
+}
+
+// turns leaf `node` into an internal node, and moves its points down into
+// its new children (where they fit)
+template<glm::length_t D>
+void gp::LooseTree<D>::split(uint32_t node) {
+    uint32_t firstChild;
+    if (!freeNodes_.empty()) {
+        firstChild = freeNodes_.back();
+        freeNodes_.pop_back();
+    } else {
+        firstChild = static_cast<uint32_t>(nodes_.size());
+        nodes_.resize(nodes_.size() + numChildren);
+    }
+
+    uint32_t depth = nodes_[node].depth + 1;
+    for (uint32_t i = 0; i < numChildren; ++i) {
+        uint32_t child = firstChild + i;
+        Box<D> box = PointTree<D>::childBounds(nodes_[node].bounds, i);
+        Box<D> loose = looseBox(box, params_.looseness, nodes_[node].looseBounds);
+        nodes_[child] = LooseTreeNode<D>{node, LooseTreeNode<D>::none, LooseTreeNode<D>::none, 0, 0, depth, box, loose};
+    }
+    nodes_[node].firstChild = firstChild;
+
+    uint32_t handle = nodes_[node].firstPoint;
+    while (handle != LooseTreeNode<D>::none) {
+        uint32_t next = next_[handle];
+        Vec const& p = positions_[handle];
+        uint32_t child = firstChild + static_cast<uint32_t>(childIndex(nodes_[node].bounds, p));
+        if (boxContains(nodes_[child].looseBounds, p)) {
+            unlink(handle);
+            link(child, handle);
+            ++nodes_[child].subtreeSize;
+        }
+        handle = next;
+    }
+
+    // (all of the points could've gone into one child)
+    for (uint32_t i = 0; i < numChildren; ++i) {
+        LooseTreeNode<D> const& child = nodes_[firstChild + i];
+        if (child.numPoints > params_.maxPointsPerLeaf && child.depth < params_.maxDepth) {
+            split(firstChild + i);
+        }
+    }
+}
+
+// turns internal `node` back into a leaf that holds every point in its
+// subtree (which all fit: a node's loose box holds its children's)
+template<glm::length_t D>
+void gp::LooseTree<D>::merge(uint32_t node) {
+    uint32_t firstChild = nodes_[node].firstChild;
+    for (uint32_t i = 0; i < numChildren; ++i) {
+        uint32_t child = firstChild + i;
+        if (!nodes_[child].isLeaf()) {
+            merge(child);
+        }
+        uint32_t handle = nodes_[child].firstPoint;
+        while (handle != LooseTreeNode<D>::none) {
+            uint32_t next = next_[handle];
+            link(node, handle);
+            handle = next;
+        }
+    }
+    nodes_[node].firstChild = LooseTreeNode<D>::none;
+    freeNodes_.push_back(firstChild);
+}
+
+// merges the highest internal node from `node` up to (but not including)
+// `end` that's small enough to be a leaf, if there is one
+template<glm::length_t D>
+void gp::LooseTree<D>::mergeAbove(uint32_t node, uint32_t end) {
+    uint32_t highest = LooseTreeNode<D>::none;
+    for (uint32_t n = node; n != end; n = nodes_[n].parent) {
+        if (!nodes_[n].isLeaf() && nodes_[n].subtreeSize <= params_.maxPointsPerLeaf/2) {
+            highest = n;
+        }
+    }
+    if (highest != LooseTreeNode<D>::none) {
+        merge(highest);
+    }
+}
+
+// the slow path of `move`: point `handle` has left its node's loose box
+template<glm::length_t D>
+void gp::LooseTree<D>::relocate(uint32_t handle, Vec const& p) {
+    throwIfNotInBounds("LooseTree::move", p, ids_[handle]);
+
+    uint32_t old = pointNodes_[handle];
+    unlink(handle);
+
+    // go up to the first node whose loose box holds `p` (the root's holds
+    // everything in bounds): the nodes on the way lose the point
+    uint32_t node = old;
+    while (!boxContains(nodes_[node].looseBounds, p)) {
+        --nodes_[node].subtreeSize;
+        node = nodes_[node].parent;
+    }
+    mergeAbove(old, node);
+
+    positions_[handle] = p;
+    place(node, handle);
+}
+
+template<glm::length_t D>
+void gp::LooseTree<D>::throwIfNotInBounds(char const* func, Vec const& p, uint32_t id) const {
+    if (!boxContains(bounds(), p)) {
+        std::stringstream ss;
+        ss << func << ": point " << id << " is outside of the tree's bounds";
+        throw std::runtime_error{std::move(ss).str()};
+    }
+}
+
+template<glm::length_t D>
+uint32_t gp::LooseTree<D>::insert(Vec const& p, uint32_t id) {
+    throwIfNotInBounds("LooseTree::insert", p, id);
+
+    uint32_t handle;
+    if (!freeHandles_.empty()) {
+        handle = freeHandles_.back();
+        freeHandles_.pop_back();
+    } else {
+        handle = static_cast<uint32_t>(positions_.size());
+        positions_.emplace_back();
+        ids_.emplace_back();
+        pointNodes_.emplace_back();
+        next_.emplace_back();
+        prev_.emplace_back();
+        pointLooseBounds_.emplace_back();
+    }
+    positions_[handle] = p;
+    ids_[handle] = id;
+
+    ++nodes_[0].subtreeSize;
+    place(0, handle);
+    ++size_;
+
+    return handle;
+}
+
+template<glm::length_t D>
+void gp::LooseTree<D>::remove(uint32_t handle) {
+    if (handle >= pointNodes_.size() || pointNodes_[handle] == LooseTreeNode<D>::none) {
+        std::stringstream ss;
+        ss << "LooseTree::remove: " << handle << " isn't the handle of a point in the tree";
+        throw std::runtime_error{std::move(ss).str()};
+    }
+
+    uint32_t node = pointNodes_[handle];
+    unlink(handle);
+    for (uint32_t n = node; n != LooseTreeNode<D>::none; n = nodes_[n].parent) {
+        --nodes_[n].subtreeSize;
+    }
+    mergeAbove(node, LooseTreeNode<D>::none);
+
+    pointNodes_[handle] = LooseTreeNode<D>::none;
+    freeHandles_.push_back(handle);
+    --size_;
+}
+
+template<glm::length_t D>
+void gp::LooseTree<D>::queryRange(Box<D> const& box, std::vector<uint32_t>& out) const {
+    if (empty() || !boxesIntersect(box, nodes_[0].looseBounds)) {
+        return;
+    }
+
+    LooseStack<D> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = LooseStackEntry{0, boxInside(nodes_[0].looseBounds, box)};
+
+    while (stackSize > 0) {
+        LooseStackEntry e = stack[--stackSize];
+        LooseTreeNode<D> const& n = nodes_[e.node];
+
+        for (uint32_t h = n.firstPoint; h != LooseTreeNode<D>::none; h = next_[h]) {
+            if (e.contained || boxContains(box, positions_[h])) {
+                out.push_back(ids_[h]);
+            }
+        }
+
+        if (n.isLeaf()) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < numChildren; ++i) {
+            uint32_t child = n.firstChild + i;
+            if (nodes_[child].subtreeSize == 0) {
+                continue;
+            }
+            if (e.contained) {
+                stack[stackSize++] = LooseStackEntry{child, true};
+            } else if (boxesIntersect(nodes_[child].looseBounds, box)) {
+                stack[stackSize++] = LooseStackEntry{child, boxInside(nodes_[child].looseBounds, box)};
+            }
+        }
+    }
+}
+
+template<glm::length_t D>
+void gp::LooseTree<D>::queryRadius(Vec const& center, float radius, std::vector<uint32_t>& out) const {
+    float r2 = radius * radius;
+    if (empty() || radius < 0.0f || boxDistance2(nodes_[0].looseBounds, center) > r2) {
+        return;
+    }
+
+    LooseStack<D> stack;
+    size_t stackSize = 0;
+    stack[stackSize++] = LooseStackEntry{0, boxFarDistance2(nodes_[0].looseBounds, center) <= r2};
+
+    while (stackSize > 0) {
+        LooseStackEntry e = stack[--stackSize];
+        LooseTreeNode<D> const& n = nodes_[e.node];
+
+        for (uint32_t h = n.firstPoint; h != LooseTreeNode<D>::none; h = next_[h]) {
+            if (e.contained || distance2(positions_[h], center) <= r2) {
+                out.push_back(ids_[h]);
+            }
+        }
+
+        if (n.isLeaf()) {
+            continue;
+        }
+
+        for (uint32_t i = 0; i < numChildren; ++i) {
+            uint32_t child = n.firstChild + i;
+            if (nodes_[child].subtreeSize == 0) {
+                continue;
+            }
+            if (e.contained) {
+                stack[stackSize++] = LooseStackEntry{child, true};
+            } else if (boxDistance2(nodes_[child].looseBounds, center) <= r2) {
+                stack[stackSize++] = LooseStackEntry{child, boxFarDistance2(nodes_[child].looseBounds, center) <= r2};
+            }
+        }
+    }
+}
+
+template class gp::LooseTree<2>;
+template class gp::LooseTree<3>;
@@ -0,0 +1,395 @@
+#pragma once
+
+#include <glm/vec2.hpp>
+#include <glm/vec3.hpp>
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// point quadtree/octree support
+//
+// a region quadtree (2D) or octree (3D) over points. Each internal node
+// splits its box into 2^D equal children, which are stored next to each
+// other in the node array, so a node only needs the index of its first
+// child. Node bounds aren't stored: queries compute them on the way down.
+// The quadtree and octree share this layout (and code): they're
+// `PointTree<2>` and `PointTree<3>`
+//
+// `LooseTree` is the same kind of tree, but for points that move every
+// frame: its points can be moved + removed in place
+namespace gp {
+
+    // an axis-aligned box in D dimensions (`min` and `max` are inclusive)
+    template<glm::length_t D>
+    struct Box final {
+        glm::vec<D, float> min;
+        glm::vec<D, float> max;
+    };
+
+    template<glm::length_t D>
+    [[nodiscard]] inline constexpr bool boxContains(Box<D> const& b, glm::vec<D, float> const& p) noexcept {
+        for (glm::length_t i = 0; i < D; ++i) {
+            if (!(b.min[i] <= p[i] && p[i] <= b.max[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // node of a point tree
+    struct PointTreeNode final {
+        static constexpr uint32_t internal = 0xffffffff;
+
+        // internal node: index of its first child in `nodes()`. Its children
+        // are the 2^D nodes starting there, where child `i` is the upper
+        // half of the node along axis `a` if bit `a` of `i` is set
+        //
+        // leaf node: index of its first point in `positions()`/`ids()`
+        uint32_t offset;
+
+        // number of points in the leaf, or `internal`
+        uint32_t count;
+
+        [[nodiscard]] bool isLeaf() const noexcept {
+            return count != internal;
+        }
+    };
+
+    // the deepest a point tree can get
+    //
+    // fixes the size of the traversal stack used by queries
+    constexpr size_t pointTreeMaxDepth = 32;
+
+    struct PointTreeParams final {
+        // the most points a leaf holds before it's split
+        size_t maxPointsPerLeaf = 8;
+
+        // leaves at this depth are never split (they grow instead), so that
+        // many points at (nearly) the same position can't split the tree
+        // forever. Clamped to `pointTreeMaxDepth`
+        size_t maxDepth = 20;
+
+        // threads that `build` computes + sorts Morton codes with (0 == one
+        // per core)
+        size_t numThreads = 0;
+    };
+
+    // a point returned by a k-nearest-neighbour query
+    struct PointTreeNeighbor final {
+        uint32_t id;
+
+        // squared distance from the query point
+        float distance2;
+    };
+
+    // a quadtree (`D == 2`) or octree (`D == 3`) over points
+    //
+    // each point has an id (e.g. its index in the caller's array), which is
+    // what queries return. Points can be:
+    //
+    // - inserted one at a time: leaves keep their points in fixed-size
+    //   blocks, so inserting into a leaf doesn't move any other leaf's
+    //   points, and a split leaf's block is recycled
+    //
+    // - bulk-built (`build`): the points are sorted along a Morton (Z-order)
+    //   curve, which puts each subtree's points next to each other, so the
+    //   tree is emitted from the sorted points in one pass. Leaves are packed
+    //   back-to-back and every array is exactly sized, which is better for
+    //   queries. It's faster than inserting large point sets one at a time
+    //   (`ak_pointtree-bench` compares the two), but slower for small ones.
+    //   More cores only speed up its Morton code + sort passes
+    template<glm::length_t D>
+    class PointTree final {
+    public:
+        using Vec = glm::vec<D, float>;
+
+        static constexpr size_t numChildren = size_t{1} << D;
+
+    private:
+        PointTreeParams params_;
+        Box<D> bounds_;
+
+        // the root is `nodes_[0]`
+        std::vector<PointTreeNode> nodes_;
+
+        // each leaf's points: in blocks, of which only the first `count`
+        // entries are used, or packed back-to-back (after a `build`)
+        std::vector<Vec> positions_;
+        std::vector<uint32_t> ids_;
+
+        // offsets of unused blocks, per size class (a block in size class
+        // `c` holds `maxPointsPerLeaf << c` points: only leaves that can't be
+        // split outgrow class 0)
+        std::vector<std::vector<uint32_t>> freeBlocks_;
+
+        size_t size_ = 0;
+
+        // true if the leaves are packed back-to-back, so they have to be
+        // moved into blocks before anything can be inserted
+        bool packed_ = false;
+
+        [[nodiscard]] size_t sizeClassOf(uint32_t count) const noexcept;
+        uint32_t allocBlock(size_t sizeClass);
+        void freeBlock(uint32_t offset, size_t sizeClass);
+        void unpack();
+
+    public:
+        explicit PointTree(Box<D> const& bounds, PointTreeParams const& params = {});
+
+        // returns the box of child `i` of a node whose box is `parent`
+        [[nodiscard]] static Box<D> childBounds(Box<D> const& parent, size_t i) noexcept;
+
+        [[nodiscard]] Box<D> const& bounds() const noexcept {
+            return bounds_;
+        }
+
+        [[nodiscard]] std::vector<PointTreeNode> const& nodes() const noexcept {
+            return nodes_;
+        }
+
+        [[nodiscard]] std::vector<Vec> const& positions() const noexcept {
+            return positions_;
+        }
+
+        [[nodiscard]] std::vector<uint32_t> const& ids() const noexcept {
+            return ids_;
+        }
+
+        // number of points in the tree
+        [[nodiscard]] size_t size() const noexcept {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        // removes every point, but keeps the tree's allocations
+        void clear() noexcept;
+
+        // replaces the tree's points with `points` (point `i` gets id `i`)
+        //
+        // throws if any point is outside of `bounds()`
+        void build(Vec const* points, size_t n);
+
+        void build(std::vector<Vec> const& points) {
+            build(points.data(), points.size());
+        }
+
+        // inserts a point at `p`
+        //
+        // throws if `p` is outside of `bounds()`. The first insert after a
+        // `build` moves every leaf's points into blocks, which is O(n)
+        void insert(Vec const& p, uint32_t id);
+
+        // appends the ids of every point in `box` to `out` (in no particular
+        // order)
+        //
+        // subtrees that are entirely inside `box` are emitted without testing
+        // their points
+        void queryRange(Box<D> const& box, std::vector<uint32_t>& out) const;
+
+        // appends the ids of every point within `radius` of `center` to
+        // `out` (in no particular order)
+        void queryRadius(Vec const& center, float radius, std::vector<uint32_t>& out) const;
+
+        // appends the (up to) `k` points nearest to `p` to `out`, nearest
+        // first (ties are broken by lowest id)
+        //
+        // visits children nearest-first, and skips nodes that are further
+        // away than the `k`th-nearest point found so far
+        void queryNearest(Vec const& p, size_t k, std::vector<PointTreeNeighbor>& out) const;
+    };
+
+    using Quadtree = PointTree<2>;
+    using Octree = PointTree<3>;
+
+    struct LooseTreeParams final {
+        // the most points a leaf holds before it's split. A subtree is
+        // merged back into one leaf once it holds half as many (or fewer),
+        // so that points moving around a split can't split + merge it every
+        // frame
+        size_t maxPointsPerLeaf = 8;
+
+        // leaves at this depth are never split (as with `PointTreeParams`).
+        // Clamped to `pointTreeMaxDepth`
+        size_t maxDepth = 20;
+
+        // the size of a node's loose box, relative to its box (clamped to
+        // >= 1)
+        //
+        // bigger loose boxes mean that points have to move further before
+        // they change node, but that queries visit more nodes
+        float looseness = 2.0f;
+    };
+
+    // node of a loose tree
+    template<glm::length_t D>
+    struct LooseTreeNode final {
+        static constexpr uint32_t none = 0xffffffff;
+
+        // `none` for the root
+        uint32_t parent;
+
+        // index of the node's first child in `nodes()` (children are laid
+        // out as a `PointTreeNode`'s are), or `none` for a leaf
+        uint32_t firstChild;
+
+        // handle of the first of the node's own points, or `none`: the rest
+        // follow it (see `LooseTree::next`)
+        uint32_t firstPoint;
+
+        // number of the node's own points
+        uint32_t numPoints;
+
+        // number of points in the node's subtree (including its own)
+        uint32_t subtreeSize;
+
+        uint32_t depth;
+
+        Box<D> bounds;
+
+        // `bounds`, scaled up by `LooseTreeParams::looseness`: every point in
+        // the node's subtree is in it
+        Box<D> looseBounds;
+
+        [[nodiscard]] bool isLeaf() const noexcept {
+            return firstChild == none;
+        }
+    };
+
+    // a loose quadtree (`D == 2`) or octree (`D == 3`) over moving points
+    //
+    // each node has a box (as in a `PointTree`) and a loose box, which is
+    // its box scaled up (by `looseness`) around its center. A point is kept
+    // in the deepest node whose loose box holds it, so it only has to change
+    // node once it leaves that node's loose box: most moves just overwrite
+    // its position. The root's loose box is just `bounds()`
+    //
+    // the points that do change node dominate the cost of a frame's moves,
+    // so bigger leaves and looser boxes make moves cheaper (at the cost of
+    // slower queries): `ak_loosetree-bench` compares the two
+    //
+    // each node's points are a linked list through the points' handles, so
+    // that a point can be unlinked from its node without moving any others.
+    // Handles (and child blocks) of removed points (and merged subtrees) go
+    // on free lists and are reused
+    template<glm::length_t D>
+    class LooseTree final {
+    public:
+        using Vec = glm::vec<D, float>;
+
+        static constexpr size_t numChildren = size_t{1} << D;
+
+    private:
+        LooseTreeParams params_;
+
+        // the root is `nodes_[0]`. Unlike a `PointTree`'s, nodes hold their
+        // boxes, because relocations start from a point's node rather than
+        // the root
+        std::vector<LooseTreeNode<D>> nodes_;
+
+        // first nodes of unused child blocks
+        std::vector<uint32_t> freeNodes_;
+
+        // per point handle (handles of removed points have garbage in these,
+        // and a `pointNodes_` entry of `none`)
+        std::vector<Vec> positions_;
+        std::vector<uint32_t> ids_;
+        std::vector<uint32_t> pointNodes_;
+        std::vector<uint32_t> next_;
+        std::vector<uint32_t> prev_;
+
+        // a copy of each point's node's loose box, so that `move` doesn't
+        // have to look at the (randomly ordered) nodes unless the point
+        // leaves it
+        std::vector<Box<D>> pointLooseBounds_;
+
+        std::vector<uint32_t> freeHandles_;
+
+        size_t size_ = 0;
+
+        void link(uint32_t node, uint32_t handle) noexcept;
+        void unlink(uint32_t handle) noexcept;
+        void place(uint32_t node, uint32_t handle);
+        void split(uint32_t node);
+        void merge(uint32_t node);
+        void mergeAbove(uint32_t node, uint32_t end);
+        void relocate(uint32_t handle, Vec const& p);
+        void throwIfNotInBounds(char const* func, Vec const& p, uint32_t id) const;
+
+    public:
+        explicit LooseTree(Box<D> const& bounds, LooseTreeParams const& params = {});
+
+        [[nodiscard]] Box<D> const& bounds() const noexcept {
+            return nodes_[0].bounds;
+        }
+
+        // nodes that aren't reachable from the root are unused
+        [[nodiscard]] std::vector<LooseTreeNode<D>> const& nodes() const noexcept {
+            return nodes_;
+        }
+
+        // number of points in the tree
+        [[nodiscard]] size_t size() const noexcept {
+            return size_;
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return size_ == 0;
+        }
+
+        [[nodiscard]] Vec const& position(uint32_t handle) const noexcept {
+            return positions_[handle];
+        }
+
+        [[nodiscard]] uint32_t id(uint32_t handle) const noexcept {
+            return ids_[handle];
+        }
+
+        // handle of the point after `handle` in its node, or
+        // `LooseTreeNode<D>::none`
+        [[nodiscard]] uint32_t next(uint32_t handle) const noexcept {
+            return next_[handle];
+        }
+
+        // removes every point, but keeps the tree's allocations
+        void clear() noexcept;
+
+        // inserts a point at `p`, and returns its handle (which stays the
+        // same until it's removed)
+        //
+        // throws if `p` is outside of `bounds()`
+        uint32_t insert(Vec const& p, uint32_t id);
+
+        // removes the point with handle `handle`
+        //
+        // throws if `handle` isn't a point in the tree
+        void remove(uint32_t handle);
+
+        // moves the point with handle `handle` (which must be in the tree)
+        // to `p`
+        //
+        // throws if `p` is outside of `bounds()`. Unless the point leaves its
+        // node's loose box, this only updates its position
+        void move(uint32_t handle, Vec const& p) {
+            if (boxContains(pointLooseBounds_[handle], p)) {
+                positions_[handle] = p;
+            } else {
+                relocate(handle, p);
+            }
+        }
+
+        // appends the ids of every point in `box` to `out` (in no particular
+        // order)
+        void queryRange(Box<D> const& box, std::vector<uint32_t>& out) const;
+
+        // appends the ids of every point within `radius` of `center` to
+        // `out` (in no particular order)
+        void queryRadius(Vec const& center, float radius, std::vector<uint32_t>& out) const;
+    };
+
+    using LooseQuadtree = LooseTree<2>;
+    using LooseOctree = LooseTree<3>;
+}
@@ -0,0 +1,663 @@
+#include "profiler.hpp"
+
+#include <GL/glew.h>
+#include <imgui/imgui.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+// how many completed frames are kept in the history
+static constexpr size_t g_MaxFrames = 300;
+
+// per-thread event capacity (between calls to `endFrame`)
+static constexpr size_t g_ThreadBufferSize = 8192;
+
+// queries are allocated in batches of this size
+static constexpr size_t g_QueryBatchSize = 64;
+
+// GPU->CPU clock offset is re-measured every N frames, because the clocks
+// drift relative to each other
+static constexpr uint64_t g_GpuClockResyncInterval = 120;
+
+static std::atomic<bool> g_Enabled{true};
+static std::atomic<uint64_t> g_NumDropped{0};
+
+// a single-producer (owning thread), single-consumer (`endFrame`) ring of
+// completed CPU events
+namespace {
+    struct ThreadBuffer final {
+        uint32_t thread;
+        std::atomic<uint64_t> head{0};  // written by producer
+        std::atomic<uint64_t> tail{0};  // written by consumer
+        std::atomic<bool> alive{true};
+        std::unique_ptr<gp::prof::Event[]> events{new gp::prof::Event[g_ThreadBufferSize]};
+
+        explicit ThreadBuffer(uint32_t _thread) : thread{_thread} {
+        }
+
+        void push(gp::prof::Event const& e) noexcept {
+            uint64_t h = head.load(std::memory_order_relaxed);
+            if (h - tail.load(std::memory_order_acquire) >= g_ThreadBufferSize) {
+                g_NumDropped.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            events[h % g_ThreadBufferSize] = e;
+            head.store(h + 1, std::memory_order_release);
+        }
+
+        void drainInto(std::vector<gp::prof::Event>& out) {
+            uint64_t t = tail.load(std::memory_order_relaxed);
+            uint64_t h = head.load(std::memory_order_acquire);
+            for (; t != h; ++t) {
+                out.push_back(events[t % g_ThreadBufferSize]);
+            }
+            tail.store(t, std::memory_order_release);
+        }
+    };
+
+    struct ThreadRegistry final {
+        std::mutex mutex;
+        std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+        std::vector<std::string> names;
+    };
+
+    // owned by each thread that records events: marks the thread's buffer
+    // as dead on thread exit, so that `endFrame` can remove it once drained
+    struct ThreadBufferHandle final {
+        std::shared_ptr<ThreadBuffer> buffer;
+
+        ThreadBufferHandle(ThreadBufferHandle const&) = delete;
+        ThreadBufferHandle(ThreadBufferHandle&&) = delete;
+        ThreadBufferHandle& operator=(ThreadBufferHandle const&) = delete;
+        ThreadBufferHandle& operator=(ThreadBufferHandle&&) = delete;
+
+        ThreadBufferHandle();
+
+        ~ThreadBufferHandle() noexcept;
+    };
+
+    // a GPU scope that has been issued, but not yet read back
+    struct PendingGpuEvent final {
+        char const* name;
+        GLuint beginQuery;
+        GLuint endQuery = 0;
+        uint32_t depth;
+    };
+
+    // all GPU scopes issued during one frame
+    struct PendingGpuFrame final {
+        uint64_t index;
+        std::vector<PendingGpuEvent> events;
+    };
+
+    // GPU profiling state: only accessed from the GL thread
+    struct GpuState final {
+        std::vector<GLuint> freeQueries;
+        std::vector<GLuint> allQueries;
+        PendingGpuFrame current{0, {}};
+        std::deque<PendingGpuFrame> inFlight;
+        uint32_t depth = 0;
+
+        // CPU time (ns) minus GPU time (ns)
+        int64_t clockOffset = 0;
+        bool clockOffsetValid = false;
+    };
+
+    struct FrameState final {
+        uint64_t index = 0;
+        int64_t begin = gp::prof::now();
+        std::deque<gp::prof::Frame> history;
+    };
+}
+
+static std::atomic<bool> g_ThreadRegistryDestroyed{false};
+
+static ThreadRegistry& threadRegistry() {
+    struct Holder final {
+        ThreadRegistry r;
+        ~Holder() noexcept {
+            g_ThreadRegistryDestroyed.store(true, std::memory_order_relaxed);
+        }
+    };
+    static Holder h;
+    return h.r;
+}
+
+// trivially destructible, so that they're still safe to read while (and
+// after) the calling thread's `thread_local`s are being destroyed
+static thread_local ThreadBuffer* t_ThreadBuffer = nullptr;
+static thread_local bool t_ThreadBufferRetired = false;
+
+ThreadBufferHandle::ThreadBufferHandle() {
+    ThreadRegistry& r = threadRegistry();
+    std::lock_guard g{r.mutex};
+    uint32_t thread = static_cast<uint32_t>(r.names.size());
+    r.names.push_back("thread " + std::to_string(thread));
+    buffer = std::make_shared<ThreadBuffer>(thread);
+    r.buffers.push_back(buffer);
+    t_ThreadBuffer = buffer.get();
+}
+
+ThreadBufferHandle::~ThreadBufferHandle() noexcept {
+    t_ThreadBuffer = nullptr;
+    t_ThreadBufferRetired = true;
+    buffer->alive.store(false, std::memory_order_release);
+}
+
+// returns the calling thread's buffer, or `nullptr` if the profiler has shut
+// down for it (e.g. a scope that runs in the destructor of another
+// `thread_local`, after the thread's buffer was retired, or of a static,
+// after the registry was destroyed)
+static ThreadBuffer* threadBuffer() noexcept {
+    if (t_ThreadBufferRetired || g_ThreadRegistryDestroyed.load(std::memory_order_relaxed)) {
+        return nullptr;
+    }
+    thread_local ThreadBufferHandle h;
+    return t_ThreadBuffer;
+}
+
+static thread_local uint32_t g_CpuDepth = 0;
+
+static GpuState g_Gpu;
+static FrameState g_Frames;
+
+void gp::prof::setEnabled(bool v) noexcept {
+    g_Enabled.store(v, std::memory_order_relaxed);
+}
+
+bool gp::prof::isEnabled() noexcept {
+    return g_Enabled.load(std::memory_order_relaxed);
+}
+
+void gp::prof::setThreadName(char const* name) {
+    ThreadBuffer* buf = threadBuffer();
+    if (!buf) {
+        return;
+    }
+    uint32_t thread = buf->thread;
+    ThreadRegistry& r = threadRegistry();
+    std::lock_guard g{r.mutex};
+    r.names[thread] = name;
+}
+
+int64_t gp::prof::now() noexcept {
+    using namespace std::chrono;
+    return duration_cast<nanoseconds>(steady_clock::now().time_since_epoch()).count();
+}
+
+gp::prof::CpuScope::CpuScope(char const* name) noexcept :
+    name_{isEnabled() ? name : nullptr},
+    begin_{name_ ? now() : 0} {
+
+    if (name_) {
+        ++g_CpuDepth;
+    }
+}
+
+gp::prof::CpuScope::~CpuScope() noexcept {
+    if (!name_) {
+        return;
+    }
+
+    int64_t end = now();
+    --g_CpuDepth;
+    ThreadBuffer* buf = threadBuffer();
+    if (buf) {
+        buf->push(Event{name_, begin_, end, g_CpuDepth, buf->thread});
+    }
+}
+
+static GLuint allocQuery() {
+    if (g_Gpu.freeQueries.empty()) {
+        GLuint batch[g_QueryBatchSize];
+        glGenQueries(static_cast<GLsizei>(g_QueryBatchSize), batch);
+        g_Gpu.freeQueries.assign(batch, batch + g_QueryBatchSize);
+        g_Gpu.allQueries.insert(g_Gpu.allQueries.end(), batch, batch + g_QueryBatchSize);
+    }
+
+    GLuint q = g_Gpu.freeQueries.back();
+    g_Gpu.freeQueries.pop_back();
+    return q;
+}
+
+// GPU scopes use a pair of GL_TIMESTAMP queries, rather than one
+// GL_TIME_ELAPSED query, because TIME_ELAPSED queries cannot be nested
+gp::prof::GpuScope::GpuScope(char const* name) : name_{name}, slot_{-1} {
+    if (!isEnabled()) {
+        return;
+    }
+
+    PendingGpuEvent e{name, allocQuery(), 0, g_Gpu.depth++};
+    glQueryCounter(e.beginQuery, GL_TIMESTAMP);
+    slot_ = static_cast<int32_t>(g_Gpu.current.events.size());
+    g_Gpu.current.events.push_back(e);
+}
+
+gp::prof::GpuScope::~GpuScope() noexcept {
+    if (slot_ < 0) {
+        return;
+    }
+
+    if (g_Gpu.depth > 0) {
+        --g_Gpu.depth;
+    }
+
+    // the frame ended (or queries were released) while the scope was open
+    if (static_cast<size_t>(slot_) >= g_Gpu.current.events.size() ||
+        g_Gpu.current.events[slot_].name != name_ ||
+        g_Gpu.current.events[slot_].endQuery != 0) {
+        return;
+    }
+
+    try {
+        GLuint q = allocQuery();
+        glQueryCounter(q, GL_TIMESTAMP);
+        g_Gpu.current.events[slot_].endQuery = q;
+    } catch (...) {
+        // allocation failed: the event is dropped when it is read back
+    }
+}
+
+static void resyncGpuClock() {
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    g_Gpu.clockOffset = gp::prof::now() - static_cast<int64_t>(gpuNow);
+    g_Gpu.clockOffsetValid = true;
+}
+
+static gp::prof::Frame* findFrame(uint64_t index) {
+    std::deque<gp::prof::Frame>& h = g_Frames.history;
+    if (h.empty() || index < h.front().index || index > h.back().index) {
+        return nullptr;
+    }
+    return &h[static_cast<size_t>(index - h.front().index)];
+}
+
+// reads back frames whose queries are old enough and available
+//
+// never blocks: stops at the first frame that isn't available yet, because
+// frames complete in order
+static void readbackGpuFrames() {
+    while (!g_Gpu.inFlight.empty()) {
+        PendingGpuFrame& pf = g_Gpu.inFlight.front();
+
+        if (pf.index + gp::prof::gpuReadbackLatency > g_Frames.index) {
+            return;
+        }
+
+        for (PendingGpuEvent const& e : pf.events) {
+            GLint available = 1;
+            if (e.endQuery) {
+                glGetQueryObjectiv(e.endQuery, GL_QUERY_RESULT_AVAILABLE, &available);
+            }
+            if (!available) {
+                return;
+            }
+        }
+
+        gp::prof::Frame* f = findFrame(pf.index);
+        if (f) {
+            f->gpuEvents.clear();
+            f->gpuEvents.reserve(pf.events.size());
+        }
+
+        for (PendingGpuEvent const& e : pf.events) {
+            if (f && e.endQuery) {
+                GLuint64 begin = 0;
+                GLuint64 end = 0;
+                glGetQueryObjectui64v(e.beginQuery, GL_QUERY_RESULT, &begin);
+                glGetQueryObjectui64v(e.endQuery, GL_QUERY_RESULT, &end);
+
+                f->gpuEvents.push_back(gp::prof::Event{
+                    e.name,
+                    static_cast<int64_t>(begin) + g_Gpu.clockOffset,
+                    static_cast<int64_t>(end) + g_Gpu.clockOffset,
+                    e.depth,
+                    gp::prof::gpuThread,
+                });
+            }
+
+            g_Gpu.freeQueries.push_back(e.beginQuery);
+            if (e.endQuery) {
+                g_Gpu.freeQueries.push_back(e.endQuery);
+            }
+        }
+
+        if (f) {
+            f->gpuEventsReady = true;
+        }
+
+        g_Gpu.inFlight.pop_front();
+    }
+}
+
+void gp::prof::endFrame() {
+    Frame f;
+    f.index = g_Frames.index;
+    f.begin = g_Frames.begin;
+    f.end = now();
+
+    // collect CPU events from all threads, and remove buffers belonging to
+    // threads that have exited
+    {
+        ThreadRegistry& r = threadRegistry();
+        std::lock_guard g{r.mutex};
+        for (auto it = r.buffers.begin(); it != r.buffers.end();) {
+            ThreadBuffer& buf = **it;
+            bool alive = buf.alive.load(std::memory_order_acquire);
+            buf.drainInto(f.cpuEvents);
+            it = alive ? it + 1 : r.buffers.erase(it);
+        }
+    }
+    std::sort(f.cpuEvents.begin(), f.cpuEvents.end(), [](Event const& a, Event const& b) {
+        return a.begin < b.begin;
+    });
+
+    g_Frames.history.push_back(std::move(f));
+    while (g_Frames.history.size() > g_MaxFrames) {
+        g_Frames.history.pop_front();
+    }
+
+    // hand this frame's GPU queries over for (later) readback
+    if (!g_Gpu.current.events.empty() || !g_Gpu.inFlight.empty()) {
+        if (!g_Gpu.clockOffsetValid || g_Frames.index % g_GpuClockResyncInterval == 0) {
+            resyncGpuClock();
+        }
+    }
+    g_Gpu.inFlight.push_back(std::move(g_Gpu.current));
+    g_Gpu.current = PendingGpuFrame{g_Frames.index + 1, {}};
+
+    ++g_Frames.index;
+    g_Frames.begin = g_Frames.history.back().end;
+
+    readbackGpuFrames();
+}
+
+void gp::prof::releaseGpuQueries() noexcept {
+    if (!g_Gpu.allQueries.empty()) {
+        glDeleteQueries(static_cast<GLsizei>(g_Gpu.allQueries.size()), g_Gpu.allQueries.data());
+    }
+
+    g_Gpu.allQueries.clear();
+    g_Gpu.freeQueries.clear();
+    g_Gpu.current.events.clear();
+    g_Gpu.inFlight.clear();
+    g_Gpu.depth = 0;
+    g_Gpu.clockOffsetValid = false;
+}
+
+std::deque<gp::prof::Frame> const& gp::prof::frames() noexcept {
+    return g_Frames.history;
+}
+
+std::string gp::prof::threadName(uint32_t thread) {
+    if (thread == gpuThread) {
+        return "GPU";
+    }
+
+    ThreadRegistry& r = threadRegistry();
+    std::lock_guard g{r.mutex};
+    return thread < r.names.size() ? r.names[thread].c_str() : "unknown";
+}
+
+uint64_t gp::prof::numDroppedEvents() noexcept {
+    return g_NumDropped.load(std::memory_order_relaxed);
+}
+
+static void writeJsonString(std::ostream& o, char const* s) {
+    o << '"';
+    for (; *s; ++s) {
+        unsigned char c = static_cast<unsigned char>(*s);
+        switch (c) {
+        case '"':
+            o << "\\\"";
+            break;
+        case '\\':
+            o << "\\\\";
+            break;
+        case '\n':
+            o << "\\n";
+            break;
+        case '\t':
+            o << "\\t";
+            break;
+        default:
+            if (c < 0x20) {
+                char buf[8];
+                std::snprintf(buf, sizeof(buf), "\\u%04x", c);
+                o << buf;
+            } else {
+                o << *s;
+            }
+        }
+    }
+    o << '"';
+}
+
+// chrome traces need integral thread IDs: the GPU is given the ID after the
+// last CPU thread
+static void writeTraceEvent(std::ostream& o, char const* name, int64_t begin, int64_t end, int64_t origin, uint32_t tid) {
+    o << ",\n{\"name\":";
+    writeJsonString(o, name);
+    char buf[128];
+    std::snprintf(buf, sizeof(buf), ",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+                  tid,
+                  static_cast<double>(begin - origin) / 1000.0,
+                  static_cast<double>(end - begin) / 1000.0);
+    o << buf;
+}
+
+void gp::prof::writeChromeTrace(char const* path) {
+    std::deque<Frame> const& h = g_Frames.history;
+
+    std::vector<std::string> names;
+    {
+        ThreadRegistry& r = threadRegistry();
+        std::lock_guard g{r.mutex};
+        names = r.names;
+    }
+    uint32_t gpuTid = static_cast<uint32_t>(names.size());
+    uint32_t framesTid = gpuTid + 1;
+
+    std::stringstream o;
+    o << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+
+    // metadata: names for each row
+    o << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"gfxplay\"}}";
+    for (uint32_t tid = 0; tid < names.size(); ++tid) {
+        o << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << tid << ",\"args\":{\"name\":";
+        writeJsonString(o, names[tid].c_str());
+        o << "}}";
+    }
+    o << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << gpuTid << ",\"args\":{\"name\":\"GPU\"}}";
+    o << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << framesTid << ",\"args\":{\"name\":\"frames\"}}";
+
+    int64_t origin = h.empty() ? 0 : h.front().begin;
+    for (Frame const& f : h) {
+        char name[32];
+        std::snprintf(name, sizeof(name), "frame %llu", static_cast<unsigned long long>(f.index));
+        writeTraceEvent(o, name, f.begin, f.end, origin, framesTid);
+
+        for (Event const& e : f.cpuEvents) {
+            writeTraceEvent(o, e.name, e.begin, e.end, origin, e.thread);
+        }
+        for (Event const& e : f.gpuEvents) {
+            writeTraceEvent(o, e.name, e.begin, e.end, origin, gpuTid);
+        }
+    }
+    o << "\n]}\n";
+
+    FILE* fd = std::fopen(path, "wb");
+    if (!fd) {
+        std::stringstream msg;
+        msg << path << ": error opening chrome trace file for writing: " << std::strerror(errno);
+        throw std::runtime_error{std::move(msg).str()};
+    }
+    GP_SCOPEGUARD({ std::fclose(fd); });
+
+    std::string s = std::move(o).str();
+    if (std::fwrite(s.data(), 1, s.size(), fd) != s.size()) {
+        std::stringstream msg;
+        msg << path << ": error writing chrome trace: " << std::strerror(errno);
+        throw std::runtime_error{std::move(msg).str()};
+    }
+}
+
+// draws one frame's events as a timeline: one lane per thread (+ the GPU),
+// with nested scopes drawn below their parents
+static void drawTimeline(gp::prof::Frame const& f) {
+    static constexpr float rowHeight = 18.0f;
+
+    struct Lane final {
+        uint32_t thread;
+        uint32_t maxDepth;
+    };
+    std::vector<Lane> lanes;
+    auto laneOf = [&lanes](gp::prof::Event const& e) -> Lane& {
+        for (Lane& l : lanes) {
+            if (l.thread == e.thread) {
+                return l;
+            }
+        }
+        return lanes.emplace_back(Lane{e.thread, 0});
+    };
+    for (gp::prof::Event const& e : f.cpuEvents) {
+        Lane& l = laneOf(e);
+        l.maxDepth = std::max(l.maxDepth, e.depth);
+    }
+    std::sort(lanes.begin(), lanes.end(), [](Lane const& a, Lane const& b) { return a.thread < b.thread; });
+    for (gp::prof::Event const& e : f.gpuEvents) {
+        Lane& l = laneOf(e);
+        l.maxDepth = std::max(l.maxDepth, e.depth);
+    }
+
+    // GPU work lags behind the CPU, so widen the window to fit it
+    int64_t begin = f.begin;
+    int64_t end = f.end;
+    for (gp::prof::Event const& e : f.gpuEvents) {
+        begin = std::min(begin, e.begin);
+        end = std::max(end, e.end);
+    }
+    double nsPerPixel = static_cast<double>(std::max<int64_t>(end - begin, 1));
+
+    ImDrawList* dl = ImGui::GetWindowDrawList();
+    float width = std::max(ImGui::GetContentRegionAvail().x, 100.0f);
+    nsPerPixel /= width;
+    ImGuiIO& io = ImGui::GetIO();
+
+    for (Lane const& l : lanes) {
+        std::string name = gp::prof::threadName(l.thread);
+        ImGui::TextUnformatted(name.c_str());
+
+        ImVec2 origin = ImGui::GetCursorScreenPos();
+        float height = rowHeight * static_cast<float>(l.maxDepth + 1);
+        dl->AddRectFilled(origin, ImVec2{origin.x + width, origin.y + height}, IM_COL32(40, 40, 40, 255));
+
+        auto const& events = l.thread == gp::prof::gpuThread ? f.gpuEvents : f.cpuEvents;
+        for (gp::prof::Event const& e : events) {
+            if (e.thread != l.thread) {
+                continue;
+            }
+
+            float x0 = origin.x + static_cast<float>(static_cast<double>(e.begin - begin) / nsPerPixel);
+            float x1 = origin.x + static_cast<float>(static_cast<double>(e.end - begin) / nsPerPixel);
+            x1 = std::max(x1, x0 + 1.0f);
+            float y0 = origin.y + rowHeight * static_cast<float>(e.depth);
+            float y1 = y0 + rowHeight - 1.0f;
+
+            // color by name, so that the same scope has the same color
+            // across frames
+            uint32_t hash = 2166136261u;
+            for (char const* c = e.name; *c; ++c) {
+                hash = (hash ^ static_cast<unsigned char>(*c)) * 16777619u;
+            }
+            ImU32 col = IM_COL32(80 + (hash & 0x7f), 80 + ((hash >> 8) & 0x7f), 80 + ((hash >> 16) & 0x7f), 255);
+
+            dl->AddRectFilled(ImVec2{x0, y0}, ImVec2{x1, y1}, col);
+            if (x1 - x0 > ImGui::CalcTextSize(e.name).x + 4.0f) {
+                dl->AddText(ImVec2{x0 + 2.0f, y0 + 2.0f}, IM_COL32(0, 0, 0, 255), e.name);
+            }
+
+            if (ImGui::IsWindowHovered() &&
+                io.MousePos.x >= x0 && io.MousePos.x < x1 &&
+                io.MousePos.y >= y0 && io.MousePos.y < y1) {
+
+                ImGui::SetTooltip("%s\n%.3f ms", e.name, static_cast<double>(e.end - e.begin) / 1000000.0);
+            }
+        }
+
+        ImGui::Dummy(ImVec2{width, height});
+    }
+}
+
+void gp::ImGuiProfilerPanel() {
+    ImGui::Begin("profiler");
+    GP_SCOPEGUARD({ ImGui::End(); });
+
+    bool enabled = prof::isEnabled();
+    if (ImGui::Checkbox("enabled", &enabled)) {
+        prof::setEnabled(enabled);
+    }
+
+    // when paused, the panel keeps showing a copy of the history, so that
+    // individual frames can be inspected
+    static bool paused = false;
+    static std::deque<prof::Frame> pausedFrames;
+    ImGui::SameLine();
+    if (ImGui::Checkbox("paused", &paused) && paused) {
+        pausedFrames = prof::frames();
+    }
+
+    ImGui::SameLine();
+    if (ImGui::Button("export chrome trace")) {
+        try {
+            prof::writeChromeTrace("gfxplay_trace.json");
+            log::info("wrote chrome trace to gfxplay_trace.json");
+        } catch (std::exception const& ex) {
+            log::error("%s", ex.what());
+        }
+    }
+
+    std::deque<prof::Frame> const& frames = paused ? pausedFrames : prof::frames();
+    if (frames.empty()) {
+        ImGui::TextUnformatted("no frames recorded");
+        return;
+    }
+
+    std::vector<float> frameTimes;
+    frameTimes.reserve(frames.size());
+    for (prof::Frame const& f : frames) {
+        frameTimes.push_back(static_cast<float>(f.end - f.begin) / 1000000.0f);
+    }
+    float maxFrameTime = *std::max_element(frameTimes.begin(), frameTimes.end());
+    ImGui::PlotLines("##frametimes", frameTimes.data(), static_cast<int>(frameTimes.size()), 0, "frame time (ms)", 0.0f, maxFrameTime, ImVec2{0.0f, 60.0f});
+
+    // frames are selected relative to the newest frame that has GPU data, so
+    // that the selection is stable while unpaused
+    static int offset = 0;
+    int newest = static_cast<int>(frames.size()) - 1;
+    while (newest > 0 && !frames[static_cast<size_t>(newest)].gpuEventsReady) {
+        --newest;
+    }
+    ImGui::SliderInt("frames ago", &offset, 0, newest);
+    offset = std::clamp(offset, 0, newest);
+
+    prof::Frame const& f = frames[static_cast<size_t>(newest - offset)];
+    ImGui::Text("frame %llu: %.3f ms (%zu CPU events, %zu GPU events, %llu dropped)",
+                static_cast<unsigned long long>(f.index),
+                static_cast<double>(f.end - f.begin) / 1000000.0,
+                f.cpuEvents.size(),
+                f.gpuEvents.size(),
+                static_cast<unsigned long long>(prof::numDroppedEvents()));
+
+    drawTimeline(f);
+}
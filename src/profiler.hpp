@@ -0,0 +1,141 @@
+#pragma once
+
+#include "app.hpp"
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// profiler support
+//
+// a lightweight, always-on, frame profiler. CPU time is measured with RAII
+// scope markers (`GP_PROFILE_SCOPE`) that write into per-thread ring buffers,
+// so that measuring a scope costs two clock reads and no locking. GPU time is
+// measured with OpenGL timer queries (`GP_PROFILE_GPU_SCOPE`) that are read
+// back a few frames later, so that the CPU never waits on the GPU
+//
+// `gp::App` marks frame boundaries and instruments its gameloop (event pump,
+// update, draw, swap) automatically. Collected frames can be viewed in an
+// ImGui panel (`ImGuiProfilerPanel`) or exported as a Chrome trace
+// (chrome://tracing, https://ui.perfetto.dev)
+namespace gp::prof {
+
+    // a completed CPU or GPU scope
+    struct Event final {
+        // must have static storage duration (e.g. a string literal)
+        char const* name;
+
+        // steady_clock nanoseconds
+        int64_t begin;
+        int64_t end;
+
+        // nesting depth of the scope on its thread (or the GPU)
+        uint32_t depth;
+
+        // profiler-assigned thread ID (see `threadName`)
+        uint32_t thread;
+    };
+
+    // thread ID used for GPU events
+    static constexpr uint32_t gpuThread = 0xffffffffu;
+
+    struct Frame final {
+        uint64_t index;
+
+        // steady_clock nanoseconds
+        int64_t begin;
+        int64_t end;
+
+        // CPU events (from all threads) that completed during the frame
+        std::vector<Event> cpuEvents;
+
+        // GPU events issued during the frame. Only populated a few frames after
+        // the frame ends (see `gpuReadbackLatency`)
+        std::vector<Event> gpuEvents;
+        bool gpuEventsReady = false;
+    };
+
+    // how many frames old a frame must be before its GPU queries are read back
+    static constexpr uint64_t gpuReadbackLatency = 3;
+
+    // enable/disable collection (enabled by default)
+    void setEnabled(bool) noexcept;
+    [[nodiscard]] bool isEnabled() noexcept;
+
+    // set the name of the calling thread, as shown in the panel/trace
+    void setThreadName(char const*);
+
+    [[nodiscard]] int64_t now() noexcept;
+
+    // RAII marker that records a CPU event from construction to destruction
+    class CpuScope final {
+        char const* name_;
+        int64_t begin_;
+
+    public:
+        explicit CpuScope(char const* name) noexcept;
+        CpuScope(CpuScope const&) = delete;
+        CpuScope(CpuScope&&) = delete;
+        CpuScope& operator=(CpuScope const&) = delete;
+        CpuScope& operator=(CpuScope&&) = delete;
+        ~CpuScope() noexcept;
+    };
+
+    // RAII marker that records a GPU event spanning all OpenGL commands
+    // issued from construction to destruction
+    //
+    // must be used on the thread that owns the OpenGL context
+    class GpuScope final {
+        char const* name_;
+        int32_t slot_;
+
+    public:
+        explicit GpuScope(char const* name);
+        GpuScope(GpuScope const&) = delete;
+        GpuScope(GpuScope&&) = delete;
+        GpuScope& operator=(GpuScope const&) = delete;
+        GpuScope& operator=(GpuScope&&) = delete;
+        ~GpuScope() noexcept;
+    };
+
+    // marks the end of a frame: collects CPU events from all threads and
+    // reads back any GPU queries that are old enough
+    //
+    // `App::show` calls this once per frame (on the GL thread)
+    void endFrame();
+
+    // deletes the profiler's OpenGL queries and discards any GPU events that
+    // are still in flight
+    //
+    // must be called before the OpenGL context is destroyed (`App` does this)
+    void releaseGpuQueries() noexcept;
+
+    // returns the completed frames that are still in the profiler's history
+    // (oldest first)
+    [[nodiscard]] std::deque<Frame> const& frames() noexcept;
+
+    // returns (a copy of) the name of a thread (`Event::thread`), because
+    // other threads may rename or register threads concurrently
+    [[nodiscard]] std::string threadName(uint32_t thread);
+
+    // events dropped because a thread's ring buffer was full
+    [[nodiscard]] uint64_t numDroppedEvents() noexcept;
+
+    // write all frames in the history as a Chrome trace (JSON)
+    //
+    // throws if the file cannot be written
+    void writeChromeTrace(char const* path);
+}
+
+namespace gp {
+    // draws a panel with frame times and a timeline of one frame's CPU and
+    // GPU events
+    //
+    // should be called between `ImGuiNewFrame` and `ImGuiRender`
+    void ImGuiProfilerPanel();
+}
+
+// example usage: `GP_PROFILE_SCOPE("update");`
+#define GP_PROFILE_SCOPE(name) gp::prof::CpuScope GP_TOKENPASTE2(gp_profile_scope_, __LINE__){name}
+#define GP_PROFILE_GPU_SCOPE(name) gp::prof::GpuScope GP_TOKENPASTE2(gp_profile_gpu_scope_, __LINE__){name}
@@ -1,13 +1,22 @@
 #include "logl_common.hpp"
+#include "parallel.hpp"
+#include "pointtree.hpp"
 
 #include <SDL.h>
 #include <cairo/cairo.h>
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <sstream>
 #include <vector>
 #include <random>
 #include <chrono>
+#include <thread>
+#include <tuple>
 
 using std::literals::operator""s;
 
@@ -47,6 +56,15 @@ namespace {
     std::ostream& operator<<(std::ostream& o, Rect const& r) {
         return o << "x = " << r.x << " y = " << r.y << " w = " << r.w << " h = " << r.h;
     }
+
+    // `r`, grown by `n` on each side
+    Rect padded(Rect const& r, int n) noexcept {
+        return Rect{r.x - n, r.y - n, r.w + 2*n, r.h + 2*n};
+    }
+
+    bool rects_overlap(Rect const& a, Rect const& b) noexcept {
+        return a.x < b.x + b.w && b.x < a.x + a.w && a.y < b.y + b.h && b.y < a.y + a.h;
+    }
 }
 
 namespace {
@@ -61,6 +79,9 @@ namespace cairo {
     class Surface {
         cairo_surface_t* ptr;
     public:
+        explicit Surface(cairo_surface_t* p) :
+            ptr{p} {
+        }
         Surface(SDL_Surface* s) :
             ptr{cairo_image_surface_create_for_data(
                     static_cast<unsigned char*>(s->pixels),
@@ -104,16 +125,24 @@ namespace cairo {
 
 namespace ui {
     // pairs the raw software drawbuffer provided by SDL with a cairo context
-    // that can write into it
+    // that can write into it, and a streaming texture that it's uploaded to
+    //
+    // callers `invalidate` whatever they change, and only redraw (e.g. by
+    // clipping to `dirty_rects`) those parts: `texture` only uploads them,
+    // so a frame where little changes costs little
     class Cairo_surface final {
         sdl::Surface sdl_surf;
         cairo::Surface cairo_surf;
         cairo::Context cairo_ctx;
+        sdl::Texture tex;
+        std::vector<Rect> dirty;
     public:
-        Cairo_surface(Dimensions2d const& dimensions) :
+        Cairo_surface(SDL_Renderer* r, Dimensions2d const& dimensions) :
             sdl_surf{sdl::CreateRGBSurface(0, dimensions.w, dimensions.h, 32, 0x00ff0000, 0x0000ff00, 0x000000ff, 0x00000000)},
             cairo_surf{sdl_surf},
-            cairo_ctx{cairo_surf} {
+            cairo_ctx{cairo_surf},
+            tex{sdl::CreateTexture(r, SDL_PIXELFORMAT_RGB888, SDL_TEXTUREACCESS_STREAMING, dimensions.w, dimensions.h)} {
+            invalidate_all();
         }
 
         operator cairo_t*() noexcept {
@@ -124,186 +153,389 @@ namespace ui {
             return cairo_surf;
         }
 
-        sdl::Texture texture(SDL_Renderer* r) {
-            return sdl::CreateTextureFromSurface(r, sdl_surf);
+        // marks `r` (clamped to the surface) as needing to be redrawn and
+        // uploaded
+        void invalidate(Rect const& r) {
+            int x0 = std::max(r.x, 0);
+            int y0 = std::max(r.y, 0);
+            int x1 = std::min(r.x + r.w, sdl_surf->w);
+            int y1 = std::min(r.y + r.h, sdl_surf->h);
+            if (x0 < x1 && y0 < y1) {
+                dirty.push_back(Rect{x0, y0, x1 - x0, y1 - y0});
+            }
+        }
+
+        void invalidate_all() {
+            dirty.clear();
+            dirty.push_back(Rect{0, 0, sdl_surf->w, sdl_surf->h});
+        }
+
+        std::vector<Rect> const& dirty_rects() const noexcept {
+            return dirty;
+        }
+
+        // intersects the cairo context's clip with the dirty rects
+        void clip_to_dirty() {
+            for (Rect const& r : dirty) {
+                cairo_rectangle(cairo_ctx, r.x, r.y, r.w, r.h);
+            }
+            cairo_clip(cairo_ctx);
+        }
+
+        // uploads the dirty rects to the texture, and returns it
+        SDL_Texture* texture() {
+            cairo_surface_flush(cairo_surf);
+
+            auto const* pixels = static_cast<unsigned char const*>(sdl_surf->pixels);
+            int pitch = sdl_surf->pitch;
+            for (Rect const& r : dirty) {
+                SDL_Rect sr{r.x, r.y, r.w, r.h};
+                sdl::UpdateTexture(tex, &sr, pixels + r.y*pitch + 4*r.x, pitch);
+            }
+            dirty.clear();
+
+            return tex;
+        }
+    };
+
+    // an offscreen cairo surface, for caching a layer of the frame that
+    // rarely changes (e.g. a background), which is then composited into a
+    // `Cairo_surface`
+    class Cairo_layer final {
+        cairo::Surface surf;
+        cairo::Context ctx;
+    public:
+        Cairo_layer(Dimensions2d const& dimensions) :
+            surf{cairo_image_surface_create(CAIRO_FORMAT_RGB24, dimensions.w, dimensions.h)},
+            ctx{surf} {
+        }
+
+        operator cairo_t*() noexcept {
+            return ctx;
+        }
+
+        operator cairo_surface_t*() noexcept {
+            return surf;
+        }
+
+        // redraws the `tile_size`d tiles of the layer that overlap any of
+        // `areas`, on `pool`'s threads, and returns them: `draw(cr, tile)`
+        // is called once per tile, with a context that only draws into that
+        // tile (but is still in layer coordinates)
+        //
+        // each tile's context draws into its own surface, which is a view of
+        // the tile's part of the layer's pixels, so the threads don't share
+        // any cairo state, and the tiles don't have to be copied back into
+        // the layer afterwards. Tiles are handed out one at a time, so busy
+        // tiles (e.g. where the tree is deep) don't hold up the rest
+        template<typename F>
+        std::vector<Rect> draw_tiled(int tile_size, gp::WorkerPool& pool, std::vector<Rect> const& areas, F draw) {
+            cairo_surface_flush(surf);
+            unsigned char* pixels = cairo_image_surface_get_data(surf);
+            int stride = cairo_image_surface_get_stride(surf);
+            int w = cairo_image_surface_get_width(surf);
+            int h = cairo_image_surface_get_height(surf);
+
+            std::vector<Rect> tiles;
+            for (int y = 0; y < h; y += tile_size) {
+                for (int x = 0; x < w; x += tile_size) {
+                    Rect tile{x, y, std::min(tile_size, w - x), std::min(tile_size, h - y)};
+                    bool dirty = std::any_of(areas.begin(), areas.end(), [&tile](Rect const& a) {
+                        return rects_overlap(a, tile);
+                    });
+                    if (dirty) {
+                        tiles.push_back(tile);
+                    }
+                }
+            }
+
+            pool.parallelFor(tiles.size(), tiles.size(), [&](size_t, size_t begin, size_t end) {
+                for (size_t i = begin; i < end; ++i) {
+                    Rect const& tile = tiles[i];
+                    cairo::Surface tile_surf{cairo_image_surface_create_for_data(
+                            pixels + tile.y*stride + 4*tile.x,
+                            CAIRO_FORMAT_RGB24,
+                            tile.w,
+                            tile.h,
+                            stride)};
+                    cairo::Context cr{tile_surf};
+                    cairo_translate(cr, -tile.x, -tile.y);
+                    draw(static_cast<cairo_t*>(cr), tile);
+                    cairo_surface_flush(tile_surf);
+                }
+            });
+
+            cairo_surface_mark_dirty(surf);
+
+            return tiles;
+        }
+    };
+
+    // a line of text that's only invalidated when it changes
+    struct Text_label final {
+        Point2d pos;
+        std::string text;
+
+        // what `text` covered when it was set
+        Rect rect{0, 0, 0, 0};
+
+        void set(Cairo_surface& csurf, std::string new_text) {
+            if (new_text == text) {
+                return;
+            }
+
+            // (padded for antialiasing)
+            cairo_text_extents_t ext;
+            cairo_text_extents(csurf, new_text.c_str(), &ext);
+            csurf.invalidate(rect);
+            rect = Rect{
+                pos.x + static_cast<int>(std::floor(ext.x_bearing)) - 2,
+                pos.y + static_cast<int>(std::floor(ext.y_bearing)) - 2,
+                static_cast<int>(std::ceil(ext.width)) + 4,
+                static_cast<int>(std::ceil(ext.height)) + 4,
+            };
+            csurf.invalidate(rect);
+            text = std::move(new_text);
+        }
+
+        void draw(cairo_t* cr) const {
+            cairo_move_to(cr, pos.x, pos.y);
+            cairo_show_text(cr, text.c_str());
         }
     };
 }
 
 namespace {
     struct Sim_el final {
-        Point2d pos;
+        glm::vec2 pos;
+        glm::vec2 vel;  // per frame
     };
 
-    struct Qtree_node final {
-        uint32_t idx = 0;
-        char n = 0;  // -1 == node, -2 == recycleable node
-    };
+    glm::vec2 to_vec2(Point2d const& p) {
+        return {static_cast<float>(p.x), static_cast<float>(p.y)};
+    }
 
-    struct Qtree final {
-        std::vector<Sim_el> data;
-        std::vector<Qtree_node> nodes;
-        Rect rect;
-    };
+    gp::Box<2> to_box(Rect const& r) {
+        return {to_vec2({r.x, r.y}), to_vec2({r.x + r.w, r.y + r.h})};
+    }
 
-    void push(Qtree& tree, size_t cur_node_idx, Rect const& bounds, Sim_el const& el) {
-        // `cur` getter is necessary because tree.nodes might move memory
-        // as it grows
-        auto cur = [&]() -> Qtree_node& { return tree.nodes[cur_node_idx]; };
-
-        if (cur().n == -1) {
-            // `cur` is an internal node, so recurse to the correct node
-            int w = bounds.w/2;
-            int h = bounds.h/2;
-
-            size_t child_idx = cur().idx;
-            int x = bounds.x;
-            if (el.pos.x >= (x + w)) {
-                // right-hand half (indices 1/3)
-                x += w;
-                child_idx += 1;
-            }
-            int y = bounds.y;
-            if (el.pos.y >= (y + h)) {
-                // bottom (indices 2/3)
-                y += h;
-                child_idx += 2;
-            }
+    // inserts each element into `tree`, and returns their handles (element
+    // `i` has id `i`)
+    std::vector<uint32_t> insert_all(gp::LooseQuadtree& tree, std::vector<Sim_el> const& els) {
+        std::vector<uint32_t> rv;
+        rv.reserve(els.size());
+        for (size_t i = 0; i < els.size(); ++i) {
+            rv.push_back(tree.insert(els[i].pos, static_cast<uint32_t>(i)));
+        }
+        return rv;
+    }
 
-            auto new_bounds = Rect{.x = x, .y = y, .w = w, .h = h};
-            push(tree, child_idx, new_bounds, el);
-        } else {
-            // `cur` is a leaf node, so populate/split it
-
-            if (cur().n == 0) {
-                // `cur` is an *empty* leaf node, so allocate 4 new
-                // entries in the tree data vector
-                auto len = tree.data.size();
-                tree.data.resize(len + 4);
-                cur().idx = len;
+    // moves each element, bouncing it off the edges of `bounds`, and moves
+    // it in `tree` to match
+    void step(std::vector<Sim_el>& els, gp::LooseQuadtree& tree, std::vector<uint32_t> const& handles) {
+        gp::Box<2> const& bounds = tree.bounds();
+        for (size_t i = 0; i < els.size(); ++i) {
+            Sim_el& el = els[i];
+            el.pos += el.vel;
+            for (int axis = 0; axis < 2; ++axis) {
+                if (el.pos[axis] < bounds.min[axis] || el.pos[axis] > bounds.max[axis]) {
+                    el.vel[axis] = -el.vel[axis];
+                    el.pos[axis] = std::clamp(el.pos[axis], bounds.min[axis], bounds.max[axis]);
+                }
             }
+            tree.move(handles[i], el.pos);
+        }
+    }
 
-            if (cur().n == -2) {
-                // TODO: this hack just enables data recycling
-                cur().n = 0;
-            }
+    bool boxes_overlap(gp::Box<2> const& a, gp::Box<2> const& b) noexcept {
+        return a.min.x <= b.max.x && b.min.x <= a.max.x && a.min.y <= b.max.y && b.min.y <= a.max.y;
+    }
 
-            if (cur().n < 4) {
-                // `cur` is a leaf node with space available
-                tree.data.at(cur().idx + cur().n) = el;
-                ++(cur().n);
-            } else {
-                // `cur` is a full leaf node, so it needs to be
-                // split into an internal node.
-
-                // save old data
-                auto old_data_idx = cur().idx;
-
-                // reassign `cur` as an internal node
-                {
-                    auto num_nodes = tree.nodes.size();
-                    tree.nodes.resize(num_nodes + 4);
-                    cur().idx = num_nodes;
-                    cur().n = -1;
-
-                    // TODO: hacky optimization: reuse the old data
-                    // entries in the new leaf
-                    tree.nodes[num_nodes].n = -2;
-                    tree.nodes[num_nodes].idx = old_data_idx;
-                }
+    // draws the grid lines of `n`'s subtree that touch `area` (subtrees
+    // that don't overlap it are skipped)
+    void draw_node(cairo_t* cr, gp::LooseQuadtree const& qt, gp::LooseTreeNode<2> const& n, gp::Box<2> const& area) {
+        if (n.isLeaf() || !boxes_overlap(n.bounds, area)) {
+            return;
+        }
 
-                // TODO: optimization: reassign the leaf data...
+        cairo_set_source_rgba(cr, 0, 0, 0, 0.1);
+        gp::Box<2> const& b = n.bounds;
+        glm::vec2 mid = 0.5f * (b.min + b.max);
 
-                // add the old leafs into this (now internal) node
-                for (auto i = 0u; i < 4; ++i) {
-                    push(tree, cur_node_idx, bounds, tree.data.at(old_data_idx + i));
-                }
-                // and push this el into it also
-                push(tree, cur_node_idx, bounds, el);
-            }
+        // grid: vertical
+        cairo_move_to(cr, mid.x, b.min.y);
+        cairo_line_to(cr, mid.x, b.max.y);
+
+        // grid: horizontal
+        cairo_move_to(cr, b.min.x, mid.y);
+        cairo_line_to(cr, b.max.x, mid.y);
+
+        cairo_stroke(cr);
+
+        // recursively draw sub-trees
+        for (size_t i = 0; i < gp::LooseQuadtree::numChildren; ++i) {
+            draw_node(cr, qt, qt.nodes()[n.firstChild + i], area);
         }
     }
 
-    Qtree from_points(Rect const& bounds, std::vector<Sim_el> const& points) {
-        auto rv = Qtree{
-             .data = {},
-            .nodes = {Qtree_node{}},
-            .rect = bounds,
-        };
+    // draws the tree's grid lines that touch `tile`
+    void draw_qtree(cairo_t* cr, gp::LooseQuadtree const& tree, Rect const& tile) {
+        // (padded by the lines' half-width, which overhangs the nodes)
+        double pad = 0.5 * cairo_get_line_width(cr);
+        gp::Box<2> area = to_box(tile);
+        area.min -= static_cast<float>(pad);
+        area.max += static_cast<float>(pad);
+        draw_node(cr, tree, tree.nodes().at(0), area);
+    }
 
-        for (const Sim_el& e : points) {
-            push(rv, 0, rv.rect, e);
+    // appends the boxes of `n`'s subtree's split (internal) nodes, which are
+    // what `draw_node` draws, to `out`
+    void collect_splits(gp::LooseQuadtree const& qt, gp::LooseTreeNode<2> const& n, std::vector<gp::Box<2>>& out) {
+        if (n.isLeaf()) {
+            return;
+        }
+        out.push_back(n.bounds);
+        for (size_t i = 0; i < gp::LooseQuadtree::numChildren; ++i) {
+            collect_splits(qt, qt.nodes()[n.firstChild + i], out);
         }
+    }
 
-        return rv;
+    bool box_less(gp::Box<2> const& a, gp::Box<2> const& b) noexcept {
+        return std::tie(a.min.x, a.min.y, a.max.x, a.max.y) < std::tie(b.min.x, b.min.y, b.max.x, b.max.y);
     }
 
-    void draw_node(ui::Cairo_surface& csurf, Qtree const& qt, Qtree_node const& n, Rect const& r) {
-        if (n.n == -2) {
-            return;  // recycled data nodes containing garbage
-        }
-        if (n.n == -1) {
-            cairo_set_source_rgba(csurf, 0, 0, 0, 0.1);
-            // grid: vertical
-            {
-                int x_mid = r.x + r.w/2;
-                cairo_move_to(csurf, x_mid, r.y);
-                cairo_line_to(csurf, x_mid, r.y + r.h);
-            }
+    // sets `out` to the boxes of the tree's split nodes, sorted
+    void collect_splits(gp::LooseQuadtree const& tree, std::vector<gp::Box<2>>& out) {
+        out.clear();
+        collect_splits(tree, tree.nodes().at(0), out);
+        std::sort(out.begin(), out.end(), box_less);
+    }
 
-            // grid: horizontal
-            {
-                int y_mid = r.y + r.h/2;
-                cairo_move_to(csurf, r.x, y_mid);
-                cairo_line_to(csurf, r.x + r.w, y_mid);
+    // appends the pixels that the grid lines of nodes that were split in
+    // `before` xor `after` (both sorted) cover to `out`, i.e. the parts of
+    // the grid that changed
+    void diff_splits(std::vector<gp::Box<2>> const& before, std::vector<gp::Box<2>> const& after, std::vector<Rect>& out) {
+        auto emit = [&out](gp::Box<2> const& b) {
+            int x0 = static_cast<int>(std::floor(b.min.x));
+            int y0 = static_cast<int>(std::floor(b.min.y));
+            int x1 = static_cast<int>(std::ceil(b.max.x));
+            int y1 = static_cast<int>(std::ceil(b.max.y));
+
+            // (padded for the lines' width + antialiasing)
+            out.push_back(padded(Rect{x0, y0, x1 - x0, y1 - y0}, 2));
+        };
+
+        auto a = before.begin();
+        auto b = after.begin();
+        while (a != before.end() || b != after.end()) {
+            if (b == after.end() || (a != before.end() && box_less(*a, *b))) {
+                emit(*a++);
+            } else if (a == before.end() || box_less(*b, *a)) {
+                emit(*b++);
+            } else {
+                ++a;
+                ++b;
             }
-            cairo_stroke(csurf);
+        }
+    }
 
-            // recursively draw sub-trees
+    bool operator==(Rect const& a, Rect const& b) noexcept {
+        return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+    }
+}
 
-            int w = r.w/2;
-            int h = r.h/2;
+namespace {
+    double ms_since(std::chrono::steady_clock::time_point t0) {
+        auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::milli>(t1 - t0).count();
+    }
 
-            {
-                Rect top_left_rect = { .x = r.x, .y = r.y, .w = w, .h = h };
-                Qtree_node const& top_left_node = qt.nodes.at(n.idx + 0);
-                draw_node(csurf, qt, top_left_node, top_left_rect);
-            }
-            {
-                Rect top_right_rect = { .x = r.x + w, .y = r.y, .w = w, .h = h };
-                Qtree_node const& top_right_node = qt.nodes.at(n.idx + 1);
-                draw_node(csurf, qt, top_right_node, top_right_rect);
-            }
-            {
-                Rect bottom_left_rect = { .x = r.x, .y = r.y + h, .w = w, .h = h };
-                Qtree_node const& bottom_left_node = qt.nodes.at(n.idx + 2);
-                draw_node(csurf, qt, bottom_left_node, bottom_left_rect);
-            }
-            {
-                Rect bottom_right_rect = { .x = r.x + w, .y = r.y + h, .w = w, .h = h };
-                Qtree_node const& bottom_right_node = qt.nodes.at(n.idx + 3);
-                draw_node(csurf, qt, bottom_right_node, bottom_right_rect);
+    // `qtree --bench-grid [n]`: times full redraws of the grid layer for a
+    // tree of `n` points (spread like the app's), drawn as one tile on one
+    // thread (serial), and then in tiles on pools of 1, 2, 4, ... threads
+    // (up to the number of cores), and checks that each tiled layer matches
+    // the serial one
+    int bench_grid(size_t n) {
+        constexpr int w = 1024;
+        constexpr int h = 1024;
+        constexpr int tile_size = 64;
+        constexpr int num_redraws = 20;
+
+        std::default_random_engine engine{1337};
+        std::normal_distribution<double> x_dist{w/2.0, 128.0};
+        std::uniform_int_distribution<int> y_dist{0, h};
+        auto qtree = gp::LooseQuadtree{to_box({0, 0, w, h})};
+        for (size_t i = 0; i < n; ++i) {
+            Point2d p{std::clamp(static_cast<int>(x_dist(engine)), 0, w - 1), y_dist(engine)};
+            qtree.insert(to_vec2(p), static_cast<uint32_t>(i));
+        }
+
+        auto draw = [&qtree](cairo_t* cr, Rect const& tile) {
+            cairo_set_source_rgb(cr, 1, 1, 1);
+            cairo_paint(cr);
+            draw_qtree(cr, qtree, tile);
+        };
+        std::vector<Rect> const everything{{0, 0, w, h}};
+
+        // times `num_redraws` full redraws of `layer`, and returns the mean
+        auto time_redraws = [&](ui::Cairo_layer& layer, int tile, gp::WorkerPool& pool) {
+            layer.draw_tiled(tile, pool, everything, draw);  // (warm-up)
+            auto t0 = std::chrono::steady_clock::now();
+            for (int i = 0; i < num_redraws; ++i) {
+                layer.draw_tiled(tile, pool, everything, draw);
             }
-        } else {
-            // draw leafs
-
-            cairo_set_source_rgba(csurf, 0, 0, 0, 1.0);
-            unsigned num_leafs = n.n;
-            for (auto i = 0u; i < num_leafs; ++i) {
-                Sim_el const& el = qt.data.at(n.idx + i);
-                //cairo_move_to(csurf, el.pos.x, el.pos.y);
-                //cairo_arc(csurf, el.pos.x, el.pos.y, 1, 0, 2*M_PI);
+            return ms_since(t0) / num_redraws;
+        };
+
+        auto same_pixels = [](ui::Cairo_layer& a, ui::Cairo_layer& b) {
+            cairo_surface_flush(a);
+            cairo_surface_flush(b);
+            size_t size = static_cast<size_t>(cairo_image_surface_get_stride(a)) * static_cast<size_t>(cairo_image_surface_get_height(a));
+            return std::equal(cairo_image_surface_get_data(a), cairo_image_surface_get_data(a) + size, cairo_image_surface_get_data(b));
+        };
+
+        auto serial = ui::Cairo_layer{{w, h}};
+        double serial_ms;
+        {
+            auto pool = gp::WorkerPool{1};
+            serial_ms = time_redraws(serial, std::max(w, h), pool);
+        }
+        std::printf("grid  %dx%d  n = %7zu  nodes = %6zu  serial            = %8.2f ms\n", w, h, n, qtree.nodes().size(), serial_ms);
+
+        size_t num_cores = std::max(1u, std::thread::hardware_concurrency());
+        size_t num_mismatches = 0;
+        for (size_t num_threads = 1;; num_threads = std::min(2*num_threads, num_cores)) {
+            auto pool = gp::WorkerPool{num_threads};
+            auto tiled = ui::Cairo_layer{{w, h}};
+            double tiled_ms = time_redraws(tiled, tile_size, pool);
+            bool mismatch = !same_pixels(serial, tiled);
+            num_mismatches += mismatch;
+
+            std::printf("grid  %dx%d  n = %7zu  nodes = %6zu  tiled (%2zu thr)   = %8.2f ms  (%4.1fx)%s\n",
+                        w,
+                        h,
+                        n,
+                        qtree.nodes().size(),
+                        num_threads,
+                        tiled_ms,
+                        serial_ms / tiled_ms,
+                        mismatch ? "  MISMATCH" : "");
+
+            if (num_threads == num_cores) {
+                break;
             }
-            //cairo_stroke(csurf);
         }
-    }
 
-    void draw_qtree(ui::Cairo_surface& csurf, Qtree const& tree) {
-        draw_node(csurf, tree, tree.nodes.at(0), tree.rect);
+        return num_mismatches > 0 ? 1 : 0;
     }
 }
 
-int main() {
+int main(int argc, char** argv) {
+    if (argc > 1 && std::strcmp(argv[1], "--bench-grid") == 0) {
+        size_t n = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 10000;
+        return bench_grid(n);
+    }
+
     auto ctx = sdl::Init(SDL_INIT_VIDEO);
     auto window_dims = Dimensions2d{512, 512};
     auto window = sdl::CreateWindoww(
@@ -315,16 +547,18 @@ int main() {
             SDL_WINDOW_SHOWN | SDL_WINDOW_ALLOW_HIGHDPI);
     auto renderer = sdl::CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED);
     auto [w, h] = drawable_area(renderer);
-    auto csurf = ui::Cairo_surface{{w, h}};
+    auto csurf = ui::Cairo_surface{renderer, {w, h}};
     auto mousepos = Point2d{0, 0};
     auto device = std::random_device{};
     auto engine = std::default_random_engine{device()};
     auto x_dist = std::normal_distribution<double>{static_cast<double>(w)/2.0, 64.0};
     auto y_dist = std::uniform_int_distribution<int>{0, h};
+    auto vel_dist = std::uniform_real_distribution<float>{-0.5f, 0.5f};
 
     auto els = std::vector<Sim_el>(10000);
     for (Sim_el& e : els) {
-        e.pos = {static_cast<int>(x_dist(engine)) % w, y_dist(engine)};
+        e.pos = to_vec2({std::clamp(static_cast<int>(x_dist(engine)), 0, w - 1), y_dist(engine)});
+        e.vel = {vel_dist(engine), vel_dist(engine)};
     }
 
     cairo_font_options_t* ft = cairo_font_options_create();
@@ -334,56 +568,130 @@ int main() {
     cairo_select_font_face(csurf, "Source Code Pro for Powerline", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
     cairo_set_font_size(csurf, 24);
 
-    auto qtree = from_points({0, 0, w, h}, els);
-    auto drawing_rect = SDL_Rect{ .x = 0, .y = 0, .w = w, .h = h };
-    auto selection_area = Rect{ .x = 200, .y = 200, .w = 200, .h = 200 };
+    auto qtree = gp::LooseQuadtree{to_box({0, 0, w, h})};
+    auto handles = insert_all(qtree, els);
+    auto drawing_rect = SDL_Rect{0, 0, w, h};
+    auto selection_area = Rect{200, 200, 200, 200};
+    auto prev_selection_area = Rect{0, 0, 0, 0};
+    auto selected = std::vector<uint32_t>{};
     auto last_time = std::chrono::steady_clock::now();
     size_t frame_num = 0;
 
+    // the grid is cached in its own layer, which is composited under
+    // everything else. It's drawn in tiles, across every core: each tile
+    // only draws the nodes that overlap it
+    //
+    // each step, the tree's splits are diffed against the last step's, and
+    // only the tiles that they changed in are redrawn (and uploaded)
+    auto grid = ui::Cairo_layer{{w, h}};
+    auto grid_pool = gp::WorkerPool{std::thread::hardware_concurrency()};
+    constexpr int grid_tile_size = 64;
+    auto splits = std::vector<gp::Box<2>>{};
+    auto prev_splits = std::vector<gp::Box<2>>{};
+    collect_splits(qtree, splits);
+    auto grid_dirty = std::vector<Rect>{{0, 0, w, h}};
+
+    // space pauses the simulation: while it's paused, the loop sleeps until
+    // the next event, and then only redraws + uploads the counters (and the
+    // selection area, if the mouse moved). While it's running, the
+    // selection area and the grid tiles that changed are redrawn each frame
+    bool paused = false;
+
+    auto fps_label = ui::Text_label{{100, 100}, {}};
+    auto frame_label = ui::Text_label{{100, 150}, {}};
+    auto selected_label = ui::Text_label{{100, 200}, {}};
+
     for (;;) {
-        // clear
-        cairo_set_source_rgb(csurf, 1, 1, 1);
-        cairo_paint(csurf);
+        if (!paused) {
+            step(els, qtree, handles);
 
-        draw_qtree(csurf, qtree);
+            std::swap(splits, prev_splits);
+            collect_splits(qtree, splits);
+            diff_splits(prev_splits, splits, grid_dirty);
 
-        cairo_set_source_rgba(csurf, 1, 0, 0, 0.1);
-        cairo_rectangle(csurf, selection_area.x, selection_area.y, selection_area.w, selection_area.h);
-        cairo_fill(csurf);
-        cairo_stroke(csurf);
+            // the highlighted points (may) have moved
+            csurf.invalidate(padded(prev_selection_area, 2));
+        }
 
-        cairo_set_source_rgb(csurf, 1, 0, 0);
+        if (!grid_dirty.empty()) {
+            auto redrawn = grid.draw_tiled(grid_tile_size, grid_pool, grid_dirty, [&qtree](cairo_t* cr, Rect const& tile) {
+                cairo_set_source_rgb(cr, 1, 1, 1);
+                cairo_paint(cr);
+                draw_qtree(cr, qtree, tile);
+            });
+            for (Rect const& tile : redrawn) {
+                csurf.invalidate(tile);
+            }
+            grid_dirty.clear();
+        }
+
+        // the selection area follows the mouse: highlight the points in it
+        selection_area.x = mousepos.x - selection_area.w/2;
+        selection_area.y = mousepos.y - selection_area.h/2;
+        selected.clear();
+        qtree.queryRange(to_box(selection_area), selected);
+
+        if (!(selection_area == prev_selection_area)) {
+            // (padded for the highlighted points, which overhang it)
+            csurf.invalidate(padded(prev_selection_area, 2));
+            csurf.invalidate(padded(selection_area, 2));
+            prev_selection_area = selection_area;
+        }
 
-        // fps counter
+        // counters
         {
             auto t = std::chrono::steady_clock::now();
             auto dur = t - last_time;
             last_time = t;
             auto fps = std::chrono::seconds{1} / dur;
 
-            cairo_set_source_rgb(csurf, 0, 0, 0);
-            cairo_move_to(csurf, 100, 100);
-            cairo_show_text(csurf, std::to_string(fps).c_str());
+            fps_label.set(csurf, std::to_string(fps));
+            frame_label.set(csurf, std::to_string(frame_num));
+            selected_label.set(csurf, std::to_string(selected.size()));
+            ++frame_num;
         }
 
-        // frame number
-        {
+        // redraw the dirty parts of the frame
+        if (!csurf.dirty_rects().empty()) {
+            cairo_save(csurf);
+            csurf.clip_to_dirty();
+
+            cairo_set_source_surface(csurf, grid, 0, 0);
+            cairo_paint(csurf);
+
+            cairo_set_source_rgba(csurf, 1, 0, 0, 0.1);
+            cairo_rectangle(csurf, selection_area.x, selection_area.y, selection_area.w, selection_area.h);
+            cairo_fill(csurf);
+
+            cairo_set_source_rgb(csurf, 1, 0, 0);
+            for (uint32_t id : selected) {
+                glm::vec2 const& p = els[id].pos;
+                cairo_rectangle(csurf, p.x - 1, p.y - 1, 2, 2);
+            }
+            cairo_fill(csurf);
+            selected_label.draw(csurf);
+
             cairo_set_source_rgb(csurf, 0, 0, 0);
-            cairo_move_to(csurf, 100, 150);
-            cairo_show_text(csurf, std::to_string(frame_num).c_str());
-            ++frame_num;
+            fps_label.draw(csurf);
+            frame_label.draw(csurf);
+
+            cairo_restore(csurf);
         }
 
-        sdl::Texture t = csurf.texture(renderer);
-        SDL_RenderCopy(renderer, t, &drawing_rect, &drawing_rect);
+        sdl::RenderCopy(renderer, csurf.texture(), &drawing_rect, &drawing_rect);
         SDL_RenderPresent(renderer);
 
+        // (while paused, nothing changes until there's an event, so wait for
+        // one, rather than spinning)
         SDL_Event e;
-        while (SDL_PollEvent(&e) != 0) {
+        bool has_event = paused ? SDL_WaitEvent(&e) != 0 : SDL_PollEvent(&e) != 0;
+        for (; has_event; has_event = SDL_PollEvent(&e) != 0) {
             if (e.type == SDL_QUIT) {
                 return 0;
             } else if (e.type == SDL_MOUSEMOTION) {
                 mousepos = {e.motion.x, e.motion.y};
+            } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_SPACE) {
+                paused = !paused;
             }
         }
     }
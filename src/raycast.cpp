@@ -0,0 +1,755 @@
+#include "raycast.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <utility>
+
+#ifdef GP_SIMD_X86
+#include <immintrin.h>
+#endif
+
+static constexpr float g_Inf = std::numeric_limits<float>::infinity();
+
+gp::PrecomputedRay::PrecomputedRay(Line const& l) noexcept :
+    origin{l.o},
+    dir{l.d},
+    invDir{1.0f/l.d.x, 1.0f/l.d.y, 1.0f/l.d.z} {
+
+    // see Woop et al.: permute the dimensions so that the ray mostly points
+    // along `kz`, swapping `kx` and `ky` if it points along -`kz`, so that the
+    // triangles' winding is preserved
+    glm::vec3 absDir = glm::abs(dir);
+    kz = absDir.x > absDir.y ? (absDir.x > absDir.z ? 0 : 2) : (absDir.y > absDir.z ? 1 : 2);
+    kx = (kz + 1) % 3;
+    ky = (kx + 1) % 3;
+    if (dir[kz] < 0.0f) {
+        std::swap(kx, ky);
+    }
+
+    shear.x = dir[kx] / dir[kz];
+    shear.y = dir[ky] / dir[kz];
+    shear.z = 1.0f / dir[kz];
+}
+
+// merges per-lane closest hits into `best`
+//
+// ties are broken by index, so that every kernel returns the same hit
+static void reduceLanes(float const* ts, int32_t const* indices, size_t n, gp::RaycastHit& best) noexcept {
+    for (size_t lane = 0; lane < n; ++lane) {
+        if (indices[lane] < 0) {
+            continue;
+        }
+        if (ts[lane] < best.t || (ts[lane] == best.t && indices[lane] < best.index)) {
+            best.t = ts[lane];
+            best.index = indices[lane];
+        }
+    }
+}
+
+static void setHitBits(uint64_t* hitMask, size_t i, uint64_t bits) noexcept {
+    if (hitMask) {
+        hitMask[i / 64] |= bits << (i % 64);
+    }
+}
+
+static void raycastAABBsScalar(gp::PrecomputedRay const& r, gp::AABBArray const& a, size_t begin, size_t end, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+        float txA = (a.minX[i] - r.origin.x) * r.invDir.x;
+        float txB = (a.maxX[i] - r.origin.x) * r.invDir.x;
+        float tyA = (a.minY[i] - r.origin.y) * r.invDir.y;
+        float tyB = (a.maxY[i] - r.origin.y) * r.invDir.y;
+        float tzA = (a.minZ[i] - r.origin.z) * r.invDir.z;
+        float tzB = (a.maxZ[i] - r.origin.z) * r.invDir.z;
+
+        float t0 = std::max(std::max(std::min(txA, txB), std::min(tyA, tyB)), std::min(tzA, tzB));
+        float t1 = std::min(std::min(std::max(txA, txB), std::max(tyA, tyB)), std::max(tzA, tzB));
+        float tEnter = std::max(t0, 0.0f);
+        bool hit = tEnter <= t1;
+
+        setHitBits(hitMask, i, hit);
+        if (hit && tEnter < best.t) {
+            best.t = tEnter;
+            best.index = static_cast<int32_t>(i);
+        }
+    }
+}
+
+static void raycastSpheresScalar(gp::PrecomputedRay const& r, gp::SphereArray const& s, size_t begin, size_t end, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+        float ocx = s.x[i] - r.origin.x;
+        float ocy = s.y[i] - r.origin.y;
+        float ocz = s.z[i] - r.origin.z;
+
+        // distance along the ray to the point closest to the sphere's center
+        float tca = ocx*r.dir.x + ocy*r.dir.y + ocz*r.dir.z;
+
+        // squared distance from the center to that point
+        float d2 = ocx*ocx + ocy*ocy + ocz*ocz - tca*tca;
+        float disc = s.r[i]*s.r[i] - d2;
+
+        float thc = std::sqrt(std::max(disc, 0.0f));
+        float t1 = tca + thc;
+        float tEnter = std::max(tca - thc, 0.0f);
+        bool hit = disc >= 0.0f && t1 >= 0.0f;
+
+        setHitBits(hitMask, i, hit);
+        if (hit && tEnter < best.t) {
+            best.t = tEnter;
+            best.index = static_cast<int32_t>(i);
+        }
+    }
+}
+
+#ifdef GP_SIMD_X86
+
+// SSE (4-wide)
+//
+// only uses SSE2, so that it doesn't need a target attribute. Selects are
+// done with and/andnot/or, rather than SSE4.1's blendv
+
+static inline __m128 select4(__m128 mask, __m128 a, __m128 b) noexcept {
+    return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+static size_t raycastAABBsSSE(gp::PrecomputedRay const& r, gp::AABBArray const& a, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    size_t n = a.size();
+    __m128 ox = _mm_set1_ps(r.origin.x);
+    __m128 oy = _mm_set1_ps(r.origin.y);
+    __m128 oz = _mm_set1_ps(r.origin.z);
+    __m128 idx = _mm_set1_ps(r.invDir.x);
+    __m128 idy = _mm_set1_ps(r.invDir.y);
+    __m128 idz = _mm_set1_ps(r.invDir.z);
+    __m128 zero = _mm_setzero_ps();
+    __m128 inf = _mm_set1_ps(g_Inf);
+
+    __m128 bestT = inf;
+    __m128i bestIdx = _mm_set1_epi32(-1);
+    __m128i laneIdx = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i step = _mm_set1_epi32(4);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 txA = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&a.minX[i]), ox), idx);
+        __m128 txB = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&a.maxX[i]), ox), idx);
+        __m128 tyA = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&a.minY[i]), oy), idy);
+        __m128 tyB = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&a.maxY[i]), oy), idy);
+        __m128 tzA = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&a.minZ[i]), oz), idz);
+        __m128 tzB = _mm_mul_ps(_mm_sub_ps(_mm_loadu_ps(&a.maxZ[i]), oz), idz);
+
+        __m128 t0 = _mm_max_ps(_mm_max_ps(_mm_min_ps(txA, txB), _mm_min_ps(tyA, tyB)), _mm_min_ps(tzA, tzB));
+        __m128 t1 = _mm_min_ps(_mm_min_ps(_mm_max_ps(txA, txB), _mm_max_ps(tyA, tyB)), _mm_max_ps(tzA, tzB));
+        __m128 tEnter = _mm_max_ps(t0, zero);
+        __m128 hit = _mm_cmple_ps(tEnter, t1);
+
+        setHitBits(hitMask, i, static_cast<uint64_t>(_mm_movemask_ps(hit)));
+
+        __m128 closer = _mm_and_ps(hit, _mm_cmplt_ps(tEnter, bestT));
+        bestT = select4(closer, tEnter, bestT);
+        bestIdx = _mm_castps_si128(select4(closer, _mm_castsi128_ps(laneIdx), _mm_castsi128_ps(bestIdx)));
+        laneIdx = _mm_add_epi32(laneIdx, step);
+    }
+
+    alignas(16) float ts[4];
+    alignas(16) int32_t indices[4];
+    _mm_store_ps(ts, bestT);
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices), bestIdx);
+    reduceLanes(ts, indices, 4, best);
+
+    return i;
+}
+
+static size_t raycastSpheresSSE(gp::PrecomputedRay const& r, gp::SphereArray const& s, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    size_t n = s.size();
+    __m128 ox = _mm_set1_ps(r.origin.x);
+    __m128 oy = _mm_set1_ps(r.origin.y);
+    __m128 oz = _mm_set1_ps(r.origin.z);
+    __m128 dx = _mm_set1_ps(r.dir.x);
+    __m128 dy = _mm_set1_ps(r.dir.y);
+    __m128 dz = _mm_set1_ps(r.dir.z);
+    __m128 zero = _mm_setzero_ps();
+    __m128 inf = _mm_set1_ps(g_Inf);
+
+    __m128 bestT = inf;
+    __m128i bestIdx = _mm_set1_epi32(-1);
+    __m128i laneIdx = _mm_setr_epi32(0, 1, 2, 3);
+    __m128i step = _mm_set1_epi32(4);
+
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128 ocx = _mm_sub_ps(_mm_loadu_ps(&s.x[i]), ox);
+        __m128 ocy = _mm_sub_ps(_mm_loadu_ps(&s.y[i]), oy);
+        __m128 ocz = _mm_sub_ps(_mm_loadu_ps(&s.z[i]), oz);
+        __m128 rad = _mm_loadu_ps(&s.r[i]);
+
+        __m128 tca = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, dx), _mm_mul_ps(ocy, dy)), _mm_mul_ps(ocz, dz));
+        __m128 oc2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ocx, ocx), _mm_mul_ps(ocy, ocy)), _mm_mul_ps(ocz, ocz));
+        __m128 disc = _mm_sub_ps(_mm_mul_ps(rad, rad), _mm_sub_ps(oc2, _mm_mul_ps(tca, tca)));
+
+        __m128 thc = _mm_sqrt_ps(_mm_max_ps(disc, zero));
+        __m128 t1 = _mm_add_ps(tca, thc);
+        __m128 tEnter = _mm_max_ps(_mm_sub_ps(tca, thc), zero);
+        __m128 hit = _mm_and_ps(_mm_cmpge_ps(disc, zero), _mm_cmpge_ps(t1, zero));
+
+        setHitBits(hitMask, i, static_cast<uint64_t>(_mm_movemask_ps(hit)));
+
+        __m128 closer = _mm_and_ps(hit, _mm_cmplt_ps(tEnter, bestT));
+        bestT = select4(closer, tEnter, bestT);
+        bestIdx = _mm_castps_si128(select4(closer, _mm_castsi128_ps(laneIdx), _mm_castsi128_ps(bestIdx)));
+        laneIdx = _mm_add_epi32(laneIdx, step);
+    }
+
+    alignas(16) float ts[4];
+    alignas(16) int32_t indices[4];
+    _mm_store_ps(ts, bestT);
+    _mm_store_si128(reinterpret_cast<__m128i*>(indices), bestIdx);
+    reduceLanes(ts, indices, 4, best);
+
+    return i;
+}
+
+// AVX (8-wide)
+//
+// AVX1 has no 256-bit integer adds, so lane indices are stepped as two
+// 128-bit halves. Selects are done with and/andnot/or because GCC can lower
+// a `_mm256_blendv_ps` that it can see the mask of into per-lane branches
+
+GP_TARGET_AVX static inline __m256 select8(__m256 mask, __m256 a, __m256 b) noexcept {
+    return _mm256_or_ps(_mm256_and_ps(mask, a), _mm256_andnot_ps(mask, b));
+}
+
+GP_TARGET_AVX static inline __m256i stepIndices8(__m256i v, __m128i step) noexcept {
+    __m128i lo = _mm_add_epi32(_mm256_castsi256_si128(v), step);
+    __m128i hi = _mm_add_epi32(_mm256_extractf128_si256(v, 1), step);
+    return _mm256_insertf128_si256(_mm256_castsi128_si256(lo), hi, 1);
+}
+
+GP_TARGET_AVX static size_t raycastAABBsAVX(gp::PrecomputedRay const& r, gp::AABBArray const& a, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    size_t n = a.size();
+    __m256 ox = _mm256_set1_ps(r.origin.x);
+    __m256 oy = _mm256_set1_ps(r.origin.y);
+    __m256 oz = _mm256_set1_ps(r.origin.z);
+    __m256 idx = _mm256_set1_ps(r.invDir.x);
+    __m256 idy = _mm256_set1_ps(r.invDir.y);
+    __m256 idz = _mm256_set1_ps(r.invDir.z);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 bestT = _mm256_set1_ps(g_Inf);
+    __m256i bestIdx = _mm256_set1_epi32(-1);
+    __m256i laneIdx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m128i step = _mm_set1_epi32(8);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 txA = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&a.minX[i]), ox), idx);
+        __m256 txB = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&a.maxX[i]), ox), idx);
+        __m256 tyA = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&a.minY[i]), oy), idy);
+        __m256 tyB = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&a.maxY[i]), oy), idy);
+        __m256 tzA = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&a.minZ[i]), oz), idz);
+        __m256 tzB = _mm256_mul_ps(_mm256_sub_ps(_mm256_loadu_ps(&a.maxZ[i]), oz), idz);
+
+        __m256 t0 = _mm256_max_ps(_mm256_max_ps(_mm256_min_ps(txA, txB), _mm256_min_ps(tyA, tyB)), _mm256_min_ps(tzA, tzB));
+        __m256 t1 = _mm256_min_ps(_mm256_min_ps(_mm256_max_ps(txA, txB), _mm256_max_ps(tyA, tyB)), _mm256_max_ps(tzA, tzB));
+        __m256 tEnter = _mm256_max_ps(t0, zero);
+        __m256 hit = _mm256_cmp_ps(tEnter, t1, _CMP_LE_OQ);
+
+        setHitBits(hitMask, i, static_cast<uint64_t>(_mm256_movemask_ps(hit)));
+
+        __m256 closer = _mm256_and_ps(hit, _mm256_cmp_ps(tEnter, bestT, _CMP_LT_OQ));
+        bestT = select8(closer, tEnter, bestT);
+        bestIdx = _mm256_castps_si256(select8(closer, _mm256_castsi256_ps(laneIdx), _mm256_castsi256_ps(bestIdx)));
+        laneIdx = stepIndices8(laneIdx, step);
+    }
+
+    alignas(32) float ts[8];
+    alignas(32) int32_t indices[8];
+    _mm256_store_ps(ts, bestT);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(indices), bestIdx);
+    reduceLanes(ts, indices, 8, best);
+
+    return i;
+}
+
+GP_TARGET_AVX static size_t raycastSpheresAVX(gp::PrecomputedRay const& r, gp::SphereArray const& s, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    size_t n = s.size();
+    __m256 ox = _mm256_set1_ps(r.origin.x);
+    __m256 oy = _mm256_set1_ps(r.origin.y);
+    __m256 oz = _mm256_set1_ps(r.origin.z);
+    __m256 dx = _mm256_set1_ps(r.dir.x);
+    __m256 dy = _mm256_set1_ps(r.dir.y);
+    __m256 dz = _mm256_set1_ps(r.dir.z);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 bestT = _mm256_set1_ps(g_Inf);
+    __m256i bestIdx = _mm256_set1_epi32(-1);
+    __m256i laneIdx = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m128i step = _mm_set1_epi32(8);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        __m256 ocx = _mm256_sub_ps(_mm256_loadu_ps(&s.x[i]), ox);
+        __m256 ocy = _mm256_sub_ps(_mm256_loadu_ps(&s.y[i]), oy);
+        __m256 ocz = _mm256_sub_ps(_mm256_loadu_ps(&s.z[i]), oz);
+        __m256 rad = _mm256_loadu_ps(&s.r[i]);
+
+        __m256 tca = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, dx), _mm256_mul_ps(ocy, dy)), _mm256_mul_ps(ocz, dz));
+        __m256 oc2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(ocx, ocx), _mm256_mul_ps(ocy, ocy)), _mm256_mul_ps(ocz, ocz));
+        __m256 disc = _mm256_sub_ps(_mm256_mul_ps(rad, rad), _mm256_sub_ps(oc2, _mm256_mul_ps(tca, tca)));
+
+        __m256 thc = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+        __m256 t1 = _mm256_add_ps(tca, thc);
+        __m256 tEnter = _mm256_max_ps(_mm256_sub_ps(tca, thc), zero);
+        __m256 hit = _mm256_and_ps(_mm256_cmp_ps(disc, zero, _CMP_GE_OQ), _mm256_cmp_ps(t1, zero, _CMP_GE_OQ));
+
+        setHitBits(hitMask, i, static_cast<uint64_t>(_mm256_movemask_ps(hit)));
+
+        __m256 closer = _mm256_and_ps(hit, _mm256_cmp_ps(tEnter, bestT, _CMP_LT_OQ));
+        bestT = select8(closer, tEnter, bestT);
+        bestIdx = _mm256_castps_si256(select8(closer, _mm256_castsi256_ps(laneIdx), _mm256_castsi256_ps(bestIdx)));
+        laneIdx = stepIndices8(laneIdx, step);
+    }
+
+    alignas(32) float ts[8];
+    alignas(32) int32_t indices[8];
+    _mm256_store_ps(ts, bestT);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(indices), bestIdx);
+    reduceLanes(ts, indices, 8, best);
+
+    return i;
+}
+
+// AVX-512 (16-wide)
+//
+// GCC 12's unmasked `_mm512_min_ps`/`_mm512_max_ps`/`_mm512_sqrt_ps` pass
+// `_mm512_undefined_ps()` as the (unused) merge source, which trips
+// -Wmaybe-uninitialized at -O2. The masked forms below take an explicit
+// source, and their all-ones mask means it's never merged
+
+GP_TARGET_AVX512 static inline __m512 min16(__m512 a, __m512 b) noexcept {
+    return _mm512_mask_min_ps(_mm512_setzero_ps(), 0xffff, a, b);
+}
+
+GP_TARGET_AVX512 static inline __m512 max16(__m512 a, __m512 b) noexcept {
+    return _mm512_mask_max_ps(_mm512_setzero_ps(), 0xffff, a, b);
+}
+
+GP_TARGET_AVX512 static inline __m512 sqrt16(__m512 a) noexcept {
+    return _mm512_mask_sqrt_ps(_mm512_setzero_ps(), 0xffff, a);
+}
+
+GP_TARGET_AVX512 static size_t raycastAABBsAVX512(gp::PrecomputedRay const& r, gp::AABBArray const& a, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    size_t n = a.size();
+    __m512 ox = _mm512_set1_ps(r.origin.x);
+    __m512 oy = _mm512_set1_ps(r.origin.y);
+    __m512 oz = _mm512_set1_ps(r.origin.z);
+    __m512 idx = _mm512_set1_ps(r.invDir.x);
+    __m512 idy = _mm512_set1_ps(r.invDir.y);
+    __m512 idz = _mm512_set1_ps(r.invDir.z);
+    __m512 zero = _mm512_setzero_ps();
+
+    __m512 bestT = _mm512_set1_ps(g_Inf);
+    __m512i bestIdx = _mm512_set1_epi32(-1);
+    __m512i laneIdx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i step = _mm512_set1_epi32(16);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 txA = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&a.minX[i]), ox), idx);
+        __m512 txB = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&a.maxX[i]), ox), idx);
+        __m512 tyA = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&a.minY[i]), oy), idy);
+        __m512 tyB = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&a.maxY[i]), oy), idy);
+        __m512 tzA = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&a.minZ[i]), oz), idz);
+        __m512 tzB = _mm512_mul_ps(_mm512_sub_ps(_mm512_loadu_ps(&a.maxZ[i]), oz), idz);
+
+        __m512 t0 = max16(max16(min16(txA, txB), min16(tyA, tyB)), min16(tzA, tzB));
+        __m512 t1 = min16(min16(max16(txA, txB), max16(tyA, tyB)), max16(tzA, tzB));
+        __m512 tEnter = max16(t0, zero);
+        __mmask16 hit = _mm512_cmp_ps_mask(tEnter, t1, _CMP_LE_OQ);
+
+        setHitBits(hitMask, i, static_cast<uint64_t>(hit));
+
+        __mmask16 closer = _mm512_mask_cmp_ps_mask(hit, tEnter, bestT, _CMP_LT_OQ);
+        bestT = _mm512_mask_blend_ps(closer, bestT, tEnter);
+        bestIdx = _mm512_mask_blend_epi32(closer, bestIdx, laneIdx);
+        laneIdx = _mm512_add_epi32(laneIdx, step);
+    }
+
+    alignas(64) float ts[16];
+    alignas(64) int32_t indices[16];
+    _mm512_store_ps(ts, bestT);
+    _mm512_store_si512(indices, bestIdx);
+    reduceLanes(ts, indices, 16, best);
+
+    return i;
+}
+
+GP_TARGET_AVX512 static size_t raycastSpheresAVX512(gp::PrecomputedRay const& r, gp::SphereArray const& s, uint64_t* hitMask, gp::RaycastHit& best) noexcept {
+    size_t n = s.size();
+    __m512 ox = _mm512_set1_ps(r.origin.x);
+    __m512 oy = _mm512_set1_ps(r.origin.y);
+    __m512 oz = _mm512_set1_ps(r.origin.z);
+    __m512 dx = _mm512_set1_ps(r.dir.x);
+    __m512 dy = _mm512_set1_ps(r.dir.y);
+    __m512 dz = _mm512_set1_ps(r.dir.z);
+    __m512 zero = _mm512_setzero_ps();
+
+    __m512 bestT = _mm512_set1_ps(g_Inf);
+    __m512i bestIdx = _mm512_set1_epi32(-1);
+    __m512i laneIdx = _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    __m512i step = _mm512_set1_epi32(16);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m512 ocx = _mm512_sub_ps(_mm512_loadu_ps(&s.x[i]), ox);
+        __m512 ocy = _mm512_sub_ps(_mm512_loadu_ps(&s.y[i]), oy);
+        __m512 ocz = _mm512_sub_ps(_mm512_loadu_ps(&s.z[i]), oz);
+        __m512 rad = _mm512_loadu_ps(&s.r[i]);
+
+        __m512 tca = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, dx), _mm512_mul_ps(ocy, dy)), _mm512_mul_ps(ocz, dz));
+        __m512 oc2 = _mm512_add_ps(_mm512_add_ps(_mm512_mul_ps(ocx, ocx), _mm512_mul_ps(ocy, ocy)), _mm512_mul_ps(ocz, ocz));
+        __m512 disc = _mm512_sub_ps(_mm512_mul_ps(rad, rad), _mm512_sub_ps(oc2, _mm512_mul_ps(tca, tca)));
+
+        __m512 thc = sqrt16(max16(disc, zero));
+        __m512 t1 = _mm512_add_ps(tca, thc);
+        __m512 tEnter = max16(_mm512_sub_ps(tca, thc), zero);
+        __mmask16 hit = _mm512_cmp_ps_mask(disc, zero, _CMP_GE_OQ) & _mm512_cmp_ps_mask(t1, zero, _CMP_GE_OQ);
+
+        setHitBits(hitMask, i, static_cast<uint64_t>(hit));
+
+        __mmask16 closer = _mm512_mask_cmp_ps_mask(hit, tEnter, bestT, _CMP_LT_OQ);
+        bestT = _mm512_mask_blend_ps(closer, bestT, tEnter);
+        bestIdx = _mm512_mask_blend_epi32(closer, bestIdx, laneIdx);
+        laneIdx = _mm512_add_epi32(laneIdx, step);
+    }
+
+    alignas(64) float ts[16];
+    alignas(64) int32_t indices[16];
+    _mm512_store_ps(ts, bestT);
+    _mm512_store_si512(indices, bestIdx);
+    reduceLanes(ts, indices, 16, best);
+
+    return i;
+}
+#endif
+
+gp::RaycastHit gp::raycastAABBs(PrecomputedRay const& r, AABBArray const& aabbs, uint64_t* hitMask, SimdLevel level) noexcept {
+    if (hitMask) {
+        std::fill(hitMask, hitMask + hitMaskSize(aabbs.size()), uint64_t{0});
+    }
+
+    RaycastHit rv;
+    size_t done = 0;
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX512) {
+        done = raycastAABBsAVX512(r, aabbs, hitMask, rv);
+    } else if (level >= SimdLevel::AVX) {
+        done = raycastAABBsAVX(r, aabbs, hitMask, rv);
+    } else if (level >= SimdLevel::SSE) {
+        done = raycastAABBsSSE(r, aabbs, hitMask, rv);
+    }
+#endif
+    raycastAABBsScalar(r, aabbs, done, aabbs.size(), hitMask, rv);
+
+    return rv;
+}
+
+gp::RaycastHit gp::raycastSpheres(PrecomputedRay const& r, SphereArray const& spheres, uint64_t* hitMask, SimdLevel level) noexcept {
+    if (hitMask) {
+        std::fill(hitMask, hitMask + hitMaskSize(spheres.size()), uint64_t{0});
+    }
+
+    RaycastHit rv;
+    size_t done = 0;
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX512) {
+        done = raycastSpheresAVX512(r, spheres, hitMask, rv);
+    } else if (level >= SimdLevel::AVX) {
+        done = raycastSpheresAVX(r, spheres, hitMask, rv);
+    } else if (level >= SimdLevel::SSE) {
+        done = raycastSpheresSSE(r, spheres, hitMask, rv);
+    }
+#endif
+    raycastSpheresScalar(r, spheres, done, spheres.size(), hitMask, rv);
+
+    return rv;
+}
+
+// triangles
+
+namespace {
+    // pointers to the components of some triangles, permuted into the ray's
+    // (kx, ky, kz) order: `p[vert][k]`
+    struct PermutedTriangles final {
+        float const* p[3][3];
+    };
+
+    PermutedTriangles permuted(gp::PrecomputedRay const& r, gp::TriangleArray const& tris) noexcept {
+        PermutedTriangles rv;
+        std::array<std::vector<float>, 3> const* verts[3] = {&tris.v0, &tris.v1, &tris.v2};
+        for (int vert = 0; vert < 3; ++vert) {
+            rv.p[vert][0] = (*verts[vert])[r.kx].data();
+            rv.p[vert][1] = (*verts[vert])[r.ky].data();
+            rv.p[vert][2] = (*verts[vert])[r.kz].data();
+        }
+        return rv;
+    }
+}
+
+// the scalar watertight test against triangle `i` of `tris`
+//
+// the SIMD kernels do exactly the same arithmetic (no FMAs, no reciprocal
+// approximations), so that they produce exactly the same hits
+static gp::RayTriangleHittestResult intersectPermuted(gp::PrecomputedRay const& r, PermutedTriangles const& tris, size_t i) noexcept {
+    float ox = r.origin[r.kx];
+    float oy = r.origin[r.ky];
+    float oz = r.origin[r.kz];
+
+    // vertices relative to the ray origin
+    float az = tris.p[0][2][i] - oz;
+    float bz = tris.p[1][2][i] - oz;
+    float cz = tris.p[2][2][i] - oz;
+
+    // ... sheared, so that the ray points along +Z
+    float ax = (tris.p[0][0][i] - ox) - r.shear.x*az;
+    float ay = (tris.p[0][1][i] - oy) - r.shear.y*az;
+    float bx = (tris.p[1][0][i] - ox) - r.shear.x*bz;
+    float by = (tris.p[1][1][i] - oy) - r.shear.y*bz;
+    float cx = (tris.p[2][0][i] - ox) - r.shear.x*cz;
+    float cy = (tris.p[2][1][i] - oy) - r.shear.y*cz;
+
+    // scaled barycentrics: 2D edge functions, so that neighbouring triangles
+    // compute an identical value for a shared edge
+    float U = cx*by - cy*bx;
+    float V = ax*cy - ay*cx;
+    float W = bx*ay - by*ax;
+
+    bool inside = (U >= 0.0f && V >= 0.0f && W >= 0.0f) || (U <= 0.0f && V <= 0.0f && W <= 0.0f);
+    float det = U + V + W;
+
+    float T = U*(r.shear.z*az) + V*(r.shear.z*bz) + W*(r.shear.z*cz);
+    float t = T / det;
+
+    gp::RayTriangleHittestResult rv;
+    rv.intersected = inside && det != 0.0f && t >= 0.0f;
+    rv.t = t;
+    rv.u = V / det;
+    rv.v = W / det;
+    return rv;
+}
+
+gp::RayTriangleHittestResult gp::rayIntersectsTriangle(PrecomputedRay const& r, glm::vec3 const* tri) noexcept {
+    PermutedTriangles p;
+    for (int vert = 0; vert < 3; ++vert) {
+        p.p[vert][0] = &tri[vert][r.kx];
+        p.p[vert][1] = &tri[vert][r.ky];
+        p.p[vert][2] = &tri[vert][r.kz];
+    }
+    return intersectPermuted(r, p, 0);
+}
+
+static void raycastTrianglesScalar(gp::PrecomputedRay const& r, PermutedTriangles const& tris, size_t begin, size_t end, gp::TriangleRaycastHit& best) noexcept {
+    for (size_t i = begin; i < end; ++i) {
+        gp::RayTriangleHittestResult res = intersectPermuted(r, tris, i);
+        if (res.intersected && res.t < best.t) {
+            best.index = static_cast<int32_t>(i);
+            best.t = res.t;
+            best.u = res.u;
+            best.v = res.v;
+        }
+    }
+}
+
+#ifdef GP_SIMD_X86
+namespace {
+    // per-lane closest hits of an 8-wide triangle kernel
+    struct TriangleLanes8 final {
+        __m256 t;
+        __m256 u;
+        __m256 v;
+        __m256i index;
+    };
+}
+
+GP_TARGET_AVX static inline void initLanes8(TriangleLanes8& lanes) noexcept {
+    lanes.t = _mm256_set1_ps(g_Inf);
+    lanes.u = _mm256_setzero_ps();
+    lanes.v = _mm256_setzero_ps();
+    lanes.index = _mm256_set1_epi32(-1);
+}
+
+// tests triangles [i, i+8) of `tris` (with IDs `ids`) and merges any closer
+// hits into `lanes`
+GP_TARGET_AVX static inline void intersect8(gp::PrecomputedRay const& r, PermutedTriangles const& tris, size_t i, __m256i ids, TriangleLanes8& lanes) noexcept {
+    __m256 ox = _mm256_set1_ps(r.origin[r.kx]);
+    __m256 oy = _mm256_set1_ps(r.origin[r.ky]);
+    __m256 oz = _mm256_set1_ps(r.origin[r.kz]);
+    __m256 sx = _mm256_set1_ps(r.shear.x);
+    __m256 sy = _mm256_set1_ps(r.shear.y);
+    __m256 sz = _mm256_set1_ps(r.shear.z);
+    __m256 zero = _mm256_setzero_ps();
+
+    __m256 az = _mm256_sub_ps(_mm256_loadu_ps(tris.p[0][2] + i), oz);
+    __m256 bz = _mm256_sub_ps(_mm256_loadu_ps(tris.p[1][2] + i), oz);
+    __m256 cz = _mm256_sub_ps(_mm256_loadu_ps(tris.p[2][2] + i), oz);
+
+    __m256 ax = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(tris.p[0][0] + i), ox), _mm256_mul_ps(sx, az));
+    __m256 ay = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(tris.p[0][1] + i), oy), _mm256_mul_ps(sy, az));
+    __m256 bx = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(tris.p[1][0] + i), ox), _mm256_mul_ps(sx, bz));
+    __m256 by = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(tris.p[1][1] + i), oy), _mm256_mul_ps(sy, bz));
+    __m256 cx = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(tris.p[2][0] + i), ox), _mm256_mul_ps(sx, cz));
+    __m256 cy = _mm256_sub_ps(_mm256_sub_ps(_mm256_loadu_ps(tris.p[2][1] + i), oy), _mm256_mul_ps(sy, cz));
+
+    __m256 U = _mm256_sub_ps(_mm256_mul_ps(cx, by), _mm256_mul_ps(cy, bx));
+    __m256 V = _mm256_sub_ps(_mm256_mul_ps(ax, cy), _mm256_mul_ps(ay, cx));
+    __m256 W = _mm256_sub_ps(_mm256_mul_ps(bx, ay), _mm256_mul_ps(by, ax));
+
+    __m256 allPos = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(U, zero, _CMP_GE_OQ), _mm256_cmp_ps(V, zero, _CMP_GE_OQ)), _mm256_cmp_ps(W, zero, _CMP_GE_OQ));
+    __m256 allNeg = _mm256_and_ps(_mm256_and_ps(_mm256_cmp_ps(U, zero, _CMP_LE_OQ), _mm256_cmp_ps(V, zero, _CMP_LE_OQ)), _mm256_cmp_ps(W, zero, _CMP_LE_OQ));
+    __m256 det = _mm256_add_ps(_mm256_add_ps(U, V), W);
+
+    __m256 T = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(U, _mm256_mul_ps(sz, az)), _mm256_mul_ps(V, _mm256_mul_ps(sz, bz))), _mm256_mul_ps(W, _mm256_mul_ps(sz, cz)));
+    __m256 t = _mm256_div_ps(T, det);
+
+    __m256 hit = _mm256_and_ps(_mm256_or_ps(allPos, allNeg), _mm256_cmp_ps(det, zero, _CMP_NEQ_OQ));
+    hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GE_OQ));
+
+    __m256 closer = _mm256_and_ps(hit, _mm256_cmp_ps(t, lanes.t, _CMP_LT_OQ));
+    if (_mm256_movemask_ps(closer)) {
+        lanes.t = select8(closer, t, lanes.t);
+        lanes.u = select8(closer, _mm256_div_ps(V, det), lanes.u);
+        lanes.v = select8(closer, _mm256_div_ps(W, det), lanes.v);
+        lanes.index = _mm256_castps_si256(select8(closer, _mm256_castsi256_ps(ids), _mm256_castsi256_ps(lanes.index)));
+    }
+}
+
+GP_TARGET_AVX static void reduceLanes8(TriangleLanes8 const& lanes, gp::TriangleRaycastHit& best) noexcept {
+    alignas(32) float ts[8];
+    alignas(32) float us[8];
+    alignas(32) float vs[8];
+    alignas(32) int32_t indices[8];
+    _mm256_store_ps(ts, lanes.t);
+    _mm256_store_ps(us, lanes.u);
+    _mm256_store_ps(vs, lanes.v);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(indices), lanes.index);
+
+    for (size_t lane = 0; lane < 8; ++lane) {
+        if (indices[lane] < 0) {
+            continue;
+        }
+        if (ts[lane] < best.t || (ts[lane] == best.t && indices[lane] < best.index)) {
+            best.index = indices[lane];
+            best.t = ts[lane];
+            best.u = us[lane];
+            best.v = vs[lane];
+        }
+    }
+}
+
+GP_TARGET_AVX static size_t raycastTrianglesAVX(gp::PrecomputedRay const& r, PermutedTriangles const& tris, size_t n, gp::TriangleRaycastHit& best) noexcept {
+    TriangleLanes8 lanes;
+    initLanes8(lanes);
+
+    __m256i ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m128i step = _mm_set1_epi32(8);
+
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        intersect8(r, tris, i, ids, lanes);
+        ids = stepIndices8(ids, step);
+    }
+
+    reduceLanes8(lanes, best);
+    return i;
+}
+
+// gathers 8 indexed triangles into SoA scratch space, so that they can go
+// through the same kernel as `TriangleArray`s
+GP_TARGET_AVX static size_t raycastIndexedTrianglesAVX(gp::PrecomputedRay const& r,
+                                                       char const* positions,
+                                                       size_t stride,
+                                                       uint32_t const* indices,
+                                                       size_t numTriangles,
+                                                       gp::TriangleRaycastHit& best) noexcept {
+    // [vert][dim][lane]
+    alignas(32) float scratch[3][3][8];
+    PermutedTriangles tris;
+    for (int vert = 0; vert < 3; ++vert) {
+        tris.p[vert][0] = scratch[vert][r.kx];
+        tris.p[vert][1] = scratch[vert][r.ky];
+        tris.p[vert][2] = scratch[vert][r.kz];
+    }
+
+    TriangleLanes8 lanes;
+    initLanes8(lanes);
+
+    __m256i ids = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+    __m128i step = _mm_set1_epi32(8);
+
+    size_t tri = 0;
+    for (; tri + 8 <= numTriangles; tri += 8) {
+        for (size_t lane = 0; lane < 8; ++lane) {
+            for (int vert = 0; vert < 3; ++vert) {
+                glm::vec3 const& pos = *reinterpret_cast<glm::vec3 const*>(positions + stride*indices[3*(tri+lane) + vert]);
+                scratch[vert][0][lane] = pos.x;
+                scratch[vert][1][lane] = pos.y;
+                scratch[vert][2][lane] = pos.z;
+            }
+        }
+
+        intersect8(r, tris, 0, ids, lanes);
+        ids = stepIndices8(ids, step);
+    }
+
+    reduceLanes8(lanes, best);
+    return tri;
+}
+#endif
+
+gp::TriangleRaycastHit gp::raycastTriangles(PrecomputedRay const& r, TriangleArray const& tris, SimdLevel level) noexcept {
+    PermutedTriangles p = permuted(r, tris);
+
+    TriangleRaycastHit rv;
+    size_t done = 0;
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX) {
+        done = raycastTrianglesAVX(r, p, tris.size(), rv);
+    }
+#endif
+    raycastTrianglesScalar(r, p, done, tris.size(), rv);
+
+    return rv;
+}
+
+gp::TriangleRaycastHit gp::raycastIndexedTriangles(PrecomputedRay const& r,
+                                                   glm::vec3 const* positions,
+                                                   size_t stride,
+                                                   uint32_t const* indices,
+                                                   size_t numIndices,
+                                                   SimdLevel level) noexcept {
+    char const* bytes = reinterpret_cast<char const*>(positions);
+    size_t numTriangles = numIndices / 3;
+
+    TriangleRaycastHit rv;
+    size_t done = 0;
+#ifdef GP_SIMD_X86
+    if (level >= SimdLevel::AVX) {
+        done = raycastIndexedTrianglesAVX(r, bytes, stride, indices, numTriangles, rv);
+    }
+#endif
+    for (size_t tri = done; tri < numTriangles; ++tri) {
+        glm::vec3 verts[3];
+        for (int vert = 0; vert < 3; ++vert) {
+            verts[vert] = *reinterpret_cast<glm::vec3 const*>(bytes + stride*indices[3*tri + vert]);
+        }
+
+        RayTriangleHittestResult res = rayIntersectsTriangle(r, verts);
+        if (res.intersected && res.t < rv.t) {
+            rv.index = static_cast<int32_t>(tri);
+            rv.t = res.t;
+            rv.u = res.u;
+            rv.v = res.v;
+        }
+    }
+
+    return rv;
+}
@@ -0,0 +1,164 @@
+#pragma once
+
+#include "app.hpp"
+#include "simd.hpp"
+#include "soa.hpp"
+
+#include <cfloat>
+#include <cstddef>
+#include <cstdint>
+
+// batched raycasting support
+//
+// casts one ray against many primitives (stored as SoA) at once. Unlike
+// `lineIntersectsAABB` etc., the ray's reciprocal direction is computed once
+// per ray (`PrecomputedRay`), and the kernels are branchless, so that they
+// can test 4 (SSE), 8 (AVX), or 16 (AVX-512) primitives per instruction
+//
+// triangles are tested with a watertight algorithm, so that picking against
+// a closed mesh can't slip through the cracks between its triangles
+namespace gp {
+
+    // a ray (`Line`), plus data that's precomputed once so that it can be
+    // tested against many primitives
+    struct PrecomputedRay final {
+        glm::vec3 origin;
+
+        // should be normalized
+        glm::vec3 dir;
+
+        // 1/dir: +-inf for axis-aligned rays, which the slab tests handle
+        glm::vec3 invDir;
+
+        // for the (watertight) triangle tests, triangles are transformed into
+        // a space where the ray starts at the origin and points along +Z. `kz`
+        // is the dimension the ray mostly points along, `kx` and `ky` are the
+        // other two, and `shear` is the shear that maps the ray onto +Z
+        int kx;
+        int ky;
+        int kz;
+        glm::vec3 shear;
+
+        PrecomputedRay() = default;
+        explicit PrecomputedRay(Line const&) noexcept;
+    };
+
+    // the closest primitive hit by a ray
+    struct RaycastHit final {
+        // index of the primitive, or -1 if nothing was hit
+        int32_t index = -1;
+
+        // distance along the ray, `P = O + tD`
+        float t = FLT_MAX;
+
+        [[nodiscard]] bool hit() const noexcept {
+            return index >= 0;
+        }
+    };
+
+    // the closest triangle hit by a ray
+    struct TriangleRaycastHit final {
+        // index of the triangle, or -1 if nothing was hit
+        int32_t index = -1;
+
+        // distance along the ray, `P = O + tD`
+        float t = FLT_MAX;
+
+        // barycentric coordinates of the hit, `P = (1-u-v)*v0 + u*v1 + v*v2`
+        float u = 0.0f;
+        float v = 0.0f;
+
+        [[nodiscard]] bool hit() const noexcept {
+            return index >= 0;
+        }
+    };
+
+    // branchless single-AABB slab test
+    //
+    // unlike `lineIntersectsAABB`, this treats the ray as starting at its
+    // origin, so it only intersects if `t1 >= max(t0, 0)`
+    [[nodiscard]] inline LineAABBHittestResult rayIntersectsAABB(PrecomputedRay const& r, AABB const& a) noexcept {
+        glm::vec3 tA = (a.min - r.origin) * r.invDir;
+        glm::vec3 tB = (a.max - r.origin) * r.invDir;
+        glm::vec3 tNear = glm::min(tA, tB);
+        glm::vec3 tFar = glm::max(tA, tB);
+
+        LineAABBHittestResult rv;
+        rv.t0 = std::max(std::max(tNear.x, tNear.y), tNear.z);
+        rv.t1 = std::min(std::min(tFar.x, tFar.y), tFar.z);
+        rv.intersected = rv.t1 >= std::max(rv.t0, 0.0f);
+        return rv;
+    }
+
+    // returns the number of `uint64_t`s needed for a hit mask of `n` primitives
+    [[nodiscard]] inline constexpr size_t hitMaskSize(size_t n) noexcept {
+        return (n + 63) / 64;
+    }
+
+    // returns the closest AABB the ray hits (at `t = max(t0, 0)`, so a ray
+    // that starts inside an AABB hits it at `t = 0`)
+    //
+    // if `hitMask` is non-null, bit `i % 64` of `hitMask[i / 64]` is set iff
+    // the ray hits AABB `i`. It must have `hitMaskSize(aabbs.size())` elements
+    [[nodiscard]] RaycastHit raycastAABBs(PrecomputedRay const&, AABBArray const& aabbs, uint64_t* hitMask = nullptr, SimdLevel = bestSimdLevel()) noexcept;
+
+    // returns the closest sphere the ray hits (at `t = max(t0, 0)`)
+    //
+    // `hitMask` behaves as in `raycastAABBs`
+    [[nodiscard]] RaycastHit raycastSpheres(PrecomputedRay const&, SphereArray const& spheres, uint64_t* hitMask = nullptr, SimdLevel = bestSimdLevel()) noexcept;
+
+    struct RayTriangleHittestResult final {
+        bool intersected;
+        float t;
+
+        // barycentric coordinates, as in `TriangleRaycastHit`
+        float u;
+        float v;
+    };
+
+    // watertight ray-triangle test
+    //
+    // this is Woop, Benthin, and Wald's "Watertight Ray/Triangle Intersection"
+    // (JCGT 2013), which is Möller-Trumbore-like in cost, but computes each
+    // edge test in a way that's shared between the triangles on either side of
+    // the edge, so rays through a shared edge/vertex can't fall between them
+    //
+    // double-sided, and only intersects at `t >= 0`. Assumes `tri` points to
+    // three vertices
+    [[nodiscard]] RayTriangleHittestResult rayIntersectsTriangle(PrecomputedRay const&, glm::vec3 const* tri) noexcept;
+
+    // returns the closest triangle the ray hits
+    //
+    // tests 8 triangles at a time with AVX
+    [[nodiscard]] TriangleRaycastHit raycastTriangles(PrecomputedRay const&, TriangleArray const&, SimdLevel = bestSimdLevel()) noexcept;
+
+    // returns the closest triangle in an indexed mesh that the ray hits
+    //
+    // `positions` is a strided array (`stride` is in bytes), so that it can
+    // point into an array of vertex structs. The returned index is the
+    // triangle's index (i.e. `indices[3*index]` is its first vertex)
+    [[nodiscard]] TriangleRaycastHit raycastIndexedTriangles(PrecomputedRay const&,
+                                                             glm::vec3 const* positions,
+                                                             size_t stride,
+                                                             uint32_t const* indices,
+                                                             size_t numIndices,
+                                                             SimdLevel = bestSimdLevel()) noexcept;
+
+    [[nodiscard]] inline TriangleRaycastHit raycastIndexedTriangles(PrecomputedRay const& r,
+                                                                    glm::vec3 const* positions,
+                                                                    uint32_t const* indices,
+                                                                    size_t numIndices,
+                                                                    SimdLevel level = bestSimdLevel()) noexcept {
+        return raycastIndexedTriangles(r, positions, sizeof(glm::vec3), indices, numIndices, level);
+    }
+
+    // as above, for vertex structs that have a `pos` member (`PlainVert`, etc.)
+    template<typename Vert>
+    [[nodiscard]] inline TriangleRaycastHit raycastIndexedTriangles(PrecomputedRay const& r,
+                                                                    Vert const* verts,
+                                                                    uint32_t const* indices,
+                                                                    size_t numIndices,
+                                                                    SimdLevel level = bestSimdLevel()) noexcept {
+        return raycastIndexedTriangles(r, &verts->pos, sizeof(Vert), indices, numIndices, level);
+    }
+}
@@ -86,6 +86,20 @@ sdl::Texture sdl::CreateTextureFromSurface(SDL_Renderer* r, SDL_Surface* s) {
     return Texture{t};
 }
 
+sdl::Texture sdl::CreateTexture(SDL_Renderer* r, Uint32 format, int access, int w, int h) {
+    SDL_Texture* t = SDL_CreateTexture(r, format, access, w, h);
+    if (t == nullptr) {
+        throw std::runtime_error{"SDL_CreateTexture failed: "s + SDL_GetError()};
+    }
+    return Texture{t};
+}
+
+void sdl::UpdateTexture(SDL_Texture* t, SDL_Rect const* rect, void const* pixels, int pitch) {
+    if (SDL_UpdateTexture(t, rect, pixels, pitch) != 0) {
+        throw std::runtime_error{"SDL_UpdateTexture failed: "s + SDL_GetError()};
+    }
+}
+
 void sdl::RenderCopy(SDL_Renderer* r, SDL_Texture* t, SDL_Rect* src, SDL_Rect* dest) {
     int rv = SDL_RenderCopy(r, t, src, dest);
     if (rv != 0) {
@@ -189,6 +189,7 @@ namespace sdl {
         SDL_Texture* handle;
 
         friend Texture CreateTextureFromSurface(SDL_Renderer* r, SDL_Surface* s);
+        friend Texture CreateTexture(SDL_Renderer* r, Uint32 format, int access, int w, int h);
         Texture(SDL_Texture* _handle) : handle{_handle} {
         }
     public:
@@ -209,6 +210,16 @@ namespace sdl {
     //     https://wiki.libsdl.org/SDL_CreateTextureFromSurface
     Texture CreateTextureFromSurface(SDL_Renderer* r, SDL_Surface* s);
 
+    // RAII'ed version of SDL_CreateTexture:
+    //     https://wiki.libsdl.org/SDL_CreateTexture
+    Texture CreateTexture(SDL_Renderer* r, Uint32 format, int access, int w, int h);
+
+    // https://wiki.libsdl.org/SDL_UpdateTexture
+    //
+    // `pixels` points at the first pixel of `rect` (or of the texture, if
+    // `rect` is nullptr)
+    void UpdateTexture(SDL_Texture* t, SDL_Rect const* rect, void const* pixels, int pitch);
+
     // https://wiki.libsdl.org/SDL_RenderCopy
     void RenderCopy(SDL_Renderer* r, SDL_Texture* t, SDL_Rect* src, SDL_Rect* dest);
 
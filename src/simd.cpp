@@ -0,0 +1,111 @@
+#include "simd.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <initializer_list>
+
+#if defined(GP_SIMD_X86) && defined(_MSC_VER)
+#include <intrin.h>
+
+static bool cpuSupports(gp::SimdLevel level) noexcept {
+    int info[4];
+    __cpuid(info, 0);
+    int maxLeaf = info[0];
+
+    __cpuid(info, 1);
+    bool sse41 = info[2] & (1 << 19);
+    bool osxsave = info[2] & (1 << 27);
+    bool avx = info[2] & (1 << 28);
+    bool fma = info[2] & (1 << 12);
+
+    // the OS must also save the YMM registers on context switches
+    bool ymm = osxsave && (_xgetbv(0) & 0x6) == 0x6;
+
+    // (the OS must also save the ZMM + opmask registers for AVX-512)
+    bool zmm = ymm && (_xgetbv(0) & 0xe6) == 0xe6;
+
+    bool avx2 = false;
+    bool avx512f = false;
+    if (maxLeaf >= 7) {
+        __cpuidex(info, 7, 0);
+        avx2 = info[1] & (1 << 5);
+        avx512f = info[1] & (1 << 16);
+    }
+
+    switch (level) {
+    case gp::SimdLevel::Scalar:
+        return true;
+    case gp::SimdLevel::SSE:
+        return sse41;
+    case gp::SimdLevel::AVX:
+        return avx && ymm;
+    case gp::SimdLevel::AVX2:
+        return avx && ymm && avx2 && fma;
+    case gp::SimdLevel::AVX512:
+        return zmm && avx512f;
+    }
+    return false;
+}
+#elif defined(GP_SIMD_X86)
+static bool cpuSupports(gp::SimdLevel level) noexcept {
+    switch (level) {
+    case gp::SimdLevel::Scalar:
+        return true;
+    case gp::SimdLevel::SSE:
+        return __builtin_cpu_supports("sse4.1");
+    case gp::SimdLevel::AVX:
+        return __builtin_cpu_supports("avx");
+    case gp::SimdLevel::AVX2:
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+    case gp::SimdLevel::AVX512:
+        return __builtin_cpu_supports("avx512f");
+    }
+    return false;
+}
+#else
+static bool cpuSupports(gp::SimdLevel level) noexcept {
+    return level == gp::SimdLevel::Scalar;
+}
+#endif
+
+static gp::SimdLevel detectSimdLevel() noexcept {
+    using gp::SimdLevel;
+
+    SimdLevel cap = SimdLevel::AVX512;
+    if (char const* env = std::getenv("GFXPLAY_SIMD"); env) {
+        for (SimdLevel l : {SimdLevel::Scalar, SimdLevel::SSE, SimdLevel::AVX, SimdLevel::AVX2, SimdLevel::AVX512}) {
+            if (std::strcmp(env, gp::simdLevelName(l)) == 0) {
+                cap = l;
+            }
+        }
+    }
+
+    SimdLevel rv = SimdLevel::Scalar;
+    for (SimdLevel l : {SimdLevel::SSE, SimdLevel::AVX, SimdLevel::AVX2, SimdLevel::AVX512}) {
+        if (l <= cap && cpuSupports(l)) {
+            rv = l;
+        }
+    }
+    return rv;
+}
+
+char const* gp::simdLevelName(SimdLevel level) noexcept {
+    switch (level) {
+    case SimdLevel::Scalar:
+        return "scalar";
+    case SimdLevel::SSE:
+        return "sse";
+    case SimdLevel::AVX:
+        return "avx";
+    case SimdLevel::AVX2:
+        return "avx2";
+    case SimdLevel::AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+gp::SimdLevel gp::bestSimdLevel() noexcept {
+    static SimdLevel const level = detectSimdLevel();
+    return level;
+}
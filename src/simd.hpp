@@ -0,0 +1,56 @@
+#pragma once
+
+// SIMD support
+//
+// the SIMD kernels in gfxplay are compiled for every instruction set they
+// support (via per-function target attributes, so the rest of the codebase
+// doesn't need `-mavx` etc.) and dispatched at runtime, based on what the
+// CPU supports. Non-x86 builds only have the scalar kernels
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define GP_SIMD_X86
+#endif
+
+// marks a function as using AVX(2/-512) instructions
+//
+// MSVC allows intrinsics in any function, so it doesn't need a marker
+#if defined(GP_SIMD_X86) && (defined(__GNUC__) || defined(__clang__))
+#define GP_TARGET_AVX __attribute__((target("avx")))
+#define GP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#define GP_TARGET_AVX512 __attribute__((target("avx512f")))
+#else
+#define GP_TARGET_AVX
+#define GP_TARGET_AVX2
+#define GP_TARGET_AVX512
+#endif
+
+// forces a generic helper to be inlined into the SIMD kernels that call it,
+// so that the kernel-specific code it calls can be compiled (and inlined)
+// with the kernel's instruction set
+#if defined(_MSC_VER)
+#define GP_FORCE_INLINE __forceinline
+#elif defined(__GNUC__) || defined(__clang__)
+#define GP_FORCE_INLINE inline __attribute__((always_inline))
+#else
+#define GP_FORCE_INLINE inline
+#endif
+
+namespace gp {
+
+    // instruction sets that SIMD kernels may be dispatched to, in ascending
+    // order of preference
+    enum class SimdLevel {
+        Scalar = 0,
+        SSE,  // SSE4.1
+        AVX,
+        AVX2,  // AVX2 + FMA
+        AVX512,  // AVX-512F
+    };
+
+    [[nodiscard]] char const* simdLevelName(SimdLevel) noexcept;
+
+    // returns the best SIMD level the CPU (and build) supports
+    //
+    // can be capped with the `GFXPLAY_SIMD` environment variable (e.g.
+    // `GFXPLAY_SIMD=sse`), which is handy for comparing kernels
+    [[nodiscard]] SimdLevel bestSimdLevel() noexcept;
+}
@@ -0,0 +1,201 @@
+#pragma once
+
+#include "app.hpp"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <vector>
+
+// structure-of-arrays (SoA) geometry support
+//
+// the SIMD kernels (culling, raycasting, etc.) process many primitives per
+// instruction, so they need each component of the primitives to be stored
+// contiguously, rather than storing whole primitives contiguously (`AABB`,
+// `Sphere`, etc.)
+namespace gp {
+
+    // SoA array of `AABB`s
+    struct AABBArray final {
+        std::vector<float> minX;
+        std::vector<float> minY;
+        std::vector<float> minZ;
+        std::vector<float> maxX;
+        std::vector<float> maxY;
+        std::vector<float> maxZ;
+
+        AABBArray() = default;
+
+        explicit AABBArray(std::vector<AABB> const& aabbs) {
+            reserve(aabbs.size());
+            for (AABB const& a : aabbs) {
+                push_back(a);
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return minX.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return minX.empty();
+        }
+
+        void reserve(size_t n) {
+            for (std::vector<float>* v : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ}) {
+                v->reserve(n);
+            }
+        }
+
+        void clear() noexcept {
+            for (std::vector<float>* v : {&minX, &minY, &minZ, &maxX, &maxY, &maxZ}) {
+                v->clear();
+            }
+        }
+
+        void push_back(AABB const& a) {
+            minX.push_back(a.min.x);
+            minY.push_back(a.min.y);
+            minZ.push_back(a.min.z);
+            maxX.push_back(a.max.x);
+            maxY.push_back(a.max.y);
+            maxZ.push_back(a.max.z);
+        }
+
+        [[nodiscard]] AABB get(size_t i) const noexcept {
+            return AABB{{minX[i], minY[i], minZ[i]}, {maxX[i], maxY[i], maxZ[i]}};
+        }
+
+        void set(size_t i, AABB const& a) noexcept {
+            minX[i] = a.min.x;
+            minY[i] = a.min.y;
+            minZ[i] = a.min.z;
+            maxX[i] = a.max.x;
+            maxY[i] = a.max.y;
+            maxZ[i] = a.max.z;
+        }
+    };
+
+    // SoA array of `Sphere`s
+    struct SphereArray final {
+        std::vector<float> x;
+        std::vector<float> y;
+        std::vector<float> z;
+        std::vector<float> r;
+
+        SphereArray() = default;
+
+        explicit SphereArray(std::vector<Sphere> const& spheres) {
+            reserve(spheres.size());
+            for (Sphere const& s : spheres) {
+                push_back(s);
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return x.size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return x.empty();
+        }
+
+        void reserve(size_t n) {
+            for (std::vector<float>* v : {&x, &y, &z, &r}) {
+                v->reserve(n);
+            }
+        }
+
+        void clear() noexcept {
+            for (std::vector<float>* v : {&x, &y, &z, &r}) {
+                v->clear();
+            }
+        }
+
+        void push_back(Sphere const& s) {
+            x.push_back(s.origin.x);
+            y.push_back(s.origin.y);
+            z.push_back(s.origin.z);
+            r.push_back(s.radius);
+        }
+
+        [[nodiscard]] Sphere get(size_t i) const noexcept {
+            return Sphere{{x[i], y[i], z[i]}, r[i]};
+        }
+
+        void set(size_t i, Sphere const& s) noexcept {
+            x[i] = s.origin.x;
+            y[i] = s.origin.y;
+            z[i] = s.origin.z;
+            r[i] = s.radius;
+        }
+    };
+
+    // SoA array of triangles
+    struct TriangleArray final {
+        // per-vertex component arrays, indexed by dimension (e.g. `v1[2]`
+        // holds the Z coordinates of each triangle's second vertex)
+        std::array<std::vector<float>, 3> v0;
+        std::array<std::vector<float>, 3> v1;
+        std::array<std::vector<float>, 3> v2;
+
+        TriangleArray() = default;
+
+        // from a triangle list (i.e. every three verts is a triangle)
+        TriangleArray(glm::vec3 const* verts, size_t n) {
+            reserve(n/3);
+            for (size_t i = 0; i + 2 < n; i += 3) {
+                push_back(verts[i], verts[i+1], verts[i+2]);
+            }
+        }
+
+        // from an indexed triangle list
+        TriangleArray(glm::vec3 const* verts, uint32_t const* indices, size_t numIndices) {
+            reserve(numIndices/3);
+            for (size_t i = 0; i + 2 < numIndices; i += 3) {
+                push_back(verts[indices[i]], verts[indices[i+1]], verts[indices[i+2]]);
+            }
+        }
+
+        [[nodiscard]] size_t size() const noexcept {
+            return v0[0].size();
+        }
+
+        [[nodiscard]] bool empty() const noexcept {
+            return v0[0].empty();
+        }
+
+        void reserve(size_t n) {
+            for (std::array<std::vector<float>, 3>* v : {&v0, &v1, &v2}) {
+                for (std::vector<float>& c : *v) {
+                    c.reserve(n);
+                }
+            }
+        }
+
+        void clear() noexcept {
+            for (std::array<std::vector<float>, 3>* v : {&v0, &v1, &v2}) {
+                for (std::vector<float>& c : *v) {
+                    c.clear();
+                }
+            }
+        }
+
+        void push_back(glm::vec3 const& a, glm::vec3 const& b, glm::vec3 const& c) {
+            for (int dim = 0; dim < 3; ++dim) {
+                v0[dim].push_back(a[dim]);
+                v1[dim].push_back(b[dim]);
+                v2[dim].push_back(c[dim]);
+            }
+        }
+
+        [[nodiscard]] std::array<glm::vec3, 3> get(size_t i) const noexcept {
+            return {{
+                {v0[0][i], v0[1][i], v0[2][i]},
+                {v1[0][i], v1[1][i], v1[2][i]},
+                {v2[0][i], v2[1][i], v2[2][i]},
+            }};
+        }
+    };
+}